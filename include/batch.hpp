@@ -0,0 +1,13 @@
+#ifndef BATCH
+#define BATCH
+
+#include <SDL3/SDL_init.h>
+
+#include "util/asr/transcriber.hpp"
+
+// Headless modes (./program --<mode> ...): transcription, the benchmarks, the
+// self checks and patient import/export. False if argv doesn't ask for one,
+// otherwise p_result is how it went
+bool run_batch(int argc, char *argv[], transcriber& p_asr, SDL_AppResult& p_result);
+
+#endif // !BATCH
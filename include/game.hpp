@@ -12,11 +12,34 @@
 #include "util/managers/sound_manager.hpp"
 #include "util/managers/text_manager.hpp"
 
+#include "util/asr/asr_tuner.hpp"
+#include "util/asr/transcriber.hpp"
+
+#include "util/clinic/clinic_dashboard.hpp"
+#include "util/clinic/duplicate_review.hpp"
+#include "util/clinic/name_matcher.hpp"
+#include "util/clinic/patient_analytics.hpp"
+#include "util/clinic/patient_browser.hpp"
+#include "util/clinic/patient_history.hpp"
+#include "util/clinic/patient_records.hpp"
+#include "util/clinic/patient_retriever.hpp"
+#include "util/clinic/patient_tools.hpp"
+
+#include "util/llm/conversation.hpp"
+#include "util/llm/hedged_request.hpp"
+#include "util/llm/llm_router.hpp"
+#include "util/llm/llm_scheduler.hpp"
+#include "util/llm/llm_toolbox.hpp"
+#include "util/llm/response_cache.hpp"
+#include "util/llm/semantic_cache.hpp"
+
 #include <array>
 #include <chrono>
 #include <cmath>
 #include <cstddef>
 #include <cstdio>
+#include <future>
+#include <memory>
 #include <string>
 #include <sys/types.h>
 #include <vector>
@@ -41,6 +64,11 @@ public:
     bool audio = false;
     bool show_text = false;
     audio_capture capture_system;
+    transcriber asr;
+    response_cache llm_cache;
+    semantic_cache llm_semantic_cache;
+    llm_scheduler llm_requests;
+    conversation chat;
 
     // Deinitializer function
     void quit();
@@ -49,11 +77,30 @@ public:
     std::string response;
     std::string clean_resp;
 
+    std::string pending_prompt;
+    std::string pending_context; // Cache context pending_prompt was sent in
+    bool pending_semantic = false; // Answer may be reused for paraphrases, unless it took tool calls
+    std::string pending_semantic_context; // Without the records version, see pending_semantic
+    std::shared_ptr<size_t> pending_tool_calls; // Written by the scheduler's worker
+    std::future<std::string> pending_answer;
+
 private:
     int splash_timer;
     game_state current_state;
 
-    std::vector<patient> record;
+    patient_records records;
+    patient_retriever retriever{records}; // After records, it registers itself as a listener
+    name_matcher names{records};          // Same
+    patient_browser browser{records};
+    patient_history history{records};     // Ctrl+Z / Ctrl+Y
+    patient_analytics analytics{records};
+    clinic_dashboard dashboard{analytics, records};
+    duplicate_review duplicates{history, records};
+    bool show_analytics = false;
+    bool show_duplicates = false;
+    bool show_patients = false;
+    llm_toolbox tools;
+    bool use_tools = true;
 
     bool window = true;
     ImVec4 my_color;
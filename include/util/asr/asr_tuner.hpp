@@ -0,0 +1,56 @@
+#ifndef ASR_TUNER
+#define ASR_TUNER
+
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+#include "transcriber.hpp"
+
+#define ASR_TUNING_PATH "asr_tuning.json"
+
+// Recording with a known-good transcript to score against
+typedef struct asr_reference {
+    std::string wav_path;
+    std::string text;
+} asr_reference;
+
+typedef struct tuning_grid {
+    std::vector<std::string> models;
+    std::vector<u_int32_t> threads;
+    std::vector<u_int32_t> beam_sizes; // 0 = whisper default
+    std::vector<u_int32_t> best_of;    // 0 = whisper default
+} tuning_grid;
+
+typedef struct tuning_result {
+    std::string model;
+    u_int32_t threads;
+    u_int32_t beam_size;
+    u_int32_t best_of;
+    double rtf; // Wall time / audio time, averaged over the references
+    double wer; // Word error rate, averaged over the references
+    bool ok;
+} tuning_result;
+
+// Every tools/ggml-*.bin model, thread counts up to the core count and a few beam settings
+tuning_grid default_tuning_grid(const std::string& p_model_dir = "tools");
+
+// Reference text comes from <wav>.txt, a transcript written by a person
+bool load_reference(const std::string& p_wav_path, asr_reference& p_out);
+
+double word_error_rate(const std::string& p_reference, const std::string& p_hypothesis);
+
+// Replays every reference through every grid point (cache disabled)
+std::vector<tuning_result> run_asr_benchmark(const transcriber_config& p_base,
+                                             const tuning_grid& p_grid,
+                                             const std::vector<asr_reference>& p_references);
+
+// Most accurate result within the real-time-factor budget, fastest one if nothing fits
+const tuning_result* pick_best(const std::vector<tuning_result>& p_results, double p_max_rtf);
+
+// Tuning is stored per machine (hostname + core count)
+std::string host_id();
+bool save_asr_tuning(const std::string& p_path, const tuning_result& p_best, double p_max_rtf);
+bool load_asr_tuning(const std::string& p_path, transcriber_config& p_config);
+
+#endif // !ASR_TUNER
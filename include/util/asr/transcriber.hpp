@@ -0,0 +1,86 @@
+#ifndef TRANSCRIBER
+#define TRANSCRIBER
+
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+#include "transcript.hpp"
+#include "transcript_cache.hpp"
+#include "vad.hpp"
+#include "wav_io.hpp"
+
+typedef struct transcriber_config {
+    std::string whisper_path = "./tools/whisper-cli";
+    std::string model_path = "tools/ggml-base.en.bin";
+    u_int32_t jobs = 0;                   // Concurrent whisper processes, 0 = auto
+    u_int32_t threads_per_job = 0;        // Threads per whisper process, 0 = auto
+    u_int32_t beam_size = 0;              // whisper -bs, 0 = whisper's default
+    u_int32_t best_of = 0;                // whisper -bo, 0 = whisper's default
+    u_int32_t batch_threshold_ms = 60000; // Recordings shorter than this are decoded in one go
+    vad_config vad;
+    bool use_cache = true;                // See transcript_cache
+
+    // Cascade: when set, segments the fast model is unsure about are decoded
+    // again with this (bigger, slower) model
+    std::string cascade_model_path;
+    float cascade_threshold = 0.6f;       // Mean token probability below this gets re-decoded
+    u_int32_t cascade_pad_ms = 250;       // Context added around a re-decoded span
+} transcriber_config;
+
+// Offline transcription through whisper-cli.
+// Long recordings are split at VAD pauses, the pieces are decoded by several
+// whisper processes at once (each one is its own model instance) and the
+// results are stitched back in order with their timestamps shifted to the
+// position of the piece in the original recording.
+class transcriber {
+public:
+    transcriber() = default;
+    explicit transcriber(const transcriber_config& p_config);
+
+    transcript transcribe_file(const std::string& p_path);
+    transcript transcribe(const pcm_buffer& p_pcm);
+
+    transcriber_config& config() { return cfg; }
+    transcript_cache& cache() { return results; }
+
+    // Everything that changes the decoded text, part of the cache key
+    std::string signature() const;
+
+private:
+    transcript run(const pcm_buffer& p_pcm, const std::string& p_source_path);
+    transcript decode_parallel(const pcm_buffer& p_pcm);
+
+    // Fast pass over a whole file followed by the cascade pass, if enabled
+    bool decode_piece(const std::string& p_wav_path,
+                      int64_t p_offset_ms,
+                      u_int32_t p_threads,
+                      std::vector<transcript_segment>& p_out) const;
+
+    // Re-decodes runs of low confidence segments with the cascade model
+    void refine(const std::string& p_wav_path,
+                int64_t p_offset_ms,
+                u_int32_t p_threads,
+                std::vector<transcript_segment>& p_segments) const;
+
+    // Runs whisper on p_wav_path (optionally only [p_from_ms, p_from_ms + p_duration_ms))
+    // and appends its segments shifted by p_offset_ms
+    bool decode(const std::string& p_wav_path,
+                const std::string& p_model_path,
+                int64_t p_offset_ms,
+                u_int32_t p_threads,
+                std::vector<transcript_segment>& p_out,
+                int64_t p_from_ms = 0,
+                int64_t p_duration_ms = 0) const;
+
+    transcriber_config cfg;
+    transcript_cache results;
+};
+
+std::string format_timestamp(int64_t p_ms); // hh:mm:ss.mmm
+
+// Overrides the model paths from AVA_ASR_MODEL / AVA_ASR_CASCADE_MODEL
+void load_asr_environment(transcriber_config& p_config);
+
+#endif // !TRANSCRIBER
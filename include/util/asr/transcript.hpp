@@ -0,0 +1,22 @@
+#ifndef TRANSCRIPT
+#define TRANSCRIPT
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+typedef struct transcript_segment {
+    int64_t from_ms; // Relative to the start of the whole recording
+    int64_t to_ms;
+    std::string text;
+    float confidence = 1.0f; // Mean token probability reported by whisper
+} transcript_segment;
+
+typedef struct transcript {
+    std::vector<transcript_segment> segments;
+    bool ok = false;
+
+    std::string text() const; // Segments joined into one plain string
+} transcript;
+
+#endif // !TRANSCRIPT
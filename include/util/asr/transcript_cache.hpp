@@ -0,0 +1,49 @@
+#ifndef TRANSCRIPT_CACHE
+#define TRANSCRIPT_CACHE
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+
+#include "../lru_cache.hpp"
+#include "transcript.hpp"
+#include "wav_io.hpp"
+
+typedef struct cache_stats {
+    u_int64_t memory_hits;
+    u_int64_t disk_hits;
+    u_int64_t misses;
+    u_int64_t stores;
+    size_t memory_entries;
+
+    double hit_rate() const {
+        u_int64_t lookups = memory_hits + disk_hits + misses;
+        return lookups ? static_cast<double>(memory_hits + disk_hits) / lookups : 0.0;
+    }
+} cache_stats;
+
+// Content addressed transcript cache.
+// Keys are XXH64 of the decoded PCM plus a hash of the model / decoding
+// parameters, so the same audio re-transcribed with the same settings never
+// reaches whisper again. Hot entries live in an in-memory LRU, everything is
+// also written to p_dir so hits survive restarts.
+class transcript_cache {
+public:
+    explicit transcript_cache(const std::string& p_dir = "cache/asr", size_t p_capacity = 128);
+
+    static std::string make_key(const pcm_buffer& p_pcm, const std::string& p_signature);
+
+    bool lookup(const std::string& p_key, transcript& p_out);
+    void store(const std::string& p_key, const transcript& p_transcript);
+
+    cache_stats stats() const;
+
+private:
+    std::string dir;
+    mutable std::mutex mutex;
+    lru_cache<std::string, transcript> memory;
+    cache_stats counters = {0, 0, 0, 0, 0};
+};
+
+#endif // !TRANSCRIPT_CACHE
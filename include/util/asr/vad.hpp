@@ -0,0 +1,29 @@
+#ifndef VAD
+#define VAD
+
+#include <cstddef>
+#include <sys/types.h>
+#include <vector>
+
+#include "wav_io.hpp"
+
+// Energy based voice activity detection, used to cut long recordings at
+// natural pauses so each piece can be decoded independently
+typedef struct vad_config {
+    u_int32_t frame_ms = 30;
+    u_int32_t min_pause_ms = 300;        // Shortest silence we are allowed to cut in
+    u_int32_t target_segment_ms = 30000; // Whisper decodes 30 s windows, aim for that
+    u_int32_t max_segment_ms = 45000;    // Hard cut (at the quietest frame) if nobody pauses
+    float threshold_scale = 2.5f;        // Silence = energy below noise floor * scale
+    bool drop_silent = true;             // Skip segments with no voiced frames at all
+} vad_config;
+
+// Range of samples in the source pcm_buffer
+typedef struct audio_span {
+    size_t first;
+    size_t count;
+} audio_span;
+
+std::vector<audio_span> split_at_pauses(const pcm_buffer& p_pcm, const vad_config& p_config);
+
+#endif // !VAD
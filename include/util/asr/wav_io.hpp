@@ -0,0 +1,29 @@
+#ifndef WAV_IO
+#define WAV_IO
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+// Decoded PCM, always downmixed to mono float in [-1, 1]
+typedef struct pcm_buffer {
+    std::vector<float> samples;
+    u_int32_t sample_rate;
+} pcm_buffer;
+
+// Reads 8/16/24/32-bit integer PCM and 32-bit float WAV files
+bool read_wav(const std::string& p_path, pcm_buffer& p_out);
+
+// Writes p_count mono samples starting at p_first as 16-bit PCM
+bool write_wav(const std::string& p_path,
+               const pcm_buffer& p_pcm,
+               size_t p_first,
+               size_t p_count);
+
+inline double pcm_duration_ms(const pcm_buffer& p_pcm) {
+    return p_pcm.sample_rate ? 1000.0 * p_pcm.samples.size() / p_pcm.sample_rate : 0.0;
+}
+
+#endif // !WAV_IO
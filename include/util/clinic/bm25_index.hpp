@@ -0,0 +1,78 @@
+#ifndef BM25_INDEX
+#define BM25_INDEX
+
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+typedef struct bm25_config {
+    float k1 = 1.2f; // Term frequency saturation
+    float b = 0.75f; // Document length normalization
+} bm25_config;
+
+// A piece of a document, terms in it count p_weight times (BM25F style field boost)
+typedef struct bm25_field {
+    std::string_view text;
+    float weight = 1.0f;
+} bm25_field;
+
+// Incremental BM25 inverted index.
+// Documents can be added, replaced and removed one at a time; a removal only
+// touches the postings of that document's own terms. Terms are lower cased
+// runs of letters/digits (bytes >= 0x80 count as letters, so UTF-8 names
+// survive), everything else separates them.
+class bm25_index {
+public:
+    typedef u_int64_t doc_id;
+
+    explicit bm25_index(const bm25_config& p_config = {}) : cfg(p_config) { }
+
+    void add(doc_id p_id, std::initializer_list<bm25_field> p_fields); // Replaces p_id if present
+    bool remove(doc_id p_id);
+    void clear();
+
+    // Best p_k documents for p_query, highest score first
+    std::vector<std::pair<doc_id, float>> search(std::string_view p_query, size_t p_k) const;
+
+    size_t size() const { return slot_of.size(); }
+    size_t terms() const { return term_ids.size(); }
+
+    // Calls p_func(term) for each term of p_text
+    static void tokenize(std::string_view p_text, const std::function<void(std::string_view)>& p_func);
+
+private:
+    // Transparent so queries can probe term_ids with a string_view
+    struct term_hash {
+        using is_transparent = void;
+        size_t operator()(std::string_view p_term) const noexcept {
+            return std::hash<std::string_view>{}(p_term);
+        }
+    };
+
+    typedef struct posting {
+        u_int32_t slot;
+        float tf; // Weighted
+    } posting;
+
+    typedef struct document {
+        doc_id id;
+        float length;
+        std::vector<u_int32_t> terms; // Distinct, to find our postings again on removal
+    } document;
+
+    bm25_config cfg;
+    std::unordered_map<std::string, u_int32_t, term_hash, std::equal_to<>> term_ids;
+    std::vector<std::vector<posting>> postings; // By term id
+    std::vector<document> docs;                 // By slot
+    std::vector<u_int32_t> free_slots;
+    std::unordered_map<doc_id, u_int32_t> slot_of;
+    double total_length = 0.0;
+};
+
+#endif // !BM25_INDEX
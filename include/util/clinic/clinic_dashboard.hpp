@@ -0,0 +1,55 @@
+#ifndef CLINIC_DASHBOARD
+#define CLINIC_DASHBOARD
+
+#include <chrono>
+#include <cstddef>
+#include <sys/types.h>
+
+#include "patient_analytics.hpp"
+#include "patient_records.hpp"
+
+typedef struct dashboard_stats {
+    u_int64_t patients;  // Matching the filter
+    double summary_ms;   // Last recompute
+    size_t recomputes;
+} dashboard_stats;
+
+// Clinic analytics window: ages and birth years as histograms and the
+// gender split, for the patients in an age, gender and birth year range.
+// Recomputed by patient_analytics::summarize() when the filter changes, and
+// at most four times a second while the records keep changing (an import),
+// otherwise the last summary is drawn. Main thread only.
+class clinic_dashboard {
+public:
+    clinic_dashboard(const patient_analytics& p_analytics, const patient_records& p_records)
+        : analytics(p_analytics), records(p_records) {}
+
+    // Between ImGui::NewFrame() and ImGui::Render()
+    void show(bool* p_open);
+
+    dashboard_stats stats() const;
+
+private:
+    static constexpr int AGE_BARS = 21;    // Five years each, the last 100 and over
+    static constexpr int DECADE_BARS = 13; // 1900s to 2020s
+
+    analytics_filter filter() const; // From the controls
+    void refresh();
+
+    const patient_analytics& analytics;
+    const patient_records& records;
+
+    int ages[2] = {0, 100};        // 100 at the top means no upper bound
+    int gender = 0;                // 0 both, then enum gender + 1
+    int born[2] = {FIRST_BIRTH_YEAR, 2029};
+
+    clinic_summary summary{};
+    analytics_filter summarized;   // The filter summary is for
+    u_int64_t summary_version = ~0ull;
+    std::chrono::steady_clock::time_point summary_at;
+    float age_bars[AGE_BARS] = {};
+    float decade_bars[DECADE_BARS] = {};
+    size_t recomputes = 0;
+};
+
+#endif // !CLINIC_DASHBOARD
@@ -0,0 +1,61 @@
+#ifndef DUPLICATE_FINDER
+#define DUPLICATE_FINDER
+
+#include <cstddef>
+#include <sys/types.h>
+#include <vector>
+
+#include "../typedefs.hpp"
+#include "patient_history.hpp"
+#include "patient_records.hpp"
+
+typedef struct dedup_config {
+    size_t bands = 30;        // LSH bands, more finds less alike pairs
+    size_t rows = 5;          // MinHash values per band, more keeps unrelated pairs apart
+    size_t max_bucket = 256;  // Bigger buckets (hundreds sharing one band) are skipped
+    float min_score = 0.75f;  // Pairs scored lower aren't suggested
+    size_t threads = 0;       // 0 for one per core
+} dedup_config;
+
+typedef struct duplicate_pair {
+    u_int64_t keep;  // Registered first (lower id)
+    u_int64_t drop;
+    float score;     // See score_duplicate()
+} duplicate_pair;
+
+typedef struct dedup_result {
+    std::vector<duplicate_pair> pairs; // Best first
+    size_t patients;
+    size_t candidates;      // Distinct pairs that shared a bucket, all of them scored
+    size_t skipped_buckets;
+    double signature_ms;
+    double bucket_ms;
+    double score_ms;
+    double total_ms;
+} dedup_result;
+
+// Patients that are probably one person registered twice, without comparing
+// every pair.
+//
+// Each patient becomes a set of shingles: name trigrams (see normalize_name)
+// salted with the birth year, the date of birth, phone number and email
+// (four copies each, so they weigh about as much as the name), and address
+// word pairs. A MinHash signature of bands * rows values estimates how much
+// two sets overlap; patients with one whole band in common share a bucket
+// and become a candidate pair, so only pairs that are already alike get
+// compared. The signatures, the buckets of each band and the candidates'
+// scores are each spread over p_config.threads threads.
+//
+// Reads a snapshot (see patient_history), so it can run on any thread while
+// the records keep changing.
+dedup_result find_duplicates(const patient_snapshot& p_snapshot, const dedup_config& p_config = {});
+
+// 0 to 1: the weighted agreement of name (edit distance), date of birth,
+// phone, email and address over the fields both records have
+float score_duplicate(const patient& p_a, const patient& p_b);
+
+// Fills p_keep's empty fields from p_drop, then removes p_drop. False if
+// either is gone, or the store can't take the merged p_keep (p_drop stays)
+bool merge_duplicate(patient_records& p_records, u_int64_t p_keep, u_int64_t p_drop);
+
+#endif // !DUPLICATE_FINDER
@@ -0,0 +1,56 @@
+#ifndef DUPLICATE_REVIEW
+#define DUPLICATE_REVIEW
+
+#include <cstddef>
+#include <future>
+#include <sys/types.h>
+#include <vector>
+
+#include "duplicate_finder.hpp"
+#include "patient_history.hpp"
+#include "patient_records.hpp"
+
+typedef struct review_stats {
+    size_t suggestions; // Still waiting for a decision
+    size_t merged;
+    size_t dismissed;
+    size_t candidates;  // Of the last search
+    double search_ms;
+    bool searching;
+} review_stats;
+
+// Merge suggestions window: looks for duplicates on a worker thread over the
+// latest snapshot, so the records stay editable meanwhile, and lists the
+// pairs best first for someone to merge (see merge_duplicate) or dismiss.
+// Pairs one of whose patients has gone since are dropped as they scroll by.
+// Main thread only.
+class duplicate_review {
+public:
+    duplicate_review(patient_history& p_history, patient_records& p_records)
+        : history(p_history), records(p_records) {}
+    ~duplicate_review(); // Waits for a search in progress
+
+    duplicate_review(const duplicate_review&) = delete;
+    duplicate_review& operator = (const duplicate_review&) = delete;
+
+    // Between ImGui::NewFrame() and ImGui::Render()
+    void show(bool* p_open);
+
+    review_stats stats() const;
+
+private:
+    void draw_patient(const patient& p_patient);
+
+    patient_history& history;
+    patient_records& records;
+    dedup_config cfg;
+    std::future<dedup_result> search;
+    std::vector<duplicate_pair> pending; // Best first
+    size_t candidates = 0;
+    double search_ms = 0.0;
+    bool searched = false;
+    size_t merged = 0;
+    size_t dismissed = 0;
+};
+
+#endif // !DUPLICATE_REVIEW
@@ -0,0 +1,127 @@
+#ifndef ID_HASH
+#define ID_HASH
+
+#include <cstddef>
+#include <sys/types.h>
+#include <vector>
+
+// Open addressing u_int64_t -> u_int64_t map for record ids: one flat array
+// of 16 byte cells, linear probing, deletion by shifting the rest of the
+// cluster back (no tombstones, so probes stay short after heavy churn).
+// A third of the memory and a fraction of the cache misses of an
+// unordered_map at ten million ids. Values must be below ~0ull.
+// Not thread safe, the owners lock around it.
+class id_hash {
+public:
+    bool find(u_int64_t p_id, u_int64_t& p_value) const {
+        if (cells.empty()) {
+            return false;
+        }
+        for (size_t i = home(p_id);; i = (i + 1) & mask) {
+            const cell& at = cells[i];
+            if (!at.stored) {
+                return false;
+            }
+            if (at.id == p_id) {
+                p_value = at.stored - 1;
+                return true;
+            }
+        }
+    }
+
+    void assign(u_int64_t p_id, u_int64_t p_value) {
+        if ((entries + 1) * 4 > cells.size() * 3) {
+            rehash(cells.empty() ? 16 : cells.size() * 2);
+        }
+        for (size_t i = home(p_id);; i = (i + 1) & mask) {
+            cell& at = cells[i];
+            if (!at.stored) {
+                at = {p_id, p_value + 1};
+                entries++;
+                return;
+            }
+            if (at.id == p_id) {
+                at.stored = p_value + 1;
+                return;
+            }
+        }
+    }
+
+    bool erase(u_int64_t p_id) {
+        if (cells.empty()) {
+            return false;
+        }
+        size_t hole = home(p_id);
+        while (cells[hole].id != p_id || !cells[hole].stored) {
+            if (!cells[hole].stored) {
+                return false;
+            }
+            hole = (hole + 1) & mask;
+        }
+
+        // Pull back every later cell of the cluster that may live in the hole
+        for (size_t next = (hole + 1) & mask; cells[next].stored; next = (next + 1) & mask) {
+            size_t want = home(cells[next].id);
+            if (((next - want) & mask) >= ((next - hole) & mask)) {
+                cells[hole] = cells[next];
+                hole = next;
+            }
+        }
+        cells[hole].stored = 0;
+        entries--;
+        return true;
+    }
+
+    void reserve(size_t p_entries) {
+        size_t wanted = 16;
+        while (wanted * 3 < p_entries * 4) {
+            wanted *= 2;
+        }
+        if (wanted > cells.size()) {
+            rehash(wanted);
+        }
+    }
+
+    void clear() {
+        cells.clear();
+        cells.shrink_to_fit();
+        mask = 0;
+        entries = 0;
+    }
+
+    size_t size() const { return entries; }
+    size_t memory() const { return cells.capacity() * sizeof(cell); }
+
+private:
+    typedef struct cell {
+        u_int64_t id;
+        u_int64_t stored; // Value + 1, 0 marks a free cell
+    } cell;
+
+    // Ids are mostly sequential, mix them so neighbours don't share a cluster
+    size_t home(u_int64_t p_id) const {
+        p_id ^= p_id >> 33;
+        p_id *= 0xFF51AFD7ED558CCDull;
+        p_id ^= p_id >> 33;
+        return static_cast<size_t>(p_id) & mask;
+    }
+
+    void rehash(size_t p_cells) {
+        std::vector<cell> old;
+        old.swap(cells);
+        cells.assign(p_cells, cell{0, 0});
+        mask = p_cells - 1;
+        entries = 0;
+        for (const cell& at : old) {
+            if (at.stored) {
+                assign(at.id, at.stored - 1);
+            }
+        }
+    }
+
+    std::vector<cell> cells;
+    size_t mask = 0;
+    size_t entries = 0;
+};
+
+#endif // !ID_HASH
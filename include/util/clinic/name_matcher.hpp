@@ -0,0 +1,96 @@
+#ifndef NAME_MATCHER
+#define NAME_MATCHER
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <unordered_map>
+#include <vector>
+
+#include "id_hash.hpp"
+#include "patient_records.hpp"
+
+typedef struct fuzzy_config {
+    size_t top_k = 5;
+    size_t candidates = 512;   // Names ranked by shared trigrams that get an edit distance
+    u_int32_t max_distance = 0; // Edits allowed, 0 picks by length: 1 up to 4 letters, 2 up to 9, then 3
+} fuzzy_config;
+
+typedef struct fuzzy_stats {
+    size_t names;
+    size_t dead;         // Replaced or removed, dropped by the next rebuild
+    size_t grams;
+    size_t last_candidates;
+    double last_lookup_us;
+} fuzzy_stats;
+
+typedef struct name_match {
+    u_int64_t id = 0;
+    u_int32_t distance = 0; // Edits between the query and the closest words of the name
+} name_match;
+
+// Typo tolerant name search, for names as the speech recognizer spells
+// them ("Ode" for Odeh).
+//
+// Every normalized name (see normalize_name) is split into trigrams, with a
+// space on both ends so word starts and ends count, and each trigram lists
+// the names containing it. A query counts shared trigrams over those lists,
+// keeps the best cfg.candidates names and ranks them by edit distance to the
+// query, computed 64 letters at a time (Myers' bit-parallel algorithm) and
+// given up as soon as it can't stay within the bound. A query of n words is
+// compared with every n consecutive words of a name, so "ode" finds
+// "Sami Odeh" and "sami ode" does too.
+//
+// Listens to a patient_records like patient_retriever. Replaced and removed
+// names are only marked dead and skipped; the lists are rebuilt once the
+// dead outnumber the live ones. match() is safe from other threads under
+// records.read_lock().
+class name_matcher : public patient_listener {
+public:
+    explicit name_matcher(patient_records& p_records, const fuzzy_config& p_config = {});
+    ~name_matcher() override;
+
+    name_matcher(const name_matcher&) = delete;
+    name_matcher& operator = (const name_matcher&) = delete;
+
+    // Closest first, then most shared trigrams; p_k of 0 uses cfg.top_k
+    std::vector<name_match> match(std::string_view p_query, size_t p_k = 0) const;
+
+    fuzzy_stats stats() const;
+
+    void on_upsert(const patient& p_patient) override;
+    void on_remove(u_int64_t p_id) override;
+    void on_clear() override;
+
+    // Levenshtein distance, or p_max + 1 once it's known to be more than p_max
+    static u_int32_t distance(std::string_view p_a, std::string_view p_b, u_int32_t p_max);
+
+private:
+    typedef struct entry {
+        u_int64_t id;
+        u_int32_t offset; // Normalized name in text
+        u_int32_t length;
+    } entry;
+
+    template <typename F>
+    static void each_gram(std::string_view p_name, F&& p_func);
+    void add(u_int64_t p_id, std::string_view p_name);
+    void forget(u_int64_t p_id);
+    void rebuild(); // Drops dead entries
+
+    patient_records& records;
+    fuzzy_config cfg;
+    std::vector<entry> entries;   // Slot order, dead ones have length 0
+    std::string text;             // Normalized names, back to back
+    id_hash slot_of;              // Live id -> slot
+    std::unordered_map<u_int32_t, std::vector<u_int32_t>> postings; // Trigram -> slots
+    size_t dead = 0;
+    std::string scratch;
+
+    mutable std::atomic<size_t> last_candidates = 0;
+    mutable std::atomic<double> last_lookup_us = 0.0;
+};
+
+#endif // !NAME_MATCHER
@@ -0,0 +1,78 @@
+#ifndef PATIENT_BROWSER
+#define PATIENT_BROWSER
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <vector>
+
+#include "patient_records.hpp"
+
+typedef struct browser_stats {
+    size_t rows;     // In the table, after the name filter
+    size_t drawn;    // Rows submitted last frame
+    double sort_ms;  // Last sort order built
+    double draw_us;  // Last frame's table
+} browser_stats;
+
+// Patient table window that stays smooth at millions of records.
+//
+// Only the rows in view are submitted (ImGuiListClipper) and only their
+// cells are formatted, straight from the hot and cold columns. Sorting
+// never moves records: each column gets a permutation of store slots, built
+// the first time the table is sorted by it and reused (backwards when
+// descending) until the records change. The name filter goes through the
+// prefix index, its matches are put in table order by their rank in the
+// permutation. Main thread only, it reads records without locking.
+class patient_browser {
+public:
+    explicit patient_browser(const patient_records& p_records) : records(p_records) {}
+
+    // Between ImGui::NewFrame() and ImGui::Render()
+    void show(bool* p_open);
+
+    browser_stats stats() const;
+
+private:
+    typedef enum browser_column {
+        COLUMN_ID,
+        COLUMN_NAME,
+        COLUMN_GENDER,
+        COLUMN_AGE,
+        COLUMN_BORN,
+        COLUMN_PHONE,
+        COLUMN_EMAIL,
+        COLUMN_COUNT
+    } browser_column;
+
+    // Slots by one column, ascending
+    typedef struct sort_order {
+        std::vector<u_int32_t> slots;
+        std::vector<u_int32_t> rank; // Position of each slot in slots
+    } sort_order;
+
+    const sort_order& order(int p_column);
+    void update_view(); // Redoes the filter and sort if they or the records changed
+    u_int32_t slot_at(size_t p_row) const;
+    void draw_row(const patient_hot& p_row);
+
+    const patient_records& records;
+    sort_order orders[COLUMN_COUNT];
+    u_int64_t orders_version = ~0ull;  // records.version() the orders are for
+
+    int sort_column = -1;              // Storage order when < 0
+    bool descending = false;
+    char query[128] = "";
+    std::string applied_query;
+    u_int64_t view_version = ~0ull;
+    int view_column = -1;
+    bool view_descending = false;
+    std::vector<u_int32_t> filtered;   // Slots in table order while a filter is set
+
+    size_t drawn = 0;
+    double sort_ms = 0.0;
+    double draw_us = 0.0;
+};
+
+#endif // !PATIENT_BROWSER
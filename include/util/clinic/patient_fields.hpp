@@ -0,0 +1,33 @@
+#ifndef PATIENT_FIELDS
+#define PATIENT_FIELDS
+
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+
+#include "../typedefs.hpp"
+
+const char* gender_name(u_int8_t p_gender); // "male" / "female"
+
+// Dates as one integer, (year << 9) | (month << 5) | day, so they compare
+// in calendar order. 0 means unknown
+u_int32_t pack_date(u_int32_t p_year, u_int32_t p_month, u_int32_t p_day);
+inline u_int32_t date_year(u_int32_t p_date) { return p_date >> 9; }
+inline u_int32_t date_month(u_int32_t p_date) { return (p_date >> 5) & 0xF; }
+inline u_int32_t date_day(u_int32_t p_date) { return p_date & 0x1F; }
+
+// "1990-04-02" (or 1990/04/02, 19900402), false for anything else
+bool parse_date(std::string_view p_text, u_int32_t& p_date);
+std::string format_date(u_int32_t p_date); // "1990-04-02", "" when unknown
+
+// Lowercase ASCII letters and digits, every run of anything else one space,
+// no leading space. p_keep_end keeps a trailing one (a typed "ann " asks for
+// the whole word). Accented Latin-1 letters are spelled in ASCII (Zoë is
+// zoe, ß is ss), other UTF-8 sequences pass through unchanged
+void normalize_name(std::string_view p_text, std::string& p_out, bool p_keep_end = false);
+
+// Migration from the fixed size layout; false if its date of birth didn't
+// parse (the rest is still converted, the date is left unknown)
+bool from_legacy(const legacy_patient& p_old, patient& p_new);
+
+#endif // !PATIENT_FIELDS
@@ -0,0 +1,112 @@
+#ifndef PATIENT_HISTORY
+#define PATIENT_HISTORY
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <sys/types.h>
+#include <vector>
+
+#include "../typedefs.hpp"
+#include "patient_records.hpp"
+#include "persistent_map.hpp"
+
+typedef struct history_config {
+    size_t depth = 256; // Commits that can be undone
+} history_config;
+
+typedef struct history_stats {
+    size_t patients;
+    size_t undo;         // Commits that can be undone
+    size_t redo;
+    u_int64_t version;   // records.version() of the current snapshot
+    size_t last_changes; // Records the last undo or redo wrote
+    double last_travel_ms;
+} history_stats;
+
+// The records as they were after one commit. Immutable, copying one copies a
+// pointer; safe to keep and read from any thread without locking anything
+class patient_snapshot {
+public:
+    const patient* find(u_int64_t p_id) const {
+        const std::shared_ptr<const patient>* found = patients.find(p_id);
+        return found ? found->get() : nullptr;
+    }
+    size_t size() const { return patients.size(); }
+    u_int64_t version() const { return number; } // records.version() it was taken at
+
+    // Every patient, in no particular order
+    template <typename F>
+    void each(F&& p_visit) const {
+        patients.each([&](u_int64_t, const std::shared_ptr<const patient>& p_patient) { p_visit(*p_patient); });
+    }
+
+private:
+    friend class patient_history;
+
+    persistent_map<std::shared_ptr<const patient>> patients;
+    u_int64_t number = 0;
+};
+
+// Versions of a patient_records: a snapshot per commit, undo and redo.
+//
+// Listens to the records and keeps every patient in a persistent_map as
+// well, so a commit only copies the few nodes on the paths it changed and
+// the version before it stays intact next to it. snapshot() hands the latest
+// one to any thread: search or export can read a consistent state for as
+// long as they like while the writer carries on. Undo and redo move to
+// another version and write only the records that differ from it (found by
+// comparing the two trees, skipping every shared subtree) back through
+// patient_records, so the store, the indexes and the other listeners follow.
+// Reopening the store starts a new history. Changes, undo and redo come from
+// the writer thread.
+//
+// The tree holds a copy of every patient, about 200 bytes each (200 MB for
+// a million), so it's only built when first needed: by the first change
+// (from the records as they were just before it), undo or snapshot(). Until
+// then opening and browsing cost nothing extra.
+class patient_history : public patient_listener {
+public:
+    explicit patient_history(patient_records& p_records, const history_config& p_config = {});
+    ~patient_history() override;
+
+    patient_history(const patient_history&) = delete;
+    patient_history& operator = (const patient_history&) = delete;
+
+    // The first call may build the tree and has to come from the writer
+    // thread, the snapshot it returns can go anywhere
+    patient_snapshot snapshot();
+
+    bool undo(); // False when there's nothing to undo, or the store couldn't take it (the history starts over)
+    bool redo();
+    bool can_undo() const { return current > 0; }
+    bool can_redo() const { return current + 1 < versions.size(); }
+
+    history_stats stats() const;
+
+    void on_begin() override;
+    void on_upsert(const patient& p_patient) override;
+    void on_remove(u_int64_t p_id) override;
+    void on_clear() override;
+    void on_commit(bool p_reloaded) override;
+
+private:
+    void build(); // versions[0] from the records as they are
+    bool travel(size_t p_to); // Makes versions[p_to] the records, false if the store couldn't take it
+    void publish();
+
+    patient_records& records;
+    history_config cfg;
+    persistent_map<std::shared_ptr<const patient>> working; // Being changed by the commit in progress
+    u_int64_t edit = 1;                 // working's edit tag, bumped once it's been shared
+    std::vector<patient_snapshot> versions; // Oldest first
+    size_t current = 0;                 // versions[current] is what the records hold
+    bool built = false;                 // versions and working follow the records
+    bool changing = false;              // Between on_begin() and on_commit() of an edit
+    bool travelling = false;            // Changes are undo or redo writing a version back
+    std::atomic<std::shared_ptr<const patient_snapshot>> published; // versions[current], for other threads
+    size_t last_changes = 0;
+    double last_travel_ms = 0.0;
+};
+
+#endif // !PATIENT_HISTORY
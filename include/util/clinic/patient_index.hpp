@@ -0,0 +1,80 @@
+#ifndef PATIENT_INDEX
+#define PATIENT_INDEX
+
+#include <atomic>
+#include <compare>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <vector>
+
+#include "../typedefs.hpp"
+#include "patient_store.hpp"
+#include "sorted_index.hpp"
+
+typedef struct index_stats {
+    size_t name_keys;
+    size_t date_keys;
+    size_t memory;       // Bytes, both indexes
+    double build_ms;
+    double last_lookup_us;
+    bool built;
+} index_stats;
+
+// Secondary indexes over a patient_store (its id hash is the primary one):
+// normalized name prefixes for type-ahead and date of birth for ranges.
+//
+// Every word of a normalized name (see normalize_name) is a key, so "doe",
+// "jane" and "jane d" all find Jane Doe. Keys are the first 16 bytes from
+// the word on, packed big endian into two integers so they compare like the
+// text; a longer prefix is checked against the record's name. Unknown dates
+// of birth aren't indexed.
+//
+// Built on the first query (open() doesn't pay for it) and then kept up to
+// date per change by patient_records, under the store's write lock: forget()
+// before a record changes or goes, add() after it's stored. Queries come
+// from the writer thread or readers holding the store's read lock.
+class patient_index {
+public:
+    explicit patient_index(const patient_store& p_store) : store(p_store) {}
+
+    patient_index(const patient_index&) = delete;
+    patient_index& operator = (const patient_index&) = delete;
+
+    // Up to p_limit ids, in key order
+    std::vector<u_int64_t> with_name_prefix(std::string_view p_prefix, size_t p_limit) const;
+    std::vector<u_int64_t> born_between(u_int32_t p_from, u_int32_t p_to, size_t p_limit) const; // Both packed, inclusive
+    size_t count_born_between(u_int32_t p_from, u_int32_t p_to) const;
+
+    void forget(u_int64_t p_id); // Before the record changes
+    void add(const patient& p_patient);
+    void clear(); // The store was emptied
+    void reset(); // The store was reloaded, rebuilt on the next query
+
+    index_stats stats() const;
+
+private:
+    typedef struct name_key {
+        u_int64_t head = 0;
+        u_int64_t tail = 0;
+        auto operator <=> (const name_key&) const = default;
+    } name_key;
+
+    static name_key pack(std::string_view p_text, unsigned char p_fill);
+    template <typename F>
+    static void each_word(std::string_view p_name, F&& p_func);
+    void build() const;
+
+    const patient_store& store;
+    mutable sorted_index<name_key> names;
+    mutable sorted_index<u_int32_t> dates;
+    mutable std::atomic<bool> built = false;
+    mutable std::mutex build_mutex;
+    mutable double build_ms = 0.0;
+    mutable std::atomic<double> last_lookup_us = 0.0;
+    std::string scratch; // Writer side normalization
+};
+
+#endif // !PATIENT_INDEX
@@ -0,0 +1,43 @@
+#ifndef PATIENT_IO
+#define PATIENT_IO
+
+#include <cstddef>
+#include <string>
+#include <sys/types.h>
+
+#include "patient_history.hpp"
+#include "patient_records.hpp"
+
+typedef struct import_config {
+    size_t threads = 0;              // Parsers, 0 for one per core
+    size_t chunk_bytes = 1ull << 20; // Lines handed to a parser at once
+} import_config;
+
+typedef struct io_stats {
+    u_int64_t records;  // Imported or exported
+    u_int64_t rejected; // Lines (or array items) that weren't a patient
+    u_int64_t bytes;
+    double ms;
+    bool ok;            // The file could be read or written
+} io_stats;
+
+// Reads patients from p_path into p_records, replacing any with the same id.
+// Newline delimited JSON (one object per line, as export_patients writes
+// it) is split into chunks at line ends and parsed on p_config.threads
+// threads while the previous chunks are stored, each chunk in one commit. A
+// file that starts with '[' is taken as one array of objects and streamed
+// through a single parser. Either way nothing builds a JSON DOM and at most
+// a few chunks are in memory. Objects use the get_patient tool's fields
+// (id, name, gender, age, date_of_birth, email, phone, address); id is
+// required, unknown fields are ignored, bad lines are counted and skipped.
+io_stats import_patients(patient_records& p_records, const std::string& p_path, const import_config& p_config = {});
+
+// Writes every patient to p_path as newline delimited JSON, streamed from
+// the columns. Goes to p_path.tmp first and is renamed over p_path when
+// complete. Holds p_records.read_lock() throughout
+io_stats export_patients(const patient_records& p_records, const std::string& p_path);
+// Same from a snapshot (see patient_history), from any thread without
+// holding up the writer. Lines come in no particular order
+io_stats export_patients(const patient_snapshot& p_snapshot, const std::string& p_path);
+
+#endif // !PATIENT_IO
@@ -0,0 +1,104 @@
+#ifndef PATIENT_RECORDS
+#define PATIENT_RECORDS
+
+#include <cstddef>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <vector>
+
+#include "../typedefs.hpp"
+#include "patient_fields.hpp"
+#include "patient_index.hpp"
+#include "patient_store.hpp"
+
+// Gets told about every change to a patient_records, so derived structures
+// (search indexes, statistics...) are updated per record instead of rebuilt
+class patient_listener {
+public:
+    virtual ~patient_listener() = default;
+
+    // Before a change (not a reload) touches the store, under the write
+    // lock: the records are still as they were
+    virtual void on_begin() {}
+    virtual void on_upsert(const patient& p_patient) = 0; // Added, or replaced an older version
+    virtual void on_remove(u_int64_t p_id) = 0;
+    virtual void on_clear() = 0;
+    // After every complete change (a batch is one), still under the write
+    // lock. p_reloaded when the records were replaced by what's on disk
+    // (open, close) or just replayed to a new listener rather than edited
+    virtual void on_commit(bool p_reloaded) { (void)p_reloaded; }
+};
+
+// The clinic's patients, keyed by patient::id.
+// Kept in a patient_store: memory only until open(), durable after.
+// Stored in columns (removal swaps the last record in): all() is the hot
+// column as a plain span for anything that wants to scan, cold() and text()
+// reach the rest of a row, get() / load() copy a whole patient out.
+// Changes come from the main thread, which can read without locking; other
+// threads (LLM tool handlers) hold read_lock() while they read.
+class patient_records {
+public:
+    // Loads p_dir (see patient_store), listeners are sent the loaded records
+    bool open(const std::string& p_dir, const store_config& p_config = {});
+    void close();
+    bool flush() { return store.flush(); }
+
+    std::shared_lock<std::shared_mutex> read_lock() const { return store.read_lock(); }
+    u_int64_t version() const { return changes; } // Bumped by every change
+
+    // Upserts are false, and skip the patients, the store can't take (its string arena is full, out of memory)
+    bool upsert(const patient& p_patient);
+    bool upsert(std::span<const patient> p_patients); // One commit for all of them
+    bool remove(u_int64_t p_id);
+    size_t remove(std::span<const u_int64_t> p_ids); // One commit, returns how many were there
+    // Upserts then removals as one commit (one undo step), p_removed gets how many were there.
+    // If an upsert fails, the removals aren't made
+    bool change(std::span<const patient> p_upserts, std::span<const u_int64_t> p_removals,
+                size_t* p_removed = nullptr);
+    void clear();
+
+    // Rows and text are valid until the next change
+    const patient_hot* find(u_int64_t p_id) const { return store.find(p_id); }
+    std::span<const patient_hot> all() const { return store.all(); }
+    const patient_cold& cold(const patient_hot& p_row) const { return store.cold(p_row); }
+    std::string_view text(string_ref p_ref) const { return store.text(p_ref); }
+
+    bool get(u_int64_t p_id, patient& p_patient) const; // False if there's no such patient
+    void load(const patient_hot& p_row, patient& p_patient) const { store.load(p_row, p_patient); }
+    size_t size() const { return store.size(); }
+
+    // Secondary indexes (see patient_index), built by the first of these
+    std::vector<u_int64_t> with_name_prefix(std::string_view p_prefix, size_t p_limit) const {
+        return index.with_name_prefix(p_prefix, p_limit);
+    }
+    std::vector<u_int64_t> born_between(u_int32_t p_from, u_int32_t p_to, size_t p_limit) const {
+        return index.born_between(p_from, p_to, p_limit);
+    }
+    size_t count_born_between(u_int32_t p_from, u_int32_t p_to) const { return index.count_born_between(p_from, p_to); }
+
+    store_stats storage() const { return store.stats(); }
+    index_stats indexes() const { return index.stats(); }
+
+    // Listeners see every change made after they're added, p_replay first
+    // sends them what's already there
+    void add_listener(patient_listener* p_listener, bool p_replay = true);
+    void remove_listener(patient_listener* p_listener);
+
+private:
+    void reload(); // Listeners start over from what's stored, caller holds the write lock
+    void begin();  // Listeners' on_begin(), caller holds the write lock
+    void unchanged(u_int64_t p_id); // An upsert failed, the store's version of p_id back into the index
+
+    patient_store store;
+    patient_index index{store};
+    std::vector<patient_listener*> listeners;
+    u_int64_t changes = 0;
+};
+
+// One line summary for prompts, e.g. "#12 Jane Doe, female, 34, born 1990-04-02, ..."
+std::string describe_patient(const patient& p_patient);
+
+#endif // !PATIENT_RECORDS
@@ -0,0 +1,59 @@
+#ifndef PATIENT_RETRIEVER
+#define PATIENT_RETRIEVER
+
+#include <cstddef>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+#include "bm25_index.hpp"
+#include "patient_records.hpp"
+
+typedef struct retriever_config {
+    size_t top_k = 5;
+    float min_relative_score = 0.35f; // Drop matches scoring below this share of the best one
+    size_t max_tokens = 512;          // Cap for the injected records
+} retriever_config;
+
+typedef struct retriever_stats {
+    size_t indexed;
+    size_t terms;
+    size_t last_hits;
+    double last_lookup_us;
+} retriever_stats;
+
+// Picks the patients a spoken question is about, for the prompt.
+// Listens to a patient_records so its BM25 index (names weigh most, then
+// ids, phone numbers and emails, then the rest) follows every change, under
+// the records' write lock.
+class patient_retriever : public patient_listener {
+public:
+    explicit patient_retriever(patient_records& p_records, const retriever_config& p_config = {});
+    ~patient_retriever() override;
+
+    patient_retriever(const patient_retriever&) = delete;
+    patient_retriever& operator = (const patient_retriever&) = delete;
+
+    // Ids of the best matches, best first
+    std::vector<u_int64_t> search(const std::string& p_query);
+    // Same without touching stats, safe from other threads under records.read_lock()
+    std::vector<u_int64_t> match(const std::string& p_query, size_t p_k) const;
+
+    // p_query with the matching records in front of it, or p_query alone if nothing matched
+    std::string augment(const std::string& p_query);
+
+    retriever_stats stats() const;
+
+    void on_upsert(const patient& p_patient) override;
+    void on_remove(u_int64_t p_id) override;
+    void on_clear() override;
+
+private:
+    patient_records& records;
+    retriever_config cfg;
+    bm25_index index;
+    size_t last_hits = 0;
+    double last_lookup_us = 0.0;
+};
+
+#endif // !PATIENT_RETRIEVER
@@ -0,0 +1,259 @@
+#ifndef PATIENT_STORE
+#define PATIENT_STORE
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
+
+#include "../sealed_file.hpp"
+#include "../typedefs.hpp"
+#include "id_hash.hpp"
+
+#define PATIENT_STORE_DIR "data/patients" // Default, AVA_PATIENT_DIR overrides it
+#define PATIENT_STORE_DATA "patients.dat"    // Header page, then the hot column
+#define PATIENT_STORE_COLD "patients.cold"   // Cold column
+#define PATIENT_STORE_STRINGS "patients.str" // String arena
+#define PATIENT_STORE_WAL "patients.wal"
+#define PATIENT_STORE_SWAP "patients.swap"   // Exists while a rewrite moves its files into place
+
+typedef struct store_config {
+    bool sync_commit = false;                 // Writers wait until their change is on disk
+    u_int32_t commit_window_ms = 10;          // Changes logged within this share one fdatasync
+    u_int64_t checkpoint_bytes = 64ull << 20; // WAL size that triggers a checkpoint
+    u_int64_t compact_bytes = 4ull << 20;     // Dead strings that (once they outweigh live ones) make a checkpoint rewrite the store
+    seal_key key = data_key();                // Set, files and WAL are encrypted, open() decrypts the hot column (see sealed_file)
+} store_config;
+
+typedef struct store_stats {
+    u_int64_t lsn;         // Last change logged
+    u_int64_t durable_lsn; // Last change on disk
+    u_int64_t syncs;       // WAL fdatasyncs, each one a group commit
+    u_int64_t frames;      // Changes logged to the WAL
+    u_int64_t checkpoints;
+    u_int64_t rewrites;    // Compactions and migrations
+    u_int64_t wal_bytes;   // Since the last checkpoint
+    u_int64_t recovered;   // Changes replayed by open()
+    u_int64_t migrated;    // Records converted from a version 1 store by open()
+    u_int64_t arena_bytes; // String arena in use, dead strings included
+    u_int64_t live_bytes;  // Strings still referenced
+    size_t row_bytes;      // Per record, both columns
+    double open_ms;
+    double last_sync_ms;
+    bool persistent;
+    bool encrypted;
+    bool failed;           // Writing to disk failed, later changes are memory only
+} store_stats;
+
+// Durable patient records in columns.
+//
+// patient_hot rows (id, name, date of birth, gender, age: what scans and
+// lookups touch) and patient_cold rows (phone, email, address) are two
+// parallel fixed size columns, and every string is a string_ref into an
+// append only arena. A record is 48 bytes plus its text instead of 1.5 KB of
+// mostly padding, and a scan over the hot column reads 24 bytes per patient.
+//
+// patients.dat (header page + hot column), patients.cold and patients.str
+// are mapped MAP_PRIVATE: reads come straight from the page cache (opening a
+// million records maps them, nothing is parsed or copied) and writes land in
+// private pages, so nothing reaches the files that isn't in the log yet.
+// Every change appends a physical redo frame (both rows, the strings it
+// appended, the record count) to patients.wal; a flusher thread writes
+// whatever piled up in commit_window_ms with one fdatasync (group commit). A
+// checkpoint pwrites the dirty rows and the new arena tail, records the last
+// LSN in the header and empties the WAL. open() replays frames past that
+// LSN, stopping at the first torn one, so a crash anywhere loses at most the
+// last window (nothing with sync_commit).
+//
+// Replaced and removed strings stay in the arena until a checkpoint finds
+// they outweigh the live ones; it then writes compacted copies of the files
+// next to them and renames them into place (patients.swap marks the rename,
+// open() finishes an interrupted one). That remaps the files, so it only runs
+// on the writer thread: a checkpoint of the flusher's leaves it to the next
+// change. A version 1 store (fixed size
+// legacy_patient records) is migrated the same way the first time it's opened.
+//
+// With store_config::key set, the three files are sealed_files and the WAL a
+// sealed_log: open() decrypts the hot column into anonymous memory instead
+// of mapping it (24 bytes per record, all of it stays resident). The cold
+// column and the arena get anonymous memory too, but a chunk of them is only
+// decrypted into it the first time a record or string in it is read or
+// written, and stays. Checkpoints write whole chunks back from memory. A plaintext store opened with
+// a key is rewritten encrypted; an encrypted one doesn't open without it.
+//
+// Records stay contiguous, a removal moves the last record into the hole.
+// Before open() (or after close()) the store lives in anonymous memory only.
+class patient_store {
+public:
+    patient_store() = default;
+    ~patient_store();
+
+    patient_store(const patient_store&) = delete;
+    patient_store& operator = (const patient_store&) = delete;
+
+    // Creates p_dir if needed, maps it and recovers from the WAL
+    bool open(const std::string& p_dir, const store_config& p_config = {});
+    void close(); // Checkpoints, then back to an empty memory only store
+
+    // Writers: one thread at a time, holding write_lock(). Each returns the change's LSN, 0 if nothing changed
+    std::unique_lock<std::shared_mutex> write_lock() { return std::unique_lock<std::shared_mutex>(mutex); }
+    u_int64_t upsert(const patient& p_patient);
+    u_int64_t remove(u_int64_t p_id, bool& p_removed);
+    u_int64_t clear();
+
+    // Without write_lock(): waits until p_lsn is on disk if sync_commit is set
+    void settle(u_int64_t p_lsn);
+    bool flush();      // Everything logged so far is on disk
+    bool checkpoint(); // From the writer thread, it may compact (remap) the store
+
+    // Readers on other threads hold read_lock(), the writer thread doesn't need to.
+    // Rows and text are valid until the next change
+    std::shared_lock<std::shared_mutex> read_lock() const { return std::shared_lock<std::shared_mutex>(mutex); }
+    const patient_hot* find(u_int64_t p_id) const;
+    std::span<const patient_hot> all() const { return {hot_rows(), count}; }
+    const patient_cold& cold(const patient_hot& p_row) const { return cold_at(&p_row - hot_rows()); }
+    std::string_view text(string_ref p_ref) const;
+    void load(const patient_hot& p_row, patient& p_patient) const; // Copies the whole record out
+    size_t size() const { return count; }
+
+    store_stats stats() const;
+
+private:
+    typedef struct store_header {
+        char magic[8];
+        u_int32_t version;
+        u_int32_t hot_size;
+        u_int32_t cold_size;
+        u_int32_t reserved;
+        u_int64_t count;
+        u_int64_t capacity;
+        u_int64_t arena_bytes;
+        u_int64_t live_bytes;
+        u_int64_t checkpoint_lsn;
+    } store_header;
+
+    // Followed by a patient_hot and a patient_cold when it carries an image,
+    // then the strings the change appended, which end at arena_bytes
+    typedef struct wal_frame {
+        u_int32_t magic;
+        u_int32_t has_image;
+        u_int64_t lsn;
+        u_int64_t slot;
+        u_int64_t count;       // Records after this change
+        u_int64_t arena_bytes; // Arena after this change
+        u_int64_t strings;
+        u_int64_t checksum;
+    } wal_frame;
+
+    // One mapping, of a file from offset on, anonymous if fd < 0
+    typedef struct region {
+        int fd = -1;
+        char* data = nullptr;
+        size_t bytes = 0;
+        off_t offset = 0;
+        sealed_file* sealed = nullptr; // Instead of fd: read into anonymous memory, written back through it
+        bool on_demand = false;        // Sealed chunks are read by fault_in() rather than up front
+        std::unique_ptr<std::atomic<bool>[]> loaded; // Per chunk of the file, on_demand only
+        size_t chunks = 0;
+    } region;
+
+    static constexpr size_t HEADER_SIZE = 4096; // Keeps the hot column page aligned
+    static constexpr u_int64_t NO_SLOT = ~0ull;
+
+    patient_hot* hot_rows() const { return reinterpret_cast<patient_hot*>(hot_column.data); }
+    patient_cold* cold_rows() const { return reinterpret_cast<patient_cold*>(cold_column.data); }
+    patient_cold& cold_at(u_int64_t p_slot) const {
+        fault_in(cold_column, p_slot * sizeof(patient_cold), (p_slot + 1) * sizeof(patient_cold));
+        return cold_rows()[p_slot];
+    }
+
+    bool persistent() const { return hot_column.fd >= 0 || hot_column.sealed; }
+    bool logging() const { return wal_fd >= 0 || wal_log.is_open(); }
+
+    bool grow(region& p_region, size_t p_bytes);
+    bool read_file(region& p_region, u_int64_t p_offset, void* p_out, size_t p_bytes);
+    void fault_in(const region& p_region, size_t p_from, size_t p_to) const; // Decrypts what [p_from, p_to) touches
+    bool write_back(region& p_region, size_t p_from, size_t p_to); // [p_from, p_to) of the mapping into the file
+    bool sync_file(region& p_region);
+    bool reserve(size_t p_slots);
+    bool intern(const std::string& p_text, string_ref p_old, string_ref& p_ref);
+    void index() const; // Builds slot_of on first use
+    u_int64_t log(u_int64_t p_slot, u_int64_t p_count, size_t p_strings_from);
+    void apply(const wal_frame& p_frame, const char* p_payload);
+    bool replay(const std::string& p_log);
+    bool migrate(const std::string& p_path); // Version 1 store into memory
+    bool map_files();
+    void unmap();
+    bool rewrite();
+    bool finish_swap();
+    bool open_wal(std::string& p_log); // p_log gets what it holds
+    bool sync_wal();
+    bool reset_wal();
+    bool write_header();
+    bool write_checkpoint(bool p_may_rewrite);
+    void flusher_main();
+
+    store_config cfg;
+    std::string dir;
+    int wal_fd = -1;
+    sealed_log wal_log;   // Instead of wal_fd when encrypted
+    sealed_file hot_file; // Behind the regions when encrypted
+    sealed_file cold_file;
+    sealed_file arena_file;
+    mutable std::mutex seal_mutex;        // The cold and arena sealed_files, fault_in() reads them from any reader
+    mutable std::atomic<bool> unreadable = false; // A chunk didn't decrypt, checkpoints would overwrite it with zeros
+
+    // Records, guarded by mutex
+    mutable std::shared_mutex mutex;
+    region hot_column;
+    region cold_column;
+    region arena;
+    size_t capacity = 0;
+    size_t count = 0;
+    size_t arena_bytes = 0;
+    size_t arena_synced = 0;      // Arena bytes already in patients.str
+    size_t live_bytes = 0;
+    std::vector<u_int64_t> dirty; // Slots changed since the last checkpoint
+    std::vector<bool> dirty_mark;
+    u_int64_t checkpoint_lsn = 0;
+
+    // id -> slot, built lazily so open() doesn't touch every record
+    mutable id_hash slot_of;
+    mutable std::atomic<bool> indexed = false;
+    mutable std::mutex index_mutex;
+
+    // WAL, guarded by wal_mutex; io_mutex serializes file writes
+    mutable std::mutex wal_mutex;
+    std::mutex io_mutex;
+    std::mutex checkpoint_mutex;
+    std::condition_variable wal_cv;     // Flusher wakeups
+    std::condition_variable durable_cv; // durable_lsn moved
+    std::string pending;                // Frames not written yet
+    u_int64_t next_lsn = 1;
+    u_int64_t logged_lsn = 0;
+    u_int64_t durable_lsn = 0;
+    u_int64_t wal_bytes = 0;
+    bool flush_requested = false;
+    bool stopping = false;
+    bool failed = false;
+    std::atomic<bool> compact_due = false; // Set by the flusher, acted on by the next change
+    std::thread flusher;
+
+    u_int64_t syncs = 0;
+    u_int64_t frames = 0;
+    u_int64_t checkpoints = 0;
+    u_int64_t rewrites = 0;
+    u_int64_t recovered = 0;
+    u_int64_t migrated = 0;
+    double open_ms = 0.0;
+    double last_sync_ms = 0.0;
+};
+#endif // !PATIENT_STORE
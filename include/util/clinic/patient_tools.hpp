@@ -0,0 +1,16 @@
+#ifndef PATIENT_TOOLS
+#define PATIENT_TOOLS
+
+#include "../llm/llm_toolbox.hpp"
+#include "name_matcher.hpp"
+#include "patient_records.hpp"
+#include "patient_retriever.hpp"
+
+// Lets the model look patients up itself (get_patient, search_patients,
+// find_patients_by_name, match_patient_name, patients_born_between,
+// list_patients, count_patients) instead of being sent records up front.
+// Handlers read under p_records.read_lock(), all the objects must outlive p_toolbox.
+void register_patient_tools(llm_toolbox& p_toolbox, const patient_records& p_records, 
+                            const patient_retriever& p_retriever, const name_matcher& p_names);
+
+#endif // !PATIENT_TOOLS
@@ -0,0 +1,235 @@
+#ifndef PERSISTENT_MAP
+#define PERSISTENT_MAP
+
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+
+// Immutable u_int64_t -> Value map (a hash array mapped trie) where a change
+// copies only the path to what it touches: at most 13 nodes of up to 32
+// slots, everything else is shared with the previous version. Copying the
+// map copies one pointer, so keeping every version is cheap, and two
+// versions are compared (diff) by walking only the subtrees that aren't
+// shared.
+//
+// Writes go to one map in place under an edit tag: nodes created under the
+// current tag belong to this edit and are changed directly, anything older
+// may be shared and is copied first. Bump the tag after handing a copy of
+// the map out. Copies are safe to read from any thread; the map being edited
+// isn't. Value should be cheap to copy (a shared_ptr).
+template <typename Value>
+class persistent_map {
+public:
+    const Value* find(u_int64_t p_key) const {
+        u_int64_t hash = mix(p_key);
+        const node* at = root.get();
+        for (u_int32_t shift = 0; at != nullptr; shift += BITS) {
+            u_int32_t bit = 1u << ((hash >> shift) & MASK);
+            if (!(at->bitmap & bit)) {
+                return nullptr;
+            }
+            const slot& s = at->slots[index(at->bitmap, bit)];
+            if (!s.child) {
+                return s.key == p_key ? &s.value : nullptr;
+            }
+            at = s.child.get();
+        }
+        return nullptr;
+    }
+
+    void assign(u_int64_t p_key, Value p_value, u_int64_t p_edit) {
+        bool added = false;
+        root = assign(std::move(root), mix(p_key), 0, p_key, std::move(p_value), p_edit, added);
+        count += added;
+    }
+
+    bool erase(u_int64_t p_key, u_int64_t p_edit) {
+        if (!find(p_key)) {
+            return false;
+        }
+        root = erase(std::move(root), mix(p_key), 0, p_key, p_edit);
+        count--;
+        return true;
+    }
+
+    void clear() {
+        root.reset();
+        count = 0;
+    }
+
+    size_t size() const { return count; }
+
+    // Every entry, in hash order
+    template <typename F>
+    void each(F&& p_visit) const {
+        each_in(root.get(), p_visit);
+    }
+
+    // Entries that differ between *this and p_other, as p_visit(key, here,
+    // there) with nullptr for a side that doesn't have the key
+    template <typename F>
+    void diff(const persistent_map& p_other, F&& p_visit) const {
+        diff(root, p_other.root, 0, p_visit);
+    }
+
+private:
+    static constexpr u_int32_t BITS = 5;
+    static constexpr u_int32_t MASK = (1u << BITS) - 1;
+
+    struct node;
+
+    typedef struct slot {
+        u_int64_t key = 0;
+        Value value{};
+        std::shared_ptr<node> child; // A subtree instead of an entry when set
+    } slot;
+
+    struct node {
+        u_int32_t bitmap = 0;     // Which of the 32 slots are in use
+        u_int64_t edit = 0;       // Tag of the edit that created it
+        std::vector<slot> slots;  // Only the used ones, in bit order
+    };
+
+    // Bijective (splitmix64's finalizer), so different keys never share a full hash
+    static u_int64_t mix(u_int64_t p_key) {
+        p_key = (p_key ^ (p_key >> 30)) * 0xBF58476D1CE4E5B9ull;
+        p_key = (p_key ^ (p_key >> 27)) * 0x94D049BB133111EBull;
+        return p_key ^ (p_key >> 31);
+    }
+
+    static size_t index(u_int32_t p_bitmap, u_int32_t p_bit) { return static_cast<size_t>(std::popcount(p_bitmap & (p_bit - 1))); }
+
+    // p_node if this edit owns it, otherwise a copy the edit owns
+    static std::shared_ptr<node> owned(std::shared_ptr<node> p_node, u_int64_t p_edit) {
+        if (!p_node) {
+            p_node = std::make_shared<node>();
+            p_node->edit = p_edit;
+        } else if (p_node->edit != p_edit) {
+            p_node = std::make_shared<node>(*p_node);
+            p_node->edit = p_edit;
+        }
+        return p_node;
+    }
+
+    static std::shared_ptr<node> assign(std::shared_ptr<node> p_node, u_int64_t p_hash, u_int32_t p_shift, u_int64_t p_key,
+                                        Value&& p_value, u_int64_t p_edit, bool& p_added) {
+        std::shared_ptr<node> at = owned(std::move(p_node), p_edit);
+        u_int32_t bit = 1u << ((p_hash >> p_shift) & MASK);
+        size_t i = index(at->bitmap, bit);
+        if (!(at->bitmap & bit)) {
+            at->bitmap |= bit;
+            at->slots.insert(at->slots.begin() + static_cast<std::ptrdiff_t>(i), slot{p_key, std::move(p_value), nullptr});
+            p_added = true;
+            return at;
+        }
+
+        slot& s = at->slots[i];
+        if (s.child) {
+            s.child = assign(std::move(s.child), p_hash, p_shift + BITS, p_key, std::move(p_value), p_edit, p_added);
+        } else if (s.key == p_key) {
+            s.value = std::move(p_value);
+        } else {
+            // Two keys on one slot: push the old entry down a level, then the new one next to it
+            std::shared_ptr<node> below = owned(nullptr, p_edit);
+            below->bitmap = 1u << ((mix(s.key) >> (p_shift + BITS)) & MASK);
+            below->slots.push_back(slot{s.key, std::move(s.value), nullptr});
+            s.value = Value{};
+            s.child = assign(std::move(below), p_hash, p_shift + BITS, p_key, std::move(p_value), p_edit, p_added);
+        }
+        return at;
+    }
+
+    // The key is known to be there. Returns nullptr for a node left empty
+    static std::shared_ptr<node> erase(std::shared_ptr<node> p_node, u_int64_t p_hash, u_int32_t p_shift, u_int64_t p_key,
+                                       u_int64_t p_edit) {
+        std::shared_ptr<node> at = owned(std::move(p_node), p_edit);
+        u_int32_t bit = 1u << ((p_hash >> p_shift) & MASK);
+        size_t i = index(at->bitmap, bit);
+        slot& s = at->slots[i];
+        if (s.child) {
+            s.child = erase(std::move(s.child), p_hash, p_shift + BITS, p_key, p_edit);
+            if (s.child) {
+                // A subtree down to one entry is folded back into this slot,
+                // so the same entries always make the same shape. erase()
+                // returned a node this edit owns, the entry can be moved out
+                if (s.child->slots.size() == 1 && !s.child->slots[0].child) {
+                    slot& last = s.child->slots[0];
+                    s.key = last.key;
+                    s.value = std::move(last.value);
+                    s.child.reset();
+                }
+                return at;
+            }
+        }
+        at->bitmap &= ~bit;
+        at->slots.erase(at->slots.begin() + static_cast<std::ptrdiff_t>(i));
+        return at->slots.empty() ? nullptr : at;
+    }
+
+    template <typename F>
+    static void each_in(const node* p_node, F& p_visit) {
+        if (p_node == nullptr) {
+            return;
+        }
+        for (const slot& s : p_node->slots) {
+            if (s.child) {
+                each_in(s.child.get(), p_visit);
+            } else {
+                p_visit(s.key, s.value);
+            }
+        }
+    }
+
+    template <typename F>
+    static void diff(const std::shared_ptr<node>& p_here, const std::shared_ptr<node>& p_there, u_int32_t p_shift, F& p_visit) {
+        if (p_here == p_there) {
+            return; // Shared, nothing below differs
+        }
+        if (!p_here || !p_there) {
+            const Value* none = nullptr;
+            auto gone = [&](u_int64_t p_key, const Value& p_value) { p_visit(p_key, &p_value, none); };
+            auto added = [&](u_int64_t p_key, const Value& p_value) { p_visit(p_key, none, &p_value); };
+            each_in(p_here.get(), gone);
+            each_in(p_there.get(), added);
+            return;
+        }
+
+        u_int32_t both = p_here->bitmap | p_there->bitmap;
+        while (both) {
+            u_int32_t bit = both & (~both + 1);
+            both &= both - 1;
+            const slot* here = (p_here->bitmap & bit) ? &p_here->slots[index(p_here->bitmap, bit)] : nullptr;
+            const slot* there = (p_there->bitmap & bit) ? &p_there->slots[index(p_there->bitmap, bit)] : nullptr;
+            if (here && there && !here->child && !there->child) {
+                if (here->key != there->key) {
+                    const Value* none = nullptr;
+                    p_visit(here->key, &here->value, none);
+                    p_visit(there->key, none, &there->value);
+                } else if (!(here->value == there->value)) {
+                    p_visit(here->key, &here->value, &there->value);
+                }
+            } else {
+                diff(subtree(here, p_shift), subtree(there, p_shift), p_shift + BITS, p_visit);
+            }
+        }
+    }
+
+    // A slot as a node one level down, so an entry can be compared with a subtree
+    static std::shared_ptr<node> subtree(const slot* p_slot, u_int32_t p_shift) {
+        if (p_slot == nullptr || p_slot->child) {
+            return p_slot ? p_slot->child : nullptr;
+        }
+        std::shared_ptr<node> single = std::make_shared<node>();
+        single->bitmap = 1u << ((mix(p_slot->key) >> (p_shift + BITS)) & MASK);
+        single->slots.push_back(slot{p_slot->key, p_slot->value, nullptr});
+        return single;
+    }
+
+    std::shared_ptr<node> root;
+    size_t count = 0;
+};
+
+#endif // !PERSISTENT_MAP
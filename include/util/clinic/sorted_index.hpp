@@ -0,0 +1,139 @@
+#ifndef SORTED_INDEX
+#define SORTED_INDEX
+
+#include <algorithm>
+#include <cstddef>
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+
+// Ordered (key, id) pairs for prefix and range lookups. Kept as a list of
+// sorted blocks of a few hundred entries (a two level B+ tree): an insert
+// or erase moves at most one block's entries, a lookup is a binary search
+// over the blocks and then inside one. Duplicate keys are fine, (key, id)
+// pairs are unique. Not thread safe, the owners lock around it.
+template <typename Key>
+class sorted_index {
+public:
+    typedef std::pair<Key, u_int64_t> entry;
+
+    void insert(Key p_key, u_int64_t p_id) {
+        entry item(std::move(p_key), p_id);
+        if (blocks.empty()) {
+            blocks.emplace_back();
+            blocks.back().push_back(std::move(item));
+            total++;
+            return;
+        }
+
+        size_t b = block_of(item);
+        std::vector<entry>& block = blocks[b];
+        block.insert(std::upper_bound(block.begin(), block.end(), item), std::move(item));
+        total++;
+
+        if (block.size() >= BLOCK * 2) {
+            std::vector<entry> upper(std::make_move_iterator(block.begin() + BLOCK),
+                                     std::make_move_iterator(block.end()));
+            block.resize(BLOCK);
+            blocks.insert(blocks.begin() + static_cast<std::ptrdiff_t>(b) + 1, std::move(upper));
+        }
+    }
+
+    bool erase(const Key& p_key, u_int64_t p_id) {
+        if (blocks.empty()) {
+            return false;
+        }
+        entry item(p_key, p_id);
+        size_t b = block_of(item);
+        std::vector<entry>& block = blocks[b];
+        auto it = std::lower_bound(block.begin(), block.end(), item);
+        if (it == block.end() || *it != item) {
+            return false;
+        }
+        block.erase(it);
+        total--;
+        if (block.empty()) {
+            blocks.erase(blocks.begin() + static_cast<std::ptrdiff_t>(b));
+        }
+        return true;
+    }
+
+    // Replaces everything, faster than inserting one by one
+    void assign(std::vector<entry> p_entries) {
+        std::sort(p_entries.begin(), p_entries.end());
+        blocks.clear();
+        for (size_t i = 0; i < p_entries.size(); i += BLOCK) {
+            size_t end = std::min(p_entries.size(), i + BLOCK);
+            blocks.emplace_back(std::make_move_iterator(p_entries.begin() + static_cast<std::ptrdiff_t>(i)),
+                                std::make_move_iterator(p_entries.begin() + static_cast<std::ptrdiff_t>(end)));
+        }
+        total = p_entries.size();
+    }
+
+    void clear() {
+        blocks.clear();
+        total = 0;
+    }
+
+    // Entries with key >= p_from in order, until p_visit returns false
+    template <typename From, typename F>
+    void scan(const From& p_from, F&& p_visit) const {
+        auto below = [](const entry& p_entry, const From& p_key) { return p_entry.first < p_key; };
+        size_t b = std::partition_point(blocks.begin(), blocks.end(), [&](const std::vector<entry>& p_block) {
+            return below(p_block.back(), p_from);
+        }) - blocks.begin();
+        for (; b < blocks.size(); b++) {
+            const std::vector<entry>& block = blocks[b];
+            for (auto it = std::lower_bound(block.begin(), block.end(), p_from, below); it != block.end(); ++it) {
+                if (!p_visit(*it)) {
+                    return;
+                }
+            }
+        }
+    }
+
+    // Entries with key < p_key, counting whole blocks instead of visiting them
+    template <typename From>
+    size_t rank(const From& p_key) const {
+        auto below = [](const entry& p_entry, const From& p_from) { return p_entry.first < p_from; };
+        size_t rank = 0;
+        for (const std::vector<entry>& block : blocks) {
+            if (!below(block.back(), p_key)) {
+                return rank + static_cast<size_t>(std::lower_bound(block.begin(), block.end(), p_key, below) - block.begin());
+            }
+            rank += block.size();
+        }
+        return rank;
+    }
+
+    // Roughly the entries with p_from <= key <= p_to, in whole blocks: two binary searches
+    template <typename From>
+    size_t estimate(const From& p_from, const From& p_to) const {
+        auto first = std::partition_point(blocks.begin(), blocks.end(), [&](const std::vector<entry>& p_block) {
+            return p_block.back().first < p_from;
+        });
+        auto last = std::partition_point(first, blocks.end(), [&](const std::vector<entry>& p_block) {
+            return !(p_to < p_block.back().first);
+        });
+        return static_cast<size_t>(last - first + 1) * BLOCK;
+    }
+
+    size_t size() const { return total; }
+    size_t memory() const { return total * sizeof(entry) + blocks.size() * sizeof(std::vector<entry>); }
+
+private:
+    static constexpr size_t BLOCK = 256; // Blocks hold BLOCK to 2 * BLOCK entries, less only after erases
+
+    // The block p_item belongs in: the first whose last entry isn't below it
+    size_t block_of(const entry& p_item) const {
+        size_t b = std::partition_point(blocks.begin(), blocks.end(), [&](const std::vector<entry>& p_block) {
+            return p_block.back() < p_item;
+        }) - blocks.begin();
+        return std::min(b, blocks.size() - 1);
+    }
+
+    std::vector<std::vector<entry>> blocks;
+    size_t total = 0;
+};
+
+#endif // !SORTED_INDEX
@@ -0,0 +1,101 @@
+#ifndef HASH
+#define HASH
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// XXH64, fast non-cryptographic 64-bit hash used for content addressing
+// (cache keys etc). Never use it for anything security related.
+namespace hash_detail {
+
+inline constexpr uint64_t P1 = 0x9E3779B185EBCA87ull;
+inline constexpr uint64_t P2 = 0xC2B2AE3D27D4EB4Full;
+inline constexpr uint64_t P3 = 0x165667B19E3779F9ull;
+inline constexpr uint64_t P4 = 0x85EBCA77C2B2AE63ull;
+inline constexpr uint64_t P5 = 0x27D4EB2F165667C5ull;
+
+inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t read64(const unsigned char* p) { uint64_t v; std::memcpy(&v, p, 8); return v; }
+inline uint32_t read32(const unsigned char* p) { uint32_t v; std::memcpy(&v, p, 4); return v; }
+
+inline uint64_t acc_round(uint64_t acc, uint64_t input) {
+    acc += input * P2;
+    return rotl(acc, 31) * P1;
+}
+
+inline uint64_t acc_merge(uint64_t acc, uint64_t val) {
+    acc ^= acc_round(0, val);
+    return acc * P1 + P4;
+}
+
+} // namespace hash_detail
+
+inline uint64_t hash64(const void* p_data, size_t p_len, uint64_t p_seed = 0) {
+    using namespace hash_detail;
+    const unsigned char* p = static_cast<const unsigned char*>(p_data);
+    const unsigned char* end = p + p_len;
+    uint64_t h;
+
+    if (p_len >= 32) {
+        uint64_t v1 = p_seed + P1 + P2, v2 = p_seed + P2, v3 = p_seed, v4 = p_seed - P1;
+        const unsigned char* limit = end - 32;
+        do {
+            v1 = acc_round(v1, read64(p));      
+            v2 = acc_round(v2, read64(p + 8));
+            v3 = acc_round(v3, read64(p + 16)); 
+            v4 = acc_round(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = acc_merge(h, v1); 
+        h = acc_merge(h, v2); 
+        h = acc_merge(h, v3); 
+        h = acc_merge(h, v4);
+    } else {
+        h = p_seed + P5;
+    }
+
+    h += p_len;
+
+    for (; p + 8 <= end; p += 8) {
+        h ^= acc_round(0, read64(p));
+        h = rotl(h, 27) * P1 + P4;
+    }
+    if (p + 4 <= end) {
+        h ^= static_cast<uint64_t>(read32(p)) * P1;
+        h = rotl(h, 23) * P2 + P3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        h ^= (*p) * P5;
+        h = rotl(h, 11) * P1;
+    }
+
+    h ^= h >> 33; 
+    h *= P2;
+    h ^= h >> 29; 
+    h *= P3;
+    h ^= h >> 32;
+    return h;
+}
+
+inline uint64_t hash64(std::string_view p_str, uint64_t p_seed = 0) {
+    return hash64(p_str.data(), p_str.size(), p_seed);
+}
+
+// 16 lowercase hex digits, handy for file names
+inline std::string hash_hex(uint64_t p_hash) {
+    static const char digits[] = "0123456789abcdef";
+    std::string out(16, '0');
+    for (int i = 15; i >= 0; i--, p_hash >>= 4) {
+        out[i] = digits[p_hash & 0xF];
+    }
+    return out;
+}
+
+#endif // !HASH
@@ -0,0 +1,51 @@
+#ifndef JSON_PATH
+#define JSON_PATH
+
+#include <cstddef>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+
+typedef enum json_kind {
+    JSON_NULL,
+    JSON_BOOL,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT
+} json_kind;
+
+// One step of a path: an object key or an array index, e.g. {"candidates", 0, "content"}
+typedef struct json_step {
+    std::string_view key;
+    size_t index = 0;
+    bool is_index = false;
+
+    json_step(const char* p_key) : key(p_key) { }
+    json_step(std::string_view p_key) : key(p_key) { }
+    json_step(size_t p_index) : index(p_index), is_index(true) { }
+    json_step(int p_index) : index(static_cast<size_t>(p_index)), is_index(true) { }
+} json_step;
+
+// A value inside the scanned document, raw points into it (quotes included for strings)
+typedef struct json_value {
+    json_kind kind = JSON_NULL;
+    std::string_view raw;
+} json_value;
+
+// On demand JSON lookup.
+// Walks p_doc once, front to back, descending only into the containers on
+// p_path and skipping everything else (safety ratings, usage metadata, ...)
+// with a bracket/quote scan; nothing is allocated and nothing is copied.
+// Only the part of the document it walks through is checked for syntax.
+// Returns false if the path doesn't exist or the document is malformed there.
+bool json_find(std::string_view p_doc, std::initializer_list<json_step> p_path, json_value& p_out);
+
+// Contents of a JSON string value. Points into the document when there's
+// nothing to unescape, otherwise into p_scratch. False if p_value isn't a string.
+bool json_string(const json_value& p_value, std::string& p_scratch, std::string_view& p_out);
+
+// json_find + json_string, always copies
+bool json_find_string(std::string_view p_doc, std::initializer_list<json_step> p_path, std::string& p_out);
+
+#endif // !JSON_PATH
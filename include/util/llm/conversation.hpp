@@ -0,0 +1,87 @@
+#ifndef CONVERSATION
+#define CONVERSATION
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <string>
+#include <vector>
+
+#include "llm_message.hpp"
+
+typedef struct conversation_config {
+    size_t token_budget = 2048;   // Summary + history + new prompt, per request
+    size_t summary_budget = 256;  // Summary is trimmed (oldest notes first) past this
+    size_t min_recent_turns = 2;  // Always sent verbatim, even over budget
+    size_t note_tokens = 48;      // Cap for the local note kept per rolled up turn
+    int64_t idle_timeout_s = 300; // A session ends after this long without a question, 0 never
+} conversation_config;
+
+// Conversation history for the assistant.
+// Every request carries a running summary of older turns plus as many recent
+// turns verbatim as fit in token_budget (counted locally, see tokenizer.hpp).
+// Turns that no longer fit are rolled into the summary right away as short
+// extractive notes, so request size and latency stay flat however long the
+// session runs. If a summarizer is set, the notes are also condensed by the
+// model in the background and swapped in when that answer lands.
+// Each visitor at the desk is a session: clear() (the next patient) or
+// idle_timeout_s without a question starts a new one.
+class conversation {
+public:
+    // Gets a prompt, returns the model's answer (typically llm_scheduler::submit at batch priority)
+    typedef std::function<std::future<std::string>(const std::string& p_prompt)> summarizer;
+
+    explicit conversation(const conversation_config& p_config = {});
+
+    void set_summarizer(summarizer p_summarizer) { summarize = std::move(p_summarizer); }
+
+    // Messages to send for p_prompt, rolls old turns into the summary as needed
+    std::vector<llm_message> build_request(const std::string& p_prompt);
+
+    void add_turn(llm_role p_role, const std::string& p_text);
+
+    // Picks up a finished background summary and ends an idle session, call once per frame
+    void poll();
+
+    // Hash of the current context, answers cached under one context don't leak into another
+    std::string fingerprint() const;
+
+    // Whether p_prompt points back at earlier turns ("what about her", "and
+    // tomorrow?"), the rest mean the same in any session
+    static bool is_follow_up(const std::string& p_prompt);
+
+    size_t context_tokens() const; // Summary + history as it stands
+    size_t turn_count() const { return turns.size(); }
+    const std::string& summary_text() const { return summary; }
+
+    void clear(); // New session, a summary still being condensed is dropped
+
+private:
+    typedef struct turn {
+        llm_role role;
+        std::string text;
+        size_t tokens;
+    } turn;
+
+    void roll_up(); // Moves the oldest turn into the summary
+    void trim_summary();
+    void request_condense();
+
+    conversation_config cfg;
+    std::deque<turn> turns;
+    size_t turn_tokens = 0;
+
+    std::string summary; // One note per line
+    size_t summary_tokens = 0;
+
+    std::chrono::steady_clock::time_point last_active = std::chrono::steady_clock::now();
+
+    summarizer summarize;
+    std::future<std::string> condensing;
+    size_t condensed_from = 0; // summary.size() when the background request was sent
+};
+
+#endif // !CONVERSATION
@@ -0,0 +1,25 @@
+#ifndef HASHING_EMBEDDER
+#define HASHING_EMBEDDER
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Dependency free sentence embedder (feature hashing).
+// Word unigrams, word bigrams and character trigrams are hashed into a
+// fixed number of signed buckets and the result is L2 normalized, so the
+// dot product of two embeddings is their cosine similarity. Spoken filler
+// ("um", "uh"...) is dropped first, so it doesn't push paraphrases apart.
+class hashing_embedder {
+public:
+    explicit hashing_embedder(size_t p_dim = 256) : dimension(p_dim) { }
+
+    std::vector<float> embed(const std::string& p_text) const;
+
+    size_t dim() const { return dimension; }
+
+private:
+    size_t dimension;
+};
+
+#endif // !HASHING_EMBEDDER
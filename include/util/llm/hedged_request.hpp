@@ -0,0 +1,28 @@
+#ifndef HEDGED_REQUEST
+#define HEDGED_REQUEST
+
+#include <cstddef>
+#include <string>
+
+#include "http_transport.hpp"
+#include "latency_histogram.hpp"
+
+typedef struct hedge_target {
+    std::string backend; // Name in latency_tracker
+    http_request request;
+} hedge_target;
+
+// Delay after which a request to this backend gets hedged: the configured
+// percentile of its recent time-to-first-byte, clamped to the config limits
+double hedge_delay_ms(const backend_latency& p_latency, const hedge_config& p_config);
+
+// Sends p_primary. With hedging enabled, if no byte came back within
+// hedge_delay_ms() a duplicate goes to p_alternate (or the same backend
+// again when it's null), the first successful answer wins and the other
+// call is killed. Latency of every call is recorded in latency_tracker.
+// p_winner, if given, is set to 0 when the answer came from p_primary, 1 otherwise;
+// p_sent to the number of calls that went out (2 once the duplicate was sent).
+http_response hedged_post(const hedge_target& p_primary, const hedge_target* p_alternate = nullptr,
+                          size_t* p_winner = nullptr, size_t* p_sent = nullptr);
+
+#endif // !HEDGED_REQUEST
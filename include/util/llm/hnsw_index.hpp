@@ -0,0 +1,68 @@
+#ifndef HNSW_INDEX
+#define HNSW_INDEX
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+
+// Hierarchical navigable small world graph for approximate nearest neighbour
+// search over L2 normalized vectors (similarity = dot product = cosine).
+// Removal only tombstones a node, it keeps routing searches but is never
+// returned. Not thread safe, the owner locks around it.
+class hnsw_index {
+public:
+    explicit hnsw_index(size_t p_dim,
+                        size_t p_m = 16,
+                        size_t p_ef_construction = 100,
+                        u_int64_t p_seed = 42);
+
+    u_int32_t add(const float* p_vector); // Returns the node id (sequential)
+    void remove(u_int32_t p_id);
+
+    // Up to p_k (id, similarity) pairs, best first
+    std::vector<std::pair<u_int32_t, float>> search(const float* p_query,
+                                                    size_t p_k,
+                                                    size_t p_ef = 64) const;
+
+    size_t size() const { return levels.size(); }
+    size_t live() const { return levels.size() - removed; }
+    size_t dim() const { return dimension; }
+
+    void clear();
+
+private:
+    typedef std::pair<float, u_int32_t> candidate; // (similarity, id)
+
+    float similarity(const float* p_a, u_int32_t p_b) const;
+    const float* vector_of(u_int32_t p_id) const { return vectors.data() + static_cast<size_t>(p_id) * dimension; }
+
+    // Best first list (size <= p_ef) of the closest nodes found on p_level
+    std::vector<candidate> search_layer(const float* p_query,
+                                        u_int32_t p_entry,
+                                        size_t p_ef,
+                                        int p_level) const;
+
+    // Keeps the p_max most diverse close neighbours (HNSW paper heuristic)
+    std::vector<u_int32_t> select_neighbours(const std::vector<candidate>& p_candidates, size_t p_max) const;
+
+    size_t dimension;
+    size_t m;
+    size_t m0; // Layer 0 gets twice the links
+    size_t ef_construction;
+    double level_mult;
+    std::mt19937_64 rng;
+
+    std::vector<float> vectors;
+    std::vector<u_int8_t> levels;
+    std::vector<std::vector<std::vector<u_int32_t>>> links; // [node][level] -> neighbours
+    std::vector<u_int8_t> deleted;
+    size_t removed = 0;
+
+    u_int32_t entry_point = 0;
+    int max_level = -1;
+};
+
+#endif // !HNSW_INDEX
@@ -0,0 +1,79 @@
+#ifndef HTTP_TRANSPORT
+#define HTTP_TRANSPORT
+
+#include <cstddef>
+#include <poll.h>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+typedef struct http_request {
+    std::string url;
+    std::vector<std::string> headers; // "Name: value"
+    std::string body;
+    long timeout_ms = 60000;
+} http_request;
+
+typedef struct http_response {
+    int status = 0;    // HTTP status, 0 when the transport itself failed
+    std::string body;
+    std::string error; // curl's own error message, if any
+
+    bool ok() const { return status >= 200 && status < 300; }
+} http_response;
+
+// One POST through a curl child process.
+// curl is exec'd directly (no shell) and the body is streamed into its
+// stdin from memory (--data-binary @-), so the prompt never becomes part of
+// a command line and its size is not limited by ARG_MAX. Headers (API keys)
+// stay off the command line too, where ps would show them: curl reads them
+// from a pipe on its fd 3 (-H @/dev/fd/3). Non-blocking, pump()
+// moves data both ways so several calls can be driven from one thread.
+class http_call {
+public:
+    http_call() = default;
+    ~http_call();
+
+    http_call(const http_call&) = delete;
+    http_call& operator = (const http_call&) = delete;
+
+    bool start(const http_request& p_request);
+
+    // Writes/reads whatever is ready, waiting at most p_timeout_ms.
+    // Returns true once the call has finished (successfully or not)
+    bool pump(int p_timeout_ms);
+
+    // Fills up to 3 pollfds for the pipes still open, for waiting on several calls at once
+    // (poll them yourself, then pump(0) each call)
+    size_t poll_fds(pollfd* p_out) const;
+
+    bool running() const { return pid > 0; }
+    bool finished() const { return done; }
+    bool got_first_byte() const { return !output.empty(); }
+
+    // Kills curl, the response is marked as failed
+    void cancel();
+
+    http_response take_response();
+
+private:
+    void close_fds();
+    void reap(bool p_block);
+
+    pid_t pid = -1;
+    int in_fd = -1;  // Our end of curl's stdin
+    int out_fd = -1; // Our end of curl's stdout
+    int err_fd = -1; // Our end of curl's stderr
+
+    std::string body;
+    size_t written = 0;
+    std::string output;
+    std::string errors;
+    int exit_code = -1;
+    bool done = false;
+};
+
+// Blocking convenience wrapper
+http_response http_post(const http_request& p_request);
+
+#endif // !HTTP_TRANSPORT
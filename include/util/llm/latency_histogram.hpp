@@ -0,0 +1,102 @@
+#ifndef LATENCY_HISTOGRAM
+#define LATENCY_HISTOGRAM
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+
+// Log bucketed latency histogram over a sliding window.
+// Buckets grow by 12.5% from 1 ms, so a percentile is accurate to ~6%.
+// Samples go into the current window, once it holds p_window samples it
+// becomes the previous window and a fresh one starts; percentiles look at
+// both, so old traffic ages out without keeping every sample around.
+class latency_histogram {
+public:
+    static constexpr size_t BUCKETS = 128;
+
+    explicit latency_histogram(size_t p_window = 512) : window(p_window ? p_window : 1) { }
+
+    void record(double p_ms);
+
+    // Upper bound of the bucket holding the p-th percentile (p in [0, 1]), 0 when empty
+    double percentile(double p_p) const;
+
+    size_t count() const; // Samples in the current + previous window
+    u_int64_t total() const; // Samples ever recorded
+
+    static double bucket_upper_ms(size_t p_bucket);
+
+private:
+    static size_t bucket_of(double p_ms);
+
+    size_t window;
+    mutable std::mutex mutex;
+    std::array<u_int32_t, BUCKETS> current = {};
+    std::array<u_int32_t, BUCKETS> previous = {};
+    size_t current_count = 0;
+    size_t previous_count = 0;
+    u_int64_t all_time = 0;
+};
+
+// Time to first byte and total time for one LLM backend
+typedef struct backend_latency {
+    latency_histogram first_byte;
+    latency_histogram total;
+    std::atomic<u_int64_t> failures = 0; // Bumped by hedged_request's worker threads
+} backend_latency;
+
+typedef struct hedge_config {
+    bool enabled = false;
+    double percentile = 0.95;      // Hedge once we're slower than this share of recent requests
+    double min_delay_ms = 100.0;
+    double max_delay_ms = 5000.0;
+    double default_delay_ms = 1500.0; // Until the histogram has min_samples
+    size_t min_samples = 20;
+} hedge_config;
+
+typedef struct hedge_stats {
+    u_int64_t requests;
+    u_int64_t hedged;     // A second request was sent
+    u_int64_t hedge_wins; // ...and it answered first
+} hedge_stats;
+
+// Process wide latency bookkeeping for the LLM client, one entry per backend
+class latency_tracker {
+public:
+    latency_tracker(const latency_tracker&) = delete;
+    latency_tracker& operator = (const latency_tracker&) = delete;
+
+    static latency_tracker& get_instance();
+
+    backend_latency& backend(const std::string& p_name); // Created on first use, never moves
+    latency_histogram& requests() { return request_latency; } // End to end, hedging included
+
+    // Calls p_func(name, latency) for every backend
+    template <typename F>
+    void for_each(F&& p_func) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& [name, latency] : backends) {
+            p_func(name, latency);
+        }
+    }
+
+    hedge_config hedging;
+
+    hedge_stats stats() const;
+    void count_request(bool p_hedged, bool p_hedge_won);
+
+private:
+    latency_tracker() = default;
+
+    mutable std::mutex mutex;
+    std::map<std::string, backend_latency> backends;
+    latency_histogram request_latency;
+    hedge_stats counters = {0, 0, 0};
+};
+
+#endif // !LATENCY_HISTOGRAM
@@ -0,0 +1,84 @@
+#ifndef LLM_BACKEND
+#define LLM_BACKEND
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "http_transport.hpp"
+#include "llm_message.hpp"
+
+class llm_toolbox;
+
+// What the router needs to know about a backend before it has latency samples
+typedef struct backend_profile {
+    double prior_ms = 1500.0;        // Expected total time for a short prompt
+    double ms_per_prompt_token = 0.0; // Prompt processing cost on top of that
+    size_t max_prompt_tokens = 32768; // Longer requests are never routed here
+} backend_profile;
+
+// One LLM endpoint. Backends only translate between llm_message and HTTP,
+// sending, hedging and latency bookkeeping are done by llm_router.
+class llm_backend {
+public:
+    llm_backend(std::string p_name, backend_profile p_profile)
+        : backend_name(std::move(p_name)), backend_info(p_profile) { }
+    virtual ~llm_backend() = default;
+
+    const std::string& name() const { return backend_name; } // Key in latency_tracker
+    const backend_profile& profile() const { return backend_info; }
+
+    virtual bool available() const = 0; // Configured well enough to try
+
+    // p_tools, if not null, are offered to the model
+    virtual http_request make_request(const std::vector<llm_message>& p_messages, const llm_toolbox* p_tools) const = 0;
+    // False if the body holds neither text nor tool calls
+    virtual bool parse_response(const std::string& p_body, llm_reply& p_out) const = 0;
+
+private:
+    std::string backend_name;
+    backend_profile backend_info;
+};
+
+typedef struct gemini_config {
+    std::string api_key; // GEMINI_API_KEY
+    std::string model = "gemini-2.0-flash";
+    std::string base_url = "https://generativelanguage.googleapis.com/v1beta/models/";
+    long timeout_ms = 60000;
+} gemini_config;
+
+// Google's generateContent API
+class gemini_backend : public llm_backend {
+public:
+    explicit gemini_backend(const gemini_config& p_config, backend_profile p_profile = {1500.0, 0.01, 1000000});
+
+    bool available() const override { return !cfg.api_key.empty(); }
+    http_request make_request(const std::vector<llm_message>& p_messages, const llm_toolbox* p_tools) const override;
+    bool parse_response(const std::string& p_body, llm_reply& p_out) const override;
+
+private:
+    gemini_config cfg;
+};
+
+typedef struct openai_config {
+    std::string url;     // Full chat completions URL, e.g. http://127.0.0.1:8080/v1/chat/completions
+    std::string api_key; // Optional, local servers usually don't check it
+    std::string model = "local";
+    long timeout_ms = 30000;
+} openai_config;
+
+// Anything speaking the OpenAI chat completions API: llama.cpp's server,
+// vLLM, Ollama, or a stub for testing
+class openai_backend : public llm_backend {
+public:
+    explicit openai_backend(const openai_config& p_config, backend_profile p_profile = {400.0, 0.5, 4096});
+
+    bool available() const override { return !cfg.url.empty(); }
+    http_request make_request(const std::vector<llm_message>& p_messages, const llm_toolbox* p_tools) const override;
+    bool parse_response(const std::string& p_body, llm_reply& p_out) const override;
+
+private:
+    openai_config cfg;
+};
+
+#endif // !LLM_BACKEND
@@ -0,0 +1,34 @@
+#ifndef LLM_MESSAGE
+#define LLM_MESSAGE
+
+#include <string>
+#include <vector>
+
+typedef enum llm_role {
+    ROLE_USER,
+    ROLE_MODEL,
+    ROLE_TOOL // Result of a tool call, sent back as the user's side
+} llm_role;
+
+// The model asking for a local function to be run
+typedef struct llm_tool_call {
+    std::string id;   // OpenAI matches results to calls by id, Gemini by name
+    std::string name;
+    std::string args; // JSON object
+} llm_tool_call;
+
+typedef struct llm_message {
+    llm_role role;
+    std::string text;                      // For ROLE_TOOL the JSON result
+    std::vector<llm_tool_call> calls = {}; // ROLE_MODEL only
+    std::string call_id = "";              // ROLE_TOOL only, the call this answers
+    std::string tool_name = "";            // ROLE_TOOL only
+} llm_message;
+
+// What came back from a backend: an answer, tool calls, or both
+typedef struct llm_reply {
+    std::string text;
+    std::vector<llm_tool_call> calls;
+} llm_reply;
+
+#endif // !LLM_MESSAGE
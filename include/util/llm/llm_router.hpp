@@ -0,0 +1,96 @@
+#ifndef LLM_ROUTER
+#define LLM_ROUTER
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+#include "llm_backend.hpp"
+#include "llm_message.hpp"
+
+class llm_toolbox;
+
+// Model name for response cache keys, answers are shared whichever backend gave them
+#define LLM_CACHE_MODEL "routed"
+
+typedef struct router_config {
+    size_t min_samples = 5;           // Below this the backend's prior_ms is used instead of its history
+    double cooldown_ms = 2000.0;      // Skip a backend this long after a failure...
+    double max_cooldown_ms = 60000.0; // ...doubling per consecutive failure up to this
+    bool hedge_across = true;         // Hedge to the runner up backend instead of the same one
+    size_t max_tool_rounds = 4;       // Round trips the model gets for tool calls before we stop
+} router_config;
+
+typedef struct route_info {
+    std::string name;
+    bool available;       // Configured and not cooling down
+    double expected_ms;   // For a 64 token prompt
+    u_int64_t routed;     // Requests sent here first
+    u_int64_t answered;   // Requests answered from here, hedges included
+    u_int32_t failures;   // Consecutive
+} route_info;
+
+// Picks a backend per request.
+// Every usable backend gets an expected time: its recent median total
+// latency (or the profile's prior until there's enough history) plus its
+// per prompt token cost. The cheapest one is tried first, with the runner
+// up as the hedge target; failures put a backend on an exponential cooldown
+// and the next one is tried. With a local server configured short questions
+// stay local, long conversations go to the hosted model.
+class llm_router {
+public:
+    llm_router(const llm_router&) = delete;
+    llm_router& operator = (const llm_router&) = delete;
+
+    static llm_router& get_instance();
+
+    void add(std::unique_ptr<llm_backend> p_backend); // During init, before any query()
+
+    // Answer text, "" when every backend failed.
+    // With p_tools the model may call them first: their results are sent back to
+    // the same backend until it answers, for at most config.max_tool_rounds round trips.
+    // p_tool_calls, if set, gets how many calls that took
+    std::string query(const std::vector<llm_message>& p_messages, const llm_toolbox* p_tools = nullptr,
+                      size_t* p_tool_calls = nullptr);
+    std::string query(const std::string& p_prompt);
+
+    std::vector<route_info> routes() const;
+    size_t size() const { return backends.size(); }
+
+    router_config config;
+
+private:
+    typedef std::chrono::steady_clock clock_type;
+
+    typedef struct backend_state {
+        std::unique_ptr<llm_backend> backend;
+        u_int32_t failures = 0;
+        clock_type::time_point down_until;
+        u_int64_t routed = 0;
+        u_int64_t answered = 0;
+    } backend_state;
+
+    llm_router() = default;
+
+    double expected_ms(const llm_backend& p_backend, size_t p_prompt_tokens) const;
+    std::vector<size_t> rank(size_t p_prompt_tokens); // Usable backends, best first
+    void mark(size_t p_index, bool p_ok);
+
+    // Tries p_order until one backend answers, p_answered is its index
+    bool send(const std::vector<llm_message>& p_messages, const llm_toolbox* p_tools,
+              const std::vector<size_t>& p_order, llm_reply& p_out, size_t& p_answered);
+
+    mutable std::mutex mutex;
+    std::vector<backend_state> backends;
+};
+
+// Registers backends from the environment:
+// GEMINI_API_KEY (+ AVA_GEMINI_MODEL) for Gemini,
+// AVA_LOCAL_LLM_URL (+ AVA_LOCAL_LLM_MODEL, AVA_LOCAL_LLM_KEY) for an OpenAI compatible server
+void load_llm_environment(llm_router& p_router);
+
+#endif // !LLM_ROUTER
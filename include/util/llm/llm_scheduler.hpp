@@ -0,0 +1,98 @@
+#ifndef LLM_SCHEDULER
+#define LLM_SCHEDULER
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
+
+typedef enum llm_priority {
+    PRIORITY_INTERACTIVE = 0, // Someone is waiting at the desk (dictation, questions)
+    PRIORITY_NORMAL = 1,
+    PRIORITY_BATCH = 2,       // Summaries, re-processing of archives
+    PRIORITY_COUNT = 3
+} llm_priority;
+
+typedef struct scheduler_config {
+    double rate_per_s = 2.0;   // Token bucket refill, this process' share of the API quota
+    double burst = 4.0;        // Bucket size
+    size_t max_in_flight = 4;  // Concurrent requests (= worker threads)
+    size_t max_queue = 1024;   // Per priority class, submits past this are rejected
+    double aging_ms = 30000.0; // Each time a job waits this long it moves a class up, so batch work can't starve
+} scheduler_config;
+
+typedef struct scheduler_stats {
+    std::array<size_t, PRIORITY_COUNT> queued;
+    std::array<size_t, PRIORITY_COUNT> max_queued;
+    std::array<double, PRIORITY_COUNT> avg_wait_ms; // Submit -> start
+    size_t in_flight;
+    u_int64_t completed;
+    u_int64_t rejected;
+    u_int64_t throttled; // Times a worker had to wait for a rate limit token
+    double tokens;
+} scheduler_stats;
+
+// Scheduler in front of the LLM client.
+// Jobs are queued per priority class and run by max_in_flight workers,
+// each start takes a token from a token bucket so bursts from several
+// callers stay under the rate limit. Interactive work goes first, but a
+// job that has waited long enough counts as interactive too and then takes
+// its turn by age.
+// Rate limiting is per process: with several workstations on one key, give
+// each one its share of the quota in rate_per_s.
+class llm_scheduler {
+public:
+    typedef std::function<std::string()> job;
+
+    explicit llm_scheduler(const scheduler_config& p_config = {});
+    ~llm_scheduler();
+
+    llm_scheduler(const llm_scheduler&) = delete;
+    llm_scheduler& operator = (const llm_scheduler&) = delete;
+
+    // Rejected jobs (queue full / shut down) resolve to an empty string right away
+    std::future<std::string> submit(job p_job, llm_priority p_priority = PRIORITY_NORMAL);
+
+    scheduler_stats stats() const;
+
+    // Stops the workers, queued jobs resolve to an empty string
+    void shutdown();
+
+private:
+    typedef std::chrono::steady_clock clock_type;
+
+    typedef struct pending {
+        job work;
+        std::promise<std::string> result;
+        clock_type::time_point submitted;
+    } pending;
+
+    void worker();
+    void refill(clock_type::time_point p_now); // mutex held
+    int next_class(clock_type::time_point p_now) const; // mutex held, -1 if empty
+
+    scheduler_config cfg;
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::array<std::deque<pending>, PRIORITY_COUNT> queues;
+    std::vector<std::thread> workers; // Started on the first submit
+    bool stopping = false;
+
+    double tokens;
+    clock_type::time_point last_refill;
+
+    scheduler_stats counters = {};
+    std::array<double, PRIORITY_COUNT> total_wait_ms = {};
+    std::array<u_int64_t, PRIORITY_COUNT> started = {};
+};
+
+#endif // !LLM_SCHEDULER
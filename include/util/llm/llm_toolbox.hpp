@@ -0,0 +1,45 @@
+#ifndef LLM_TOOLBOX
+#define LLM_TOOLBOX
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+#include "../../json/json.hpp"
+#include "llm_message.hpp"
+
+// Gets the call's arguments, returns a JSON object for the model
+typedef std::function<nlohmann::json(const nlohmann::json& p_args)> llm_tool_handler;
+
+typedef struct llm_tool {
+    std::string name;
+    std::string description;
+    nlohmann::json parameters; // JSON schema of the arguments object
+    llm_tool_handler handler;
+} llm_tool;
+
+// Local functions the model may call instead of being sent the data up front.
+// Handlers run on whichever thread makes the request (a scheduler worker),
+// they have to do their own locking.
+class llm_toolbox {
+public:
+    void add(llm_tool p_tool) { entries.push_back(std::move(p_tool)); } // During init only
+
+    const std::vector<llm_tool>& tools() const { return entries; }
+    bool empty() const { return entries.empty(); }
+
+    // Runs p_call, errors (unknown tool, bad arguments, a throwing handler) come back as {"error": ...}
+    std::string call(const llm_tool_call& p_call) const;
+
+    u_int64_t calls() const { return call_count.load(std::memory_order_relaxed); }
+    u_int64_t failures() const { return failure_count.load(std::memory_order_relaxed); }
+
+private:
+    std::vector<llm_tool> entries;
+    mutable std::atomic<u_int64_t> call_count = 0;
+    mutable std::atomic<u_int64_t> failure_count = 0;
+};
+
+#endif // !LLM_TOOLBOX
@@ -0,0 +1,82 @@
+#ifndef RESPONSE_CACHE
+#define RESPONSE_CACHE
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+
+#include "../lru_cache.hpp"
+#include "../sealed_file.hpp"
+
+typedef struct response_cache_config {
+    std::string path = "cache/llm_responses.jsonl"; // Append only log, replayed on load
+    size_t capacity = 4096;                          // Entries kept in memory
+    int64_t ttl_s = 24 * 60 * 60;                    // Default time to live, <= 0 never expires
+    seal_key key = data_key();                       // Set, the log is a sealed_log (a plaintext one is encrypted by load())
+} response_cache_config;
+
+typedef struct response_cache_stats {
+    u_int64_t hits;
+    u_int64_t misses;
+    u_int64_t expired;
+    u_int64_t stores;
+    size_t entries;
+
+    double hit_rate() const {
+        u_int64_t lookups = hits + misses;
+        return lookups ? static_cast<double>(hits) / lookups : 0.0;
+    }
+} response_cache_stats;
+
+// Exact match LLM response cache.
+// Keys are XXH64 of the normalized prompt + model + parameter signature, so
+// "What time do you open?" and "what time do you open" share an entry.
+// Entries are kept in an in-memory LRU and appended to a JSON-lines log on
+// disk, which is replayed (and compacted) by load() so the cache survives
+// restarts.
+class response_cache {
+public:
+    explicit response_cache(const response_cache_config& p_config = {});
+
+    bool load();
+
+    bool lookup(const std::string& p_prompt,
+                const std::string& p_model,
+                const std::string& p_params,
+                std::string& p_response);
+
+    // p_ttl_s < 0 uses the configured default
+    void store(const std::string& p_prompt,
+               const std::string& p_model,
+               const std::string& p_params,
+               const std::string& p_response,
+               int64_t p_ttl_s = -1);
+
+    response_cache_stats stats() const;
+
+    // Lowercase, punctuation dropped, whitespace collapsed
+    static std::string normalize_prompt(const std::string& p_prompt);
+
+private:
+    typedef struct entry {
+        std::string prompt; // Normalized, guards against hash collisions
+        std::string response;
+        int64_t expires_at; // Unix seconds, 0 = never
+    } entry;
+
+    static std::string make_key(const std::string& p_normalized,
+                                const std::string& p_model,
+                                const std::string& p_params);
+
+    void append_to_log(const std::string& p_key, const entry& p_entry);
+
+    response_cache_config cfg;
+    sealed_log log; // Opened on first use when cfg.key is set
+    mutable std::mutex mutex;
+    lru_cache<std::string, entry> memory;
+    response_cache_stats counters = {0, 0, 0, 0, 0};
+};
+
+#endif // !RESPONSE_CACHE
@@ -0,0 +1,84 @@
+#ifndef SEMANTIC_CACHE
+#define SEMANTIC_CACHE
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+#include "hashing_embedder.hpp"
+#include "hnsw_index.hpp"
+
+typedef struct semantic_cache_config {
+    float threshold = 0.85f;      // Minimum cosine similarity for a hit
+    size_t capacity = 8192;       // Live entries, the oldest half is dropped past this
+    int64_t ttl_s = 24 * 60 * 60; // <= 0 never expires
+    size_t dim = 256;
+} semantic_cache_config;
+
+typedef struct semantic_cache_stats {
+    u_int64_t hits;
+    u_int64_t misses;
+    size_t entries;
+    double last_lookup_us;
+    double avg_lookup_us;
+    double max_lookup_us;
+    float last_similarity; // Best similarity seen by the last lookup
+
+    double hit_rate() const {
+        u_int64_t lookups = hits + misses;
+        return lookups ? static_cast<double>(hits) / lookups : 0.0;
+    }
+} semantic_cache_stats;
+
+// Second cache tier behind the exact response_cache.
+// Prompts are embedded locally (hashing_embedder) and looked up in an HNSW
+// index, a cached answer is returned when the closest stored prompt for the
+// same model / parameters is similar enough and asks about the same things:
+// "patient 1234" and "patient 1235", or "today" and "tomorrow", embed almost
+// alike, so numbers, dates and names (see specifics()) have to match
+// exactly. Memory only, it is re-filled as the session goes.
+class semantic_cache {
+public:
+    explicit semantic_cache(const semantic_cache_config& p_config = {});
+
+    bool lookup(const std::string& p_prompt,
+                const std::string& p_model,
+                const std::string& p_params,
+                std::string& p_response);
+
+    void store(const std::string& p_prompt,
+               const std::string& p_model,
+               const std::string& p_params,
+               const std::string& p_response);
+
+    semantic_cache_stats stats() const;
+
+    // Numbers, day and date words, and names (capitalized past the start of
+    // a sentence) of p_prompt, lowercase and sorted
+    static std::string specifics(const std::string& p_prompt);
+
+private:
+    typedef struct entry {
+        u_int64_t scope; // Hash of model + params, answers never cross models
+        std::string specifics;
+        std::string response;
+        int64_t expires_at;
+        std::vector<float> vector; // Kept for rebuilding the index
+    } entry;
+
+    void rebuild(); // Drops expired entries and the oldest half, mutex held
+
+    semantic_cache_config cfg;
+    hashing_embedder embedder;
+    hnsw_index index;
+    std::vector<entry> entries; // Indexed by hnsw node id
+
+    mutable std::mutex mutex;
+    semantic_cache_stats counters = {0, 0, 0, 0.0, 0.0, 0.0, 0.0f};
+    double total_lookup_us = 0.0;
+};
+
+#endif // !SEMANTIC_CACHE
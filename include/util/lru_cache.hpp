@@ -0,0 +1,76 @@
+#ifndef LRU_CACHE
+#define LRU_CACHE
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+// Plain least-recently-used map. Not thread safe, the owners lock around it.
+template <typename K, typename V, typename Hash = std::hash<K>>
+class lru_cache {
+public:
+    explicit lru_cache(size_t p_capacity = 128) : cap(p_capacity ? p_capacity : 1) { }
+
+    // Returns nullptr on miss, a hit becomes the most recently used entry
+    V* get(const K& p_key) {
+        auto it = index.find(p_key);
+        if (it == index.end()) {
+            return nullptr;
+        }
+        entries.splice(entries.begin(), entries, it->second);
+        return &it->second->second;
+    }
+
+    // Inserts or overwrites, evicting the least recently used entry when full
+    void put(const K& p_key, V p_value) {
+        auto it = index.find(p_key);
+        if (it != index.end()) {
+            it->second->second = std::move(p_value);
+            entries.splice(entries.begin(), entries, it->second);
+            return;
+        }
+
+        if (entries.size() >= cap) {
+            index.erase(entries.back().first);
+            entries.pop_back();
+        }
+
+        entries.emplace_front(p_key, std::move(p_value));
+        index[p_key] = entries.begin();
+    }
+
+    bool erase(const K& p_key) {
+        auto it = index.find(p_key);
+        if (it == index.end()) {
+            return false;
+        }
+        entries.erase(it->second);
+        index.erase(it);
+        return true;
+    }
+
+    // Most recently used first
+    template <typename F>
+    void for_each(F&& p_func) const {
+        for (const auto& [key, value] : entries) {
+            p_func(key, value);
+        }
+    }
+
+    size_t size() const { return entries.size(); }
+    size_t capacity() const { return cap; }
+
+    void clear() {
+        entries.clear();
+        index.clear();
+    }
+
+private:
+    size_t cap;
+    std::list<std::pair<K, V>> entries;
+    std::unordered_map<K, typename std::list<std::pair<K, V>>::iterator, Hash> index;
+};
+
+#endif // !LRU_CACHE
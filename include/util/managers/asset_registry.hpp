@@ -0,0 +1,137 @@
+#ifndef ASSET_REGISTRY
+#define ASSET_REGISTRY
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <unordered_map>
+#include <vector>
+
+#include "../typedefs.hpp"
+
+// Transparent hasher so names can be looked up from a string_view / const char*
+// without building a temporary std::string
+struct asset_name_hash {
+    using is_transparent = void;
+    size_t operator()(std::string_view p_name) const noexcept {
+        return std::hash<std::string_view>{}(p_name);
+    }
+};
+
+// Generational asset registry shared by the managers.
+// Names are interned once at load time and resolved to an asset_handle,
+// every hot-path lookup after that is a bounds check + generation compare.
+// Erasing an asset bumps the slot generation, so stale handles are detected
+// instead of silently aliasing whatever gets loaded into the slot next.
+//
+// NOTE: pointers returned by get() are only valid until the next insert()
+template <typename T>
+class asset_registry {
+public:
+    // Returns the existing handle if p_name is already registered
+    asset_handle insert(std::string_view p_name, const T& p_asset) {
+        auto it = names.find(p_name);
+        if (it != names.end()) {
+            return it->second;
+        }
+
+        u_int32_t index;
+        if (!free_slots.empty()) {
+            index = free_slots.back();
+            free_slots.pop_back();
+        } else {
+            index = static_cast<u_int32_t>(slots.size());
+            slots.push_back({T{}, 1, false, {}});
+        }
+
+        slot& s = slots[index];
+        s.asset = p_asset;
+        s.alive = true;
+
+        auto [name_it, inserted] = names.emplace(std::string(p_name), asset_handle{index, s.generation});
+        s.name = name_it->first;
+
+        return name_it->second;
+    }
+
+    // Name -> handle, meant to be called once when the asset is loaded (not per frame)
+    asset_handle find(std::string_view p_name) const {
+        auto it = names.find(p_name);
+        return (it != names.end()) ? it->second : INVALID_ASSET_HANDLE;
+    }
+
+    bool valid(asset_handle p_handle) const {
+        return p_handle.index < slots.size() &&
+               slots[p_handle.index].alive &&
+               slots[p_handle.index].generation == p_handle.generation;
+    }
+
+    // O(1) lookup, returns nullptr for invalid or stale (use-after-free) handles
+    T* get(asset_handle p_handle) {
+        return valid(p_handle) ? &slots[p_handle.index].asset : nullptr;
+    }
+
+    const T* get(asset_handle p_handle) const {
+        return valid(p_handle) ? &slots[p_handle.index].asset : nullptr;
+    }
+
+    std::string_view name_of(asset_handle p_handle) const {
+        return valid(p_handle) ? slots[p_handle.index].name : std::string_view{};
+    }
+
+    bool erase(asset_handle p_handle) {
+        if (!valid(p_handle)) {
+            return false;
+        }
+
+        slot& s = slots[p_handle.index];
+        names.erase(names.find(s.name));
+        s.asset = T{};
+        s.name = {};
+        s.alive = false;
+        s.generation++; // Invalidates every outstanding handle to this slot
+        free_slots.push_back(p_handle.index);
+
+        return true;
+    }
+
+    // Calls p_func(name, asset) for every live asset
+    template <typename F>
+    void for_each(F&& p_func) {
+        for (slot& s : slots) {
+            if (s.alive) {
+                p_func(s.name, s.asset);
+            }
+        }
+    }
+
+    size_t size() const { return names.size(); }
+
+    void clear() {
+        // Bump generations instead of dropping the slots so old handles stay detectable
+        for (u_int32_t i = 0; i < slots.size(); i++) {
+            if (slots[i].alive) {
+                slots[i] = {T{}, slots[i].generation + 1, false, {}};
+                free_slots.push_back(i);
+            }
+        }
+        names.clear();
+    }
+
+private:
+    typedef struct slot {
+        T asset;
+        u_int32_t generation;
+        bool alive;
+        std::string_view name; // Points into the key stored in `names`
+    } slot;
+
+    std::vector<slot> slots;
+    std::vector<u_int32_t> free_slots;
+    std::unordered_map<std::string, asset_handle, asset_name_hash, std::equal_to<>> names;
+};
+
+#endif // !ASSET_REGISTRY
@@ -16,7 +16,9 @@
 #include <vector>
 #include <mutex>
 
+#include "../sealed_file.hpp"
 #include "../typedefs.hpp"
+#include "asset_registry.hpp"
 
 class sound_manager {
 public: 
@@ -25,9 +27,11 @@ public:
     static sound_manager& get_instance();
 
     bool init();
-    bool load_wav(const std::string& p_path, const std::string& p_name);
-    wav_audio* get_audio(const std::string& p_name);
-    void play(const std::string& p_name);
+    // Returns INVALID_ASSET_HANDLE on failure, resolve names once and keep the handle
+    asset_handle load_wav(const std::string& p_path, const std::string& p_name);
+    asset_handle find_audio(const std::string& p_name) const;
+    wav_audio* get_audio(asset_handle p_handle);
+    void play(asset_handle p_handle);
     void quit();
     
 private:
@@ -36,7 +40,7 @@ private:
 
     SDL_AudioDeviceID audio_device = 0;
     
-    std::unordered_map<std::string, wav_audio> audio_cache;
+    asset_registry<wav_audio> audio_cache;
 };
 
 // SDL Audio capture
@@ -59,11 +63,13 @@ public:
     SDL_AudioStream* stream_i;
 
     FILE* wav_file;
+    sealed_file sealed_wav; // Instead of wav_file when data_key() is set
     u_int32_t wav_data;
     SDL_AudioSpec audio_spec;
 
 private:
-    void write_wav(FILE* p_file, const SDL_AudioSpec* p_spec, u_int32_t p_data);
+    bool open_wav(); // output.wav with a placeholder header
+    void write_wav(const SDL_AudioSpec* p_spec, u_int32_t p_data); // Patches the header
 };
 
 #endif // !SOUND_MANAGER
@@ -9,6 +9,7 @@
 #include <algorithm>
 
 #include "../typedefs.hpp"
+#include "asset_registry.hpp"
 
 class text_manager {
 public:
@@ -20,14 +21,15 @@ public:
 
     bool init(); // Init SDL_TTF
     
-    bool load_font(const std::string& p_path, 
-                   const std::string& p_name, 
-                   int p_def_ptsize = 14); // Load a font from a path, then give it a name
-    ttf_font* get_font(const std::string& p_name);
+    asset_handle load_font(const std::string& p_path, 
+                           const std::string& p_name, 
+                           int p_def_ptsize = 14); // Load a font from a path, then give it a name (INVALID_ASSET_HANDLE on failure)
+    asset_handle find_font(const std::string& p_name) const; // Resolve a name once, then keep the handle
+    ttf_font* get_font(asset_handle p_font);
 
     // A very complex but very usable text rendering function
     void render_text(SDL_Renderer* p_renderer,
-                    const std::string& p_font_name,
+                    asset_handle p_font,
                     const std::string& p_text, 
                     float ptsize,
                     const SDL_Color p_color,
@@ -38,7 +40,7 @@ public:
                     bool p_shadow_outline); 
 
     // Batch rendering support
-    void queue_text(const std::string& p_font_name,
+    void queue_text(asset_handle p_font,
                     const std::string& p_text,
                     float p_ptsize,
                     const SDL_Color p_color,
@@ -50,7 +52,7 @@ public:
     void render_queued_text(SDL_Renderer* p_renderer); // Also batch rednering support
 
     // Util for getting text rect size (might move to tools.hpp)
-    SDL_Rect get_text_size(const std::string& p_font_name,
+    SDL_Rect get_text_size(asset_handle p_font,
                         const std::string& p_text,
                         float p_ptsize,
                         int p_max_width,
@@ -64,12 +66,12 @@ private:
     ~text_manager();
 
     // Caches for different parts
-    std::unordered_map<std::string, ttf_font> font_cache; // To store fonts
+    asset_registry<ttf_font> font_cache; // To store fonts
     std::unordered_map<std::string, SDL_Texture*> text_texture_cache; // To store text textures (switching to text labeling system instead)
     std::vector<text_render_request> render_queue; // Text batching system
 
     // Helper functions
-    std::string generate_cache_key(const std::string& p_font_name,
+    std::string generate_cache_key(asset_handle p_font,
                                  const char* p_text,
                                  float p_ptsize,
                                  const SDL_Color p_color) const; // Creates key for bacthed text request
@@ -0,0 +1,120 @@
+#ifndef SEALED_FILE
+#define SEALED_FILE
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <vector>
+
+#define SEAL_CHUNK (16 << 10) // Plaintext bytes per chunk of a new sealed_file
+
+struct evp_cipher_ctx_st; // EVP_CIPHER_CTX, OpenSSL stays out of this header
+
+// AES-256 master key. Each file derives its own key from it and a random salt
+typedef struct seal_key {
+    u_int8_t bytes[32] = {};
+    bool set = false;
+} seal_key;
+
+// The key data at rest is sealed with: AVA_DATA_KEY (64 hex digits) or the
+// file AVA_DATA_KEY_FILE names (the same, or 32 raw bytes). Unset, data is
+// written in plaintext as before. Read once
+const seal_key& data_key();
+
+bool parse_seal_key(std::string_view p_text, seal_key& p_key);
+
+// Starts with the magic of a sealed_file or a sealed_log
+bool is_sealed(const std::string& p_path);
+
+// A file encrypted and authenticated in chunks (AES-256-GCM, through
+// OpenSSL's EVP so AES-NI and PCLMUL or VAES do the work).
+//
+// A header with a random salt, then every SEAL_CHUNK bytes of plaintext as
+// nonce, ciphertext and tag. A chunk's position, and whether it's the last
+// one, are authenticated with it: chunks can't be moved, swapped between
+// files or cut off the end unnoticed. Any byte range can be read or written
+// without touching the rest, so the file works like a plain one under
+// pread/pwrite style access. Writes collect whole plaintext chunks in memory
+// and sync() seals them with a fresh nonce each; a chunk is never rewritten
+// in place without its old ciphertext first saved to <path>.journal, which
+// open() rolls back, so a crash leaves every chunk as it was before or after
+// the last sync(). One thread at a time.
+class sealed_file {
+public:
+    sealed_file() = default;
+    ~sealed_file();
+
+    sealed_file(const sealed_file&) = delete;
+    sealed_file& operator = (const sealed_file&) = delete;
+
+    // Creates p_path if it's missing or empty. False if it isn't sealed or doesn't open with p_key
+    bool open(const std::string& p_path, const seal_key& p_key);
+    bool close(); // Syncs first, false if that failed
+    bool is_open() const { return fd >= 0; }
+
+    u_int64_t size() const { return length; } // Plaintext, writes not synced yet included
+    bool read(u_int64_t p_offset, void* p_out, size_t p_bytes);
+    bool write(u_int64_t p_offset, const void* p_data, size_t p_bytes); // Past the end grows the file (zeros between)
+    bool sync(); // Every write so far is on disk
+    size_t chunk_size() const { return chunk; }
+
+private:
+    size_t physical_chunk() const;
+    u_int64_t chunks_on_disk() const; // Incl. the last, partial one
+    bool load_chunk(u_int64_t p_index, std::string& p_plain); // As on disk
+    bool seal_chunk(u_int64_t p_index, bool p_last, const std::string& p_plain, u_int8_t* p_out);
+    std::string* chunk_for_write(u_int64_t p_index); // Its dirty copy, nullptr if it can't be read
+    bool recover(); // Rolls back an interrupted sync()
+
+    int fd = -1;
+    std::string path;
+    size_t chunk = SEAL_CHUNK;
+    u_int64_t length = 0;                   // Plaintext bytes
+    u_int64_t synced_length = 0;            // Of them on disk
+    std::map<u_int64_t, std::string> dirty; // Chunk index -> whole plaintext, not on disk yet
+    size_t dirty_bytes = 0;
+    evp_cipher_ctx_st* encrypt_ctx = nullptr;
+    evp_cipher_ctx_st* decrypt_ctx = nullptr;
+    std::vector<u_int8_t> scratch;          // Sealed chunks on their way in or out
+};
+
+// An append only file of sealed records (the same cipher), for logs: each
+// append() is one record authenticated together with its offset, a torn or
+// altered record and everything after it are dropped by open(). A header
+// with a fresh salt starts the file on the first append after reset().
+class sealed_log {
+public:
+    sealed_log() = default;
+    ~sealed_log();
+
+    sealed_log(const sealed_log&) = delete;
+    sealed_log& operator = (const sealed_log&) = delete;
+
+    // p_plain gets every intact record, back to back. False if the file can't be read or the key is wrong
+    bool open(const std::string& p_path, const seal_key& p_key, std::string& p_plain);
+    void close();
+    bool is_open() const { return fd >= 0; }
+
+    bool append(std::string_view p_plain);
+    bool sync();  // fdatasync
+    bool reset(); // Empty again, durably
+    u_int64_t bytes() const { return file_bytes; } // On disk, header and tags included
+
+private:
+    bool start(); // New header and key
+
+    int fd = -1;
+    seal_key master;
+    u_int64_t file_bytes = 0;
+    evp_cipher_ctx_st* encrypt_ctx = nullptr;
+};
+
+// Whole files: read whatever p_path holds, sealed (with p_key) or not, and
+// write p_data sealed when p_key is set (plaintext otherwise) to a temporary
+// file that's then renamed over p_path
+bool load_sealed(const std::string& p_path, std::string& p_data, const seal_key& p_key);
+bool save_sealed(const std::string& p_path, std::string_view p_data, const seal_key& p_key);
+
+#endif // !SEALED_FILE
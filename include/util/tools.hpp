@@ -12,6 +12,7 @@
 #include <unistd.h>
 #include <iostream>
 #include "../json/json.hpp"
+#include "json_path.hpp"
 
 using json = nlohmann::json;
 
@@ -92,66 +93,26 @@ inline std::string run_command(const char* cmd) {
     return str;
 }
 
-inline std::string query_gemini(const std::string& prompt) {
-    const std::string api_key = "ADD-YOUR-OWN";
-
-    // Properly escape JSON payload for shell
-    std::string json_data =
-        "{\"contents\":[{\"parts\":[{\"text\":\"" + prompt + "\"}]}]}";
-
-    std::string cmd =
-        "curl -s \"https://generativelanguage.googleapis.com/v1beta/models/gemini-2.0-flash:generateContent\" "
-        "-H \"Content-Type: application/json\" "
-        "-H \"X-goog-api-key: " + api_key + "\" "
-        "-X POST "
-        "-d '" + json_data + "'";
-
-    std::string result;
-    char buffer[256];
-
-    FILE* pipe = popen(cmd.c_str(), "r");
-    if (!pipe) {
-        std::cerr << "ERROR: Failed to run curl command.\n";
-        return "";
-    }
-
-    while (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
-        result += buffer;
-    }
-
-    int exit_code = pclose(pipe);
-    if (exit_code != 0) {
-        std::cerr << "ERROR: curl exited with code " << exit_code << "\n";
-    }
-
-    if (result.empty()) {
-        std::cerr << "ERROR: Gemini API returned an empty response.\n";
-    }
-
-    return result;
-}
-
+// Only walks as far as candidates[0].content.parts[0].text, no DOM is built
 inline std::string extract_text(const std::string& json_str) {
     if (json_str.empty()) {
         std::cerr << "ERROR: extract_text received empty string.\n";
         return "";
     }
 
-    try {
-        auto j = json::parse(json_str);
-
-        // Optional: sanity check
-        if (!j.contains("candidates") || j["candidates"].empty()) {
-            std::cerr << "ERROR: JSON does not contain valid 'candidates'.\n";
-            return "";
-        }
+    std::string text;
+    if (json_find_string(json_str, {"candidates", 0, "content", "parts", 0, "text"}, text)) {
+        return text;
+    }
 
-        return j["candidates"][0]["content"]["parts"][0]["text"];
-    } catch (const std::exception& e) {
-        std::cerr << "JSON parse error: " << e.what() << "\n";
+    std::string message;
+    if (json_find_string(json_str, {"error", "message"}, message)) {
+        std::cerr << "ERROR: Gemini API: " << message << "\n";
+    } else {
+        std::cerr << "ERROR: JSON does not contain valid 'candidates'.\n";
         std::cerr << "Raw input: " << json_str << "\n";
-        return "";
     }
+    return "";
 }
 
 #endif // TOOLS
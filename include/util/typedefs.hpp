@@ -26,6 +26,18 @@ typedef struct vector_2i {
     int y;
 } vector_2i;
 
+// For the asset registry (see managers/asset_registry.hpp)
+typedef struct asset_handle {
+    u_int32_t index;
+    u_int32_t generation; // 0 is never a live generation
+} asset_handle;
+
+static constexpr asset_handle INVALID_ASSET_HANDLE = {0, 0};
+
+inline bool operator==(asset_handle p_a, asset_handle p_b) {
+    return p_a.index == p_b.index && p_a.generation == p_b.generation;
+}
+
 // For Sound Manager
 typedef struct wav_audio {
     uint8_t *data;
@@ -44,7 +56,7 @@ typedef struct ttf_font {
 } ttf_font;
 
 typedef struct text_render_request {
-    std::string font_name;
+    asset_handle font;
     std::string text;
     float ptsize;
     SDL_Color color;
@@ -84,15 +96,51 @@ typedef enum gender {
     FEMALE = 0
 } gender;
 
+// Where a string lives in a string arena (see clinic/patient_store.hpp)
+typedef struct string_ref {
+    u_int32_t offset;
+    u_int32_t length;
+} string_ref;
+
+// Fields scans and lookups touch, one fixed size row per patient
+typedef struct patient_hot {
+    u_int64_t id;
+    string_ref name;
+    u_int32_t date_of_birth; // pack_date(), 0 when unknown
+    u_int8_t gender;         // enum gender
+    u_int8_t age;
+    u_int16_t reserved;
+} patient_hot;
+
+// The rest, in a separate column so scans don't pull it into cache
+typedef struct patient_cold {
+    u_int64_t number;
+    string_ref email;
+    string_ref address;
+} patient_cold;
+
+// A whole patient as handed to and copied out of patient_records
 typedef struct patient {
+    u_int64_t id = 0;
+    std::string name;
+    u_int32_t date_of_birth = 0; // pack_date(), 0 when unknown
+    u_int8_t gender = FEMALE;
+    u_int8_t age = 0;
+    u_int64_t number = 0;
+    std::string email;
+    std::string address;
+} patient;
+
+// The fixed size record version 1 stores were made of, read once to migrate them
+typedef struct legacy_patient {
     char name[256];
     char date_of_birth[64];
     char email[128];
     char address[1024];
-    const char* gender;
+    u_int8_t gender;
     u_int8_t age;
     u_int64_t id;
     u_int64_t number;
-} patient;
+} legacy_patient;
 
 #endif // !UTIL
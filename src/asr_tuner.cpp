@@ -0,0 +1,242 @@
+#include "util/asr/asr_tuner.hpp"
+#include "json/json.hpp"
+#include <SDL3/SDL_log.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+using json = nlohmann::json;
+
+namespace {
+
+// Lowercase words with punctuation stripped, "Ode." and "ode" are the same word
+std::vector<std::string> normalize_words(const std::string& p_text) {
+    std::vector<std::string> words;
+    std::string word;
+    for (char c : p_text) {
+        unsigned char u = static_cast<unsigned char>(c);
+        if (std::isalnum(u) || c == '\'') {
+            word += static_cast<char>(std::tolower(u));
+        } else if (std::isspace(u) && !word.empty()) {
+            words.push_back(std::move(word));
+            word.clear();
+        }
+    }
+    if (!word.empty()) {
+        words.push_back(std::move(word));
+    }
+    return words;
+}
+
+} // namespace
+
+tuning_grid default_tuning_grid(const std::string& p_model_dir) {
+    tuning_grid grid;
+
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(p_model_dir, ec)) {
+        std::string name = entry.path().filename().string();
+        if (name.starts_with("ggml-") && name.ends_with(".bin")) {
+            grid.models.push_back(entry.path().string());
+        }
+    }
+    std::sort(grid.models.begin(), grid.models.end());
+    if (grid.models.empty()) {
+        grid.models.push_back(transcriber_config{}.model_path);
+    }
+
+    const u_int32_t cores = std::max(1u, std::thread::hardware_concurrency());
+    for (u_int32_t t = 1; t < cores; t *= 2) {
+        grid.threads.push_back(t);
+    }
+    grid.threads.push_back(cores);
+
+    grid.beam_sizes = {1, 5};
+    grid.best_of = {1, 5};
+
+    return grid;
+}
+
+bool load_reference(const std::string& p_wav_path, asr_reference& p_out) {
+    p_out.wav_path = p_wav_path;
+
+    // Written by a person: whisper's own output (<wav>.json) would score the
+    // model that produced it as perfect and the tuner could never pick another
+    std::ifstream txt(p_wav_path + ".txt");
+    if (!txt) {
+        return false;
+    }
+    std::stringstream ss;
+    ss << txt.rdbuf();
+    p_out.text = ss.str();
+    return true;
+}
+
+double word_error_rate(const std::string& p_reference, const std::string& p_hypothesis) {
+    std::vector<std::string> ref = normalize_words(p_reference);
+    std::vector<std::string> hyp = normalize_words(p_hypothesis);
+    if (ref.empty()) {
+        return hyp.empty() ? 0.0 : 1.0;
+    }
+
+    // Word level Levenshtein distance, two rows
+    std::vector<size_t> prev(hyp.size() + 1), curr(hyp.size() + 1);
+    for (size_t j = 0; j <= hyp.size(); j++) {
+        prev[j] = j;
+    }
+    for (size_t i = 1; i <= ref.size(); i++) {
+        curr[0] = i;
+        for (size_t j = 1; j <= hyp.size(); j++) {
+            size_t substitute = prev[j - 1] + (ref[i - 1] != hyp[j - 1]);
+            curr[j] = std::min({prev[j] + 1, curr[j - 1] + 1, substitute});
+        }
+        std::swap(prev, curr);
+    }
+
+    return static_cast<double>(prev[hyp.size()]) / ref.size();
+}
+
+std::vector<tuning_result> run_asr_benchmark(const transcriber_config& p_base,
+                                             const tuning_grid& p_grid,
+                                             const std::vector<asr_reference>& p_references) {
+    std::vector<tuning_result> results;
+
+    std::vector<pcm_buffer> audio(p_references.size());
+    for (size_t i = 0; i < p_references.size(); i++) {
+        read_wav(p_references[i].wav_path, audio[i]);
+    }
+
+    for (const auto& model : p_grid.models) {
+        for (u_int32_t threads : p_grid.threads) {
+            for (u_int32_t beam : p_grid.beam_sizes) {
+                for (u_int32_t best_of : p_grid.best_of) {
+                    // best_of only applies to sampling (beam size 1), with a beam it's the same run again
+                    if (beam > 1 && best_of > 1) {
+                        continue;
+                    }
+                    transcriber_config cfg = p_base;
+                    cfg.model_path = model;
+                    cfg.threads_per_job = threads;
+                    cfg.jobs = 1;
+                    cfg.beam_size = beam;
+                    cfg.best_of = best_of;
+                    cfg.use_cache = false; // We want the engine, not the cache
+                    transcriber engine(cfg);
+
+                    tuning_result result = {model, threads, beam, best_of, 0.0, 0.0, true};
+                    for (size_t i = 0; i < p_references.size(); i++) {
+                        auto start = std::chrono::steady_clock::now();
+                        transcript out = engine.transcribe_file(p_references[i].wav_path);
+                        double wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+                        result.ok &= out.ok;
+                        result.rtf += wall_ms / std::max(1.0, pcm_duration_ms(audio[i]));
+                        result.wer += word_error_rate(p_references[i].text, out.text());
+                    }
+                    result.rtf /= std::max<size_t>(1, p_references.size());
+                    result.wer /= std::max<size_t>(1, p_references.size());
+
+                    printf("%-32s t=%-3u bs=%-2u bo=%-2u  RTF %.3f  WER %5.1f%%%s\n",
+                           model.c_str(), threads, beam, best_of,
+                           result.rtf, result.wer * 100.0, result.ok ? "" : "  (FAILED)");
+                    fflush(stdout);
+
+                    results.push_back(result);
+                }
+            }
+        }
+    }
+
+    return results;
+}
+
+const tuning_result* pick_best(const std::vector<tuning_result>& p_results, double p_max_rtf) {
+    const tuning_result* best = nullptr;
+    const tuning_result* fastest = nullptr;
+
+    for (const auto& result : p_results) {
+        if (!result.ok) {
+            continue;
+        }
+        if (!fastest || result.rtf < fastest->rtf) {
+            fastest = &result;
+        }
+        if (result.rtf <= p_max_rtf &&
+            (!best || result.wer < best->wer || (result.wer == best->wer && result.rtf < best->rtf))) {
+            best = &result;
+        }
+    }
+
+    return best ? best : fastest;
+}
+
+std::string host_id() {
+    char name[256] = {0};
+    if (gethostname(name, sizeof(name) - 1) != 0) {
+        std::snprintf(name, sizeof(name), "unknown");
+    }
+    return std::string(name) + "/" + std::to_string(std::thread::hardware_concurrency());
+}
+
+bool save_asr_tuning(const std::string& p_path, const tuning_result& p_best, double p_max_rtf) {
+    json j = json::object();
+
+    // Keep the other machines' entries, the file can be shared
+    std::ifstream in(p_path);
+    if (in) {
+        try {
+            j = json::parse(in);
+        } catch (const std::exception&) {
+            j = json::object();
+        }
+    }
+
+    j[host_id()] = {
+        {"model", p_best.model},
+        {"threads", p_best.threads},
+        {"beam_size", p_best.beam_size},
+        {"best_of", p_best.best_of},
+        {"rtf", p_best.rtf},
+        {"wer", p_best.wer},
+        {"rtf_budget", p_max_rtf}
+    };
+
+    std::ofstream out(p_path);
+    if (!out) {
+        SDL_Log("asr_tuner: couldn't write %s", p_path.c_str());
+        return false;
+    }
+    out << j.dump(4);
+    return true;
+}
+
+bool load_asr_tuning(const std::string& p_path, transcriber_config& p_config) {
+    std::ifstream in(p_path);
+    if (!in) {
+        return false;
+    }
+
+    try {
+        json j = json::parse(in);
+        auto it = j.find(host_id());
+        if (it == j.end()) {
+            return false;
+        }
+
+        p_config.model_path = it->at("model").get<std::string>();
+        p_config.threads_per_job = it->at("threads").get<u_int32_t>();
+        p_config.beam_size = it->at("beam_size").get<u_int32_t>();
+        p_config.best_of = it->at("best_of").get<u_int32_t>();
+    } catch (const std::exception& e) {
+        SDL_Log("asr_tuner: ignoring bad %s: %s", p_path.c_str(), e.what());
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,722 @@
+#include "batch.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string_view>
+#include <thread>
+#include <unistd.h>
+#include <unordered_set>
+#include <vector>
+
+#include "util/asr/asr_tuner.hpp"
+#include "util/clinic/duplicate_finder.hpp"
+#include "util/clinic/patient_analytics.hpp"
+#include "util/clinic/patient_fields.hpp"
+#include "util/clinic/patient_index.hpp"
+#include "util/clinic/patient_io.hpp"
+#include "util/clinic/patient_store.hpp"
+#include "util/json_path.hpp"
+#include "util/llm/semantic_cache.hpp"
+#include "util/sealed_file.hpp"
+#include "util/tools.hpp"
+
+// Gemini shaped response with the metadata a real one carries around the text
+static std::string sample_gemini_response(size_t p_text_bytes) {
+    std::string answer;
+    while (answer.size() < p_text_bytes) {
+        answer += "Dr. M\\u00fcller sees patients on Tuesdays from 9:00 to 12:30. "
+                  "Please bring your \\\"insurance card\\\" and arrive 10 minutes early.\\n";
+    }
+
+    json rating = json::array();
+    for (const char* category : {"HARM_CATEGORY_HATE_SPEECH", "HARM_CATEGORY_DANGEROUS_CONTENT",
+                                 "HARM_CATEGORY_HARASSMENT", "HARM_CATEGORY_SEXUALLY_EXPLICIT"}) {
+        rating.push_back({{"category", category}, {"probability", "NEGLIGIBLE"}});
+    }
+
+    // Text goes in pre-escaped, json would double the backslashes
+    std::string doc = json{
+        {"candidates", json::array({json{
+            {"content", {{"parts", json::array({json{{"text", "@TEXT@"}}})}, {"role", "model"}}},
+            {"finishReason", "STOP"},
+            {"safetyRatings", rating},
+            {"avgLogprobs", -0.1234}
+        }})},
+        {"usageMetadata", {{"promptTokenCount", 42}, {"candidatesTokenCount", 512}, {"totalTokenCount", 554}}},
+        {"modelVersion", "gemini-2.0-flash"}
+    }.dump(2);
+    doc.replace(doc.find("@TEXT@"), 6, answer);
+    return doc;
+}
+
+// DOM parse vs path scan over the same response, p_iterations each
+static bool bench_json_extract(const std::string& p_doc, size_t p_iterations) {
+    typedef std::chrono::steady_clock clock_type;
+    auto ns_per_op = [p_iterations](clock_type::time_point p_start) {
+        return std::chrono::duration<double, std::nano>(clock_type::now() - p_start).count() / p_iterations;
+    };
+
+    size_t sink = 0;
+    std::string dom_text;
+
+    auto start = clock_type::now();
+    for (size_t i = 0; i < p_iterations; i++) {
+        json j = json::parse(p_doc);
+        dom_text = j["candidates"][0]["content"]["parts"][0]["text"];
+        sink += dom_text.size();
+    }
+    double dom_ns = ns_per_op(start);
+
+    std::string scratch;
+    std::string_view view;
+    start = clock_type::now();
+    for (size_t i = 0; i < p_iterations; i++) {
+        json_value value;
+        if (json_find(p_doc, {"candidates", 0, "content", "parts", 0, "text"}, value) &&
+            json_string(value, scratch, view)) {
+            sink += view.size();
+        }
+    }
+    double scan_ns = ns_per_op(start);
+
+    std::string copy;
+    start = clock_type::now();
+    for (size_t i = 0; i < p_iterations; i++) {
+        json_find_string(p_doc, {"candidates", 0, "content", "parts", 0, "text"}, copy);
+        sink += copy.size();
+    }
+    double copy_ns = ns_per_op(start);
+
+    bool same = view == dom_text && copy == dom_text;
+    double mb = static_cast<double>(p_doc.size()) / (1024.0 * 1024.0);
+    printf("%zu byte response, %zu byte text, %zu iterations (%zu)\n", p_doc.size(), dom_text.size(), p_iterations, sink);
+    printf("  DOM (json::parse)        %10.0f ns  %8.1f MB/s\n", dom_ns, mb / (dom_ns * 1e-9));
+    printf("  json_find + json_string  %10.0f ns  %8.1f MB/s  %.1fx\n", scan_ns, mb / (scan_ns * 1e-9), dom_ns / scan_ns);
+    printf("  json_find_string (copy)  %10.0f ns  %8.1f MB/s  %.1fx\n", copy_ns, mb / (copy_ns * 1e-9), dom_ns / copy_ns);
+    printf("  results %s\n", same ? "match" : "DIFFER");
+    return same;
+}
+
+// Made up but realistically sized patients, the same ones every run
+static void sample_patients(size_t p_count, std::vector<patient>& p_patients) {
+    static const char* const first[] = {"Maria", "James", "Ana", "Mohammed", "Sofia", "Liam", "Marta", "Noah",
+                                        "Elena", "Lucas", "Mariam", "Oliver", "Ines", "Mateo", "Emma", "Yusuf"};
+    static const char* const last[] = {"Garcia", "Smith", "Muller", "Rossi", "Nowak", "Silva", "Kowalski", "Dubois",
+                                       "Jensen", "Novak", "Fernandes", "Brown", "Schmidt", "Costa", "Moreau", "Ivanova"};
+
+    p_patients.resize(p_count);
+    u_int64_t state = 0x9E3779B97F4A7C15ull;
+    auto next = [&state]() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    };
+    for (size_t i = 0; i < p_count; i++) {
+        patient& p = p_patients[i];
+        p.id = i + 1;
+        p.name = std::string(first[next() % 16]) + " " + last[next() % 16];
+        p.date_of_birth = pack_date(1930 + next() % 90, 1 + next() % 12, 1 + next() % 28);
+        p.gender = next() % 2;
+        p.age = static_cast<u_int8_t>(2025 - date_year(p.date_of_birth));
+        p.number = 600000000 + next() % 100000000;
+        p.email = "patient" + std::to_string(p.id) + "@example.com";
+        p.address = std::to_string(1 + next() % 300) + " " + last[next() % 16] + " Street, Apt " +
+                    std::to_string(next() % 50) + ", Springfield";
+    }
+}
+
+// Fixed size legacy_patient records against the column store, p_count each
+static bool bench_patient_layout(size_t p_count) {
+    typedef std::chrono::steady_clock clock_type;
+    auto ms_since = [](clock_type::time_point p_start) {
+        return std::chrono::duration<double, std::milli>(clock_type::now() - p_start).count();
+    };
+    // Best of a few, the first pass also pays for page faults
+    auto best_ms = [&ms_since](auto p_scan, size_t& p_hits) {
+        double best = 1e300;
+        for (int round = 0; round < 5; round++) {
+            auto start = clock_type::now();
+            p_hits = p_scan();
+            best = std::min(best, ms_since(start));
+        }
+        return best;
+    };
+
+    std::vector<patient> patients;
+    sample_patients(p_count, patients);
+
+    std::vector<legacy_patient> legacy(p_count);
+    for (size_t i = 0; i < p_count; i++) {
+        const patient& p = patients[i];
+        legacy_patient& old = legacy[i];
+        std::memset(&old, 0, sizeof(old));
+        std::snprintf(old.name, sizeof(old.name), "%s", p.name.c_str());
+        std::snprintf(old.date_of_birth, sizeof(old.date_of_birth), "%s", format_date(p.date_of_birth).c_str());
+        std::snprintf(old.email, sizeof(old.email), "%s", p.email.c_str());
+        std::snprintf(old.address, sizeof(old.address), "%s", p.address.c_str());
+        old.gender = p.gender;
+        old.age = p.age;
+        old.id = p.id;
+        old.number = p.number;
+    }
+
+    // The migration path, fixed size record to patient to columns
+    patient_store store;
+    patient converted;
+    auto start = clock_type::now();
+    {
+        auto lock = store.write_lock();
+        for (const legacy_patient& old : legacy) {
+            from_legacy(old, converted);
+            store.upsert(converted);
+        }
+    }
+    double migrate_ms = ms_since(start);
+    std::span<const patient_hot> rows = store.all();
+
+    // Women born in the 1980s: date strings against packed dates
+    size_t legacy_women, column_women;
+    double legacy_filter_ms = best_ms([&legacy]() {
+        size_t hits = 0;
+        for (const legacy_patient& p : legacy) {
+            hits += p.gender == FEMALE && std::strncmp(p.date_of_birth, "198", 3) == 0;
+        }
+        return hits;
+    }, legacy_women);
+    const u_int32_t from = pack_date(1980, 1, 1), to = pack_date(1989, 12, 31);
+    double column_filter_ms = best_ms([rows, from, to]() {
+        size_t hits = 0;
+        for (const patient_hot& p : rows) {
+            hits += p.gender == FEMALE && p.date_of_birth >= from && p.date_of_birth <= to;
+        }
+        return hits;
+    }, column_women);
+
+    // Name prefix: inline arrays against the string arena
+    size_t legacy_names, column_names;
+    double legacy_name_ms = best_ms([&legacy]() {
+        size_t hits = 0;
+        for (const legacy_patient& p : legacy) {
+            hits += std::strncmp(p.name, "Mar", 3) == 0;
+        }
+        return hits;
+    }, legacy_names);
+    double column_name_ms = best_ms([rows, &store]() {
+        size_t hits = 0;
+        for (const patient_hot& p : rows) {
+            hits += store.text(p.name).starts_with("Mar");
+        }
+        return hits;
+    }, column_names);
+
+    // Secondary indexes: built once, then lookups instead of scans
+    patient_index index(store);
+    start = clock_type::now();
+    index.count_born_between(from, to);
+    double index_build_ms = ms_since(start);
+    size_t indexed_names, indexed_births;
+    double index_name_ms = best_ms([&index]() { return index.with_name_prefix("Mar", 20).size(); }, indexed_names);
+    double index_count_ms = best_ms([&index, from, to]() { return index.count_born_between(from, to); }, indexed_births);
+    size_t births = 0;
+    for (const patient_hot& p : rows) {
+        births += p.date_of_birth >= from && p.date_of_birth <= to;
+    }
+
+    store_stats stats = store.stats();
+    double legacy_mb = static_cast<double>(p_count * sizeof(legacy_patient)) / (1024.0 * 1024.0);
+    double column_mb = static_cast<double>(p_count * stats.row_bytes + stats.arena_bytes) / (1024.0 * 1024.0);
+    double hot_mb = static_cast<double>(p_count * sizeof(patient_hot)) / (1024.0 * 1024.0);
+    double index_mb = static_cast<double>(index.stats().memory) / (1024.0 * 1024.0);
+    bool same = legacy_women == column_women && legacy_names == column_names && indexed_births == births;
+
+    printf("%zu patients\n", p_count);
+    printf("  memory     legacy %8.1f MB (%zu B/record)  columns %6.1f MB (%zu B rows + %.0f B text)  %.1fx smaller\n",
+           legacy_mb, sizeof(legacy_patient), column_mb, stats.row_bytes,
+           static_cast<double>(stats.arena_bytes) / static_cast<double>(std::max<size_t>(p_count, 1)),
+           legacy_mb / column_mb);
+    printf("  migration  %.1f ms\n", migrate_ms);
+    printf("  date scan  legacy %8.2f ms  hot column %6.2f ms (%.1f MB)  %.1fx\n",
+           legacy_filter_ms, column_filter_ms, hot_mb, legacy_filter_ms / column_filter_ms);
+    printf("  name scan  legacy %8.2f ms  hot column %6.2f ms + arena     %.1fx\n",
+           legacy_name_ms, column_name_ms, legacy_name_ms / column_name_ms);
+    printf("  indexes    built in %.0f ms (%.1f MB)  20 names by prefix %.1f us  1980s births counted %.1f us\n",
+           index_build_ms, index_mb, index_name_ms * 1000.0, index_count_ms * 1000.0);
+    printf("  results %s (%zu / %zu matches)\n", same ? "match" : "DIFFER", column_women, column_names);
+    return same;
+}
+
+// Age, gender and birth year distributions from the analytics columns
+// against a walk over p_count patient structs, all of them and women in
+// their forties
+static bool bench_patient_analytics(size_t p_count) {
+    typedef std::chrono::steady_clock clock_type;
+    std::vector<patient> patients;
+    sample_patients(p_count, patients);
+    patient_records records;
+    records.upsert(patients);
+    patient_analytics analytics(records);
+
+    analytics_filter forties;
+    forties.min_age = 40;
+    forties.max_age = 49;
+    forties.gender = FEMALE;
+
+    bool same = true;
+    for (const analytics_filter& filter : {analytics_filter{}, forties}) {
+        double walk_ms = 1e300, column_ms = 1e300;
+        clinic_summary walked{}, summary{};
+        for (int round = 0; round < 5; round++) {
+            auto start = clock_type::now();
+            walked = clinic_summary{};
+            u_int64_t age_sum = 0;
+            for (const patient& p : patients) {
+                if (p.age < filter.min_age || p.age > filter.max_age || (filter.gender >= 0 && p.gender != filter.gender) ||
+                    p.date_of_birth < filter.born_from || p.date_of_birth > filter.born_to) {
+                    continue;
+                }
+                walked.patients++;
+                walked.by_gender[p.gender == MALE]++;
+                walked.by_age[p.age]++;
+                u_int32_t year = date_year(p.date_of_birth);
+                if (year >= FIRST_BIRTH_YEAR && year < FIRST_BIRTH_YEAR + 256) {
+                    walked.by_birth_year[year - FIRST_BIRTH_YEAR]++;
+                } else {
+                    walked.unknown_birth++;
+                }
+                age_sum += p.age;
+            }
+            walked.mean_age = walked.patients ? static_cast<double>(age_sum) / static_cast<double>(walked.patients) : 0.0;
+            walk_ms = std::min(walk_ms, std::chrono::duration<double, std::milli>(clock_type::now() - start).count());
+
+            summary = analytics.summarize(filter);
+            column_ms = std::min(column_ms, summary.ms);
+        }
+        same = same && walked.patients == summary.patients && walked.unknown_birth == summary.unknown_birth &&
+               std::memcmp(walked.by_gender, summary.by_gender, sizeof(walked.by_gender)) == 0 &&
+               std::memcmp(walked.by_age, summary.by_age, sizeof(walked.by_age)) == 0 &&
+               std::memcmp(walked.by_birth_year, summary.by_birth_year, sizeof(walked.by_birth_year)) == 0;
+        printf("  %-16s %9llu patients  structs %7.2f ms  columns %6.2f ms  %.1fx\n",
+               filter.gender < 0 ? "everyone" : "women in 40s", static_cast<unsigned long long>(summary.patients),
+               walk_ms, column_ms, walk_ms / column_ms);
+    }
+    printf("%zu patients, analytics %.1f MB\n", p_count, static_cast<double>(analytics.memory()) / (1024.0 * 1024.0));
+    printf("  results %s\n", same ? "match" : "DIFFER");
+    return same;
+}
+
+// Duplicate suggestions over p_count sample patients and one in a hundred
+// of them registered again: a typo in the name and sometimes another email
+// digit, phone number or day and month swapped
+static bool bench_duplicates(size_t p_count) {
+    std::vector<patient> patients;
+    sample_patients(p_count, patients);
+    u_int64_t state = 0x2545F4914F6CDD1Dull;
+    auto next = [&state]() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    };
+    std::unordered_set<u_int64_t> injected; // keep << 32 | drop
+    for (size_t i = 0; i < p_count; i += 100) {
+        patient copy = patients[i];
+        copy.id = patients.size() + 1;
+        size_t at = next() % copy.name.size();
+        if (copy.name[at] != ' ') {
+            copy.name[at] = static_cast<char>('a' + next() % 26);
+        }
+        switch (next() % 4) {
+        case 0:
+            copy.email[copy.email.find('@') - 1] ^= 1; // Another digit
+            break;
+        case 1:
+            copy.number++;
+            break;
+        case 2:
+            if (date_day(copy.date_of_birth) <= 12) {
+                copy.date_of_birth = pack_date(date_year(copy.date_of_birth), date_day(copy.date_of_birth),
+                                               date_month(copy.date_of_birth));
+            }
+            break;
+        }
+        injected.insert(patients[i].id << 32 | copy.id);
+        patients.push_back(copy);
+    }
+
+    patient_records records;
+    patient_history history(records);
+    records.upsert(patients);
+    dedup_result result = find_duplicates(history.snapshot());
+
+    size_t found = 0;
+    for (const duplicate_pair& pair : result.pairs) {
+        found += injected.count(pair.keep << 32 | pair.drop);
+    }
+    double recall = injected.empty() ? 1.0 : static_cast<double>(found) / static_cast<double>(injected.size());
+    printf("%zu patients, %zu registered twice\n", result.patients, injected.size());
+    printf("  signatures %8.1f ms\n  buckets    %8.1f ms  %zu candidate pairs, %zu buckets skipped\n",
+           result.signature_ms, result.bucket_ms, result.candidates, result.skipped_buckets);
+    printf("  scores     %8.1f ms\n  total      %8.1f ms\n", result.score_ms, result.total_ms);
+    printf("  found %zu of %zu (%.1f%%), %zu other suggestions\n", found, injected.size(), recall * 100.0,
+           result.pairs.size() - found);
+    return recall >= 0.95;
+}
+
+// Export then import of p_count patients through a newline delimited JSON
+// file, the import once on one thread and once on all of them
+static bool bench_patient_io(size_t p_count) {
+    std::vector<patient> patients;
+    sample_patients(p_count, patients);
+    patient_records source;
+    source.upsert(patients);
+
+    std::string path = (std::filesystem::temp_directory_path() / "ava_patient_io_bench.ndjson").string();
+    io_stats exported = export_patients(source, path);
+    if (!exported.ok) {
+        return false;
+    }
+    auto mb_per_s = [](const io_stats& p_stats) {
+        return static_cast<double>(p_stats.bytes) / (1024.0 * 1024.0) / (p_stats.ms / 1000.0);
+    };
+    auto records_per_s = [](const io_stats& p_stats) {
+        return static_cast<double>(p_stats.records) / (p_stats.ms / 1000.0);
+    };
+
+    printf("%zu patients, %.1f MB of NDJSON\n", p_count, static_cast<double>(exported.bytes) / (1024.0 * 1024.0));
+    printf("  export            %8.1f ms  %7.1f MB/s  %10.0f records/s\n",
+           exported.ms, mb_per_s(exported), records_per_s(exported));
+
+    bool same = true;
+    for (size_t threads : {size_t(1), size_t(0)}) {
+        patient_records target;
+        import_config config;
+        config.threads = threads;
+        io_stats imported = import_patients(target, path, config);
+
+        patient first, last;
+        same = imported.ok && imported.rejected == 0 && target.size() == p_count &&
+               target.get(patients.front().id, first) && first.name == patients.front().name &&
+               target.get(patients.back().id, last) && last.address == patients.back().address &&
+               last.date_of_birth == patients.back().date_of_birth && same;
+        printf("  import %2zu threads %8.1f ms  %7.1f MB/s  %10.0f records/s\n",
+               threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency()),
+               imported.ms, mb_per_s(imported), records_per_s(imported));
+    }
+    std::error_code error;
+    std::filesystem::remove(path, error);
+    printf("  results %s\n", same ? "match" : "DIFFER");
+    return same;
+}
+
+// Encryption at rest against plaintext: p_mb MB through a plain file and a
+// sealed_file (sequential, then random 4 KB reads), then a store of
+// p_records patients written, checkpointed and opened both ways
+static bool bench_encryption(size_t p_mb, size_t p_records) {
+    typedef std::chrono::steady_clock clock_type;
+    auto ms_since = [](clock_type::time_point p_start) {
+        return std::chrono::duration<double, std::milli>(clock_type::now() - p_start).count();
+    };
+    seal_key key;
+    std::random_device random;
+    for (u_int8_t& byte : key.bytes) {
+        byte = static_cast<u_int8_t>(random());
+    }
+    key.set = true;
+
+    const size_t bytes = p_mb << 20;
+    std::string data(bytes, '\0');
+    std::mt19937_64 generator(7);
+    for (size_t i = 0; i + 8 <= bytes; i += 8) {
+        u_int64_t word = generator();
+        std::memcpy(&data[i], &word, sizeof(word));
+    }
+    std::vector<u_int64_t> offsets(4096);
+    for (u_int64_t& offset : offsets) {
+        offset = generator() % (bytes - 4096);
+    }
+
+    const std::filesystem::path dir = std::filesystem::temp_directory_path() / "ava_crypto_bench";
+    std::error_code error;
+    std::filesystem::remove_all(dir, error);
+    std::filesystem::create_directories(dir, error);
+    const std::string plain_path = (dir / "plain").string(), sealed_path = (dir / "sealed").string();
+    auto mb_per_s = [bytes](double p_ms) { return static_cast<double>(bytes) / (1024.0 * 1024.0) / (p_ms / 1000.0); };
+
+    // Plaintext, through the page cache like the store's own files
+    std::string back(bytes, '\0');
+    char block[4096];
+    auto start = clock_type::now();
+    int fd = ::open(plain_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    bool ok = fd >= 0 && ::pwrite(fd, data.data(), bytes, 0) == static_cast<ssize_t>(bytes) && ::fdatasync(fd) == 0;
+    double plain_write_ms = ms_since(start);
+    start = clock_type::now();
+    ok = ok && ::pread(fd, back.data(), bytes, 0) == static_cast<ssize_t>(bytes) && back == data;
+    double plain_read_ms = ms_since(start);
+    start = clock_type::now();
+    for (u_int64_t offset : offsets) {
+        ok = ok && ::pread(fd, block, sizeof(block), static_cast<off_t>(offset)) == static_cast<ssize_t>(sizeof(block));
+    }
+    double plain_random_us = ms_since(start) * 1000.0 / static_cast<double>(offsets.size());
+    if (fd >= 0) {
+        ::close(fd);
+    }
+
+    sealed_file sealed;
+    start = clock_type::now();
+    ok = ok && sealed.open(sealed_path, key) && sealed.write(0, data.data(), bytes) && sealed.sync();
+    double sealed_write_ms = ms_since(start);
+    std::fill(back.begin(), back.end(), '\0');
+    start = clock_type::now();
+    ok = ok && sealed.read(0, back.data(), bytes) && back == data;
+    double sealed_read_ms = ms_since(start);
+    start = clock_type::now();
+    for (u_int64_t offset : offsets) {
+        ok = ok && sealed.read(offset, block, sizeof(block)) && std::memcmp(block, &data[offset], sizeof(block)) == 0;
+    }
+    double sealed_random_us = ms_since(start) * 1000.0 / static_cast<double>(offsets.size());
+    sealed.close();
+    double overhead = static_cast<double>(std::filesystem::file_size(sealed_path, error)) / static_cast<double>(bytes) - 1.0;
+
+    printf("%zu MB, %zu KB chunks (%.2f%% larger on disk)\n", p_mb, static_cast<size_t>(SEAL_CHUNK >> 10), overhead * 100.0);
+    printf("  write + sync  plain %8.1f ms %7.0f MB/s  sealed %8.1f ms %7.0f MB/s\n",
+           plain_write_ms, mb_per_s(plain_write_ms), sealed_write_ms, mb_per_s(sealed_write_ms));
+    printf("  read          plain %8.1f ms %7.0f MB/s  sealed %8.1f ms %7.0f MB/s\n",
+           plain_read_ms, mb_per_s(plain_read_ms), sealed_read_ms, mb_per_s(sealed_read_ms));
+    printf("  random 4 KB   plain %8.2f us           sealed %8.2f us\n", plain_random_us, sealed_random_us);
+
+    std::vector<patient> patients;
+    sample_patients(p_records, patients);
+    printf("%zu patients\n", p_records);
+    for (bool encrypted : {false, true}) {
+        store_config config;
+        config.key = encrypted ? key : seal_key{};
+        const std::string store_dir = (dir / (encrypted ? "sealed_store" : "plain_store")).string();
+        double write_ms, open_ms;
+        {
+            patient_store store;
+            ok = store.open(store_dir, config) && ok;
+            start = clock_type::now();
+            {
+                auto lock = store.write_lock();
+                for (const patient& p : patients) {
+                    store.upsert(p);
+                }
+            }
+            ok = store.flush() && store.checkpoint() && ok;
+            write_ms = ms_since(start);
+        }
+        patient_store store;
+        start = clock_type::now();
+        ok = store.open(store_dir, config) && store.size() == p_records && ok;
+        size_t born = 0;
+        for (const patient_hot& row : store.all()) {
+            born += row.date_of_birth != 0; // Touches every row, mapped pages included
+        }
+        open_ms = ms_since(start);
+        patient last;
+        if (const patient_hot* row = store.find(patients.back().id)) {
+            store.load(*row, last);
+        }
+        ok = last.address == patients.back().address && born > 0 && ok;
+        printf("  %-9s store  upsert + checkpoint %8.1f ms  open + scan %8.1f ms\n",
+               encrypted ? "encrypted" : "plaintext", write_ms, open_ms);
+    }
+
+    std::filesystem::remove_all(dir, error);
+    printf("  results %s\n", ok ? "match" : "DIFFER");
+    return ok;
+}
+
+// Prompt pairs the semantic tier must keep apart (other patient, other day,
+// other name) and paraphrases it should still answer
+static bool check_semantic_cache() {
+    struct pair_case {
+        const char* stored;
+        const char* asked;
+        bool hit;
+    };
+    const pair_case cases[] = {
+        {"What is the phone number of patient 1234?", "What is the phone number of patient 1235?", false},
+        {"Do I have an appointment today?", "Do I have an appointment tomorrow?", false},
+        {"When is the appointment of Maria Lopez?", "When is the appointment of Mario Lopez?", false},
+        {"Is the clinic open on Monday?", "Is the clinic open on Tuesday?", false},
+        {"What are your opening hours?", "what are your opening hours", true},
+        {"Where can I park my car near the clinic?", "Where can I park my car near the clinic please?", true},
+    };
+
+    bool ok = true;
+    for (const pair_case& test : cases) {
+        semantic_cache cache;
+        cache.store(test.stored, "check", "", "answer");
+        std::string response;
+        bool hit = cache.lookup(test.asked, "check", "", response);
+        printf("  %-45s -> %-45s %s\n", test.stored, test.asked, hit ? "hit" : "miss");
+        ok = hit == test.hit && ok;
+    }
+    printf("  results %s\n", ok ? "match" : "DIFFER");
+    return ok;
+}
+
+bool run_batch(int argc, char *argv[], transcriber& p_asr, SDL_AppResult& p_result) {
+    if (argc < 2) {
+        return false;
+    }
+
+    std::string_view mode = argv[1];
+
+    // ./program --transcribe <recording.wav>
+    if (mode == "--transcribe" && argc > 2) {
+        load_asr_tuning(ASR_TUNING_PATH, p_asr.config());
+        load_asr_environment(p_asr.config());
+
+        transcript out = p_asr.transcribe_file(argv[2]);
+        for (const auto& segment : out.segments) {
+            printf("[%s --> %s] %s\n",
+                   format_timestamp(segment.from_ms).c_str(),
+                   format_timestamp(segment.to_ms).c_str(),
+                   segment.text.c_str());
+        }
+        p_result = out.ok ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+        return true;
+    }
+
+    // ./program --asr-bench [max real-time factor] [reference.wav...]
+    if (mode == "--asr-bench") {
+        double max_rtf = (argc > 2) ? std::atof(argv[2]) : 0.5;
+
+        std::vector<asr_reference> references;
+        for (int i = 3; i < argc; i++) {
+            asr_reference reference;
+            if (load_reference(argv[i], reference)) {
+                references.push_back(reference);
+            } else {
+                SDL_Log("No reference transcript for %s (expected %s.txt)", argv[i], argv[i]);
+            }
+        }
+        if (argc <= 3) {
+            asr_reference reference;
+            if (load_reference("output.wav", reference)) {
+                references.push_back(reference);
+            }
+        }
+        if (references.empty()) {
+            SDL_Log("No reference recordings to benchmark");
+            p_result = SDL_APP_FAILURE;
+            return true;
+        }
+
+        std::vector<tuning_result> results = 
+            run_asr_benchmark(p_asr.config(), default_tuning_grid(), references);
+        const tuning_result* best = pick_best(results, max_rtf);
+        if (!best) {
+            SDL_Log("Every configuration failed");
+            p_result = SDL_APP_FAILURE;
+            return true;
+        }
+
+        printf("BEST FOR %s (RTF <= %.2f): %s t=%u bs=%u bo=%u  RTF %.3f  WER %.1f%%\n",
+               host_id().c_str(), max_rtf, best->model.c_str(), best->threads, 
+               best->beam_size, best->best_of, best->rtf, best->wer * 100.0);
+
+        p_result = save_asr_tuning(ASR_TUNING_PATH, *best, max_rtf) ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+        return true;
+    }
+
+    // ./program --json-bench [iterations] [response.json]
+    if (mode == "--json-bench") {
+        size_t iterations = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 2000;
+        if (iterations == 0) {
+            iterations = 1;
+        }
+
+        std::vector<std::string> docs;
+        if (argc > 3) {
+            std::ifstream file(argv[3], std::ios::binary);
+            std::stringstream contents;
+            contents << file.rdbuf();
+            if (!file) {
+                SDL_Log("Couldn't read %s", argv[3]);
+                p_result = SDL_APP_FAILURE;
+                return true;
+            }
+            docs.push_back(contents.str());
+        } else {
+            docs = {sample_gemini_response(200), sample_gemini_response(4096), sample_gemini_response(65536)};
+        }
+
+        bool ok = true;
+        for (const auto& doc : docs) {
+            ok = bench_json_extract(doc, iterations) && ok;
+        }
+        p_result = ok ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+        return true;
+    }
+
+    // ./program --patient-bench [records]
+    if (mode == "--patient-bench") {
+        size_t count = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 1000000;
+        p_result = bench_patient_layout(std::max<size_t>(count, 1)) ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+        return true;
+    }
+
+    // ./program --analytics-bench [records]
+    if (mode == "--analytics-bench") {
+        size_t count = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 1000000;
+        p_result = bench_patient_analytics(std::max<size_t>(count, 1)) ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+        return true;
+    }
+
+    // ./program --dedup-bench [records]
+    if (mode == "--dedup-bench") {
+        size_t count = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 1000000;
+        p_result = bench_duplicates(std::max<size_t>(count, 1)) ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+        return true;
+    }
+
+    // ./program --crypto-bench [MB] [records]
+    if (mode == "--crypto-bench") {
+        size_t mb = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 256;
+        size_t count = (argc > 3) ? std::strtoul(argv[3], nullptr, 10) : 1000000;
+        p_result = bench_encryption(std::max<size_t>(mb, 1), std::max<size_t>(count, 1)) ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+        return true;
+    }
+
+    // ./program --semantic-cache-check
+    if (mode == "--semantic-cache-check") {
+        p_result = check_semantic_cache() ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+        return true;
+    }
+
+    // ./program --patient-io-bench [records]
+    if (mode == "--patient-io-bench") {
+        size_t count = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 1000000;
+        p_result = bench_patient_io(std::max<size_t>(count, 1)) ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+        return true;
+    }
+
+    // ./program --import-patients <file.ndjson>   ./program --export-patients <file.ndjson>
+    if ((mode == "--import-patients" || mode == "--export-patients") && argc > 2) {
+        const char* patient_dir = std::getenv("AVA_PATIENT_DIR");
+        patient_records records;
+        if (!records.open(patient_dir ? patient_dir : PATIENT_STORE_DIR)) {
+            p_result = SDL_APP_FAILURE;
+            return true;
+        }
+        io_stats stats = mode == "--import-patients" ? import_patients(records, argv[2]) : export_patients(records, argv[2]);
+        records.close();
+        printf("%s %llu patients (%llu skipped) in %.1f ms\n", mode == "--import-patients" ? "Imported" : "Exported",
+               static_cast<unsigned long long>(stats.records), static_cast<unsigned long long>(stats.rejected), stats.ms);
+        p_result = stats.ok ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+        return true;
+    }
+
+    return false;
+}
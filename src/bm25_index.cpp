@@ -0,0 +1,142 @@
+#include "util/clinic/bm25_index.hpp"
+#include <algorithm>
+#include <cmath>
+
+void bm25_index::tokenize(std::string_view p_text, const std::function<void(std::string_view)>& p_func) {
+    std::string term;
+    for (size_t i = 0; i <= p_text.size(); i++) {
+        unsigned char c = i < p_text.size() ? static_cast<unsigned char>(p_text[i]) : ' ';
+        bool word = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c >= 0x80;
+        if (word) {
+            term += static_cast<char>((c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c);
+        } else if (!term.empty()) {
+            p_func(term);
+            term.clear();
+        }
+    }
+}
+
+void bm25_index::add(doc_id p_id, std::initializer_list<bm25_field> p_fields) {
+    remove(p_id);
+
+    // Weighted term frequencies of this document
+    std::unordered_map<u_int32_t, float> tf;
+    float length = 0.0f;
+    for (const bm25_field& f : p_fields) {
+        tokenize(f.text, [&](std::string_view p_term) {
+            auto it = term_ids.find(p_term);
+            if (it == term_ids.end()) {
+                it = term_ids.emplace(std::string(p_term), static_cast<u_int32_t>(postings.size())).first;
+                postings.emplace_back();
+            }
+            tf[it->second] += f.weight;
+            length += f.weight;
+        });
+    }
+
+    u_int32_t slot;
+    if (!free_slots.empty()) {
+        slot = free_slots.back();
+        free_slots.pop_back();
+    } else {
+        slot = static_cast<u_int32_t>(docs.size());
+        docs.emplace_back();
+    }
+
+    document& doc = docs[slot];
+    doc.id = p_id;
+    doc.length = length;
+    doc.terms.clear();
+    doc.terms.reserve(tf.size());
+    for (const auto& [term, freq] : tf) {
+        postings[term].push_back({slot, freq});
+        doc.terms.push_back(term);
+    }
+
+    slot_of[p_id] = slot;
+    total_length += length;
+}
+
+bool bm25_index::remove(doc_id p_id) {
+    auto it = slot_of.find(p_id);
+    if (it == slot_of.end()) {
+        return false;
+    }
+
+    u_int32_t slot = it->second;
+    document& doc = docs[slot];
+    for (u_int32_t term : doc.terms) {
+        std::vector<posting>& list = postings[term];
+        for (size_t i = 0; i < list.size(); i++) {
+            if (list[i].slot == slot) {
+                list[i] = list.back(); // Order within a posting list doesn't matter
+                list.pop_back();
+                break;
+            }
+        }
+    }
+
+    total_length -= doc.length;
+    doc.terms.clear();
+    doc.length = 0.0f;
+    free_slots.push_back(slot);
+    slot_of.erase(it);
+    return true;
+}
+
+void bm25_index::clear() {
+    term_ids.clear();
+    postings.clear();
+    docs.clear();
+    free_slots.clear();
+    slot_of.clear();
+    total_length = 0.0;
+}
+
+std::vector<std::pair<bm25_index::doc_id, float>> bm25_index::search(std::string_view p_query, size_t p_k) const {
+    std::vector<std::pair<doc_id, float>> out;
+    if (slot_of.empty() || p_k == 0) {
+        return out;
+    }
+
+    const double n = static_cast<double>(slot_of.size());
+    const double avg_length = std::max(total_length / n, 1e-6);
+
+    std::vector<u_int32_t> query_terms;
+    tokenize(p_query, [&](std::string_view p_term) {
+        auto it = term_ids.find(p_term);
+        if (it != term_ids.end() && !postings[it->second].empty()) {
+            query_terms.push_back(it->second);
+        }
+    });
+    std::sort(query_terms.begin(), query_terms.end());
+    query_terms.erase(std::unique(query_terms.begin(), query_terms.end()), query_terms.end());
+
+    std::unordered_map<u_int32_t, float> scores;
+    for (u_int32_t term : query_terms) {
+        const std::vector<posting>& list = postings[term];
+        const double df = static_cast<double>(list.size());
+        const float idf = static_cast<float>(std::log(1.0 + (n - df + 0.5) / (df + 0.5)));
+
+        for (const posting& p : list) {
+            float norm = cfg.k1 * (1.0f - cfg.b + cfg.b * static_cast<float>(docs[p.slot].length / avg_length));
+            scores[p.slot] += idf * (p.tf * (cfg.k1 + 1.0f)) / (p.tf + norm);
+        }
+    }
+
+    out.reserve(scores.size());
+    for (const auto& [slot, score] : scores) {
+        out.push_back({docs[slot].id, score});
+    }
+
+    auto better = [](const auto& p_a, const auto& p_b) { 
+        return p_a.second != p_b.second ? p_a.second > p_b.second : p_a.first < p_b.first; 
+    };
+    if (out.size() > p_k) {
+        std::partial_sort(out.begin(), out.begin() + p_k, out.end(), better);
+        out.resize(p_k);
+    } else {
+        std::sort(out.begin(), out.end(), better);
+    }
+    return out;
+}
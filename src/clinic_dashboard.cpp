@@ -0,0 +1,96 @@
+#include "util/clinic/clinic_dashboard.hpp"
+#include <algorithm>
+#include <cstdio>
+
+#include "imgui/imgui.h"
+#include "util/clinic/patient_fields.hpp"
+
+namespace {
+
+constexpr auto REFRESH_EVERY = std::chrono::milliseconds(250); // While records change
+
+bool same_filter(const analytics_filter& p_a, const analytics_filter& p_b) {
+    return p_a.min_age == p_b.min_age && p_a.max_age == p_b.max_age && p_a.gender == p_b.gender &&
+           p_a.born_from == p_b.born_from && p_a.born_to == p_b.born_to;
+}
+
+} // namespace
+
+analytics_filter clinic_dashboard::filter() const {
+    analytics_filter f;
+    f.min_age = static_cast<u_int8_t>(ages[0]);
+    f.max_age = ages[1] >= 100 ? 255 : static_cast<u_int8_t>(ages[1]);
+    f.gender = gender - 1;
+    // The whole range keeps patients without a known date of birth too
+    if (born[0] > FIRST_BIRTH_YEAR || born[1] < FIRST_BIRTH_YEAR + DECADE_BARS * 10 - 1) {
+        f.born_from = pack_date(static_cast<u_int32_t>(born[0]), 1, 1);
+        f.born_to = pack_date(static_cast<u_int32_t>(born[1]), 12, 31);
+    }
+    return f;
+}
+
+void clinic_dashboard::refresh() {
+    analytics_filter wanted = filter();
+    auto now = std::chrono::steady_clock::now();
+    bool changed = !same_filter(wanted, summarized) || recomputes == 0;
+    bool stale = records.version() != summary_version && now - summary_at >= REFRESH_EVERY;
+    if (!changed && !stale) {
+        return;
+    }
+
+    summary = analytics.summarize(wanted);
+    summarized = wanted;
+    summary_version = records.version();
+    summary_at = now;
+    recomputes++;
+
+    std::fill(std::begin(age_bars), std::end(age_bars), 0.0f);
+    for (int age = 0; age < 256; age++) {
+        age_bars[std::min(age / 5, AGE_BARS - 1)] += static_cast<float>(summary.by_age[age]);
+    }
+    std::fill(std::begin(decade_bars), std::end(decade_bars), 0.0f);
+    for (int year = 0; year < DECADE_BARS * 10; year++) {
+        decade_bars[year / 10] += static_cast<float>(summary.by_birth_year[year]);
+    }
+}
+
+void clinic_dashboard::show(bool* p_open) {
+    if (!ImGui::Begin("CLINIC ANALYTICS", p_open)) {
+        ImGui::End();
+        return;
+    }
+
+    ImGui::SetNextItemWidth(240.0f);
+    ImGui::DragIntRange2("AGE", &ages[0], &ages[1], 0.2f, 0, 100, "%d", ages[1] >= 100 ? "100+" : "%d");
+    ImGui::SetNextItemWidth(240.0f);
+    ImGui::DragIntRange2("BORN", &born[0], &born[1], 0.2f, FIRST_BIRTH_YEAR, FIRST_BIRTH_YEAR + DECADE_BARS * 10 - 1);
+    ImGui::SetNextItemWidth(240.0f);
+    const char* genders[] = {"EVERYONE", "WOMEN", "MEN"}; // Index - 1 is enum gender
+    ImGui::Combo("GENDER", &gender, genders, IM_ARRAYSIZE(genders));
+    refresh();
+
+    ImGui::Text("%llu PATIENTS  MEAN AGE %.1f  %llu WITHOUT A BIRTH DATE  (%.2f ms)",
+                static_cast<unsigned long long>(summary.patients), summary.mean_age,
+                static_cast<unsigned long long>(summary.unknown_birth), summary.ms);
+
+    double women = summary.patients ? static_cast<double>(summary.by_gender[FEMALE]) / static_cast<double>(summary.patients) : 0.0;
+    char split[64];
+    snprintf(split, sizeof(split), "WOMEN %.1f%%  /  MEN %.1f%%", women * 100.0, summary.patients ? (1.0 - women) * 100.0 : 0.0);
+    ImGui::ProgressBar(static_cast<float>(women), ImVec2(-1.0f, 0.0f), split);
+
+    float width = ImGui::GetContentRegionAvail().x;
+    ImGui::SeparatorText("AGE (5 YEARS A BAR, 100+ LAST)");
+    ImGui::PlotHistogram("##ages", age_bars, AGE_BARS, 0, nullptr, 0.0f, FLT_MAX, ImVec2(width, 140.0f));
+    ImGui::SeparatorText("BIRTH DECADE (1900s TO 2020s)");
+    ImGui::PlotHistogram("##decades", decade_bars, DECADE_BARS, 0, nullptr, 0.0f, FLT_MAX, ImVec2(width, 140.0f));
+
+    ImGui::End();
+}
+
+dashboard_stats clinic_dashboard::stats() const {
+    dashboard_stats s{};
+    s.patients = summary.patients;
+    s.summary_ms = summary.ms;
+    s.recomputes = recomputes;
+    return s;
+}
@@ -0,0 +1,212 @@
+#include "util/llm/conversation.hpp"
+#include "util/hash.hpp"
+#include "util/llm/tokenizer.hpp"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <string_view>
+
+namespace {
+
+constexpr char SUMMARY_PREFIX[] = "Summary of the earlier conversation:\n";
+constexpr char SUMMARY_ACK[] = "Understood.";
+
+// Words that only make sense next to what was said before
+constexpr std::string_view REFERRING_WORDS[] = {
+    "he", "she", "him", "his", "her", "hers", "they", "them", "their", "theirs", "it", "its",
+    "that", "this", "those", "these", "there", "then", "also", "again", "else", "same", "other",
+    "another", "one", "ones", "instead", "too", "previous", "earlier"};
+
+// Openings of a question that continues the last one
+constexpr std::string_view FOLLOW_UP_OPENINGS[] = {"and", "or", "but", "so", "what about", "how about"};
+
+// First sentence of p_text, cut to roughly p_max_tokens
+std::string first_sentence(const std::string& p_text, size_t p_max_tokens) {
+    size_t end = p_text.find_first_of(".?!\n");
+    std::string sentence = p_text.substr(0, end == std::string::npos ? p_text.size() : end + 1);
+
+    // Cut on a word boundary once over budget
+    while (count_tokens(sentence) > p_max_tokens) {
+        size_t space = sentence.find_last_of(' ');
+        if (space == std::string::npos || space == 0) {
+            break;
+        }
+        sentence.resize(space);
+        sentence += "...";
+    }
+
+    size_t begin = sentence.find_first_not_of(" \t");
+    return begin == std::string::npos ? "" : sentence.substr(begin);
+}
+
+} // namespace
+
+conversation::conversation(const conversation_config& p_config) : cfg(p_config) { }
+
+void conversation::add_turn(llm_role p_role, const std::string& p_text) {
+    last_active = std::chrono::steady_clock::now();
+    size_t tokens = count_tokens(p_text);
+    turns.push_back({p_role, p_text, tokens});
+    turn_tokens += tokens;
+}
+
+size_t conversation::context_tokens() const {
+    return summary_tokens + turn_tokens;
+}
+
+void conversation::roll_up() {
+    const turn& oldest = turns.front();
+
+    std::string note = first_sentence(oldest.text, cfg.note_tokens);
+    if (!note.empty()) {
+        summary += (oldest.role == ROLE_USER ? "- User: " : "- Assistant: ") + note + "\n";
+    }
+
+    turn_tokens -= oldest.tokens;
+    turns.pop_front();
+
+    summary_tokens = count_tokens(summary);
+    trim_summary();
+}
+
+void conversation::trim_summary() {
+    while (summary_tokens > cfg.summary_budget && !summary.empty()) {
+        size_t line_end = summary.find('\n');
+        summary.erase(0, line_end == std::string::npos ? summary.size() : line_end + 1);
+        condensed_from = (condensed_from > line_end) ? condensed_from - line_end - 1 : 0;
+        summary_tokens = count_tokens(summary);
+    }
+}
+
+void conversation::request_condense() {
+    if (!summarize || condensing.valid() || summary.empty()) {
+        return;
+    }
+
+    condensed_from = summary.size();
+    condensing = summarize(
+        "Condense these notes from an earlier part of a clinic front desk conversation into a "
+        "short summary of at most " + std::to_string(cfg.summary_budget / 2) + " words. "
+        "Keep every name, date, number and open question. Reply with the summary only.\n\n" + summary);
+}
+
+void conversation::poll() {
+    bool started = !turns.empty() || !summary.empty();
+    if (started && cfg.idle_timeout_s > 0 &&
+        std::chrono::steady_clock::now() - last_active > std::chrono::seconds(cfg.idle_timeout_s)) {
+        clear(); // Whoever was asking has left the desk
+        return;
+    }
+
+    if (!condensing.valid() || condensing.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return;
+    }
+
+    std::string condensed = condensing.get();
+    if (condensed.empty()) {
+        return; // Keep the local notes
+    }
+
+    // Notes added while the model was busy stay after the condensed part
+    std::string tail = summary.substr(std::min(condensed_from, summary.size()));
+    std::string candidate = condensed + (condensed.ends_with('\n') ? "" : "\n") + tail;
+    if (count_tokens(candidate) < summary_tokens) {
+        summary = std::move(candidate);
+        summary_tokens = count_tokens(summary);
+    }
+    condensed_from = 0;
+}
+
+std::vector<llm_message> conversation::build_request(const std::string& p_prompt) {
+    last_active = std::chrono::steady_clock::now();
+    const size_t prompt_tokens = count_tokens(p_prompt);
+    // The summary exchange costs a little on top of the notes themselves
+    const size_t wrapper_tokens = count_tokens(SUMMARY_PREFIX) + count_tokens(SUMMARY_ACK);
+
+    bool rolled = false;
+    while (turns.size() > cfg.min_recent_turns &&
+           summary_tokens + wrapper_tokens + turn_tokens + prompt_tokens > cfg.token_budget) {
+        roll_up();
+        rolled = true;
+    }
+    if (rolled) {
+        request_condense();
+    }
+
+    std::vector<llm_message> messages;
+    messages.reserve(turns.size() + 3);
+
+    if (!summary.empty()) {
+        // Gemini wants user/model alternation, so the summary goes in as an exchange
+        messages.push_back({ROLE_USER, SUMMARY_PREFIX + summary});
+        messages.push_back({ROLE_MODEL, SUMMARY_ACK});
+    }
+
+    for (const auto& t : turns) {
+        // Merge same-role neighbours (e.g. a failed answer left two user turns in a row)
+        if (!messages.empty() && messages.back().role == t.role) {
+            messages.back().text += "\n" + t.text;
+        } else {
+            messages.push_back({t.role, t.text});
+        }
+    }
+
+    if (!messages.empty() && messages.back().role == ROLE_USER) {
+        messages.back().text += "\n" + p_prompt;
+    } else {
+        messages.push_back({ROLE_USER, p_prompt});
+    }
+
+    return messages;
+}
+
+std::string conversation::fingerprint() const {
+    if (turns.empty() && summary.empty()) {
+        return ""; // Context free, shares cache entries with plain prompts
+    }
+
+    u_int64_t h = hash64(summary);
+    for (const auto& t : turns) {
+        h = hash64(t.text, h ^ static_cast<u_int64_t>(t.role));
+    }
+    return hash_hex(h);
+}
+
+bool conversation::is_follow_up(const std::string& p_prompt) {
+    std::string words; // Lowercase, single spaced
+    for (char c : p_prompt) {
+        if (std::isalnum(static_cast<unsigned char>(c)) || c == '\'') {
+            words += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        } else if (!words.empty() && words.back() != ' ') {
+            words += ' ';
+        }
+    }
+
+    for (std::string_view opening : FOLLOW_UP_OPENINGS) {
+        if (words.starts_with(opening) && (words.size() == opening.size() || words[opening.size()] == ' ')) {
+            return true;
+        }
+    }
+
+    size_t begin = 0;
+    while (begin < words.size()) {
+        size_t end = std::min(words.find(' ', begin), words.size());
+        std::string_view word(words.data() + begin, end - begin);
+        if (std::find(std::begin(REFERRING_WORDS), std::end(REFERRING_WORDS), word) != std::end(REFERRING_WORDS)) {
+            return true;
+        }
+        begin = end + 1;
+    }
+    return false;
+}
+
+void conversation::clear() {
+    // The scheduler's future doesn't block when dropped, its answer just goes nowhere
+    condensing = {};
+    last_active = std::chrono::steady_clock::now();
+    turns.clear();
+    turn_tokens = 0;
+    summary.clear();
+    summary_tokens = 0;
+    condensed_from = 0;
+}
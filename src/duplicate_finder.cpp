@@ -0,0 +1,368 @@
+#include "util/clinic/duplicate_finder.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "util/clinic/name_matcher.hpp"
+#include "util/clinic/patient_fields.hpp"
+#include "util/hash.hpp"
+
+namespace {
+
+constexpr size_t CHUNK = 4096;       // Patients per signature job
+constexpr size_t PAIR_CHUNK = 65536; // Candidates per scoring job
+constexpr u_int32_t HEAVY = 4;       // Copies of the date, phone and email shingles
+
+typedef std::chrono::steady_clock clock_type;
+
+double ms_since(clock_type::time_point p_start) {
+    return std::chrono::duration<double, std::milli>(clock_type::now() - p_start).count();
+}
+
+// p_work(i) for every i below p_count, handed out in order to p_threads threads (this one included)
+template <typename F>
+void parallel_for(size_t p_count, size_t p_threads, F&& p_work) {
+    std::atomic<size_t> next = 0;
+    auto worker = [&]() {
+        for (size_t i; (i = next.fetch_add(1)) < p_count;) {
+            p_work(i);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < std::min(p_threads, p_count); t++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+}
+
+// Independent hash functions a * x + b over 32 bit shingles, the same every run
+typedef struct minhash_family {
+    std::vector<u_int32_t> a;
+    std::vector<u_int32_t> b;
+
+    explicit minhash_family(size_t p_count) : a(p_count), b(p_count) {
+        u_int64_t state = 0x2545F4914F6CDD1Dull;
+        for (size_t k = 0; k < p_count; k++) {
+            state += 0x9E3779B97F4A7C15ull;
+            u_int64_t z = (state ^ (state >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            z ^= z >> 31;
+            a[k] = static_cast<u_int32_t>(z) | 1u;
+            b[k] = static_cast<u_int32_t>(z >> 32);
+        }
+    }
+} minhash_family;
+
+u_int32_t fold(u_int64_t p_hash) {
+    return static_cast<u_int32_t>(p_hash ^ (p_hash >> 32));
+}
+
+void lowercase(std::string_view p_text, std::string& p_out) {
+    p_out.assign(p_text);
+    for (char& c : p_out) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+}
+
+// A patient's shingles; p_name is its normalized name
+void shingles(const patient& p_patient, std::string_view p_name, std::string& p_scratch, std::vector<u_int32_t>& p_out) {
+    p_out.clear();
+    p_scratch.assign(" ");
+    p_scratch.append(p_name);
+    p_scratch.push_back(' ');
+    // Salted with the birth year: thousands share a common name, few of them a year too
+    u_int64_t salt = 1 + (static_cast<u_int64_t>(date_year(p_patient.date_of_birth)) << 8);
+    for (size_t i = 0; i + 3 <= p_scratch.size(); i++) {
+        p_out.push_back(fold(hash64(p_scratch.data() + i, 3, salt)));
+    }
+
+    auto heavy = [&](u_int64_t p_hash) {
+        for (u_int32_t copy = 0; copy < HEAVY; copy++) {
+            p_out.push_back(fold(hash64(&p_hash, sizeof(p_hash), 16 + copy)));
+        }
+    };
+    if (p_patient.date_of_birth) {
+        heavy(p_patient.date_of_birth | (1ull << 40));
+    }
+    if (p_patient.number) {
+        heavy(p_patient.number ^ (2ull << 60));
+    }
+    if (!p_patient.email.empty()) {
+        lowercase(p_patient.email, p_scratch);
+        heavy(hash64(p_scratch, 3));
+    }
+
+    // Address word pairs: "12 Garcia Street" and "12 Garcia St" still share one
+    normalize_name(p_patient.address, p_scratch);
+    size_t first = 0, space = p_scratch.find(' ');
+    while (space != std::string::npos) {
+        size_t next = p_scratch.find(' ', space + 1);
+        size_t end = next == std::string::npos ? p_scratch.size() : next;
+        p_out.push_back(fold(hash64(p_scratch.data() + first, end - first, 4)));
+        first = space + 1;
+        space = next;
+    }
+    if (first == 0 && !p_scratch.empty()) {
+        p_out.push_back(fold(hash64(p_scratch, 4))); // A single word
+    }
+}
+
+float name_similarity(std::string_view p_a, std::string_view p_b) {
+    size_t longest = std::max(p_a.size(), p_b.size());
+    if (longest == 0) {
+        return 0.0f;
+    }
+    u_int32_t bound = static_cast<u_int32_t>(longest / 2);
+    u_int32_t edits = name_matcher::distance(p_a, p_b, bound);
+    return edits > bound ? 0.0f : 1.0f - static_cast<float>(edits) / static_cast<float>(longest);
+}
+
+float date_similarity(u_int32_t p_a, u_int32_t p_b) {
+    if (p_a == p_b) {
+        return 1.0f;
+    }
+    if (date_year(p_a) != date_year(p_b)) {
+        return 0.0f;
+    }
+    bool swapped = date_day(p_a) == date_month(p_b) && date_month(p_a) == date_day(p_b);
+    bool one_off = date_day(p_a) == date_day(p_b) || date_month(p_a) == date_month(p_b);
+    return swapped || one_off ? 0.6f : 0.0f;
+}
+
+float address_similarity(const std::string& p_a, const std::string& p_b) {
+    std::string a, b;
+    normalize_name(p_a, a);
+    normalize_name(p_b, b);
+    if (a == b) {
+        return 1.0f;
+    }
+    auto words = [](const std::string& p_text) {
+        std::vector<std::string_view> out;
+        std::string_view rest = p_text;
+        while (!rest.empty()) {
+            size_t space = rest.find(' ');
+            out.push_back(rest.substr(0, space));
+            rest = space == std::string_view::npos ? std::string_view() : rest.substr(space + 1);
+        }
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+        return out;
+    };
+    std::vector<std::string_view> x = words(a), y = words(b);
+    size_t shared = 0;
+    for (size_t i = 0, j = 0; i < x.size() && j < y.size();) {
+        if (x[i] == y[j]) {
+            shared++;
+            i++;
+            j++;
+        } else if (x[i] < y[j]) {
+            i++;
+        } else {
+            j++;
+        }
+    }
+    size_t total = x.size() + y.size() - shared;
+    return total ? static_cast<float>(shared) / static_cast<float>(total) : 0.0f;
+}
+
+bool same_email(std::string_view p_a, std::string_view p_b) {
+    if (p_a.size() != p_b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < p_a.size(); i++) {
+        if (std::tolower(static_cast<unsigned char>(p_a[i])) != std::tolower(static_cast<unsigned char>(p_b[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// score_duplicate() with the names already normalized. Gives up with 0 once
+// even a perfect name and address couldn't reach p_floor, which is where
+// most candidates end: a common name, born the same year
+float score(const patient& p_a, const patient& p_b, std::string_view p_name_a, std::string_view p_name_b, float p_floor) {
+    float sum = 0.0f, weight = 0.35f;
+    if (p_a.date_of_birth && p_b.date_of_birth) {
+        sum += 0.25f * date_similarity(p_a.date_of_birth, p_b.date_of_birth);
+        weight += 0.25f;
+    }
+    if (p_a.number && p_b.number) {
+        sum += 0.15f * (p_a.number == p_b.number);
+        weight += 0.15f;
+    }
+    if (!p_a.email.empty() && !p_b.email.empty()) {
+        float email = 1.0f;
+        if (!same_email(p_a.email, p_b.email)) {
+            std::string a, b;
+            lowercase(p_a.email, a);
+            lowercase(p_b.email, b);
+            email = name_matcher::distance(a, b, 2) <= 2 ? 0.6f : 0.0f;
+        }
+        sum += 0.15f * email;
+        weight += 0.15f;
+    }
+    bool addresses = !p_a.address.empty() && !p_b.address.empty();
+    if (addresses) {
+        weight += 0.10f;
+    }
+    if ((sum + 0.35f + (addresses ? 0.10f : 0.0f)) / weight < p_floor) {
+        return 0.0f;
+    }
+    sum += 0.35f * name_similarity(p_name_a, p_name_b);
+    if (addresses) {
+        sum += 0.10f * address_similarity(p_a.address, p_b.address);
+    }
+    return sum / weight;
+}
+
+} // namespace
+
+dedup_result find_duplicates(const patient_snapshot& p_snapshot, const dedup_config& p_config) {
+    auto start = clock_type::now();
+    dedup_result result{};
+    const size_t threads = p_config.threads ? p_config.threads : std::max(1u, std::thread::hardware_concurrency());
+    const size_t bands = std::max<size_t>(p_config.bands, 1), rows = std::max<size_t>(p_config.rows, 1);
+
+    std::vector<const patient*> patients;
+    patients.reserve(p_snapshot.size());
+    p_snapshot.each([&](const patient& p_patient) { patients.push_back(&p_patient); });
+    const size_t count = patients.size();
+    result.patients = count;
+
+    // Signatures, kept only as one 32 bit key per band, band after band
+    minhash_family family(bands * rows);
+    std::vector<u_int32_t> keys(bands * count);
+    std::vector<std::string> names((count + CHUNK - 1) / CHUNK); // Normalized, each chunk's back to back
+    std::vector<u_int32_t> name_at(count);                      // Offset into its chunk's names
+    parallel_for(names.size(), threads, [&](size_t p_chunk) {
+        std::vector<u_int32_t> set, signature(bands * rows);
+        std::string name, scratch;
+        std::string& text = names[p_chunk];
+        size_t end = std::min(count, (p_chunk + 1) * CHUNK);
+        for (size_t slot = p_chunk * CHUNK; slot < end; slot++) {
+            normalize_name(patients[slot]->name, name);
+            name_at[slot] = static_cast<u_int32_t>(text.size());
+            text += name;
+            shingles(*patients[slot], name, scratch, set);
+
+            std::fill(signature.begin(), signature.end(), ~0u);
+            for (u_int32_t shingle : set) {
+                for (size_t k = 0; k < signature.size(); k++) {
+                    signature[k] = std::min(signature[k], family.a[k] * shingle + family.b[k]);
+                }
+            }
+            for (size_t band = 0; band < bands; band++) {
+                keys[band * count + slot] = fold(hash64(&signature[band * rows], rows * sizeof(u_int32_t), band));
+            }
+        }
+    });
+    auto name_of = [&](size_t p_slot) {
+        const std::string& text = names[p_slot / CHUNK];
+        u_int32_t from = name_at[p_slot];
+        u_int32_t to = (p_slot + 1) % CHUNK == 0 || p_slot + 1 == count ? static_cast<u_int32_t>(text.size()) : name_at[p_slot + 1];
+        return std::string_view(text).substr(from, to - from);
+    };
+    result.signature_ms = ms_since(start);
+
+    // Buckets: sort each band by key, every pair inside a run of one key is a candidate
+    auto bucket_start = clock_type::now();
+    std::vector<std::vector<u_int64_t>> band_pairs(bands);
+    std::atomic<size_t> skipped = 0;
+    parallel_for(bands, threads, [&](size_t p_band) {
+        std::vector<u_int64_t> entries(count);
+        for (size_t slot = 0; slot < count; slot++) {
+            entries[slot] = static_cast<u_int64_t>(keys[p_band * count + slot]) << 32 | slot;
+        }
+        std::sort(entries.begin(), entries.end());
+        std::vector<u_int64_t>& pairs = band_pairs[p_band];
+        for (size_t first = 0, last; first < count; first = last) {
+            for (last = first + 1; last < count && (entries[last] >> 32) == (entries[first] >> 32); last++) {
+            }
+            if (last - first > p_config.max_bucket) {
+                skipped++;
+                continue;
+            }
+            for (size_t i = first; i < last; i++) {
+                for (size_t j = i + 1; j < last; j++) {
+                    // Slots come sorted within a key, so low slot first
+                    pairs.push_back((entries[i] & 0xFFFFFFFFull) << 32 | (entries[j] & 0xFFFFFFFFull));
+                }
+            }
+        }
+    });
+    std::vector<u_int64_t> candidates;
+    for (std::vector<u_int64_t>& pairs : band_pairs) {
+        candidates.insert(candidates.end(), pairs.begin(), pairs.end());
+        std::vector<u_int64_t>().swap(pairs);
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    result.candidates = candidates.size();
+    result.skipped_buckets = skipped;
+    result.bucket_ms = ms_since(bucket_start);
+
+    // Scores
+    auto score_start = clock_type::now();
+    std::vector<std::vector<duplicate_pair>> found((candidates.size() + PAIR_CHUNK - 1) / PAIR_CHUNK);
+    parallel_for(found.size(), threads, [&](size_t p_chunk) {
+        size_t end = std::min(candidates.size(), (p_chunk + 1) * PAIR_CHUNK);
+        for (size_t i = p_chunk * PAIR_CHUNK; i < end; i++) {
+            size_t a = candidates[i] >> 32, b = candidates[i] & 0xFFFFFFFFull;
+            float similarity = score(*patients[a], *patients[b], name_of(a), name_of(b), p_config.min_score);
+            if (similarity >= p_config.min_score) {
+                u_int64_t x = patients[a]->id, y = patients[b]->id;
+                found[p_chunk].push_back({std::min(x, y), std::max(x, y), similarity});
+            }
+        }
+    });
+    for (std::vector<duplicate_pair>& pairs : found) {
+        result.pairs.insert(result.pairs.end(), pairs.begin(), pairs.end());
+    }
+    std::sort(result.pairs.begin(), result.pairs.end(), [](const duplicate_pair& p_a, const duplicate_pair& p_b) {
+        return p_a.score != p_b.score ? p_a.score > p_b.score : p_a.keep < p_b.keep;
+    });
+    result.score_ms = ms_since(score_start);
+    result.total_ms = ms_since(start);
+    return result;
+}
+
+float score_duplicate(const patient& p_a, const patient& p_b) {
+    std::string a, b;
+    normalize_name(p_a.name, a);
+    normalize_name(p_b.name, b);
+    return score(p_a, p_b, a, b, 0.0f);
+}
+
+bool merge_duplicate(patient_records& p_records, u_int64_t p_keep, u_int64_t p_drop) {
+    patient keep, drop;
+    if (p_keep == p_drop || !p_records.get(p_keep, keep) || !p_records.get(p_drop, drop)) {
+        return false;
+    }
+    if (keep.name.empty()) {
+        keep.name = drop.name;
+    }
+    if (!keep.date_of_birth) {
+        keep.date_of_birth = drop.date_of_birth;
+    }
+    if (!keep.age) {
+        keep.age = drop.age;
+    }
+    if (!keep.number) {
+        keep.number = drop.number;
+    }
+    if (keep.email.empty()) {
+        keep.email = drop.email;
+    }
+    if (keep.address.empty()) {
+        keep.address = drop.address;
+    }
+    // One commit, a single undo brings both back as they were
+    return p_records.change({&keep, 1}, {&p_drop, 1});
+}
@@ -0,0 +1,120 @@
+#include "util/clinic/duplicate_review.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+#include "imgui/imgui.h"
+#include "util/clinic/patient_fields.hpp"
+
+duplicate_review::~duplicate_review() {
+    if (search.valid()) {
+        search.wait();
+    }
+}
+
+void duplicate_review::draw_patient(const patient& p_patient) {
+    ImGui::Text("#%llu %s", static_cast<unsigned long long>(p_patient.id), p_patient.name.c_str());
+    std::string born = format_date(p_patient.date_of_birth);
+    ImGui::TextDisabled("%s  %s  %llu", born.empty() ? "-" : born.c_str(),
+                        p_patient.email.empty() ? "-" : p_patient.email.c_str(),
+                        static_cast<unsigned long long>(p_patient.number));
+}
+
+void duplicate_review::show(bool* p_open) {
+    if (!ImGui::Begin("DUPLICATE PATIENTS", p_open)) {
+        ImGui::End();
+        return;
+    }
+
+    if (search.valid() && search.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        dedup_result result = search.get();
+        pending = std::move(result.pairs);
+        candidates = result.candidates;
+        search_ms = result.total_ms;
+        searched = true;
+    }
+
+    bool searching = search.valid();
+    ImGui::BeginDisabled(searching);
+    if (ImGui::Button("FIND DUPLICATES")) {
+        search = std::async(std::launch::async, [snapshot = history.snapshot(), config = cfg]() {
+            return find_duplicates(snapshot, config);
+        });
+        searching = true;
+    }
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(160.0f);
+    ImGui::SliderFloat("MIN SCORE", &cfg.min_score, 0.5f, 1.0f, "%.2f");
+    ImGui::EndDisabled();
+
+    if (searching) {
+        ImGui::Text("SEARCHING %zu PATIENTS...", history.snapshot().size());
+    } else if (searched) {
+        ImGui::Text("%zu SUGGESTIONS  (%zu CANDIDATE PAIRS IN %.0f ms)", pending.size(), candidates, search_ms);
+    }
+
+    ImGuiTableFlags flags = ImGuiTableFlags_Resizable | ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersOuter |
+                            ImGuiTableFlags_BordersV | ImGuiTableFlags_ScrollY;
+    size_t resolved = pending.size(); // One pair decided per frame at most
+    bool merge = false;
+    if (!pending.empty() && ImGui::BeginTable("duplicates", 4, flags)) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("SCORE", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableSetupColumn("KEEP", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("DROP", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("##decide", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableHeadersRow();
+
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(pending.size()));
+        while (clipper.Step()) {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                const duplicate_pair& pair = pending[static_cast<size_t>(i)];
+                patient keep, drop;
+                ImGui::TableNextRow();
+                if (!records.get(pair.keep, keep) || !records.get(pair.drop, drop)) {
+                    resolved = std::min(resolved, static_cast<size_t>(i)); // Merged or removed elsewhere
+                    continue;
+                }
+                ImGui::PushID(i);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f", pair.score);
+                ImGui::TableNextColumn();
+                draw_patient(keep);
+                ImGui::TableNextColumn();
+                draw_patient(drop);
+                ImGui::TableNextColumn();
+                if (ImGui::SmallButton("MERGE") && resolved == pending.size()) {
+                    resolved = static_cast<size_t>(i);
+                    merge = true;
+                }
+                if (ImGui::SmallButton("NOT A DUPLICATE") && resolved == pending.size()) {
+                    resolved = static_cast<size_t>(i);
+                    dismissed++;
+                }
+                ImGui::PopID();
+            }
+        }
+        ImGui::EndTable();
+    }
+
+    if (resolved < pending.size()) {
+        if (merge && merge_duplicate(records, pending[resolved].keep, pending[resolved].drop)) {
+            merged++;
+        }
+        pending.erase(pending.begin() + static_cast<std::ptrdiff_t>(resolved));
+    }
+    ImGui::End();
+}
+
+review_stats duplicate_review::stats() const {
+    review_stats s{};
+    s.suggestions = pending.size();
+    s.merged = merged;
+    s.dismissed = dismissed;
+    s.candidates = candidates;
+    s.search_ms = search_ms;
+    s.searching = search.valid();
+    return s;
+}
@@ -1,5 +1,6 @@
 #include "game.hpp"
 #include "imgui/imgui.h"
+#include "util/hash.hpp"
 #include "util/tools.hpp"
 #include "util/typedefs.hpp"
 #include <SDL3/SDL_keycode.h>
@@ -26,11 +27,46 @@ bool game::init(SDL_Renderer* p_renderer, SDL_Window* p_window) {
         return false;
     }
 
+    // Per machine tuning from --asr-bench first, the environment wins over it
+    load_asr_tuning(ASR_TUNING_PATH, asr.config());
+    load_asr_environment(asr.config());
+
+    load_llm_environment(llm_router::get_instance());
+
+    // Patient data is fetched by the model through tool calls, AVA_LLM_TOOLS=0 sends
+    // BM25 matches along with the question instead
+    register_patient_tools(tools, records, retriever, names);
+    const char* patient_dir = std::getenv("AVA_PATIENT_DIR");
+    if (!records.open(patient_dir ? patient_dir : PATIENT_STORE_DIR)) {
+        SDL_Log("Patient records are not persistent this session");
+    }
+    if (const char* use = std::getenv("AVA_LLM_TOOLS")) {
+        use_tools = std::atoi(use) != 0;
+    }
+    llm_cache.load();
+
+    // Old turns get condensed in the background, behind anything the user is waiting on
+    chat.set_summarizer([this](const std::string& p_prompt) {
+        return llm_requests.submit([p_prompt]() {
+            return llm_router::get_instance().query(p_prompt);
+        }, PRIORITY_BATCH);
+    });
+
+    // AVA_LLM_HEDGE=1 duplicates requests whose first byte is slower than p95
+    if (const char* hedge = std::getenv("AVA_LLM_HEDGE")) {
+        latency_tracker::get_instance().hedging.enabled = std::atoi(hedge) != 0;
+    }
+
     return true;
 }
 
 void game::poll_events(SDL_Event* p_event) { 
     if (p_event->type == SDL_EVENT_KEY_DOWN) {
+        // Debug overlay works in every state
+        if (p_event->key.key == SDLK_F3) {
+            debug = !debug;
+        }
+
         switch (current_state) {
             case STATE_SPLASH: {
 
@@ -44,6 +80,24 @@ void game::poll_events(SDL_Event* p_event) {
                 if (p_event->key.key == SDLK_W && !window) {
                     window = true;                
                 }
+                if (p_event->key.key == SDLK_F4) {
+                    show_patients = !show_patients;
+                }
+                if (p_event->key.key == SDLK_F5) {
+                    show_analytics = !show_analytics;
+                }
+                if (p_event->key.key == SDLK_F6) {
+                    show_duplicates = !show_duplicates;
+                }
+                // Undo and redo patient edits, unless a text field has the keyboard (it has its own)
+                if ((p_event->key.mod & SDL_KMOD_CTRL) && !ImGui::GetIO().WantTextInput) {
+                    bool shift = (p_event->key.mod & SDL_KMOD_SHIFT) != 0;
+                    if (p_event->key.key == SDLK_Z && !shift) {
+                        history.undo();
+                    } else if (p_event->key.key == SDLK_Y || (p_event->key.key == SDLK_Z && shift)) {
+                        history.redo();
+                    }
+                }
             } break;
 
             case STATE_PAUSE: {
@@ -65,6 +119,28 @@ void game::update() {
 
         case STATE_GAME: {
             capture_system.main_action();
+            chat.poll();
+
+            // Answer from the scheduler
+            if (pending_answer.valid() &&
+                pending_answer.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                clean_resp = pending_answer.get();
+                if (!clean_resp.empty()) {
+                    llm_cache.store(pending_prompt, LLM_CACHE_MODEL, pending_context, clean_resp);
+                    // Only answers the model gave without looking anything up carry over to paraphrases
+                    if (pending_semantic && *pending_tool_calls == 0) {
+                        llm_semantic_cache.store(pending_prompt, LLM_CACHE_MODEL, pending_semantic_context, clean_resp);
+                    }
+                    chat.add_turn(ROLE_USER, pending_prompt);
+                    chat.add_turn(ROLE_MODEL, clean_resp);
+                }
+                pending_prompt.clear();
+                pending_context.clear();
+                pending_semantic_context.clear();
+
+                show_text = true;
+                printf("%s", clean_resp.c_str());
+            }
         }; break;
 
         default: break;
@@ -99,26 +175,84 @@ void game::render(SDL_Renderer* p_renderer) {
                         audio = false;
                         printf("TEST OFF \n");
                         capture_system.play();
-                        text = run_command("./tools/whisper-cli -m tools/ggml-base.en.bin -f output.wav --no-prints --no-timestamps");
+                        text = asr.transcribe_file("output.wav").text();
                         printf("transcribed %s\n", text.c_str());
-                        response = query_gemini(text);
-                        clean_resp = extract_text(response);
+                        // Front desk questions repeat a lot, only go to the network on a miss.
+                        // Exact (normalized) match first, then paraphrases. A follow up means
+                        // something else in another conversation, it's keyed on that too
+                        std::string question = text;
+                        std::string context = conversation::is_follow_up(text) ? chat.fingerprint() : "";
+                        const std::string semantic_context = context;
+                        if (use_tools) {
+                            // The model looks records up itself, any edit may change the answer
+                            context += ":v" + std::to_string(records.version());
+                        } else {
+                            // Records the question seems to be about go in front of it. Which ones
+                            // (and what they say) is part of the cache key, edits invalidate answers
+                            question = retriever.augment(text);
+                            if (question != text) {
+                                context += ":" + hash_hex(hash64(question));
+                            }
+                        }
+                        // Paraphrases only for general questions: nothing specific (numbers,
+                        // days, names) and no records retrieved for it. Answers to those are
+                        // stored only if the model didn't call a tool either
+                        bool semantic = question == text && semantic_cache::specifics(text).empty();
+                        if (llm_cache.lookup(text, LLM_CACHE_MODEL, context, clean_resp) ||
+                            (semantic && llm_semantic_cache.lookup(text, LLM_CACHE_MODEL, semantic_context, clean_resp))) {
+                            chat.add_turn(ROLE_USER, text);
+                            chat.add_turn(ROLE_MODEL, clean_resp);
+                            show_text = true;
+                            printf("%s", clean_resp.c_str());
+                        } else {
+                            // Runs on the scheduler, update() picks the answer up when it lands
+                            pending_prompt = text;
+                            pending_context = context;
+                            pending_semantic = semantic;
+                            pending_semantic_context = semantic_context;
+                            pending_tool_calls = std::make_shared<size_t>(0);
+                            const llm_toolbox* toolbox = use_tools ? &tools : nullptr;
+                            pending_answer = llm_requests.submit([messages = chat.build_request(question), toolbox,
+                                                                  calls = pending_tool_calls]() {
+                                return llm_router::get_instance().query(messages, toolbox, calls.get());
+                            }, PRIORITY_INTERACTIVE);
+                        }
                         text.clear();
-
-                        show_text = true;
-                        printf("%s", clean_resp.c_str());
                     }
                 }
+                // The one at the desk is done, their questions don't carry over
+                ImGui::BeginDisabled(pending_answer.valid());
+                if (ImGui::Button("NEXT PATIENT")) {
+                    chat.clear();
+                    show_text = false;
+                }
+                ImGui::EndDisabled();
+                if (pending_answer.valid()) {
+                    ImGui::Text("THINKING...");
+                }
                 if (show_text) {
                     ImGui::Text("%s", clean_resp.c_str());
                 }
 
                 ImGui::End();
             }
+            if (show_patients) {
+                browser.show(&show_patients);
+            }
+            if (show_analytics) {
+                dashboard.show(&show_analytics);
+            }
+            if (show_duplicates) {
+                duplicates.show(&show_duplicates);
+            }
         } break;
 
         default: break;
     } 
+
+    if (debug) {
+        show_debug();
+    }
 }
 
 void game::reset() { 
@@ -127,7 +261,139 @@ void game::reset() {
 }
 
 void game::quit() {
-
+    llm_requests.shutdown();
+    records.close();
 }
 
-void game::show_debug() { }
+void game::show_debug() {
+    ImGui::Begin("DEBUG WINDOW", &debug);
+
+    ImGui::Text("FPS: %.1f", ImGui::GetIO().Framerate);
+
+    ImGui::SeparatorText("TRANSCRIPTION CACHE");
+    cache_stats asr_stats = asr.cache().stats();
+    ImGui::Text("HITS: %llu (MEMORY %llu / DISK %llu)",
+                static_cast<unsigned long long>(asr_stats.memory_hits + asr_stats.disk_hits),
+                static_cast<unsigned long long>(asr_stats.memory_hits),
+                static_cast<unsigned long long>(asr_stats.disk_hits));
+    ImGui::Text("MISSES: %llu", static_cast<unsigned long long>(asr_stats.misses));
+    ImGui::Text("HIT RATE: %.1f%%", asr_stats.hit_rate() * 100.0);
+    ImGui::Text("IN MEMORY: %zu", asr_stats.memory_entries);
+
+    ImGui::SeparatorText("LLM RESPONSE CACHE");
+    response_cache_stats llm_stats = llm_cache.stats();
+    ImGui::Text("HITS: %llu  MISSES: %llu (EXPIRED %llu)",
+                static_cast<unsigned long long>(llm_stats.hits),
+                static_cast<unsigned long long>(llm_stats.misses),
+                static_cast<unsigned long long>(llm_stats.expired));
+    ImGui::Text("HIT RATE: %.1f%%", llm_stats.hit_rate() * 100.0);
+    ImGui::Text("ENTRIES: %zu", llm_stats.entries);
+
+    ImGui::SeparatorText("LLM SEMANTIC CACHE");
+    semantic_cache_stats sem_stats = llm_semantic_cache.stats();
+    ImGui::Text("HITS: %llu  MISSES: %llu  HIT RATE: %.1f%%",
+                static_cast<unsigned long long>(sem_stats.hits),
+                static_cast<unsigned long long>(sem_stats.misses),
+                sem_stats.hit_rate() * 100.0);
+    ImGui::Text("LOOKUP: %.1f us (AVG %.1f / MAX %.1f)", 
+                sem_stats.last_lookup_us, sem_stats.avg_lookup_us, sem_stats.max_lookup_us);
+    ImGui::Text("LAST SIMILARITY: %.3f  ENTRIES: %zu", sem_stats.last_similarity, sem_stats.entries);
+
+    ImGui::SeparatorText("PATIENT RETRIEVAL");
+    retriever_stats retrieval = retriever.stats();
+    ImGui::Text("INDEXED: %zu  TERMS: %zu  LAST: %zu HITS IN %.1f us",
+                retrieval.indexed, retrieval.terms, retrieval.last_hits, retrieval.last_lookup_us);
+    fuzzy_stats fuzzy = names.stats();
+    ImGui::Text("FUZZY NAMES: %zu (%zu DEAD)  TRIGRAMS: %zu  LAST: %zu CANDIDATES IN %.1f us",
+                fuzzy.names, fuzzy.dead, fuzzy.grams, fuzzy.last_candidates, fuzzy.last_lookup_us);
+    browser_stats table = browser.stats();
+    ImGui::Text("PATIENT TABLE: %zu ROWS  %zu DRAWN IN %.0f us  LAST SORT: %.1f ms",
+                table.rows, table.drawn, table.draw_us, table.sort_ms);
+    dashboard_stats dash = dashboard.stats();
+    ImGui::Text("ANALYTICS: %zu ROWS  %zu MB  LAST SUMMARY: %llu PATIENTS IN %.2f ms (%zu SO FAR)",
+                analytics.size(), analytics.memory() >> 20, static_cast<unsigned long long>(dash.patients),
+                dash.summary_ms, dash.recomputes);
+    review_stats review = duplicates.stats();
+    ImGui::Text("DUPLICATES: %s  %zu SUGGESTED  %zu MERGED / %zu DISMISSED  LAST SEARCH: %zu PAIRS IN %.0f ms",
+                review.searching ? "SEARCHING" : "IDLE", review.suggestions, review.merged, review.dismissed,
+                review.candidates, review.search_ms);
+    history_stats versions = history.stats();
+    ImGui::Text("HISTORY: VERSION %llu  %zu UNDO / %zu REDO  LAST: %zu RECORDS IN %.2f ms",
+                static_cast<unsigned long long>(versions.version), versions.undo, versions.redo,
+                versions.last_changes, versions.last_travel_ms);
+    store_stats storage = records.storage();
+    ImGui::Text("STORE: %s  LSN %llu / DURABLE %llu  SYNCS: %llu  WAL: %llu KB  LAST SYNC: %.2f ms",
+                storage.failed ? "FAILED" : (storage.persistent ? (storage.encrypted ? "ENCRYPTED" : "DISK") : "MEMORY"),
+                static_cast<unsigned long long>(storage.lsn),
+                static_cast<unsigned long long>(storage.durable_lsn),
+                static_cast<unsigned long long>(storage.syncs),
+                static_cast<unsigned long long>(storage.wal_bytes >> 10),
+                storage.last_sync_ms);
+    ImGui::Text("ROWS: %zu x %zu B  TEXT: %llu KB (%llu KB LIVE)  REWRITES: %llu",
+                records.size(), storage.row_bytes,
+                static_cast<unsigned long long>(storage.arena_bytes >> 10),
+                static_cast<unsigned long long>(storage.live_bytes >> 10),
+                static_cast<unsigned long long>(storage.rewrites));
+    index_stats indexes = records.indexes();
+    if (indexes.built) {
+        ImGui::Text("INDEXES: %zu NAME / %zu DATE KEYS  %zu MB  BUILT IN %.0f ms  LAST LOOKUP: %.1f us",
+                    indexes.name_keys, indexes.date_keys, indexes.memory >> 20, indexes.build_ms, indexes.last_lookup_us);
+    } else {
+        ImGui::Text("INDEXES: NOT BUILT YET");
+    }
+    ImGui::Text("TOOLS: %s  CALLS: %llu  FAILED: %llu", use_tools ? "ON" : "OFF",
+                static_cast<unsigned long long>(tools.calls()),
+                static_cast<unsigned long long>(tools.failures()));
+
+    ImGui::SeparatorText("LLM CONVERSATION");
+    ImGui::Text("TURNS: %zu  CONTEXT: %zu TOKENS  SUMMARY: %zu CHARS",
+                chat.turn_count(), chat.context_tokens(), chat.summary_text().size());
+
+    ImGui::SeparatorText("LLM SCHEDULER");
+    scheduler_stats sched = llm_requests.stats();
+    ImGui::Text("QUEUED: INTERACTIVE %zu / NORMAL %zu / BATCH %zu  IN FLIGHT: %zu",
+                sched.queued[PRIORITY_INTERACTIVE], sched.queued[PRIORITY_NORMAL], 
+                sched.queued[PRIORITY_BATCH], sched.in_flight);
+    ImGui::Text("MAX DEPTH: %zu / %zu / %zu  AVG WAIT: %.0f / %.0f / %.0f ms",
+                sched.max_queued[PRIORITY_INTERACTIVE], sched.max_queued[PRIORITY_NORMAL], 
+                sched.max_queued[PRIORITY_BATCH],
+                sched.avg_wait_ms[PRIORITY_INTERACTIVE], sched.avg_wait_ms[PRIORITY_NORMAL], 
+                sched.avg_wait_ms[PRIORITY_BATCH]);
+    ImGui::Text("COMPLETED: %llu  REJECTED: %llu  THROTTLED: %llu  TOKENS: %.1f",
+                static_cast<unsigned long long>(sched.completed),
+                static_cast<unsigned long long>(sched.rejected),
+                static_cast<unsigned long long>(sched.throttled),
+                sched.tokens);
+
+    ImGui::SeparatorText("LLM ROUTING");
+    for (const route_info& route : llm_router::get_instance().routes()) {
+        ImGui::Text("%s: %s  EXPECTED %.0f ms  ROUTED %llu  ANSWERED %llu  FAILING %u",
+                    route.name.c_str(), route.available ? "UP" : "DOWN", route.expected_ms,
+                    static_cast<unsigned long long>(route.routed),
+                    static_cast<unsigned long long>(route.answered),
+                    route.failures);
+    }
+
+    ImGui::SeparatorText("LLM LATENCY");
+    latency_tracker& latency = latency_tracker::get_instance();
+    hedge_stats hedging = latency.stats();
+    ImGui::Text("REQUESTS: %llu  P50 %.0f ms  P99 %.0f ms",
+                static_cast<unsigned long long>(hedging.requests),
+                latency.requests().percentile(0.50),
+                latency.requests().percentile(0.99));
+    ImGui::Text("HEDGING: %s  HEDGED: %llu  HEDGE WINS: %llu",
+                latency.hedging.enabled ? "ON" : "OFF",
+                static_cast<unsigned long long>(hedging.hedged),
+                static_cast<unsigned long long>(hedging.hedge_wins));
+    latency.for_each([](const std::string& name, backend_latency& backend) {
+        ImGui::Text("%s: TTFB P50 %.0f / P95 %.0f ms  TOTAL P99 %.0f ms  HEDGE AFTER %.0f ms  FAILS %llu",
+                    name.c_str(),
+                    backend.first_byte.percentile(0.50),
+                    backend.first_byte.percentile(0.95),
+                    backend.total.percentile(0.99),
+                    hedge_delay_ms(backend, latency_tracker::get_instance().hedging),
+                    static_cast<unsigned long long>(backend.failures.load(std::memory_order_relaxed)));
+    });
+
+    ImGui::End();
+}
@@ -0,0 +1,74 @@
+#include "util/llm/hashing_embedder.hpp"
+#include "util/hash.hpp"
+#include "util/llm/response_cache.hpp"
+#include <array>
+#include <cmath>
+#include <string_view>
+
+namespace {
+
+constexpr std::array<std::string_view, 9> FILLER = {
+    "um", "umm", "uh", "uhh", "er", "erm", "ah", "hmm", "mm"
+};
+
+// Feature weights, whole words matter more than shared letters
+constexpr float UNIGRAM_WEIGHT = 1.0f;
+constexpr float BIGRAM_WEIGHT = 0.7f;
+constexpr float TRIGRAM_WEIGHT = 0.35f;
+
+void add_feature(std::vector<float>& p_out, std::string_view p_feature, u_int64_t p_seed, float p_weight) {
+    u_int64_t h = hash64(p_feature, p_seed);
+    float sign = (h >> 63) ? -1.0f : 1.0f; // Signed buckets cancel collisions out on average
+    p_out[h % p_out.size()] += sign * p_weight;
+}
+
+} // namespace
+
+std::vector<float> hashing_embedder::embed(const std::string& p_text) const {
+    std::vector<float> out(dimension, 0.0f);
+
+    std::string normalized = response_cache::normalize_prompt(p_text);
+
+    std::vector<std::string_view> words;
+    std::string_view rest = normalized;
+    while (!rest.empty()) {
+        size_t space = rest.find(' ');
+        std::string_view word = rest.substr(0, space);
+        bool filler = false;
+        for (std::string_view f : FILLER) {
+            filler |= (word == f);
+        }
+        if (!filler) {
+            words.push_back(word);
+        }
+        rest = (space == std::string_view::npos) ? std::string_view{} : rest.substr(space + 1);
+    }
+
+    for (size_t i = 0; i < words.size(); i++) {
+        add_feature(out, words[i], 1, UNIGRAM_WEIGHT);
+
+        if (i + 1 < words.size()) {
+            std::string bigram = std::string(words[i]) + ' ' + std::string(words[i + 1]);
+            add_feature(out, bigram, 2, BIGRAM_WEIGHT);
+        }
+
+        // Character trigrams with word boundary markers absorb spelling noise ("Ode"/"Odeh")
+        std::string padded = "^" + std::string(words[i]) + "$";
+        for (size_t c = 0; c + 3 <= padded.size(); c++) {
+            add_feature(out, std::string_view(padded).substr(c, 3), 3, TRIGRAM_WEIGHT);
+        }
+    }
+
+    float norm = 0.0f;
+    for (float v : out) {
+        norm += v * v;
+    }
+    if (norm > 0.0f) {
+        norm = 1.0f / std::sqrt(norm);
+        for (float& v : out) {
+            v *= norm;
+        }
+    }
+
+    return out;
+}
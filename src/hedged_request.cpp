@@ -0,0 +1,151 @@
+#include "util/llm/hedged_request.hpp"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock clock_type;
+
+double elapsed_ms(clock_type::time_point p_since) {
+    return std::chrono::duration<double, std::milli>(clock_type::now() - p_since).count();
+}
+
+// One leg of a (possibly) hedged request
+typedef struct leg {
+    const hedge_target* target;
+    backend_latency* latency;
+    http_call call;
+    clock_type::time_point started;
+    bool first_byte_seen = false;
+    double first_byte_ms = -1.0; // Held back until we know the call didn't fail
+    bool finished = false;
+} leg;
+
+} // namespace
+
+double hedge_delay_ms(const backend_latency& p_latency, const hedge_config& p_config) {
+    if (p_latency.first_byte.count() < p_config.min_samples) {
+        return p_config.default_delay_ms;
+    }
+    return std::clamp(p_latency.first_byte.percentile(p_config.percentile), 
+                      p_config.min_delay_ms, p_config.max_delay_ms);
+}
+
+http_response hedged_post(const hedge_target& p_primary, const hedge_target* p_alternate, size_t* p_winner,
+                          size_t* p_sent) {
+    latency_tracker& tracker = latency_tracker::get_instance();
+    const hedge_config cfg = tracker.hedging;
+    const auto start = clock_type::now();
+
+    std::vector<leg> legs(2);
+    size_t active = 1;
+
+    legs[0].target = &p_primary;
+    legs[0].latency = &tracker.backend(p_primary.backend);
+    legs[0].started = start;
+    legs[0].call.start(p_primary.request);
+
+    const hedge_target* second = p_alternate ? p_alternate : &p_primary;
+    const double delay = hedge_delay_ms(*legs[0].latency, cfg);
+
+    int winner = -1;
+    http_response fallback;
+    bool have_fallback = false;
+
+    while (winner < 0) {
+        bool can_hedge = cfg.enabled && active == 1 && !legs[0].first_byte_seen && !legs[0].finished;
+
+        // Wait on every live pipe at once, or until it's time to hedge
+        pollfd fds[6];
+        nfds_t count = 0;
+        for (size_t i = 0; i < active; i++) {
+            if (!legs[i].finished) {
+                count += legs[i].call.poll_fds(fds + count);
+            }
+        }
+        int timeout = can_hedge ? std::max(1, static_cast<int>(delay - elapsed_ms(start))) : -1;
+        if (count > 0) {
+            poll(fds, count, timeout);
+        }
+
+        bool any_running = false;
+        for (size_t i = 0; i < active; i++) {
+            leg& l = legs[i];
+            if (l.finished) {
+                continue;
+            }
+
+            l.finished = l.call.pump(0);
+
+            // curl's -w trailer also shows up on failures, only trust it for live or good calls
+            if (!l.first_byte_seen && l.call.got_first_byte()) {
+                l.first_byte_seen = true;
+                l.first_byte_ms = elapsed_ms(l.started);
+                if (!l.finished) {
+                    l.latency->first_byte.record(l.first_byte_ms);
+                    l.first_byte_ms = -1.0;
+                }
+            }
+
+            if (!l.finished) {
+                any_running = true;
+                continue;
+            }
+
+            http_response response = l.call.take_response();
+            if (response.ok()) {
+                if (l.first_byte_ms >= 0.0) {
+                    l.latency->first_byte.record(l.first_byte_ms);
+                }
+                l.latency->total.record(elapsed_ms(l.started));
+                winner = static_cast<int>(i);
+                fallback = std::move(response);
+                break;
+            }
+
+            l.latency->failures.fetch_add(1, std::memory_order_relaxed);
+            if (!have_fallback || i == 0) {
+                fallback = std::move(response); // Report the primary's error if both fail
+                have_fallback = true;
+            }
+        }
+
+        if (winner >= 0) {
+            break;
+        }
+
+        // Slow first byte (or a fast failure): send the duplicate
+        if (cfg.enabled && active == 1 &&
+            (legs[0].finished || (!legs[0].first_byte_seen && elapsed_ms(start) >= delay))) {
+            legs[1].target = second;
+            legs[1].latency = &tracker.backend(second->backend);
+            legs[1].started = clock_type::now();
+            legs[1].call.start(second->request);
+            active = 2;
+            continue;
+        }
+
+        if (!any_running) {
+            break; // Everything we sent has failed
+        }
+    }
+
+    // Losing leg is cancelled, its curl is killed by cancel()
+    for (size_t i = 0; i < active; i++) {
+        if (static_cast<int>(i) != winner && !legs[i].finished) {
+            legs[i].call.cancel();
+        }
+    }
+
+    tracker.requests().record(elapsed_ms(start));
+    tracker.count_request(active > 1, winner == 1);
+    if (p_winner) {
+        *p_winner = winner == 1 ? 1 : 0;
+    }
+    if (p_sent) {
+        *p_sent = active;
+    }
+
+    return fallback;
+}
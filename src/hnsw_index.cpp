@@ -0,0 +1,204 @@
+#include "util/llm/hnsw_index.hpp"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <unordered_set>
+
+hnsw_index::hnsw_index(size_t p_dim, size_t p_m, size_t p_ef_construction, u_int64_t p_seed)
+    : dimension(p_dim),
+      m(std::max<size_t>(2, p_m)),
+      m0(2 * std::max<size_t>(2, p_m)),
+      ef_construction(std::max(p_ef_construction, p_m)),
+      level_mult(1.0 / std::log(static_cast<double>(std::max<size_t>(2, p_m)))),
+      rng(p_seed) { }
+
+float hnsw_index::similarity(const float* p_a, u_int32_t p_b) const {
+    const float* b = vector_of(p_b);
+    float dot = 0.0f;
+    for (size_t i = 0; i < dimension; i++) {
+        dot += p_a[i] * b[i];
+    }
+    return dot;
+}
+
+std::vector<hnsw_index::candidate> hnsw_index::search_layer(const float* p_query,
+                                                            u_int32_t p_entry,
+                                                            size_t p_ef,
+                                                            int p_level) const {
+    std::unordered_set<u_int32_t> visited;
+    visited.insert(p_entry);
+
+    // to_visit pops the most similar first, found pops the least similar first
+    std::priority_queue<candidate> to_visit;
+    std::priority_queue<candidate, std::vector<candidate>, std::greater<candidate>> found;
+
+    float s = similarity(p_query, p_entry);
+    to_visit.push({s, p_entry});
+    found.push({s, p_entry});
+
+    while (!to_visit.empty()) {
+        candidate current = to_visit.top();
+        if (found.size() >= p_ef && current.first < found.top().first) {
+            break; // Everything left is worse than our worst result
+        }
+        to_visit.pop();
+
+        for (u_int32_t neighbour : links[current.second][p_level]) {
+            if (!visited.insert(neighbour).second) {
+                continue;
+            }
+
+            float ns = similarity(p_query, neighbour);
+            if (found.size() < p_ef || ns > found.top().first) {
+                to_visit.push({ns, neighbour});
+                found.push({ns, neighbour});
+                if (found.size() > p_ef) {
+                    found.pop();
+                }
+            }
+        }
+    }
+
+    std::vector<candidate> out;
+    out.reserve(found.size());
+    while (!found.empty()) {
+        out.push_back(found.top());
+        found.pop();
+    }
+    std::reverse(out.begin(), out.end());
+    return out;
+}
+
+std::vector<u_int32_t> hnsw_index::select_neighbours(const std::vector<candidate>& p_candidates, size_t p_max) const {
+    std::vector<u_int32_t> out;
+    out.reserve(p_max);
+
+    // Take a candidate only if it is closer to the new node than to anything
+    // already picked, this keeps links spread out instead of clustered
+    for (const auto& [sim, id] : p_candidates) {
+        if (out.size() >= p_max) {
+            break;
+        }
+        bool diverse = true;
+        for (u_int32_t picked : out) {
+            if (similarity(vector_of(id), picked) > sim) {
+                diverse = false;
+                break;
+            }
+        }
+        if (diverse) {
+            out.push_back(id);
+        }
+    }
+
+    // Top up with the closest leftovers so sparse graphs stay connected
+    for (const auto& [sim, id] : p_candidates) {
+        if (out.size() >= p_max) {
+            break;
+        }
+        if (std::find(out.begin(), out.end(), id) == out.end()) {
+            out.push_back(id);
+        }
+    }
+
+    return out;
+}
+
+u_int32_t hnsw_index::add(const float* p_vector) {
+    const u_int32_t id = static_cast<u_int32_t>(levels.size());
+
+    std::uniform_real_distribution<double> uniform(std::nextafter(0.0, 1.0), 1.0);
+    int level = std::min(static_cast<int>(-std::log(uniform(rng)) * level_mult), 255);
+
+    vectors.insert(vectors.end(), p_vector, p_vector + dimension);
+    levels.push_back(static_cast<u_int8_t>(level));
+    links.emplace_back(level + 1);
+    deleted.push_back(0);
+
+    if (max_level < 0) {
+        entry_point = id;
+        max_level = level;
+        return id;
+    }
+
+    // Greedy descent through the layers above the new node
+    u_int32_t current = entry_point;
+    for (int l = max_level; l > level; l--) {
+        current = search_layer(p_vector, current, 1, l).front().second;
+    }
+
+    for (int l = std::min(level, max_level); l >= 0; l--) {
+        std::vector<candidate> candidates = search_layer(p_vector, current, ef_construction, l);
+        size_t max_links = (l == 0) ? m0 : m;
+
+        links[id][l] = select_neighbours(candidates, m);
+
+        for (u_int32_t neighbour : links[id][l]) {
+            auto& back = links[neighbour][l];
+            back.push_back(id);
+            if (back.size() > max_links) {
+                // Re-prune the neighbour's list around the neighbour itself
+                std::vector<candidate> pool;
+                pool.reserve(back.size());
+                for (u_int32_t n : back) {
+                    pool.push_back({similarity(vector_of(neighbour), n), n});
+                }
+                std::sort(pool.begin(), pool.end(), std::greater<candidate>());
+                back = select_neighbours(pool, max_links);
+            }
+        }
+
+        current = candidates.front().second;
+    }
+
+    if (level > max_level) {
+        max_level = level;
+        entry_point = id;
+    }
+
+    return id;
+}
+
+void hnsw_index::remove(u_int32_t p_id) {
+    if (p_id < deleted.size() && !deleted[p_id]) {
+        deleted[p_id] = 1;
+        removed++;
+    }
+}
+
+std::vector<std::pair<u_int32_t, float>> hnsw_index::search(const float* p_query,
+                                                            size_t p_k,
+                                                            size_t p_ef) const {
+    std::vector<std::pair<u_int32_t, float>> out;
+    if (max_level < 0 || p_k == 0) {
+        return out;
+    }
+
+    u_int32_t current = entry_point;
+    for (int l = max_level; l > 0; l--) {
+        current = search_layer(p_query, current, 1, l).front().second;
+    }
+
+    // Over-fetch a little so tombstoned nodes don't eat into k
+    std::vector<candidate> found = search_layer(p_query, current, std::max(p_ef, p_k) + std::min(removed, p_k), 0);
+    for (const auto& [sim, id] : found) {
+        if (out.size() >= p_k) {
+            break;
+        }
+        if (!deleted[id]) {
+            out.push_back({id, sim});
+        }
+    }
+
+    return out;
+}
+
+void hnsw_index::clear() {
+    vectors.clear();
+    levels.clear();
+    links.clear();
+    deleted.clear();
+    removed = 0;
+    entry_point = 0;
+    max_level = -1;
+}
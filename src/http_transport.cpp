@@ -0,0 +1,325 @@
+#include "util/llm/http_transport.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+// curl appends this + the status code after the body (-w)
+constexpr char STATUS_MARKER[] = "\n@@AVA_HTTP_STATUS@@";
+
+// Where curl finds the header pipe
+constexpr int HEADER_FD = 3;
+
+void set_nonblocking(int p_fd) {
+    fcntl(p_fd, F_SETFL, fcntl(p_fd, F_GETFL) | O_NONBLOCK);
+}
+
+} // namespace
+
+http_call::~http_call() {
+    cancel();
+}
+
+bool http_call::start(const http_request& p_request) {
+    cancel();
+
+    body = p_request.body;
+    written = 0;
+    output.clear();
+    errors.clear();
+    exit_code = -1;
+    done = false;
+
+    // stdin goes through a socketpair so writes can use MSG_NOSIGNAL, a
+    // curl that dies early must not take us down with SIGPIPE. All of them
+    // close on exec, other threads' curls mustn't inherit this one's ends
+    int in_pair[2];
+    int out_pipe[2];
+    int err_pipe[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, in_pair) == -1) {
+        errors = std::string("socketpair: ") + strerror(errno);
+        done = true;
+        return false;
+    }
+    if (pipe2(out_pipe, O_CLOEXEC) == -1) {
+        errors = std::string("pipe: ") + strerror(errno);
+        close(in_pair[0]);
+        close(in_pair[1]);
+        done = true;
+        return false;
+    }
+    if (pipe2(err_pipe, O_CLOEXEC) == -1) {
+        errors = std::string("pipe: ") + strerror(errno);
+        close(in_pair[0]);
+        close(in_pair[1]);
+        close(out_pipe[0]);
+        close(out_pipe[1]);
+        done = true;
+        return false;
+    }
+
+    // Headers are a few hundred bytes, they fit in the pipe whole and curl
+    // reads them to EOF once it starts
+    std::string header_lines;
+    for (const auto& header : p_request.headers) {
+        header_lines += header + "\n";
+    }
+    int header_pipe[2] = {-1, -1};
+    if (!header_lines.empty()) {
+        bool ok = pipe2(header_pipe, O_CLOEXEC) == 0;
+        if (ok) {
+            set_nonblocking(header_pipe[1]);
+            ok = write(header_pipe[1], header_lines.data(), header_lines.size()) ==
+                 static_cast<ssize_t>(header_lines.size());
+            close(header_pipe[1]);
+        }
+        if (!ok) {
+            errors = std::string("header pipe: ") + strerror(errno);
+            if (header_pipe[0] != -1) {
+                close(header_pipe[0]);
+            }
+            close(in_pair[0]);
+            close(in_pair[1]);
+            close(out_pipe[0]);
+            close(out_pipe[1]);
+            close(err_pipe[0]);
+            close(err_pipe[1]);
+            done = true;
+            return false;
+        }
+    }
+
+    // Build argv before forking, only async-signal-safe calls in the child
+    std::string timeout = std::to_string(std::max(1L, p_request.timeout_ms / 1000));
+    std::string write_out = std::string(STATUS_MARKER) + "%{http_code}";
+    std::vector<std::string> args = {
+        "curl", "-sS", "-X", "POST",
+        "--max-time", timeout,
+        "--data-binary", "@-",
+        "-H", "Expect:", // Large bodies would otherwise wait a second for 100-continue
+        "-w", write_out
+    };
+    if (header_pipe[0] != -1) {
+        args.push_back("-H");
+        args.push_back("@/dev/fd/" + std::to_string(HEADER_FD));
+    }
+    args.push_back(p_request.url);
+
+    std::vector<char*> argv;
+    for (auto& arg : args) {
+        argv.push_back(arg.data());
+    }
+    argv.push_back(nullptr);
+
+    pid = fork();
+    if (pid == -1) {
+        errors = std::string("fork: ") + strerror(errno);
+        close(in_pair[0]);
+        close(in_pair[1]);
+        close(out_pipe[0]);
+        close(out_pipe[1]);
+        close(err_pipe[0]);
+        close(err_pipe[1]);
+        if (header_pipe[0] != -1) {
+            close(header_pipe[0]);
+        }
+        done = true;
+        return false;
+    }
+
+    if (pid == 0) {
+        // Child process, dup2() clears close on exec on the copies
+        dup2(in_pair[1], STDIN_FILENO);
+        dup2(out_pipe[1], STDOUT_FILENO);
+        dup2(err_pipe[1], STDERR_FILENO);
+        close(in_pair[0]);
+        close(in_pair[1]);
+        close(out_pipe[0]);
+        close(out_pipe[1]);
+        close(err_pipe[0]);
+        close(err_pipe[1]);
+        if (header_pipe[0] == HEADER_FD) {
+            fcntl(HEADER_FD, F_SETFD, 0); // Already in place, only has to survive exec
+        } else if (header_pipe[0] != -1) {
+            dup2(header_pipe[0], HEADER_FD);
+        }
+
+        execvp("curl", argv.data());
+        _exit(127); // Only happens on error
+    }
+
+    // Parent process
+    if (header_pipe[0] != -1) {
+        close(header_pipe[0]);
+    }
+    close(in_pair[1]);
+    close(out_pipe[1]);
+    close(err_pipe[1]);
+    in_fd = in_pair[0];
+    out_fd = out_pipe[0];
+    err_fd = err_pipe[0];
+    set_nonblocking(in_fd);
+    set_nonblocking(out_fd);
+    set_nonblocking(err_fd);
+
+    if (body.empty()) {
+        close(in_fd);
+        in_fd = -1;
+    }
+
+    return true;
+}
+
+size_t http_call::poll_fds(pollfd* p_out) const {
+    size_t count = 0;
+    if (in_fd != -1) p_out[count++] = {in_fd, POLLOUT, 0};
+    if (out_fd != -1) p_out[count++] = {out_fd, POLLIN, 0};
+    if (err_fd != -1) p_out[count++] = {err_fd, POLLIN, 0};
+    return count;
+}
+
+bool http_call::pump(int p_timeout_ms) {
+    if (done) {
+        return true;
+    }
+
+    pollfd fds[3];
+    int count = static_cast<int>(poll_fds(fds));
+
+    if (count == 0) {
+        reap(true);
+        return done;
+    }
+
+    if (poll(fds, count, p_timeout_ms) < 0) {
+        if (errno != EINTR) {
+            cancel();
+        }
+        return done;
+    }
+
+    char buff[1 << 16];
+    for (int i = 0; i < count; i++) {
+        if (!fds[i].revents) {
+            continue;
+        }
+
+        if (fds[i].fd == in_fd) {
+            // Stream the body straight from memory, 64 KB at a time
+            while (written < body.size()) {
+                ssize_t n = send(in_fd, body.data() + written, 
+                                 std::min<size_t>(body.size() - written, sizeof(buff)), MSG_NOSIGNAL);
+                if (n <= 0) {
+                    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                        break;
+                    }
+                    written = body.size(); // curl went away, stop writing
+                    break;
+                }
+                written += n;
+            }
+            if (written >= body.size()) {
+                close(in_fd); // EOF tells curl the body is complete
+                in_fd = -1;
+                std::string().swap(body);
+            }
+        } else {
+            int& fd = (fds[i].fd == out_fd) ? out_fd : err_fd;
+            std::string& sink = (fds[i].fd == out_fd) ? output : errors;
+            ssize_t n;
+            while ((n = read(fd, buff, sizeof(buff))) > 0) {
+                sink.append(buff, n);
+            }
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+                close(fd);
+                fd = -1;
+            }
+        }
+    }
+
+    if (out_fd == -1 && err_fd == -1) {
+        if (in_fd != -1) {
+            close(in_fd);
+            in_fd = -1;
+        }
+        reap(true);
+    }
+
+    return done;
+}
+
+void http_call::reap(bool p_block) {
+    if (pid <= 0) {
+        done = true;
+        return;
+    }
+
+    int status = 0;
+    if (waitpid(pid, &status, p_block ? 0 : WNOHANG) == pid) {
+        exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+        pid = -1;
+        done = true;
+    }
+}
+
+void http_call::close_fds() {
+    for (int* fd : {&in_fd, &out_fd, &err_fd}) {
+        if (*fd != -1) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+void http_call::cancel() {
+    close_fds();
+    if (pid > 0) {
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+        pid = -1;
+        exit_code = -1;
+        if (errors.empty()) {
+            errors = "cancelled";
+        }
+    }
+    done = true;
+}
+
+http_response http_call::take_response() {
+    http_response response;
+
+    size_t marker = output.rfind(STATUS_MARKER);
+    if (marker != std::string::npos) {
+        response.status = std::atoi(output.c_str() + marker + sizeof(STATUS_MARKER) - 1);
+        output.resize(marker);
+    }
+    response.body = std::move(output);
+    response.error = std::move(errors);
+
+    if (exit_code != 0 && response.error.empty()) {
+        response.error = (exit_code == 127) ? "couldn't run curl" : "curl exited with code " + std::to_string(exit_code);
+    }
+    if (exit_code != 0) {
+        response.status = 0;
+    }
+
+    output.clear();
+    errors.clear();
+    return response;
+}
+
+http_response http_post(const http_request& p_request) {
+    http_call call;
+    if (call.start(p_request)) {
+        while (!call.pump(-1)) { }
+    }
+    return call.take_response();
+}
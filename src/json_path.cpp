@@ -0,0 +1,314 @@
+#include "util/json_path.hpp"
+#include <cstring>
+#include <sys/types.h>
+
+namespace {
+
+typedef struct cursor {
+    const char* at;
+    const char* end;
+} cursor;
+
+void skip_space(cursor& p_cur) {
+    while (p_cur.at < p_cur.end && 
+           (*p_cur.at == ' ' || *p_cur.at == '\n' || *p_cur.at == '\r' || *p_cur.at == '\t')) {
+        p_cur.at++;
+    }
+}
+
+// p_cur at the opening quote, leaves it after the closing one
+bool skip_string(cursor& p_cur, bool* p_escaped = nullptr) {
+    const char* at = p_cur.at + 1;
+    bool escaped = false;
+    while (true) {
+        // memchr is vectorized, text fields are long and mostly escape free
+        const char* quote = static_cast<const char*>(std::memchr(at, '"', p_cur.end - at));
+        if (!quote) {
+            return false;
+        }
+        const char* backslash = static_cast<const char*>(std::memchr(at, '\\', quote - at));
+        if (!backslash) {
+            p_cur.at = quote + 1;
+            if (p_escaped) {
+                *p_escaped = escaped;
+            }
+            return true;
+        }
+        escaped = true;
+        at = backslash + 2; // Whatever is escaped, quotes included, is skipped
+        if (at > p_cur.end) {
+            return false;
+        }
+    }
+}
+
+// Skips one value of any kind, p_cur at its first character
+bool skip_value(cursor& p_cur) {
+    if (p_cur.at >= p_cur.end) {
+        return false;
+    }
+
+    char c = *p_cur.at;
+    if (c == '"') {
+        return skip_string(p_cur);
+    }
+
+    if (c == '{' || c == '[') {
+        // Only brackets and strings matter, anything else inside is skipped unchecked
+        size_t depth = 0;
+        while (p_cur.at < p_cur.end) {
+            c = *p_cur.at;
+            if (c == '"') {
+                if (!skip_string(p_cur)) {
+                    return false;
+                }
+                continue;
+            }
+            if (c == '{' || c == '[') {
+                depth++;
+            } else if (c == '}' || c == ']') {
+                if (--depth == 0) {
+                    p_cur.at++;
+                    return true;
+                }
+            }
+            p_cur.at++;
+        }
+        return false;
+    }
+
+    // Number or literal
+    const char* start = p_cur.at;
+    while (p_cur.at < p_cur.end && *p_cur.at != ',' && *p_cur.at != '}' && *p_cur.at != ']' &&
+           *p_cur.at != ' ' && *p_cur.at != '\n' && *p_cur.at != '\r' && *p_cur.at != '\t') {
+        p_cur.at++;
+    }
+    return p_cur.at > start;
+}
+
+json_kind kind_of(char p_c) {
+    switch (p_c) {
+        case '"': return JSON_STRING;
+        case '{': return JSON_OBJECT;
+        case '[': return JSON_ARRAY;
+        case 't': case 'f': return JSON_BOOL;
+        case 'n': return JSON_NULL;
+        default: return JSON_NUMBER;
+    }
+}
+
+// Compares a raw key (quotes included) to p_want, unescaping only if it has to
+bool key_equals(std::string_view p_raw, bool p_escaped, std::string_view p_want) {
+    std::string_view inner = p_raw.substr(1, p_raw.size() - 2);
+    if (!p_escaped) {
+        return inner == p_want;
+    }
+    std::string scratch;
+    std::string_view key;
+    return json_string({JSON_STRING, p_raw}, scratch, key) && key == p_want;
+}
+
+// Steps into member p_key of the object at p_cur
+bool enter_member(cursor& p_cur, std::string_view p_key) {
+    p_cur.at++; // {
+    while (true) {
+        skip_space(p_cur);
+        if (p_cur.at >= p_cur.end || *p_cur.at != '"') {
+            return false; // Also covers '}', the key isn't there
+        }
+
+        const char* key_start = p_cur.at;
+        bool escaped = false;
+        if (!skip_string(p_cur, &escaped)) {
+            return false;
+        }
+        std::string_view raw_key(key_start, p_cur.at - key_start);
+
+        skip_space(p_cur);
+        if (p_cur.at >= p_cur.end || *p_cur.at != ':') {
+            return false;
+        }
+        p_cur.at++;
+        skip_space(p_cur);
+
+        if (key_equals(raw_key, escaped, p_key)) {
+            return true;
+        }
+
+        if (!skip_value(p_cur)) {
+            return false;
+        }
+        skip_space(p_cur);
+        if (p_cur.at >= p_cur.end || *p_cur.at != ',') {
+            return false;
+        }
+        p_cur.at++;
+    }
+}
+
+// Steps into element p_index of the array at p_cur
+bool enter_element(cursor& p_cur, size_t p_index) {
+    p_cur.at++; // [
+    for (size_t i = 0; ; i++) {
+        skip_space(p_cur);
+        if (p_cur.at >= p_cur.end || *p_cur.at == ']') {
+            return false;
+        }
+        if (i == p_index) {
+            return true;
+        }
+        if (!skip_value(p_cur)) {
+            return false;
+        }
+        skip_space(p_cur);
+        if (p_cur.at >= p_cur.end || *p_cur.at != ',') {
+            return false;
+        }
+        p_cur.at++;
+    }
+}
+
+int hex_digit(char p_c) {
+    if (p_c >= '0' && p_c <= '9') return p_c - '0';
+    if (p_c >= 'a' && p_c <= 'f') return p_c - 'a' + 10;
+    if (p_c >= 'A' && p_c <= 'F') return p_c - 'A' + 10;
+    return -1;
+}
+
+bool read_hex4(const char* p_at, const char* p_end, u_int32_t& p_out) {
+    if (p_end - p_at < 4) {
+        return false;
+    }
+    p_out = 0;
+    for (int i = 0; i < 4; i++) {
+        int d = hex_digit(p_at[i]);
+        if (d < 0) {
+            return false;
+        }
+        p_out = (p_out << 4) | static_cast<u_int32_t>(d);
+    }
+    return true;
+}
+
+void append_utf8(std::string& p_out, u_int32_t p_cp) {
+    if (p_cp < 0x80) {
+        p_out += static_cast<char>(p_cp);
+    } else if (p_cp < 0x800) {
+        p_out += static_cast<char>(0xC0 | (p_cp >> 6));
+        p_out += static_cast<char>(0x80 | (p_cp & 0x3F));
+    } else if (p_cp < 0x10000) {
+        p_out += static_cast<char>(0xE0 | (p_cp >> 12));
+        p_out += static_cast<char>(0x80 | ((p_cp >> 6) & 0x3F));
+        p_out += static_cast<char>(0x80 | (p_cp & 0x3F));
+    } else {
+        p_out += static_cast<char>(0xF0 | (p_cp >> 18));
+        p_out += static_cast<char>(0x80 | ((p_cp >> 12) & 0x3F));
+        p_out += static_cast<char>(0x80 | ((p_cp >> 6) & 0x3F));
+        p_out += static_cast<char>(0x80 | (p_cp & 0x3F));
+    }
+}
+
+} // namespace
+
+bool json_find(std::string_view p_doc, std::initializer_list<json_step> p_path, json_value& p_out) {
+    cursor cur = {p_doc.data(), p_doc.data() + p_doc.size()};
+    skip_space(cur);
+
+    for (const json_step& step : p_path) {
+        if (cur.at >= cur.end) {
+            return false;
+        }
+        bool entered = step.is_index ? (*cur.at == '[' && enter_element(cur, step.index))
+                                        : (*cur.at == '{' && enter_member(cur, step.key));
+        if (!entered) {
+            return false;
+        }
+    }
+
+    const char* start = cur.at;
+    if (!skip_value(cur)) {
+        return false;
+    }
+    p_out.kind = kind_of(*start);
+    p_out.raw = std::string_view(start, cur.at - start);
+    return true;
+}
+
+bool json_string(const json_value& p_value, std::string& p_scratch, std::string_view& p_out) {
+    if (p_value.kind != JSON_STRING || p_value.raw.size() < 2) {
+        return false;
+    }
+
+    std::string_view inner = p_value.raw.substr(1, p_value.raw.size() - 2);
+    size_t first = inner.find('\\');
+    if (first == std::string_view::npos) {
+        p_out = inner; // Zero copy
+        return true;
+    }
+
+    p_scratch.clear();
+    p_scratch.reserve(inner.size());
+    p_scratch.append(inner.data(), first);
+
+    const char* at = inner.data() + first;
+    const char* end = inner.data() + inner.size();
+    while (at < end) {
+        const char* backslash = static_cast<const char*>(std::memchr(at, '\\', end - at));
+        if (!backslash) {
+            p_scratch.append(at, end - at);
+            break;
+        }
+        p_scratch.append(at, backslash - at);
+        if (backslash + 1 >= end) {
+            return false;
+        }
+
+        at = backslash + 2;
+        switch (backslash[1]) {
+            case '"': p_scratch += '"'; break;
+            case '\\': p_scratch += '\\'; break;
+            case '/': p_scratch += '/'; break;
+            case 'b': p_scratch += '\b'; break;
+            case 'f': p_scratch += '\f'; break;
+            case 'n': p_scratch += '\n'; break;
+            case 'r': p_scratch += '\r'; break;
+            case 't': p_scratch += '\t'; break;
+            case 'u': {
+                u_int32_t cp = 0;
+                if (!read_hex4(at, end, cp)) {
+                    return false;
+                }
+                at += 4;
+                // Surrogate pair
+                if (cp >= 0xD800 && cp <= 0xDBFF) {
+                    u_int32_t low = 0;
+                    if (end - at >= 6 && at[0] == '\\' && at[1] == 'u' && read_hex4(at + 2, end, low) &&
+                        low >= 0xDC00 && low <= 0xDFFF) {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                        at += 6;
+                    } else {
+                        cp = 0xFFFD;
+                    }
+                } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                    cp = 0xFFFD;
+                }
+                append_utf8(p_scratch, cp);
+            } break;
+            default: return false;
+        }
+    }
+
+    p_out = p_scratch;
+    return true;
+}
+
+bool json_find_string(std::string_view p_doc, std::initializer_list<json_step> p_path, std::string& p_out) {
+    json_value value;
+    std::string scratch;
+    std::string_view text;
+    if (!json_find(p_doc, p_path, value) || !json_string(value, scratch, text)) {
+        return false;
+    }
+    p_out.assign(text);
+    return true;
+}
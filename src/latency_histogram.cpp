@@ -0,0 +1,89 @@
+#include "util/llm/latency_histogram.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr double GROWTH = 1.125;
+
+} // namespace
+
+double latency_histogram::bucket_upper_ms(size_t p_bucket) {
+    return std::pow(GROWTH, static_cast<double>(p_bucket));
+}
+
+size_t latency_histogram::bucket_of(double p_ms) {
+    if (p_ms <= 1.0) {
+        return 0;
+    }
+    size_t bucket = static_cast<size_t>(std::ceil(std::log(p_ms) / std::log(GROWTH)));
+    return std::min(bucket, BUCKETS - 1);
+}
+
+void latency_histogram::record(double p_ms) {
+    size_t bucket = bucket_of(p_ms);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (current_count >= window) {
+        previous = current;
+        previous_count = current_count;
+        current.fill(0);
+        current_count = 0;
+    }
+    current[bucket]++;
+    current_count++;
+    all_time++;
+}
+
+double latency_histogram::percentile(double p_p) const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    size_t samples = current_count + previous_count;
+    if (samples == 0) {
+        return 0.0;
+    }
+
+    size_t rank = static_cast<size_t>(std::ceil(std::clamp(p_p, 0.0, 1.0) * samples));
+    rank = std::max<size_t>(rank, 1);
+
+    size_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+        seen += current[i] + previous[i];
+        if (seen >= rank) {
+            return bucket_upper_ms(i);
+        }
+    }
+    return bucket_upper_ms(BUCKETS - 1);
+}
+
+size_t latency_histogram::count() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return current_count + previous_count;
+}
+
+u_int64_t latency_histogram::total() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return all_time;
+}
+
+latency_tracker& latency_tracker::get_instance() {
+    static latency_tracker tracker;
+    return tracker;
+}
+
+backend_latency& latency_tracker::backend(const std::string& p_name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return backends[p_name]; // std::map nodes never move
+}
+
+hedge_stats latency_tracker::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
+
+void latency_tracker::count_request(bool p_hedged, bool p_hedge_won) {
+    std::lock_guard<std::mutex> lock(mutex);
+    counters.requests++;
+    counters.hedged += p_hedged;
+    counters.hedge_wins += p_hedge_won;
+}
@@ -0,0 +1,196 @@
+#include "util/llm/llm_backend.hpp"
+#include "util/json_path.hpp"
+#include "util/llm/llm_toolbox.hpp"
+#include "util/tools.hpp"
+
+namespace {
+
+// Tool arguments/results are JSON text, anything unparsable goes through as a string
+json parse_or_wrap(const std::string& p_text) {
+    json value = json::parse(p_text, nullptr, false);
+    if (value.is_discarded()) {
+        return json{{"result", p_text}};
+    }
+    return value.is_object() ? value : json{{"result", std::move(value)}};
+}
+
+void log_api_error(const char* p_backend, const std::string& p_body) {
+    std::string message;
+    if (json_find_string(p_body, {"error", "message"}, message)) {
+        SDL_Log("%s: %s", p_backend, message.c_str());
+    } else {
+        SDL_Log("%s: response has no answer", p_backend);
+    }
+}
+
+} // namespace
+
+gemini_backend::gemini_backend(const gemini_config& p_config, backend_profile p_profile)
+    : llm_backend("gemini", p_profile), cfg(p_config) { }
+
+http_request gemini_backend::make_request(const std::vector<llm_message>& p_messages, const llm_toolbox* p_tools) const {
+    // Serialized by nlohmann::json, so quotes/newlines/unicode in the prompt are escaped properly
+    json contents = json::array();
+    for (const auto& message : p_messages) {
+        if (message.role == ROLE_TOOL) {
+            json part = {{"functionResponse", {{"name", message.tool_name}, {"response", parse_or_wrap(message.text)}}}};
+            // Answers to one turn's calls go back together
+            if (!contents.empty() && contents.back().contains("tool")) {
+                contents.back()["parts"].push_back(std::move(part));
+            } else {
+                contents.push_back({{"role", "user"}, {"parts", json::array({std::move(part)})}, {"tool", true}});
+            }
+            continue;
+        }
+
+        json parts = json::array();
+        if (!message.text.empty()) {
+            parts.push_back({{"text", message.text}});
+        }
+        for (const auto& call : message.calls) {
+            parts.push_back({{"functionCall", {{"name", call.name}, {"args", parse_or_wrap(call.args)}}}});
+        }
+        contents.push_back({
+            {"role", message.role == ROLE_MODEL ? "model" : "user"},
+            {"parts", std::move(parts)}
+        });
+    }
+    for (auto& content : contents) {
+        content.erase("tool"); // Only a marker for the merge above
+    }
+
+    json payload = {{"contents", std::move(contents)}};
+    if (p_tools && !p_tools->empty()) {
+        json declarations = json::array();
+        for (const llm_tool& tool : p_tools->tools()) {
+            declarations.push_back({
+                {"name", tool.name},
+                {"description", tool.description},
+                {"parameters", tool.parameters}
+            });
+        }
+        payload["tools"] = json::array({json{{"functionDeclarations", std::move(declarations)}}});
+    }
+
+    http_request request;
+    request.url = cfg.base_url + cfg.model + ":generateContent";
+    request.headers = {
+        "Content-Type: application/json",
+        "X-goog-api-key: " + cfg.api_key
+    };
+    request.body = payload.dump(-1, ' ', false, json::error_handler_t::replace);
+    request.timeout_ms = cfg.timeout_ms;
+    return request;
+}
+
+bool gemini_backend::parse_response(const std::string& p_body, llm_reply& p_out) const {
+    p_out = {};
+
+    // Walks candidates[0].content.parts one at a time, no DOM
+    json_value part;
+    std::string scratch;
+    for (size_t i = 0; json_find(p_body, {"candidates", 0, "content", "parts", i}, part); i++) {
+        json_value field;
+        std::string_view text;
+        if (json_find(part.raw, {"text"}, field) && json_string(field, scratch, text)) {
+            p_out.text += text;
+        }
+
+        llm_tool_call call;
+        if (json_find_string(part.raw, {"functionCall", "name"}, call.name)) {
+            if (json_find(part.raw, {"functionCall", "args"}, field)) {
+                call.args = field.raw;
+            }
+            json_find_string(part.raw, {"functionCall", "id"}, call.id);
+            p_out.calls.push_back(std::move(call));
+        }
+    }
+
+    if (p_out.text.empty() && p_out.calls.empty()) {
+        log_api_error("gemini_backend", p_body);
+        return false;
+    }
+    return true;
+}
+
+openai_backend::openai_backend(const openai_config& p_config, backend_profile p_profile)
+    : llm_backend("local", p_profile), cfg(p_config) { }
+
+http_request openai_backend::make_request(const std::vector<llm_message>& p_messages, const llm_toolbox* p_tools) const {
+    json messages = json::array();
+    for (const auto& message : p_messages) {
+        if (message.role == ROLE_TOOL) {
+            messages.push_back({{"role", "tool"}, {"tool_call_id", message.call_id}, {"content", message.text}});
+            continue;
+        }
+
+        json entry = {
+            {"role", message.role == ROLE_MODEL ? "assistant" : "user"},
+            {"content", message.text}
+        };
+        if (!message.calls.empty()) {
+            json calls = json::array();
+            for (const auto& call : message.calls) {
+                calls.push_back({
+                    {"id", call.id},
+                    {"type", "function"},
+                    {"function", {{"name", call.name}, {"arguments", call.args}}}
+                });
+            }
+            entry["tool_calls"] = std::move(calls);
+        }
+        messages.push_back(std::move(entry));
+    }
+
+    json payload = {
+        {"model", cfg.model},
+        {"messages", std::move(messages)},
+        {"stream", false}
+    };
+    if (p_tools && !p_tools->empty()) {
+        json tools = json::array();
+        for (const llm_tool& tool : p_tools->tools()) {
+            tools.push_back({
+                {"type", "function"},
+                {"function", {{"name", tool.name}, {"description", tool.description}, {"parameters", tool.parameters}}}
+            });
+        }
+        payload["tools"] = std::move(tools);
+    }
+
+    http_request request;
+    request.url = cfg.url;
+    request.headers = {"Content-Type: application/json"};
+    if (!cfg.api_key.empty()) {
+        request.headers.push_back("Authorization: Bearer " + cfg.api_key);
+    }
+    request.body = payload.dump(-1, ' ', false, json::error_handler_t::replace);
+    request.timeout_ms = cfg.timeout_ms;
+    return request;
+}
+
+bool openai_backend::parse_response(const std::string& p_body, llm_reply& p_out) const {
+    p_out = {};
+
+    json_value content;
+    std::string scratch;
+    std::string_view text;
+    if (json_find(p_body, {"choices", 0, "message", "content"}, content) && json_string(content, scratch, text)) {
+        p_out.text = text; // null when the model only calls tools
+    }
+
+    json_value raw_call;
+    for (size_t i = 0; json_find(p_body, {"choices", 0, "message", "tool_calls", i}, raw_call); i++) {
+        llm_tool_call call;
+        json_find_string(raw_call.raw, {"id"}, call.id);
+        json_find_string(raw_call.raw, {"function", "name"}, call.name);
+        json_find_string(raw_call.raw, {"function", "arguments"}, call.args); // A string holding JSON
+        p_out.calls.push_back(std::move(call));
+    }
+
+    if (p_out.text.empty() && p_out.calls.empty()) {
+        log_api_error("openai_backend", p_body);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,217 @@
+#include "util/llm/llm_router.hpp"
+#include "util/llm/hedged_request.hpp"
+#include "util/llm/latency_histogram.hpp"
+#include "util/llm/llm_toolbox.hpp"
+#include "util/llm/tokenizer.hpp"
+#include <SDL3/SDL_log.h>
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+
+llm_router& llm_router::get_instance() {
+    static llm_router instance;
+    return instance;
+}
+
+void llm_router::add(std::unique_ptr<llm_backend> p_backend) {
+    std::lock_guard<std::mutex> lock(mutex);
+    backend_state state;
+    state.backend = std::move(p_backend);
+    backends.push_back(std::move(state));
+}
+
+double llm_router::expected_ms(const llm_backend& p_backend, size_t p_prompt_tokens) const {
+    const backend_latency& latency = latency_tracker::get_instance().backend(p_backend.name());
+    double base = latency.total.count() >= config.min_samples ? latency.total.percentile(0.50) 
+                                                              : p_backend.profile().prior_ms;
+    return base + p_backend.profile().ms_per_prompt_token * static_cast<double>(p_prompt_tokens);
+}
+
+std::vector<size_t> llm_router::rank(size_t p_prompt_tokens) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto now = clock_type::now();
+
+    std::vector<std::pair<double, size_t>> scored;
+    std::vector<std::pair<double, size_t>> cooling; // Last resort, better than no answer at all
+    for (size_t i = 0; i < backends.size(); i++) {
+        const llm_backend& b = *backends[i].backend;
+        if (!b.available() || p_prompt_tokens > b.profile().max_prompt_tokens) {
+            continue;
+        }
+        double cost = expected_ms(b, p_prompt_tokens);
+        (backends[i].down_until > now ? cooling : scored).push_back({cost, i});
+    }
+
+    std::sort(scored.begin(), scored.end());
+    std::sort(cooling.begin(), cooling.end());
+
+    std::vector<size_t> order;
+    order.reserve(scored.size() + cooling.size());
+    for (const auto& [cost, i] : scored) {
+        order.push_back(i);
+    }
+    for (const auto& [cost, i] : cooling) {
+        order.push_back(i);
+    }
+    if (!order.empty()) {
+        backends[order.front()].routed++;
+    }
+    return order;
+}
+
+void llm_router::mark(size_t p_index, bool p_ok) {
+    std::lock_guard<std::mutex> lock(mutex);
+    backend_state& state = backends[p_index];
+
+    if (p_ok) {
+        state.failures = 0;
+        state.down_until = {};
+        state.answered++;
+        return;
+    }
+
+    state.failures++;
+    double cooldown = std::min(config.cooldown_ms * static_cast<double>(1u << std::min(state.failures - 1, 16u)),
+                               config.max_cooldown_ms);
+    state.down_until = clock_type::now() + std::chrono::milliseconds(static_cast<long long>(cooldown));
+}
+
+bool llm_router::send(const std::vector<llm_message>& p_messages, const llm_toolbox* p_tools,
+                      const std::vector<size_t>& p_order, llm_reply& p_out, size_t& p_answered) {
+    // backends never changes after init, so the pointers below stay valid without the lock
+    for (size_t k = 0; k < p_order.size(); k++) {
+        const llm_backend& primary = *backends[p_order[k]].backend;
+        hedge_target first = {primary.name(), primary.make_request(p_messages, p_tools)};
+
+        hedge_target second;
+        bool has_second = config.hedge_across && k + 1 < p_order.size();
+        if (has_second) {
+            const llm_backend& alternate = *backends[p_order[k + 1]].backend;
+            second = {alternate.name(), alternate.make_request(p_messages, p_tools)};
+        }
+
+        size_t winner = 0, sent = 1;
+        http_response response = hedged_post(first, has_second ? &second : nullptr, &winner, &sent);
+        size_t answered = p_order[k + winner];
+
+        if (response.ok() && backends[answered].backend->parse_response(response.body, p_out)) {
+            mark(answered, true);
+            p_answered = answered;
+            return true;
+        }
+
+        if (!response.error.empty()) {
+            SDL_Log("llm_router: %s: %s", backends[answered].backend->name().c_str(), response.error.c_str());
+        } else if (!response.ok()) {
+            SDL_Log("llm_router: %s returned HTTP %d", backends[answered].backend->name().c_str(), response.status);
+        }
+        mark(answered, false);
+
+        // Without an answer both legs failed, the alternate isn't worth a retry of its own
+        if (!response.ok() && has_second && sent == 2) {
+            mark(p_order[k + 1], false);
+            k++;
+        }
+    }
+    return false;
+}
+
+std::string llm_router::query(const std::vector<llm_message>& p_messages, const llm_toolbox* p_tools,
+                              size_t* p_tool_calls) {
+    size_t tokens = 0;
+    for (const auto& message : p_messages) {
+        tokens += count_tokens(message.text);
+    }
+
+    std::vector<size_t> order = rank(tokens);
+    if (order.empty()) {
+        SDL_Log("llm_router: no backend for a %zu token request", tokens);
+        return "";
+    }
+
+    std::vector<llm_message> exchange = p_messages;
+    for (size_t round = 0; ; round++) {
+        llm_reply reply;
+        size_t answered = 0;
+        if (!send(exchange, p_tools, order, reply, answered)) {
+            return "";
+        }
+        if (!p_tools || reply.calls.empty()) {
+            return reply.text;
+        }
+        if (round == config.max_tool_rounds) {
+            SDL_Log("llm_router: still calling tools after %zu rounds, giving up", round);
+            return reply.text;
+        }
+
+        // Tool results only make sense to the backend that asked for them
+        order = {answered};
+        if (p_tool_calls) {
+            *p_tool_calls += reply.calls.size();
+        }
+
+        for (size_t i = 0; i < reply.calls.size(); i++) {
+            if (reply.calls[i].id.empty()) {
+                reply.calls[i].id = "call_" + std::to_string(round) + "_" + std::to_string(i);
+            }
+        }
+        std::vector<llm_message> results;
+        results.reserve(reply.calls.size());
+        for (const llm_tool_call& call : reply.calls) {
+            results.push_back({ROLE_TOOL, p_tools->call(call), {}, call.id, call.name});
+        }
+
+        exchange.push_back({ROLE_MODEL, std::move(reply.text), std::move(reply.calls)});
+        exchange.insert(exchange.end(), std::make_move_iterator(results.begin()), std::make_move_iterator(results.end()));
+    }
+}
+
+std::string llm_router::query(const std::string& p_prompt) {
+    return query(std::vector<llm_message>{{ROLE_USER, p_prompt}});
+}
+
+std::vector<route_info> llm_router::routes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto now = clock_type::now();
+
+    std::vector<route_info> out;
+    out.reserve(backends.size());
+    for (const auto& state : backends) {
+        out.push_back({
+            state.backend->name(),
+            state.backend->available() && state.down_until <= now,
+            expected_ms(*state.backend, 64),
+            state.routed,
+            state.answered,
+            state.failures
+        });
+    }
+    return out;
+}
+
+void load_llm_environment(llm_router& p_router) {
+    if (const char* url = std::getenv("AVA_LOCAL_LLM_URL")) {
+        openai_config local;
+        local.url = url;
+        if (const char* model = std::getenv("AVA_LOCAL_LLM_MODEL")) {
+            local.model = model;
+        }
+        if (const char* key = std::getenv("AVA_LOCAL_LLM_KEY")) {
+            local.api_key = key;
+        }
+        p_router.add(std::make_unique<openai_backend>(local));
+    }
+
+    gemini_config gemini;
+    if (const char* key = std::getenv("GEMINI_API_KEY")) {
+        gemini.api_key = key;
+    }
+    if (const char* model = std::getenv("AVA_GEMINI_MODEL")) {
+        gemini.model = model;
+    }
+    p_router.add(std::make_unique<gemini_backend>(gemini));
+
+    if (gemini.api_key.empty() && !std::getenv("AVA_LOCAL_LLM_URL")) {
+        SDL_Log("llm_router: neither GEMINI_API_KEY nor AVA_LOCAL_LLM_URL is set, questions won't be answered");
+    }
+}
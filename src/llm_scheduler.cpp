@@ -0,0 +1,153 @@
+#include "util/llm/llm_scheduler.hpp"
+#include <algorithm>
+
+llm_scheduler::llm_scheduler(const scheduler_config& p_config)
+    : cfg(p_config), tokens(p_config.burst), last_refill(clock_type::now()) {
+    cfg.max_in_flight = std::max<size_t>(1, cfg.max_in_flight);
+    cfg.rate_per_s = std::max(1e-3, cfg.rate_per_s);
+    cfg.burst = std::max(1.0, cfg.burst);
+}
+
+llm_scheduler::~llm_scheduler() {
+    shutdown();
+}
+
+std::future<std::string> llm_scheduler::submit(job p_job, llm_priority p_priority) {
+    pending item = {std::move(p_job), {}, clock_type::now()};
+    std::future<std::string> future = item.result.get_future();
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    auto& queue = queues[p_priority];
+    if (stopping || queue.size() >= cfg.max_queue) {
+        counters.rejected++;
+        lock.unlock();
+        item.result.set_value("");
+        return future;
+    }
+
+    queue.push_back(std::move(item));
+    counters.max_queued[p_priority] = std::max(counters.max_queued[p_priority], queue.size());
+
+    // Workers are spawned lazily so an idle scheduler costs nothing
+    if (workers.empty()) {
+        for (size_t i = 0; i < cfg.max_in_flight; i++) {
+            workers.emplace_back(&llm_scheduler::worker, this);
+        }
+    }
+
+    lock.unlock();
+    wake.notify_one();
+    return future;
+}
+
+void llm_scheduler::refill(clock_type::time_point p_now) {
+    double seconds = std::chrono::duration<double>(p_now - last_refill).count();
+    tokens = std::min(cfg.burst, tokens + seconds * cfg.rate_per_s);
+    last_refill = p_now;
+}
+
+int llm_scheduler::next_class(clock_type::time_point p_now) const {
+    int best = -1;
+    int best_effective = 0;
+    for (int c = 0; c < PRIORITY_COUNT; c++) {
+        if (queues[c].empty()) {
+            continue;
+        }
+
+        // A job moves up one class per aging_ms waited. Equal classes go
+        // oldest first, so an aged job gets ahead of interactive work too
+        const pending& front = queues[c].front();
+        double waited = std::chrono::duration<double, std::milli>(p_now - front.submitted).count();
+        int lifted = cfg.aging_ms > 0.0 ? static_cast<int>(std::min<double>(waited / cfg.aging_ms, PRIORITY_COUNT)) : 0;
+        int effective = std::max(0, c - lifted);
+
+        if (best < 0 || effective < best_effective ||
+            (effective == best_effective && front.submitted < queues[best].front().submitted)) {
+            best = c;
+            best_effective = effective;
+        }
+    }
+    return best;
+}
+
+void llm_scheduler::worker() {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        wake.wait(lock, [this] {
+            return stopping || std::any_of(queues.begin(), queues.end(), [](const auto& q) { return !q.empty(); });
+        });
+        if (stopping) {
+            return;
+        }
+
+        // Rate limit: sleep until the bucket holds a whole token
+        clock_type::time_point now = clock_type::now();
+        refill(now);
+        if (tokens < 1.0) {
+            counters.throttled++;
+            auto wait = std::chrono::duration<double>((1.0 - tokens) / cfg.rate_per_s);
+            wake.wait_until(lock, now + std::chrono::duration_cast<clock_type::duration>(wait));
+            continue; // Re-check everything, we may have been woken for shutdown
+        }
+
+        int c = next_class(now);
+        if (c < 0) {
+            continue;
+        }
+
+        pending item = std::move(queues[c].front());
+        queues[c].pop_front();
+        tokens -= 1.0;
+        counters.in_flight++;
+        total_wait_ms[c] += std::chrono::duration<double, std::milli>(now - item.submitted).count();
+        started[c]++;
+
+        lock.unlock();
+        std::string result;
+        try {
+            result = item.work();
+        } catch (...) {
+            result.clear(); // Same contract as the LLM client, empty = failed
+        }
+        item.result.set_value(std::move(result));
+        lock.lock();
+
+        counters.in_flight--;
+        counters.completed++;
+    }
+}
+
+scheduler_stats llm_scheduler::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    scheduler_stats out = counters;
+    for (int c = 0; c < PRIORITY_COUNT; c++) {
+        out.queued[c] = queues[c].size();
+        out.avg_wait_ms[c] = started[c] ? total_wait_ms[c] / started[c] : 0.0;
+    }
+    double seconds = std::chrono::duration<double>(clock_type::now() - last_refill).count();
+    out.tokens = std::min(cfg.burst, tokens + seconds * cfg.rate_per_s);
+    return out;
+}
+
+void llm_scheduler::shutdown() {
+    std::vector<std::thread> joining;
+    std::array<std::deque<pending>, PRIORITY_COUNT> dropped;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        joining.swap(workers);
+        dropped.swap(queues);
+    }
+    wake.notify_all();
+
+    for (auto& queue : dropped) {
+        for (auto& item : queue) {
+            item.result.set_value("");
+        }
+    }
+    for (auto& thread : joining) {
+        thread.join();
+    }
+}
@@ -0,0 +1,27 @@
+#include "util/llm/llm_toolbox.hpp"
+
+using json = nlohmann::json;
+
+std::string llm_toolbox::call(const llm_tool_call& p_call) const {
+    call_count.fetch_add(1, std::memory_order_relaxed);
+
+    for (const llm_tool& tool : entries) {
+        if (tool.name != p_call.name) {
+            continue;
+        }
+        try {
+            json args = p_call.args.empty() ? json::object() : json::parse(p_call.args);
+            json result = tool.handler(args);
+            if (!result.is_object()) {
+                result = json{{"result", std::move(result)}}; // Both APIs want an object back
+            }
+            return result.dump(-1, ' ', false, json::error_handler_t::replace);
+        } catch (const std::exception& e) {
+            failure_count.fetch_add(1, std::memory_order_relaxed);
+            return json{{"error", std::string("bad call to ") + p_call.name + ": " + e.what()}}.dump(-1, ' ', false, json::error_handler_t::replace);
+        }
+    }
+
+    failure_count.fetch_add(1, std::memory_order_relaxed);
+    return json{{"error", "no tool named " + p_call.name}}.dump(-1, ' ', false, json::error_handler_t::replace);
+}
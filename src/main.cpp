@@ -3,6 +3,7 @@
 
 #include "global.hpp"
 #include "game.hpp"
+#include "batch.hpp"
 
 static SDL_Window* window;
 static SDL_Renderer* renderer;
@@ -12,6 +13,11 @@ game game;
 // This function runs once at startup
 SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
     SDL_SetAppMetadata(DESCRIPTION, VERSION, NULL); // Set game metadata (all vals defined in global.hpp)
+
+    SDL_AppResult batch_result;
+    if (run_batch(argc, argv, game.asr, batch_result)) {
+        return batch_result;
+    }
     
     SDL_SetHint(SDL_HINT_APP_NAME, TITLE); // title
     SDL_SetHint(SDL_HINT_MAIN_CALLBACK_RATE, FPS_HINT_VALUE); // to limit FPS to a set value 
@@ -99,9 +105,12 @@ SDL_AppResult SDL_AppIterate(void *appstate) {
 
 // This function runs once at shutdown
 void SDL_AppQuit(void *appstate, SDL_AppResult result) {
-    ImGui_ImplSDLRenderer3_Shutdown();
-    ImGui_ImplSDL3_Shutdown();
-    ImGui::DestroyContext();
+    // Batch modes exit before ImGui is ever set up
+    if (ImGui::GetCurrentContext()) {
+        ImGui_ImplSDLRenderer3_Shutdown();
+        ImGui_ImplSDL3_Shutdown();
+        ImGui::DestroyContext();
+    }
 
     game.quit();
 
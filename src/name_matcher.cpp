@@ -0,0 +1,306 @@
+#include "util/clinic/name_matcher.hpp"
+#include <algorithm>
+#include <chrono>
+
+#include "util/clinic/patient_fields.hpp"
+
+namespace {
+
+constexpr size_t MAX_PATTERN = 64; // Letters of a query, one bit each
+
+// Which letters of the pattern each byte value matches, as bit masks
+typedef struct pattern {
+    u_int64_t matches[256];
+    size_t length;
+} pattern;
+
+void compile(std::string_view p_text, pattern& p_pattern) {
+    std::fill(std::begin(p_pattern.matches), std::end(p_pattern.matches), 0);
+    p_pattern.length = std::min(p_text.size(), MAX_PATTERN);
+    for (size_t i = 0; i < p_pattern.length; i++) {
+        p_pattern.matches[static_cast<unsigned char>(p_text[i])] |= 1ull << i;
+    }
+}
+
+// Myers' bit-parallel edit distance (the global distance variant, Hyyrö 2001):
+// a column of the DP matrix is kept as +1 / -1 vertical deltas in two words
+// and advanced one text letter at a time with a few logic ops and an add
+u_int32_t bounded_distance(const pattern& p_pattern, std::string_view p_text, u_int32_t p_max) {
+    size_t m = p_pattern.length, n = p_text.size();
+    if ((m > n ? m - n : n - m) > p_max) {
+        return p_max + 1;
+    }
+    if (m == 0) {
+        return static_cast<u_int32_t>(n);
+    }
+
+    u_int64_t positive = ~0ull, negative = 0;
+    u_int64_t last = 1ull << (m - 1);
+    size_t score = m;
+    for (size_t j = 0; j < n; j++) {
+        u_int64_t eq = p_pattern.matches[static_cast<unsigned char>(p_text[j])];
+        u_int64_t xv = eq | negative;
+        u_int64_t xh = (((eq & positive) + positive) ^ positive) | eq;
+        u_int64_t ph = negative | ~(xh | positive);
+        u_int64_t mh = positive & xh;
+        if (ph & last) {
+            score++;
+        } else if (mh & last) {
+            score--;
+        }
+        ph = (ph << 1) | 1; // The top row grows by one per letter
+        mh <<= 1;
+        positive = mh | ~(xv | ph);
+        negative = ph & xv;
+
+        // Each letter left can take at most one edit back
+        if (score > p_max + (n - j - 1)) {
+            return p_max + 1;
+        }
+    }
+    return score <= p_max ? static_cast<u_int32_t>(score) : p_max + 1;
+}
+
+// Two rows of the DP matrix, for the rare pair that's longer than a pattern
+u_int32_t plain_distance(std::string_view p_a, std::string_view p_b, u_int32_t p_max) {
+    std::vector<u_int32_t> previous(p_b.size() + 1), current(p_b.size() + 1);
+    for (size_t j = 0; j <= p_b.size(); j++) {
+        previous[j] = static_cast<u_int32_t>(j);
+    }
+    for (size_t i = 1; i <= p_a.size(); i++) {
+        current[0] = static_cast<u_int32_t>(i);
+        u_int32_t row_min = current[0];
+        for (size_t j = 1; j <= p_b.size(); j++) {
+            u_int32_t substitute = previous[j - 1] + (p_a[i - 1] != p_b[j - 1]);
+            current[j] = std::min({previous[j] + 1, current[j - 1] + 1, substitute});
+            row_min = std::min(row_min, current[j]);
+        }
+        if (row_min > p_max) {
+            return p_max + 1;
+        }
+        previous.swap(current);
+    }
+    return std::min(previous[p_b.size()], p_max + 1);
+}
+
+// Where each word of a normalized name starts
+void word_starts(std::string_view p_name, std::vector<size_t>& p_starts) {
+    p_starts.clear();
+    for (size_t at = 0; at < p_name.size(); at++) {
+        p_starts.push_back(at);
+        at = p_name.find(' ', at);
+        if (at == std::string_view::npos) {
+            break;
+        }
+    }
+}
+
+} // namespace
+
+name_matcher::name_matcher(patient_records& p_records, const fuzzy_config& p_config)
+    : records(p_records), cfg(p_config) {
+    records.add_listener(this);
+}
+
+name_matcher::~name_matcher() {
+    records.remove_listener(this);
+}
+
+u_int32_t name_matcher::distance(std::string_view p_a, std::string_view p_b, u_int32_t p_max) {
+    if (p_a.size() > p_b.size()) {
+        std::swap(p_a, p_b);
+    }
+    if (p_a.size() > MAX_PATTERN) {
+        return plain_distance(p_a, p_b, p_max);
+    }
+    pattern compiled;
+    compile(p_a, compiled);
+    return bounded_distance(compiled, p_b, p_max);
+}
+
+template <typename F>
+void name_matcher::each_gram(std::string_view p_name, F&& p_func) {
+    // Padded with a space on both ends without copying
+    auto at = [p_name](size_t p_i) -> u_int32_t {
+        return p_i == 0 || p_i > p_name.size() ? ' ' : static_cast<unsigned char>(p_name[p_i - 1]);
+    };
+    for (size_t i = 0; i < p_name.size(); i++) {
+        p_func((at(i) << 16) | (at(i + 1) << 8) | at(i + 2));
+    }
+}
+
+void name_matcher::add(u_int64_t p_id, std::string_view p_name) {
+    normalize_name(p_name, scratch);
+    if (scratch.empty()) {
+        return;
+    }
+
+    u_int32_t slot = static_cast<u_int32_t>(entries.size());
+    entries.push_back({p_id, static_cast<u_int32_t>(text.size()), static_cast<u_int32_t>(scratch.size())});
+    text += scratch;
+    slot_of.assign(p_id, slot);
+
+    std::vector<u_int32_t> grams;
+    each_gram(scratch, [&grams](u_int32_t p_gram) { grams.push_back(p_gram); });
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+    for (u_int32_t gram : grams) {
+        postings[gram].push_back(slot);
+    }
+}
+
+void name_matcher::forget(u_int64_t p_id) {
+    u_int64_t slot;
+    if (slot_of.find(p_id, slot)) {
+        entries[slot].length = 0;
+        slot_of.erase(p_id);
+        dead++;
+    }
+}
+
+void name_matcher::rebuild() {
+    std::vector<entry> live;
+    live.reserve(entries.size() - dead);
+    for (const entry& e : entries) {
+        if (e.length) {
+            live.push_back(e);
+        }
+    }
+    std::string old_text;
+    old_text.swap(text);
+
+    entries.clear();
+    postings.clear();
+    slot_of.clear();
+    slot_of.reserve(live.size());
+    dead = 0;
+    for (const entry& e : live) {
+        add(e.id, std::string_view(old_text).substr(e.offset, e.length));
+    }
+}
+
+void name_matcher::on_upsert(const patient& p_patient) {
+    forget(p_patient.id);
+    add(p_patient.id, p_patient.name);
+    if (dead > 1024 && dead > entries.size() - dead) {
+        rebuild();
+    }
+}
+
+void name_matcher::on_remove(u_int64_t p_id) {
+    forget(p_id);
+    if (dead > 1024 && dead > entries.size() - dead) {
+        rebuild();
+    }
+}
+
+void name_matcher::on_clear() {
+    entries.clear();
+    entries.shrink_to_fit();
+    text.clear();
+    text.shrink_to_fit();
+    postings.clear();
+    slot_of.clear();
+    dead = 0;
+}
+
+std::vector<name_match> name_matcher::match(std::string_view p_query, size_t p_k) const {
+    auto start = std::chrono::steady_clock::now();
+    size_t k = p_k ? p_k : cfg.top_k;
+
+    std::string query;
+    normalize_name(p_query, query);
+    query.resize(std::min(query.size(), MAX_PATTERN));
+    std::vector<name_match> found;
+    if (query.empty() || !k) {
+        return found;
+    }
+    u_int32_t max = cfg.max_distance;
+    if (!max) {
+        max = query.size() <= 4 ? 1 : (query.size() <= 9 ? 2 : 3);
+    }
+
+    std::vector<u_int32_t> grams;
+    each_gram(query, [&grams](u_int32_t p_gram) { grams.push_back(p_gram); });
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+
+    // Shared trigrams per name. An edit changes at most three trigrams, so
+    // names sharing fewer than that allows can't be close enough
+    std::vector<u_int8_t> shared(entries.size(), 0);
+    std::vector<u_int32_t> touched;
+    for (u_int32_t gram : grams) {
+        auto list = postings.find(gram);
+        if (list == postings.end()) {
+            continue;
+        }
+        for (u_int32_t slot : list->second) {
+            if (entries[slot].length && shared[slot]++ == 0) {
+                touched.push_back(slot);
+            }
+        }
+    }
+    size_t needed = grams.size() > 3 * max ? grams.size() - 3 * max : 1;
+    touched.erase(std::remove_if(touched.begin(), touched.end(), [&](u_int32_t p_slot) {
+        return shared[p_slot] < needed;
+    }), touched.end());
+    if (touched.size() > cfg.candidates) {
+        std::nth_element(touched.begin(), touched.begin() + static_cast<std::ptrdiff_t>(cfg.candidates), touched.end(),
+                         [&shared](u_int32_t p_a, u_int32_t p_b) {
+            return shared[p_a] != shared[p_b] ? shared[p_a] > shared[p_b] : p_a < p_b;
+        });
+        touched.resize(cfg.candidates);
+    }
+
+    // Against every run of as many words as the query has
+    pattern compiled;
+    compile(query, compiled);
+    size_t query_words = static_cast<size_t>(std::count(query.begin(), query.end(), ' ')) + 1;
+    std::vector<size_t> starts;
+    std::vector<std::pair<u_int8_t, name_match>> ranked;
+    for (u_int32_t slot : touched) {
+        const entry& e = entries[slot];
+        std::string_view name = std::string_view(text).substr(e.offset, e.length);
+        word_starts(name, starts);
+
+        u_int32_t best = max + 1; // Anything further counts as max + 1
+        if (starts.size() <= query_words) {
+            best = bounded_distance(compiled, name, max);
+        } else {
+            for (size_t w = 0; w + query_words <= starts.size() && best > 0; w++) {
+                size_t end = w + query_words < starts.size() ? starts[w + query_words] - 1 : name.size();
+                // Only a closer run matters
+                best = std::min(best, bounded_distance(compiled, name.substr(starts[w], end - starts[w]), best - 1));
+            }
+        }
+        if (best <= max) {
+            ranked.emplace_back(shared[slot], name_match{e.id, best});
+        }
+    }
+
+    // Equally close, the name sharing more of the query wins ("ode": Odeh before de la Cruz)
+    std::sort(ranked.begin(), ranked.end(), [](const auto& p_a, const auto& p_b) {
+        if (p_a.second.distance != p_b.second.distance) {
+            return p_a.second.distance < p_b.second.distance;
+        }
+        return p_a.first != p_b.first ? p_a.first > p_b.first : p_a.second.id < p_b.second.id;
+    });
+    for (size_t i = 0; i < ranked.size() && i < k; i++) {
+        found.push_back(ranked[i].second);
+    }
+
+    last_candidates.store(touched.size(), std::memory_order_relaxed);
+    last_lookup_us.store(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count(),
+                         std::memory_order_relaxed);
+    return found;
+}
+
+fuzzy_stats name_matcher::stats() const {
+    fuzzy_stats s{};
+    s.names = entries.size() - dead;
+    s.dead = dead;
+    s.grams = postings.size();
+    s.last_candidates = last_candidates.load(std::memory_order_relaxed);
+    s.last_lookup_us = last_lookup_us.load(std::memory_order_relaxed);
+    return s;
+}
@@ -0,0 +1,188 @@
+#include "util/clinic/patient_analytics.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+constexpr size_t BLOCK = 4096; // Rows per mask, stays in L1 with its columns
+constexpr size_t LANES = 4;    // Copies of each histogram
+
+typedef struct tallies {
+    u_int64_t patients = 0;
+    u_int64_t males = 0;
+    u_int64_t age_sum = 0;
+    u_int64_t by_age[LANES][256] = {};
+    u_int64_t by_year[LANES][257] = {}; // [0] unknown, then from FIRST_BIRTH_YEAR
+} tallies;
+
+// 1 for the rows p_filter keeps, 0 for the rest
+void filter_block(const u_int8_t* p_ages, const u_int8_t* p_genders, const u_int32_t* p_births, size_t p_rows,
+                  const analytics_filter& p_filter, u_int8_t* p_keep) {
+    const u_int8_t low = p_filter.min_age, high = p_filter.max_age;
+    const u_int8_t want = p_filter.gender < 0 ? 0 : static_cast<u_int8_t>(p_filter.gender == MALE);
+    const u_int8_t care = p_filter.gender < 0 ? 0 : 1;
+    // One unsigned compare per date: below born_from wraps around to above the span
+    const u_int32_t from = p_filter.born_from, span = p_filter.born_to - p_filter.born_from;
+    for (size_t i = 0; i < p_rows; i++) {
+        p_keep[i] = static_cast<u_int8_t>((p_ages[i] >= low) & (p_ages[i] <= high) &
+                                          (((p_genders[i] ^ want) & care) == 0) & (p_births[i] - from <= span));
+    }
+}
+
+// Year bin of a packed date, 0 when unknown or out of range
+inline u_int32_t year_bin(u_int32_t p_birth) {
+    u_int32_t offset = (p_birth >> 9) - FIRST_BIRTH_YEAR;
+    return offset < 256 ? offset + 1 : 0;
+}
+
+// p_keep is nullptr when every row counts
+void count_block(const u_int8_t* p_ages, const u_int8_t* p_genders, const u_int32_t* p_births, size_t p_rows,
+                 const u_int8_t* p_keep, tallies& p_out) {
+    // Block sized sums fit 32 bits, which keeps more of them per vector
+    u_int32_t patients = 0, males = 0, age_sum = 0;
+    if (p_keep) {
+        for (size_t i = 0; i < p_rows; i++) {
+            u_int32_t keep = p_keep[i];
+            patients += keep;
+            males += keep & p_genders[i];
+            age_sum += keep * p_ages[i];
+        }
+    } else {
+        patients = static_cast<u_int32_t>(p_rows);
+        for (size_t i = 0; i < p_rows; i++) {
+            males += p_genders[i];
+            age_sum += p_ages[i];
+        }
+    }
+    p_out.patients += patients;
+    p_out.males += males;
+    p_out.age_sum += age_sum;
+
+    // A selective filter: list the kept rows first (without branches) and
+    // only count those instead of adding zeros for the rest
+    if (p_keep && patients < p_rows / 2) {
+        u_int16_t kept[BLOCK];
+        size_t count = 0;
+        for (size_t i = 0; i < p_rows; i++) {
+            kept[count] = static_cast<u_int16_t>(i);
+            count += p_keep[i];
+        }
+        for (size_t k = 0; k < count; k++) {
+            size_t lane = k % LANES, i = kept[k];
+            p_out.by_age[lane][p_ages[i]]++;
+            p_out.by_year[lane][year_bin(p_births[i])]++;
+        }
+        return;
+    }
+
+    size_t i = 0;
+    for (; i + LANES <= p_rows; i += LANES) {
+        for (size_t lane = 0; lane < LANES; lane++) {
+            u_int64_t keep = p_keep ? p_keep[i + lane] : 1;
+            p_out.by_age[lane][p_ages[i + lane]] += keep;
+            p_out.by_year[lane][year_bin(p_births[i + lane])] += keep;
+        }
+    }
+    for (; i < p_rows; i++) {
+        u_int64_t keep = p_keep ? p_keep[i] : 1;
+        p_out.by_age[0][p_ages[i]] += keep;
+        p_out.by_year[0][year_bin(p_births[i])] += keep;
+    }
+}
+
+} // namespace
+
+patient_analytics::patient_analytics(patient_records& p_records) : records(p_records) {
+    records.add_listener(this);
+}
+
+patient_analytics::~patient_analytics() {
+    records.remove_listener(this);
+}
+
+void patient_analytics::on_upsert(const patient& p_patient) {
+    u_int64_t slot;
+    if (!slot_of.find(p_patient.id, slot)) {
+        slot = ids.size();
+        slot_of.assign(p_patient.id, slot);
+        ids.push_back(p_patient.id);
+        ages.push_back(0);
+        genders.push_back(0);
+        births.push_back(0);
+    }
+    ages[slot] = p_patient.age;
+    genders[slot] = p_patient.gender == MALE;
+    births[slot] = p_patient.date_of_birth;
+}
+
+void patient_analytics::on_remove(u_int64_t p_id) {
+    u_int64_t slot;
+    if (!slot_of.find(p_id, slot)) {
+        return;
+    }
+    slot_of.erase(p_id);
+    size_t last = ids.size() - 1;
+    if (slot != last) {
+        ids[slot] = ids[last];
+        ages[slot] = ages[last];
+        genders[slot] = genders[last];
+        births[slot] = births[last];
+        slot_of.assign(ids[slot], slot);
+    }
+    ids.pop_back();
+    ages.pop_back();
+    genders.pop_back();
+    births.pop_back();
+}
+
+void patient_analytics::on_clear() {
+    ids.clear();
+    ages.clear();
+    genders.clear();
+    births.clear();
+    slot_of.clear();
+}
+
+clinic_summary patient_analytics::summarize(const analytics_filter& p_filter) const {
+    auto start = std::chrono::steady_clock::now();
+    clinic_summary summary{};
+    if (p_filter.born_to < p_filter.born_from || p_filter.max_age < p_filter.min_age) {
+        return summary;
+    }
+
+    analytics_filter everyone;
+    bool filtered = p_filter.min_age != everyone.min_age || p_filter.max_age != everyone.max_age ||
+                    p_filter.gender >= 0 || p_filter.born_from != everyone.born_from || p_filter.born_to != everyone.born_to;
+
+    tallies counts;
+    u_int8_t keep[BLOCK];
+    for (size_t from = 0; from < ids.size(); from += BLOCK) {
+        size_t rows = std::min(BLOCK, ids.size() - from);
+        if (filtered) {
+            filter_block(&ages[from], &genders[from], &births[from], rows, p_filter, keep);
+        }
+        count_block(&ages[from], &genders[from], &births[from], rows, filtered ? keep : nullptr, counts);
+    }
+
+    summary.patients = counts.patients;
+    summary.by_gender[MALE] = counts.males;
+    summary.by_gender[FEMALE] = counts.patients - counts.males;
+    summary.mean_age = counts.patients ? static_cast<double>(counts.age_sum) / static_cast<double>(counts.patients) : 0.0;
+    for (size_t lane = 0; lane < LANES; lane++) {
+        for (size_t age = 0; age < 256; age++) {
+            summary.by_age[age] += counts.by_age[lane][age];
+        }
+        summary.unknown_birth += counts.by_year[lane][0];
+        for (size_t year = 0; year < 256; year++) {
+            summary.by_birth_year[year] += counts.by_year[lane][year + 1];
+        }
+    }
+    summary.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return summary;
+}
+
+size_t patient_analytics::memory() const {
+    return ids.capacity() * sizeof(u_int64_t) + ages.capacity() + genders.capacity() +
+           births.capacity() * sizeof(u_int32_t) + slot_of.memory();
+}
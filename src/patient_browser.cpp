@@ -0,0 +1,279 @@
+#include "util/clinic/patient_browser.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <utility>
+
+#include "imgui/imgui.h"
+#include "util/clinic/patient_fields.hpp"
+
+namespace {
+
+constexpr size_t MAX_FILTERED = 50000; // Name matches shown at once
+
+typedef std::chrono::steady_clock clock_type;
+
+double micros_since(clock_type::time_point p_since) {
+    return std::chrono::duration<double, std::micro>(clock_type::now() - p_since).count();
+}
+
+// A slot and its sort key; text keys are the first 16 bytes big endian, so they compare like the text
+typedef struct keyed_slot {
+    u_int64_t head;
+    u_int64_t tail;
+    u_int32_t slot;
+
+    bool operator < (const keyed_slot& p_other) const {
+        if (head != p_other.head) {
+            return head < p_other.head;
+        }
+        return tail != p_other.tail ? tail < p_other.tail : slot < p_other.slot;
+    }
+    bool same_key(const keyed_slot& p_other) const { return head == p_other.head && tail == p_other.tail; }
+} keyed_slot;
+
+void text_key(std::string_view p_text, keyed_slot& p_key) {
+    p_key.head = p_key.tail = 0;
+    for (size_t i = 0; i < 16; i++) {
+        u_int64_t& half = i < 8 ? p_key.head : p_key.tail;
+        half = (half << 8) | (i < p_text.size() ? static_cast<unsigned char>(p_text[i]) : 0);
+    }
+}
+
+} // namespace
+
+const patient_browser::sort_order& patient_browser::order(int p_column) {
+    if (orders_version != records.version()) {
+        for (sort_order& o : orders) {
+            o.slots.clear();
+            o.rank.clear();
+        }
+        orders_version = records.version();
+    }
+    sort_order& o = orders[p_column];
+    std::span<const patient_hot> rows = records.all();
+    if (!o.slots.empty() || rows.empty()) {
+        return o;
+    }
+    auto start = clock_type::now();
+
+    // Sorting (key, slot) pairs. Text columns are keyed by their first 16
+    // normalized bytes, the whole texts are kept back to back for runs of
+    // equal keys
+    bool text = p_column == COLUMN_NAME || p_column == COLUMN_EMAIL;
+    std::vector<keyed_slot> keyed(rows.size());
+    std::string texts, normalized;
+    std::vector<u_int32_t> text_at;
+    if (text) {
+        text_at.resize(rows.size() + 1, 0);
+    }
+    for (size_t i = 0; i < rows.size(); i++) {
+        const patient_hot& row = rows[i];
+        keyed_slot& key = keyed[i];
+        key = {0, 0, static_cast<u_int32_t>(i)};
+        switch (p_column) {
+            case COLUMN_ID: key.head = row.id; break;
+            case COLUMN_GENDER: key.head = row.gender; break;
+            case COLUMN_AGE: key.head = row.age; break;
+            case COLUMN_BORN: key.head = row.date_of_birth; break;
+            case COLUMN_PHONE: key.head = records.cold(row).number; break;
+            default: {
+                normalize_name(records.text(p_column == COLUMN_NAME ? row.name : records.cold(row).email), normalized);
+                text_key(normalized, key);
+                texts += normalized;
+                text_at[i + 1] = static_cast<u_int32_t>(texts.size());
+            } break;
+        }
+    }
+    std::sort(keyed.begin(), keyed.end());
+
+    // Runs that tie on all 16 bytes get keyed by the next 16 and sorted
+    // again, and so on (an MSD radix sort, in integer compares)
+    if (text) {
+        std::vector<std::pair<size_t, size_t>> runs, next; // Start, end
+        auto find_runs = [&keyed](size_t p_start, size_t p_end, std::vector<std::pair<size_t, size_t>>& p_runs) {
+            for (size_t i = p_start; i < p_end;) {
+                size_t end = i + 1;
+                while (end < p_end && keyed[end].same_key(keyed[i])) {
+                    end++;
+                }
+                // Keys shorter than 16 bytes end in a zero and are the whole text
+                if (end - i > 1 && (keyed[i].tail & 0xFF)) {
+                    p_runs.emplace_back(i, end);
+                }
+                i = end;
+            }
+        };
+        find_runs(0, keyed.size(), runs);
+
+        std::string_view all_texts = texts;
+        for (size_t depth = 16; !runs.empty(); depth += 16) {
+            next.clear();
+            for (auto [start, end] : runs) {
+                for (size_t j = start; j < end; j++) {
+                    u_int32_t slot = keyed[j].slot;
+                    text_key(all_texts.substr(text_at[slot], text_at[slot + 1] - text_at[slot]).substr(depth), keyed[j]);
+                }
+                std::sort(keyed.begin() + static_cast<std::ptrdiff_t>(start), keyed.begin() + static_cast<std::ptrdiff_t>(end));
+                find_runs(start, end, next);
+            }
+            runs.swap(next);
+        }
+    }
+
+    o.slots.resize(rows.size());
+    for (size_t i = 0; i < keyed.size(); i++) {
+        o.slots[i] = keyed[i].slot;
+    }
+
+    o.rank.resize(rows.size());
+    for (size_t i = 0; i < o.slots.size(); i++) {
+        o.rank[o.slots[i]] = static_cast<u_int32_t>(i);
+    }
+
+    sort_ms = micros_since(start) / 1000.0;
+    return o;
+}
+
+void patient_browser::update_view() {
+    if (sort_column >= 0) {
+        order(sort_column); // Rebuilt if the records changed
+    }
+    if (view_version == records.version() && applied_query == query &&
+        view_column == sort_column && view_descending == descending) {
+        return;
+    }
+    view_version = records.version();
+    applied_query = query;
+    view_column = sort_column;
+    view_descending = descending;
+
+    filtered.clear();
+    if (applied_query.empty()) {
+        return;
+    }
+    const patient_hot* first = records.all().data();
+    for (u_int64_t id : records.with_name_prefix(applied_query, MAX_FILTERED)) {
+        if (const patient_hot* row = records.find(id)) {
+            filtered.push_back(static_cast<u_int32_t>(row - first));
+        }
+    }
+
+    // Table order is the column's permutation, or storage order
+    const std::vector<u_int32_t>* rank = sort_column >= 0 ? &orders[sort_column].rank : nullptr;
+    std::sort(filtered.begin(), filtered.end(), [rank, this](u_int32_t p_a, u_int32_t p_b) {
+        u_int32_t a = rank ? (*rank)[p_a] : p_a;
+        u_int32_t b = rank ? (*rank)[p_b] : p_b;
+        return descending ? a > b : a < b;
+    });
+}
+
+u_int32_t patient_browser::slot_at(size_t p_row) const {
+    if (!applied_query.empty()) {
+        return filtered[p_row];
+    }
+    if (sort_column < 0) {
+        return static_cast<u_int32_t>(p_row);
+    }
+    const std::vector<u_int32_t>& slots = orders[sort_column].slots;
+    return slots[descending ? slots.size() - 1 - p_row : p_row];
+}
+
+void patient_browser::draw_row(const patient_hot& p_row) {
+    char cell[32];
+    ImGui::TableNextRow();
+
+    // Hidden columns aren't formatted either
+    if (ImGui::TableNextColumn()) {
+        std::snprintf(cell, sizeof(cell), "%llu", static_cast<unsigned long long>(p_row.id));
+        ImGui::TextUnformatted(cell);
+    }
+    if (ImGui::TableNextColumn()) {
+        std::string_view name = records.text(p_row.name);
+        ImGui::TextUnformatted(name.data(), name.data() + name.size());
+    }
+    if (ImGui::TableNextColumn()) {
+        ImGui::TextUnformatted(gender_name(p_row.gender));
+    }
+    if (ImGui::TableNextColumn() && p_row.age) {
+        std::snprintf(cell, sizeof(cell), "%u", static_cast<unsigned>(p_row.age));
+        ImGui::TextUnformatted(cell);
+    }
+    if (ImGui::TableNextColumn() && p_row.date_of_birth) {
+        std::snprintf(cell, sizeof(cell), "%04u-%02u-%02u", date_year(p_row.date_of_birth),
+                      date_month(p_row.date_of_birth), date_day(p_row.date_of_birth));
+        ImGui::TextUnformatted(cell);
+    }
+    const patient_cold& cold = records.cold(p_row);
+    if (ImGui::TableNextColumn() && cold.number) {
+        std::snprintf(cell, sizeof(cell), "%llu", static_cast<unsigned long long>(cold.number));
+        ImGui::TextUnformatted(cell);
+    }
+    if (ImGui::TableNextColumn()) {
+        std::string_view email = records.text(cold.email);
+        ImGui::TextUnformatted(email.data(), email.data() + email.size());
+    }
+}
+
+void patient_browser::show(bool* p_open) {
+    if (!ImGui::Begin("PATIENTS", p_open)) {
+        ImGui::End();
+        return;
+    }
+    auto start = clock_type::now();
+
+    ImGui::SetNextItemWidth(240.0f);
+    ImGui::InputTextWithHint("##find", "FIND BY NAME", query, sizeof(query));
+    size_t rows = applied_query.empty() ? records.size() : filtered.size(); // As of last frame
+    ImGui::SameLine();
+    ImGui::Text("%zu PATIENTS", rows);
+
+    ImGuiTableFlags flags = ImGuiTableFlags_Resizable | ImGuiTableFlags_Reorderable | ImGuiTableFlags_Hideable |
+                            ImGuiTableFlags_Sortable | ImGuiTableFlags_SortTristate | ImGuiTableFlags_RowBg |
+                            ImGuiTableFlags_BordersOuter | ImGuiTableFlags_BordersV | ImGuiTableFlags_ScrollY;
+    drawn = 0;
+    if (ImGui::BeginTable("patients", COLUMN_COUNT, flags)) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("ID", ImGuiTableColumnFlags_WidthFixed, 0.0f, COLUMN_ID);
+        ImGui::TableSetupColumn("NAME", ImGuiTableColumnFlags_WidthStretch | ImGuiTableColumnFlags_NoHide, 0.0f, COLUMN_NAME);
+        ImGui::TableSetupColumn("GENDER", ImGuiTableColumnFlags_WidthFixed, 0.0f, COLUMN_GENDER);
+        ImGui::TableSetupColumn("AGE", ImGuiTableColumnFlags_WidthFixed, 0.0f, COLUMN_AGE);
+        ImGui::TableSetupColumn("BORN", ImGuiTableColumnFlags_WidthFixed, 0.0f, COLUMN_BORN);
+        ImGui::TableSetupColumn("PHONE", ImGuiTableColumnFlags_WidthFixed, 0.0f, COLUMN_PHONE);
+        ImGui::TableSetupColumn("EMAIL", ImGuiTableColumnFlags_WidthStretch, 0.0f, COLUMN_EMAIL);
+        ImGui::TableHeadersRow();
+
+        if (ImGuiTableSortSpecs* specs = ImGui::TableGetSortSpecs()) {
+            if (specs->SpecsDirty) {
+                sort_column = specs->SpecsCount ? static_cast<int>(specs->Specs[0].ColumnUserID) : -1;
+                descending = specs->SpecsCount && specs->Specs[0].SortDirection == ImGuiSortDirection_Descending;
+                specs->SpecsDirty = false;
+            }
+        }
+        update_view();
+        rows = applied_query.empty() ? records.size() : filtered.size();
+
+        std::span<const patient_hot> all = records.all();
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(rows));
+        while (clipper.Step()) {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                draw_row(all[slot_at(static_cast<size_t>(i))]);
+                drawn++;
+            }
+        }
+        ImGui::EndTable();
+    }
+
+    draw_us = micros_since(start);
+    ImGui::End();
+}
+
+browser_stats patient_browser::stats() const {
+    browser_stats s{};
+    s.rows = applied_query.empty() ? records.size() : filtered.size();
+    s.drawn = drawn;
+    s.sort_ms = sort_ms;
+    s.draw_us = draw_us;
+    return s;
+}
@@ -0,0 +1,122 @@
+#include "util/clinic/patient_fields.hpp"
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+// Fixed size fields aren't guaranteed to be terminated when full
+template <size_t N>
+std::string field(const char (&p_field)[N]) {
+    return std::string(p_field, strnlen(p_field, N));
+}
+
+bool digits(std::string_view p_text, u_int32_t& p_value) {
+    if (p_text.empty()) {
+        return false;
+    }
+    p_value = 0;
+    for (char c : p_text) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        p_value = p_value * 10 + static_cast<u_int32_t>(c - '0');
+    }
+    return true;
+}
+
+} // namespace
+
+const char* gender_name(u_int8_t p_gender) {
+    return p_gender == MALE ? "male" : "female";
+}
+
+u_int32_t pack_date(u_int32_t p_year, u_int32_t p_month, u_int32_t p_day) {
+    return (p_year << 9) | ((p_month & 0xF) << 5) | (p_day & 0x1F);
+}
+
+bool parse_date(std::string_view p_text, u_int32_t& p_date) {
+    while (!p_text.empty() && p_text.front() == ' ') {
+        p_text.remove_prefix(1);
+    }
+    while (!p_text.empty() && p_text.back() == ' ') {
+        p_text.remove_suffix(1);
+    }
+
+    u_int32_t year, month, day;
+    bool ok;
+    if (p_text.size() == 8) {
+        ok = digits(p_text.substr(0, 4), year) && digits(p_text.substr(4, 2), month) &&
+             digits(p_text.substr(6, 2), day);
+    } else {
+        ok = p_text.size() == 10 && (p_text[4] == '-' || p_text[4] == '/') && p_text[7] == p_text[4] &&
+             digits(p_text.substr(0, 4), year) && digits(p_text.substr(5, 2), month) &&
+             digits(p_text.substr(8, 2), day);
+    }
+    if (!ok || year == 0 || month < 1 || month > 12 || day < 1 || day > 31) {
+        return false;
+    }
+
+    p_date = pack_date(year, month, day);
+    return true;
+}
+
+std::string format_date(u_int32_t p_date) {
+    if (!p_date) {
+        return "";
+    }
+    char text[16];
+    std::snprintf(text, sizeof(text), "%04u-%02u-%02u", date_year(p_date), date_month(p_date), date_day(p_date));
+    return text;
+}
+
+void normalize_name(std::string_view p_text, std::string& p_out, bool p_keep_end) {
+    // U+00C0 to U+00FF (0xC3, then 0x80 + n) spelled in ASCII, nothing for the × and ÷ signs
+    static const char* const latin[64] = {
+        "a", "a", "a", "a", "a", "a", "ae", "c", "e", "e", "e", "e", "i", "i", "i", "i",
+        "d", "n", "o", "o", "o", "o", "o", "", "o", "u", "u", "u", "u", "y", "th", "ss",
+        "a", "a", "a", "a", "a", "a", "ae", "c", "e", "e", "e", "e", "i", "i", "i", "i",
+        "d", "n", "o", "o", "o", "o", "o", "", "o", "u", "u", "u", "u", "y", "th", "y"
+    };
+
+    p_out.clear();
+    bool gap = false;
+    for (size_t i = 0; i < p_text.size(); i++) {
+        unsigned char u = static_cast<unsigned char>(p_text[i]);
+        std::string_view letters = p_text.substr(i, 1);
+        char lower;
+        if (u >= 'A' && u <= 'Z') {
+            lower = static_cast<char>(u - 'A' + 'a');
+            letters = std::string_view(&lower, 1);
+        } else if (u == 0xC3 && i + 1 < p_text.size() && (static_cast<unsigned char>(p_text[i + 1]) & 0xC0) == 0x80) {
+            letters = latin[static_cast<unsigned char>(p_text[++i]) - 0x80];
+        } else if (u < 0x80 && !(u >= '0' && u <= '9') && !(u >= 'a' && u <= 'z')) {
+            letters = std::string_view();
+        }
+
+        if (letters.empty()) {
+            gap = true;
+            continue;
+        }
+        if (gap && !p_out.empty()) {
+            p_out += ' ';
+        }
+        gap = false;
+        p_out += letters;
+    }
+    if (gap && p_keep_end && !p_out.empty()) {
+        p_out += ' ';
+    }
+}
+
+bool from_legacy(const legacy_patient& p_old, patient& p_new) {
+    p_new.id = p_old.id;
+    p_new.name = field(p_old.name);
+    p_new.gender = p_old.gender;
+    p_new.age = p_old.age;
+    p_new.number = p_old.number;
+    p_new.email = field(p_old.email);
+    p_new.address = field(p_old.address);
+
+    p_new.date_of_birth = 0;
+    return !p_old.date_of_birth[0] || parse_date(field(p_old.date_of_birth), p_new.date_of_birth);
+}
@@ -0,0 +1,162 @@
+#include "util/clinic/patient_history.hpp"
+#include <SDL3/SDL_log.h>
+#include <chrono>
+#include <utility>
+
+patient_history::patient_history(patient_records& p_records, const history_config& p_config)
+    : records(p_records), cfg(p_config) {
+    versions.emplace_back();
+    publish();
+    records.add_listener(this, false); // Built from the records when first needed
+}
+
+patient_history::~patient_history() {
+    records.remove_listener(this);
+}
+
+patient_snapshot patient_history::snapshot() {
+    if (!built) {
+        build();
+    }
+    return *published.load();
+}
+
+void patient_history::on_begin() {
+    if (travelling) {
+        return;
+    }
+    if (!built) {
+        build(); // The version this change can be undone to
+    }
+    changing = true;
+}
+
+void patient_history::on_upsert(const patient& p_patient) {
+    if (changing) {
+        working.assign(p_patient.id, std::make_shared<const patient>(p_patient), edit);
+    }
+}
+
+void patient_history::on_remove(u_int64_t p_id) {
+    if (changing) {
+        working.erase(p_id, edit);
+    }
+}
+
+void patient_history::on_clear() {
+    if (changing) {
+        working.clear();
+    }
+}
+
+void patient_history::on_commit(bool p_reloaded) {
+    if (p_reloaded) {
+        // Other records, a new history once it's needed
+        built = changing = false;
+        working.clear();
+        edit++;
+        versions.assign(1, patient_snapshot{});
+        current = 0;
+        publish();
+        return;
+    }
+    if (!changing) {
+        return;
+    }
+    changing = false;
+
+    patient_snapshot next;
+    next.patients = working;
+    next.number = records.version();
+    edit++; // working's nodes are shared with next from here on
+
+    versions.resize(current + 1); // A new change drops what could be redone
+    versions.push_back(std::move(next));
+    if (versions.size() > cfg.depth + 1) {
+        versions.erase(versions.begin());
+    }
+    current = versions.size() - 1;
+    publish();
+}
+
+bool patient_history::undo() {
+    if (!can_undo()) {
+        return false;
+    }
+    return travel(current - 1);
+}
+
+bool patient_history::redo() {
+    if (!can_redo()) {
+        return false;
+    }
+    return travel(current + 1);
+}
+
+void patient_history::build() {
+    working.clear();
+    patient p;
+    for (const patient_hot& row : records.all()) {
+        records.load(row, p);
+        working.assign(p.id, std::make_shared<const patient>(p), edit);
+    }
+
+    patient_snapshot first;
+    first.patients = working;
+    first.number = records.version();
+    edit++;
+    versions.assign(1, std::move(first));
+    current = 0;
+    built = true;
+    publish();
+}
+
+bool patient_history::travel(size_t p_to) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<patient> upserts;
+    std::vector<u_int64_t> removals;
+    versions[current].patients.diff(versions[p_to].patients, [&](u_int64_t p_id, const std::shared_ptr<const patient>*,
+                                                                 const std::shared_ptr<const patient>* p_there) {
+        if (p_there) {
+            upserts.push_back(**p_there);
+        } else {
+            removals.push_back(p_id);
+        }
+    });
+
+    // The records end up equal to versions[p_to], which is kept as is
+    // instead of rebuilding the same tree from the changes
+    travelling = true;
+    bool stored = records.change(upserts, removals);
+    travelling = false;
+    if (!stored) {
+        // The records match no version now, the history starts over from them
+        SDL_Log("patient_history: the store couldn't take the change back, starting a new history");
+        build();
+        return false;
+    }
+
+    working = versions[p_to].patients;
+    edit++;
+    current = p_to;
+    versions[current].number = records.version();
+    last_changes = upserts.size() + removals.size();
+    last_travel_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    publish();
+    return true;
+}
+
+void patient_history::publish() {
+    published.store(std::make_shared<const patient_snapshot>(versions[current]));
+}
+
+history_stats patient_history::stats() const {
+    history_stats result{};
+    result.patients = built ? versions[current].size() : records.size();
+    result.undo = current;
+    result.redo = versions.size() - 1 - current;
+    result.version = built ? versions[current].version() : records.version();
+    result.last_changes = last_changes;
+    result.last_travel_ms = last_travel_ms;
+    return result;
+}
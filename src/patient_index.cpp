@@ -0,0 +1,212 @@
+#include "util/clinic/patient_index.hpp"
+#include <algorithm>
+#include <chrono>
+
+#include "util/clinic/id_hash.hpp"
+#include "util/clinic/patient_fields.hpp"
+
+namespace {
+
+typedef std::chrono::steady_clock clock_type;
+
+double micros_since(clock_type::time_point p_since) {
+    return std::chrono::duration<double, std::micro>(clock_type::now() - p_since).count();
+}
+
+// Normalized with a space after the last word too, so a typed "ann " finds "Ann"
+void index_name(std::string_view p_name, std::string& p_out) {
+    normalize_name(p_name, p_out);
+    if (!p_out.empty()) {
+        p_out += ' ';
+    }
+}
+
+} // namespace
+
+patient_index::name_key patient_index::pack(std::string_view p_text, unsigned char p_fill) {
+    name_key key;
+    for (size_t i = 0; i < 16; i++) {
+        u_int64_t byte = i < p_text.size() ? static_cast<unsigned char>(p_text[i]) : p_fill;
+        u_int64_t& half = i < 8 ? key.head : key.tail;
+        half = (half << 8) | byte;
+    }
+    return key;
+}
+
+template <typename F>
+void patient_index::each_word(std::string_view p_name, F&& p_func) {
+    for (size_t at = 0; at < p_name.size(); at++) {
+        p_func(p_name.substr(at));
+        at = p_name.find(' ', at);
+        if (at == std::string_view::npos) {
+            break;
+        }
+    }
+}
+
+void patient_index::build() const {
+    if (built.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(build_mutex);
+    if (built.load(std::memory_order_relaxed)) {
+        return;
+    }
+    auto start = clock_type::now();
+
+    std::span<const patient_hot> rows = store.all();
+    std::vector<std::pair<name_key, u_int64_t>> name_entries;
+    std::vector<std::pair<u_int32_t, u_int64_t>> date_entries;
+    name_entries.reserve(rows.size() * 2);
+    date_entries.reserve(rows.size());
+
+    std::string name;
+    for (const patient_hot& row : rows) {
+        index_name(store.text(row.name), name);
+        each_word(name, [&](std::string_view p_word) { name_entries.emplace_back(pack(p_word, 0), row.id); });
+        if (row.date_of_birth) {
+            date_entries.emplace_back(row.date_of_birth, row.id);
+        }
+    }
+    names.assign(std::move(name_entries));
+    dates.assign(std::move(date_entries));
+
+    build_ms = micros_since(start) / 1000.0;
+    built.store(true, std::memory_order_release);
+}
+
+std::vector<u_int64_t> patient_index::with_name_prefix(std::string_view p_prefix, size_t p_limit) const {
+    build();
+    auto start = clock_type::now();
+
+    std::vector<u_int64_t> ids;
+    std::string prefix;
+    normalize_name(p_prefix, prefix, true);
+    if (prefix.empty() || !p_limit) {
+        return ids;
+    }
+
+    // Keys only hold 16 bytes. A longer prefix looks through the narrowest
+    // range among its words' keys (every one of them starts a word of a
+    // matching name) and the names themselves decide
+    std::string_view from = prefix;
+    if (prefix.size() > 16) {
+        size_t narrowest = ~static_cast<size_t>(0);
+        each_word(prefix, [&](std::string_view p_word) {
+            size_t range = names.estimate(pack(p_word, 0), pack(p_word, 0xFF));
+            if (range < narrowest) {
+                narrowest = range;
+                from = p_word;
+            }
+        });
+    }
+    name_key last = pack(from, 0xFF);
+    std::string name;
+    id_hash seen;
+    names.scan(pack(from, 0), [&](const std::pair<name_key, u_int64_t>& p_entry) {
+        if (p_entry.first > last) {
+            return false;
+        }
+        u_int64_t unused;
+        if (seen.find(p_entry.second, unused)) {
+            return true; // Two of its words match
+        }
+        if (prefix.size() > 16) {
+            const patient_hot* row = store.find(p_entry.second);
+            bool match = false;
+            if (row) {
+                index_name(store.text(row->name), name);
+                each_word(name, [&](std::string_view p_word) { match = match || p_word.starts_with(prefix); });
+            }
+            if (!match) {
+                return true;
+            }
+        }
+        ids.push_back(p_entry.second);
+        seen.assign(p_entry.second, 0);
+        return ids.size() < p_limit;
+    });
+
+    last_lookup_us.store(micros_since(start), std::memory_order_relaxed);
+    return ids;
+}
+
+std::vector<u_int64_t> patient_index::born_between(u_int32_t p_from, u_int32_t p_to, size_t p_limit) const {
+    build();
+    auto start = clock_type::now();
+
+    std::vector<u_int64_t> ids;
+    if (p_limit && p_from <= p_to) {
+        dates.scan(p_from, [&](const std::pair<u_int32_t, u_int64_t>& p_entry) {
+            if (p_entry.first > p_to) {
+                return false;
+            }
+            ids.push_back(p_entry.second);
+            return ids.size() < p_limit;
+        });
+    }
+
+    last_lookup_us.store(micros_since(start), std::memory_order_relaxed);
+    return ids;
+}
+
+size_t patient_index::count_born_between(u_int32_t p_from, u_int32_t p_to) const {
+    build();
+    if (p_from > p_to) {
+        return 0;
+    }
+    return dates.rank(static_cast<u_int64_t>(p_to) + 1) - dates.rank(p_from);
+}
+
+void patient_index::forget(u_int64_t p_id) {
+    if (!built.load(std::memory_order_acquire)) {
+        return;
+    }
+    const patient_hot* row = store.find(p_id);
+    if (!row) {
+        return;
+    }
+    index_name(store.text(row->name), scratch);
+    each_word(scratch, [&](std::string_view p_word) { names.erase(pack(p_word, 0), p_id); });
+    if (row->date_of_birth) {
+        dates.erase(row->date_of_birth, p_id);
+    }
+}
+
+void patient_index::add(const patient& p_patient) {
+    if (!built.load(std::memory_order_acquire)) {
+        return;
+    }
+    index_name(p_patient.name, scratch);
+    each_word(scratch, [&](std::string_view p_word) { names.insert(pack(p_word, 0), p_patient.id); });
+    if (p_patient.date_of_birth) {
+        dates.insert(p_patient.date_of_birth, p_patient.id);
+    }
+}
+
+void patient_index::clear() {
+    std::lock_guard<std::mutex> lock(build_mutex);
+    names.clear();
+    dates.clear();
+}
+
+void patient_index::reset() {
+    std::lock_guard<std::mutex> lock(build_mutex);
+    names.clear();
+    dates.clear();
+    built.store(false, std::memory_order_release);
+}
+
+index_stats patient_index::stats() const {
+    index_stats s{};
+    s.built = built.load(std::memory_order_acquire);
+    if (s.built) {
+        s.name_keys = names.size();
+        s.date_keys = dates.size();
+        s.memory = names.memory() + dates.memory();
+        s.build_ms = build_ms;
+    }
+    s.last_lookup_us = last_lookup_us.load(std::memory_order_relaxed);
+    return s;
+}
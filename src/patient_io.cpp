@@ -0,0 +1,534 @@
+#include "util/clinic/patient_io.hpp"
+#include "json/json.hpp"
+#include <SDL3/SDL_log.h>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <thread>
+#include <utility>
+
+using json = nlohmann::json;
+
+namespace {
+
+constexpr size_t ARRAY_BATCH = 8192;    // Records per commit when streaming an array
+constexpr size_t FLUSH_BYTES = 1u << 20; // Export buffer
+
+typedef enum patient_field {
+    FIELD_NONE,
+    FIELD_ID,
+    FIELD_NAME,
+    FIELD_GENDER,
+    FIELD_AGE,
+    FIELD_BORN,
+    FIELD_EMAIL,
+    FIELD_PHONE,
+    FIELD_ADDRESS
+} patient_field;
+
+patient_field field_of(std::string_view p_key) {
+    static const std::pair<std::string_view, patient_field> FIELDS[] = {
+        {"id", FIELD_ID}, {"name", FIELD_NAME}, {"gender", FIELD_GENDER}, {"age", FIELD_AGE},
+        {"date_of_birth", FIELD_BORN}, {"email", FIELD_EMAIL}, {"phone", FIELD_PHONE}, {"address", FIELD_ADDRESS}
+    };
+    for (const auto& [name, field] : FIELDS) {
+        if (name == p_key) {
+            return field;
+        }
+    }
+    return FIELD_NONE;
+}
+
+// Turns SAX events straight into patients, no DOM in between. Records are
+// the objects at the top level (one per line) or inside a top level array;
+// values nested deeper than a record's fields are skipped
+class patient_sax : public nlohmann::json_sax<json> {
+public:
+    std::vector<patient> out;
+    patient_records* sink = nullptr; // Streams out in batches to it when set
+    u_int64_t stored = 0;
+    u_int64_t rejected = 0;
+    std::string error;
+
+    // Before each line
+    void restart() {
+        depth = 0;
+        in_array = false;
+        in_record = false;
+        field = FIELD_NONE;
+    }
+
+    bool null() override { return scalar(); }
+    bool boolean(bool) override { return scalar(); }
+    bool number_integer(number_integer_t p_value) override {
+        if (p_value >= 0) {
+            return number(static_cast<u_int64_t>(p_value));
+        }
+        return scalar();
+    }
+    bool number_unsigned(number_unsigned_t p_value) override { return number(p_value); }
+    bool number_float(number_float_t p_value, const string_t&) override {
+        if (p_value >= 0.0 && p_value < 1.8e19) {
+            return number(static_cast<u_int64_t>(p_value));
+        }
+        return scalar();
+    }
+    bool binary(binary_t&) override { return scalar(); }
+
+    bool string(string_t& p_value) override {
+        if (!at_field()) {
+            return scalar();
+        }
+        switch (field) {
+        case FIELD_ID:
+        case FIELD_PHONE:
+            if (u_int64_t value = 0; digits(p_value, value)) {
+                set_number(value);
+            }
+            break;
+        case FIELD_NAME:
+            current.name = std::move(p_value);
+            break;
+        case FIELD_GENDER:
+            if (!p_value.empty() && (p_value[0] == 'm' || p_value[0] == 'M')) {
+                current.gender = MALE;
+            } else if (!p_value.empty() && (p_value[0] == 'f' || p_value[0] == 'F')) {
+                current.gender = FEMALE;
+            }
+            break;
+        case FIELD_BORN:
+            if (!parse_date(p_value, current.date_of_birth)) {
+                current.date_of_birth = 0;
+            }
+            break;
+        case FIELD_EMAIL:
+            current.email = std::move(p_value);
+            break;
+        case FIELD_ADDRESS:
+            current.address = std::move(p_value);
+            break;
+        default:
+            break;
+        }
+        field = FIELD_NONE;
+        return true;
+    }
+
+    bool start_object(std::size_t) override {
+        if (depth == record_depth() - 1) {
+            current = patient{};
+            has_id = false;
+            in_record = true;
+        } else if (at_field()) {
+            field = FIELD_NONE; // A nested value, skipped
+        }
+        depth++;
+        return true;
+    }
+
+    bool key(string_t& p_key) override {
+        field = in_record && depth == record_depth() ? field_of(p_key) : FIELD_NONE;
+        return true;
+    }
+
+    bool end_object() override {
+        depth--;
+        if (in_record && depth == record_depth() - 1) {
+            in_record = false;
+            if (has_id) {
+                out.push_back(std::move(current));
+                if (sink != nullptr && out.size() >= ARRAY_BATCH) {
+                    drain();
+                }
+            } else {
+                rejected++;
+            }
+        }
+        return true;
+    }
+
+    bool start_array(std::size_t) override {
+        if (depth == 0) {
+            in_array = true;
+        } else if (in_array && depth == 1) {
+            rejected++; // An array where a record should be
+        } else if (at_field()) {
+            field = FIELD_NONE;
+        }
+        depth++;
+        return true;
+    }
+
+    bool end_array() override {
+        depth--;
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& p_error) override {
+        error = p_error.what();
+        return false;
+    }
+
+    void drain() {
+        if (sink != nullptr && !out.empty()) {
+            sink->upsert(out);
+            stored += out.size();
+            out.clear();
+        }
+    }
+
+private:
+    int record_depth() const { return in_array ? 2 : 1; } // Depth of a record's fields
+
+    bool at_field() const { return in_record && depth == record_depth() && field != FIELD_NONE; }
+
+    // Any value that isn't a field we keep
+    bool scalar() {
+        if (depth == 0 || (in_array && depth == 1)) {
+            rejected++; // Not an object
+        }
+        field = FIELD_NONE;
+        return true;
+    }
+
+    bool number(u_int64_t p_value) {
+        if (!at_field()) {
+            return scalar();
+        }
+        set_number(p_value);
+        field = FIELD_NONE;
+        return true;
+    }
+
+    void set_number(u_int64_t p_value) {
+        switch (field) {
+        case FIELD_ID:
+            if (p_value != 0) {
+                current.id = p_value;
+                has_id = true;
+            }
+            break;
+        case FIELD_AGE:
+            if (p_value <= 255) {
+                current.age = static_cast<u_int8_t>(p_value);
+            }
+            break;
+        case FIELD_GENDER:
+            current.gender = p_value == MALE ? MALE : FEMALE;
+            break;
+        case FIELD_PHONE:
+            current.number = p_value;
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Phone numbers and ids written as text ("+970 59 123", "42"), false without a digit
+    static bool digits(std::string_view p_text, u_int64_t& p_value) {
+        bool any = false;
+        for (char c : p_text) {
+            if (c >= '0' && c <= '9') {
+                p_value = p_value * 10 + static_cast<u_int64_t>(c - '0');
+                any = true;
+            }
+        }
+        return any;
+    }
+
+    patient current;
+    bool has_id = false;
+    bool in_record = false;
+    bool in_array = false;
+    int depth = 0;
+    patient_field field = FIELD_NONE;
+};
+
+typedef struct parsed_chunk {
+    std::vector<patient> patients;
+    u_int64_t rejected = 0;
+    u_int64_t bad_line = 0; // First line that failed to parse, 0 if none did
+    std::string error;
+} parsed_chunk;
+
+// Parses a run of whole lines, p_first_line is the number of its first one
+parsed_chunk parse_lines(std::string p_text, u_int64_t p_first_line) {
+    patient_sax sax;
+    sax.out.reserve(p_text.size() / 160);
+    parsed_chunk result;
+
+    u_int64_t line = p_first_line;
+    size_t start = 0;
+    while (start < p_text.size()) {
+        size_t end = p_text.find('\n', start);
+        if (end == std::string::npos) {
+            end = p_text.size();
+        }
+        size_t stop = end;
+        if (stop > start && p_text[stop - 1] == '\r') {
+            stop--;
+        }
+        bool blank = std::all_of(p_text.begin() + static_cast<std::ptrdiff_t>(start), p_text.begin() + static_cast<std::ptrdiff_t>(stop),
+                                 [](char c) { return std::isspace(static_cast<unsigned char>(c)); });
+        if (!blank) {
+            size_t before = sax.out.size();
+            u_int64_t rejected = sax.rejected;
+            sax.restart();
+            const char* text = p_text.data();
+            if (!json::sax_parse(text + start, text + stop, &sax)) {
+                sax.out.resize(before); // Nothing from a broken line
+                sax.rejected = rejected + 1;
+                if (result.bad_line == 0) {
+                    result.bad_line = line;
+                    result.error = sax.error;
+                }
+            }
+        }
+        start = end + 1;
+        line++;
+    }
+
+    result.patients = std::move(sax.out);
+    result.rejected = sax.rejected;
+    return result;
+}
+
+double elapsed_ms(std::chrono::steady_clock::time_point p_start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - p_start).count();
+}
+
+io_stats import_array(patient_records& p_records, std::ifstream& p_in) {
+    patient_sax sax;
+    sax.sink = &p_records;
+    io_stats stats{};
+    bool parsed = json::sax_parse(p_in, &sax);
+    sax.drain();
+    if (!parsed) {
+        SDL_Log("Patient import stopped: %s", sax.error.c_str());
+    }
+    stats.records = sax.stored;
+    stats.rejected = sax.rejected;
+    return stats;
+}
+
+io_stats import_lines(patient_records& p_records, std::ifstream& p_in, const import_config& p_config) {
+    size_t threads = p_config.threads != 0 ? p_config.threads : std::max(1u, std::thread::hardware_concurrency());
+    size_t chunk_bytes = std::max<size_t>(p_config.chunk_bytes, 4096);
+    io_stats stats{};
+
+    std::string carry; // Partial last line of the previous read
+    u_int64_t line = 1;
+    bool eof = false;
+    auto next_chunk = [&](std::string& p_chunk) {
+        while (!eof) {
+            p_chunk = std::move(carry);
+            carry.clear();
+            size_t old = p_chunk.size();
+            p_chunk.resize(old + chunk_bytes);
+            p_in.read(p_chunk.data() + old, static_cast<std::streamsize>(chunk_bytes));
+            p_chunk.resize(old + static_cast<size_t>(p_in.gcount()));
+            if (!p_in) {
+                eof = true;
+                return !p_chunk.empty();
+            }
+            size_t cut = p_chunk.rfind('\n');
+            if (cut != std::string::npos) {
+                carry.assign(p_chunk, cut + 1);
+                p_chunk.resize(cut + 1);
+                return true;
+            }
+            carry = std::move(p_chunk); // A line longer than a chunk, keep reading
+        }
+        return false;
+    };
+
+    std::deque<std::future<parsed_chunk>> pending;
+    bool logged = false;
+    for (;;) {
+        while (pending.size() < threads * 2) {
+            std::string chunk;
+            if (!next_chunk(chunk)) {
+                break;
+            }
+            u_int64_t first = line;
+            line += static_cast<u_int64_t>(std::count(chunk.begin(), chunk.end(), '\n'));
+            pending.push_back(std::async(std::launch::async, parse_lines, std::move(chunk), first));
+        }
+        if (pending.empty()) {
+            break;
+        }
+
+        // In file order, so a later line with the same id wins
+        parsed_chunk done = pending.front().get();
+        pending.pop_front();
+        p_records.upsert(done.patients);
+        stats.records += done.patients.size();
+        stats.rejected += done.rejected;
+        if (done.bad_line != 0 && !logged) {
+            SDL_Log("Patient import: skipping line %llu: %s", static_cast<unsigned long long>(done.bad_line), done.error.c_str());
+            logged = true;
+        }
+    }
+    return stats;
+}
+
+void append_number(std::string& p_out, u_int64_t p_value) {
+    char digits[24];
+    auto [end, error] = std::to_chars(digits, digits + sizeof(digits), p_value);
+    p_out.append(digits, end);
+}
+
+void append_string(std::string& p_out, std::string_view p_text) {
+    p_out += '"';
+    size_t plain = 0;
+    for (size_t i = 0; i < p_text.size(); i++) {
+        unsigned char c = static_cast<unsigned char>(p_text[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        p_out.append(p_text.substr(plain, i - plain));
+        switch (c) {
+        case '"': p_out += "\\\""; break;
+        case '\\': p_out += "\\\\"; break;
+        case '\n': p_out += "\\n"; break;
+        case '\r': p_out += "\\r"; break;
+        case '\t': p_out += "\\t"; break;
+        default: {
+            char escape[8];
+            std::snprintf(escape, sizeof(escape), "\\u%04x", c);
+            p_out += escape;
+        }
+        }
+        plain = i + 1;
+    }
+    p_out.append(p_text.substr(plain));
+    p_out += '"';
+}
+
+void append_date(std::string& p_out, u_int32_t p_date) {
+    if (p_date == 0) {
+        p_out += "\"\"";
+        return;
+    }
+    char text[16];
+    std::snprintf(text, sizeof(text), "\"%04u-%02u-%02u\"", date_year(p_date), date_month(p_date), date_day(p_date));
+    p_out += text;
+}
+
+// One line, the fields in get_patient's order
+void append_patient(std::string& p_out, u_int64_t p_id, std::string_view p_name, u_int8_t p_gender, u_int8_t p_age,
+                    u_int32_t p_date_of_birth, std::string_view p_email, u_int64_t p_phone, std::string_view p_address) {
+    p_out += "{\"id\":";
+    append_number(p_out, p_id);
+    p_out += ",\"name\":";
+    append_string(p_out, p_name);
+    p_out += ",\"gender\":\"";
+    p_out += gender_name(p_gender);
+    p_out += "\",\"age\":";
+    append_number(p_out, p_age);
+    p_out += ",\"date_of_birth\":";
+    append_date(p_out, p_date_of_birth);
+    p_out += ",\"email\":";
+    append_string(p_out, p_email);
+    p_out += ",\"phone\":";
+    append_number(p_out, p_phone);
+    p_out += ",\"address\":";
+    append_string(p_out, p_address);
+    p_out += "}\n";
+}
+
+// p_fill(buffer, next) appends one line at a time and calls next() after
+// each. Written to p_path.tmp and renamed over p_path when complete
+template <typename F>
+io_stats write_export(const std::string& p_path, F&& p_fill) {
+    auto start = std::chrono::steady_clock::now();
+    io_stats stats{};
+    std::string temp = p_path + ".tmp";
+    std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        SDL_Log("Couldn't create %s for the patient export: %s", temp.c_str(), std::strerror(errno));
+        return stats;
+    }
+
+    std::string buffer;
+    buffer.reserve(FLUSH_BYTES + 4096);
+    auto next = [&]() {
+        stats.records++;
+        if (buffer.size() >= FLUSH_BYTES) {
+            out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            stats.bytes += buffer.size();
+            buffer.clear();
+        }
+    };
+    p_fill(buffer, next);
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    stats.bytes += buffer.size();
+    out.close();
+
+    std::error_code error;
+    if (!out) {
+        SDL_Log("Couldn't write %s", temp.c_str());
+        std::filesystem::remove(temp, error);
+        return stats;
+    }
+    std::filesystem::rename(temp, p_path, error);
+    if (error) {
+        SDL_Log("Couldn't replace %s: %s", p_path.c_str(), error.message().c_str());
+        return stats;
+    }
+    stats.ms = elapsed_ms(start);
+    stats.ok = true;
+    return stats;
+}
+
+} // namespace
+
+io_stats import_patients(patient_records& p_records, const std::string& p_path, const import_config& p_config) {
+    auto start = std::chrono::steady_clock::now();
+    std::ifstream in(p_path, std::ios::binary);
+    if (!in) {
+        SDL_Log("Couldn't open %s for the patient import: %s", p_path.c_str(), std::strerror(errno));
+        return {};
+    }
+
+    in >> std::ws;
+    bool array = in.peek() == '[';
+    in.clear();
+    in.seekg(0);
+
+    io_stats stats = array ? import_array(p_records, in) : import_lines(p_records, in, p_config);
+    std::error_code error;
+    stats.bytes = std::filesystem::file_size(p_path, error);
+    stats.ms = elapsed_ms(start);
+    stats.ok = true;
+    return stats;
+}
+
+io_stats export_patients(const patient_records& p_records, const std::string& p_path) {
+    return write_export(p_path, [&](std::string& p_buffer, auto& p_next) {
+        auto lock = p_records.read_lock();
+        for (const patient_hot& row : p_records.all()) {
+            const patient_cold& cold = p_records.cold(row);
+            append_patient(p_buffer, row.id, p_records.text(row.name), row.gender, row.age, row.date_of_birth,
+                           p_records.text(cold.email), cold.number, p_records.text(cold.address));
+            p_next();
+        }
+    });
+}
+
+io_stats export_patients(const patient_snapshot& p_snapshot, const std::string& p_path) {
+    return write_export(p_path, [&](std::string& p_buffer, auto& p_next) {
+        p_snapshot.each([&](const patient& p_patient) {
+            append_patient(p_buffer, p_patient.id, p_patient.name, p_patient.gender, p_patient.age, p_patient.date_of_birth,
+                           p_patient.email, p_patient.number, p_patient.address);
+            p_next();
+        });
+    });
+}
@@ -0,0 +1,224 @@
+#include "util/clinic/patient_records.hpp"
+#include <algorithm>
+
+bool patient_records::open(const std::string& p_dir, const store_config& p_config) {
+    bool ok = store.open(p_dir, p_config);
+    auto lock = store.write_lock();
+    reload();
+    return ok;
+}
+
+void patient_records::close() {
+    store.close();
+    auto lock = store.write_lock();
+    reload();
+}
+
+void patient_records::reload() {
+    changes++;
+    index.reset();
+    patient p;
+    for (patient_listener* listener : listeners) {
+        listener->on_clear();
+        for (const patient_hot& row : store.all()) {
+            store.load(row, p);
+            listener->on_upsert(p);
+        }
+        listener->on_commit(true);
+    }
+}
+
+void patient_records::begin() {
+    for (patient_listener* listener : listeners) {
+        listener->on_begin();
+    }
+}
+
+bool patient_records::get(u_int64_t p_id, patient& p_patient) const {
+    const patient_hot* row = store.find(p_id);
+    if (row) {
+        store.load(*row, p_patient);
+    }
+    return row != nullptr;
+}
+
+bool patient_records::upsert(const patient& p_patient) {
+    u_int64_t lsn;
+    {
+        auto lock = store.write_lock();
+        begin();
+        index.forget(p_patient.id);
+        lsn = store.upsert(p_patient);
+        if (lsn == 0) {
+            unchanged(p_patient.id);
+            return false;
+        }
+        changes++;
+        index.add(p_patient);
+
+        for (patient_listener* listener : listeners) {
+            listener->on_upsert(p_patient);
+            listener->on_commit(false);
+        }
+    }
+    store.settle(lsn);
+    return true;
+}
+
+bool patient_records::upsert(std::span<const patient> p_patients) {
+    return change(p_patients, {});
+}
+
+void patient_records::unchanged(u_int64_t p_id) {
+    patient old;
+    if (get(p_id, old)) {
+        index.add(old);
+    }
+}
+
+bool patient_records::remove(u_int64_t p_id) {
+    bool removed;
+    u_int64_t lsn;
+    {
+        auto lock = store.write_lock();
+        if (!store.find(p_id)) {
+            return false; // Nothing to tell the listeners
+        }
+        begin();
+        index.forget(p_id);
+        lsn = store.remove(p_id, removed);
+        if (!removed) {
+            return false;
+        }
+        changes++;
+
+        for (patient_listener* listener : listeners) {
+            listener->on_remove(p_id);
+            listener->on_commit(false);
+        }
+    }
+    store.settle(lsn);
+    return true;
+}
+
+size_t patient_records::remove(std::span<const u_int64_t> p_ids) {
+    size_t removed = 0;
+    change({}, p_ids, &removed);
+    return removed;
+}
+
+bool patient_records::change(std::span<const patient> p_upserts, std::span<const u_int64_t> p_removals,
+                             size_t* p_removed) {
+    bool stored = true;
+    u_int64_t lsn = 0;
+    size_t removed = 0;
+    {
+        auto lock = store.write_lock();
+        bool begun = false;
+        auto begin_once = [&]() {
+            if (!begun) {
+                begin(); // Only once something is going to change
+                begun = true;
+            }
+        };
+
+        for (const patient& p : p_upserts) {
+            begin_once();
+            index.forget(p.id);
+            u_int64_t done = store.upsert(p);
+            if (done == 0) {
+                unchanged(p.id);
+                stored = false;
+                continue;
+            }
+            lsn = done;
+            index.add(p);
+            for (patient_listener* listener : listeners) {
+                listener->on_upsert(p);
+            }
+        }
+        // A merge mustn't lose the record it folded into one the store couldn't take
+        for (u_int64_t id : p_removals) {
+            if (!stored || !store.find(id)) {
+                continue;
+            }
+            begin_once();
+            bool was_there;
+            index.forget(id);
+            lsn = store.remove(id, was_there);
+            removed++;
+            for (patient_listener* listener : listeners) {
+                listener->on_remove(id);
+            }
+        }
+
+        if (p_removed) {
+            *p_removed = removed;
+        }
+        if (lsn == 0) {
+            return stored; // Nothing changed, nothing to commit
+        }
+        changes++;
+        for (patient_listener* listener : listeners) {
+            listener->on_commit(false);
+        }
+    }
+    store.settle(lsn);
+    return stored;
+}
+
+void patient_records::clear() {
+    u_int64_t lsn;
+    {
+        auto lock = store.write_lock();
+        begin();
+        changes++;
+        lsn = store.clear();
+        index.clear();
+
+        for (patient_listener* listener : listeners) {
+            listener->on_clear();
+            listener->on_commit(false);
+        }
+    }
+    store.settle(lsn);
+}
+
+void patient_records::add_listener(patient_listener* p_listener, bool p_replay) {
+    auto lock = store.write_lock();
+    listeners.push_back(p_listener);
+    if (p_replay) {
+        patient p;
+        for (const patient_hot& row : store.all()) {
+            store.load(row, p);
+            p_listener->on_upsert(p);
+        }
+        p_listener->on_commit(true);
+    }
+}
+
+void patient_records::remove_listener(patient_listener* p_listener) {
+    auto lock = store.write_lock();
+    listeners.erase(std::remove(listeners.begin(), listeners.end(), p_listener), listeners.end());
+}
+
+std::string describe_patient(const patient& p_patient) {
+    std::string line = "#" + std::to_string(p_patient.id) + " " + p_patient.name;
+    line += std::string(", ") + gender_name(p_patient.gender);
+    if (p_patient.age) {
+        line += ", " + std::to_string(p_patient.age);
+    }
+    if (p_patient.date_of_birth) {
+        line += ", born " + format_date(p_patient.date_of_birth);
+    }
+    if (!p_patient.email.empty()) {
+        line += ", " + p_patient.email;
+    }
+    if (p_patient.number) {
+        line += ", phone " + std::to_string(p_patient.number);
+    }
+    if (!p_patient.address.empty()) {
+        line += ", lives at " + p_patient.address;
+    }
+    return line;
+}
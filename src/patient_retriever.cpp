@@ -0,0 +1,87 @@
+#include "util/clinic/patient_retriever.hpp"
+#include "util/llm/tokenizer.hpp"
+#include <chrono>
+
+patient_retriever::patient_retriever(patient_records& p_records, const retriever_config& p_config)
+    : records(p_records), cfg(p_config) {
+    records.add_listener(this);
+}
+
+patient_retriever::~patient_retriever() {
+    records.remove_listener(this);
+}
+
+void patient_retriever::on_upsert(const patient& p_patient) {
+    std::string id = std::to_string(p_patient.id);
+    std::string number = p_patient.number ? std::to_string(p_patient.number) : "";
+    std::string born = format_date(p_patient.date_of_birth);
+
+    index.add(p_patient.id, {
+        {p_patient.name, 3.0f},
+        {id, 2.0f},
+        {number, 2.0f},
+        {p_patient.email, 1.5f},
+        {born, 1.0f},
+        {p_patient.address, 1.0f},
+        {gender_name(p_patient.gender), 0.5f}
+    });
+}
+
+void patient_retriever::on_remove(u_int64_t p_id) {
+    index.remove(p_id);
+}
+
+void patient_retriever::on_clear() {
+    index.clear();
+}
+
+std::vector<u_int64_t> patient_retriever::match(const std::string& p_query, size_t p_k) const {
+    std::vector<std::pair<u_int64_t, float>> hits = index.search(p_query, p_k);
+    std::vector<u_int64_t> ids;
+    ids.reserve(hits.size());
+    for (const auto& [id, score] : hits) {
+        if (score >= hits.front().second * cfg.min_relative_score) {
+            ids.push_back(id);
+        }
+    }
+    return ids;
+}
+
+std::vector<u_int64_t> patient_retriever::search(const std::string& p_query) {
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<u_int64_t> ids = match(p_query, cfg.top_k);
+
+    last_hits = ids.size();
+    last_lookup_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    return ids;
+}
+
+std::string patient_retriever::augment(const std::string& p_query) {
+    std::vector<u_int64_t> ids = search(p_query);
+    if (ids.empty()) {
+        return p_query;
+    }
+
+    std::string context = "Clinic records that may be relevant:\n";
+    size_t tokens = count_tokens(context);
+    patient p;
+    for (u_int64_t id : ids) {
+        if (!records.get(id, p)) {
+            continue;
+        }
+        std::string line = "- " + describe_patient(p) + "\n";
+        size_t line_tokens = count_tokens(line);
+        if (tokens + line_tokens > cfg.max_tokens) {
+            break; // Best matches come first, the rest can go
+        }
+        context += line;
+        tokens += line_tokens;
+    }
+
+    return context + "\nQuestion: " + p_query;
+}
+
+retriever_stats patient_retriever::stats() const {
+    return {index.size(), index.terms(), last_hits, last_lookup_us};
+}
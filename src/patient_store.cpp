@@ -0,0 +1,1191 @@
+#include "util/clinic/patient_store.hpp"
+#include "util/clinic/patient_fields.hpp"
+#include "util/hash.hpp"
+#include <SDL3/SDL_log.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <initializer_list>
+#include <limits>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace {
+
+constexpr char STORE_MAGIC[8] = {'A', 'V', 'A', 'P', 'A', 'T', '0', '2'};
+constexpr char LEGACY_MAGIC[8] = {'A', 'V', 'A', 'P', 'A', 'T', '0', '1'};
+constexpr u_int32_t STORE_VERSION = 2;
+constexpr u_int32_t FRAME_MAGIC = 0x32574150;        // "PAW2"
+constexpr u_int32_t LEGACY_FRAME_MAGIC = 0x4C415750; // "PWAL"
+constexpr size_t MAX_ARENA = std::numeric_limits<u_int32_t>::max(); // string_ref offsets are 32 bit
+constexpr size_t MIN_ARENA = 64 << 10;
+
+const char* const STORE_FILES[] = {PATIENT_STORE_DATA, PATIENT_STORE_COLD, PATIENT_STORE_STRINGS};
+
+static_assert(sizeof(patient_hot) == 24 && sizeof(patient_cold) == 24, "Column rows are part of the file format");
+
+// Version 1 layout, only read to migrate it
+typedef struct legacy_header {
+    char magic[8];
+    u_int32_t version;
+    u_int32_t record_size;
+    u_int64_t count;
+    u_int64_t capacity;
+    u_int64_t checkpoint_lsn;
+} legacy_header;
+
+typedef struct legacy_frame {
+    u_int32_t magic;
+    u_int32_t has_image;
+    u_int64_t lsn;
+    u_int64_t slot;
+    u_int64_t count;
+    u_int64_t checksum;
+} legacy_frame;
+
+typedef std::chrono::steady_clock clock_type;
+
+double elapsed_ms(clock_type::time_point p_since) {
+    return std::chrono::duration<double, std::milli>(clock_type::now() - p_since).count();
+}
+
+bool write_all(int p_fd, const void* p_data, size_t p_len, off_t p_offset = -1) {
+    const char* at = static_cast<const char*>(p_data);
+    while (p_len > 0) {
+        ssize_t n = p_offset < 0 ? ::write(p_fd, at, p_len) : ::pwrite(p_fd, at, p_len, p_offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        at += n;
+        p_len -= static_cast<size_t>(n);
+        if (p_offset >= 0) {
+            p_offset += n;
+        }
+    }
+    return true;
+}
+
+std::string read_all(int p_fd) {
+    std::string data;
+    char buffer[1 << 16];
+    ssize_t n;
+    off_t offset = 0;
+    while ((n = ::pread(p_fd, buffer, sizeof(buffer), offset)) > 0 || (n < 0 && errno == EINTR)) {
+        if (n > 0) {
+            data.append(buffer, static_cast<size_t>(n));
+            offset += n;
+        }
+    }
+    return data;
+}
+
+// A whole file under a new name, on disk before it's renamed over anything. Sealed if p_key is set
+bool write_file(const std::string& p_path, std::initializer_list<std::pair<const void*, size_t>> p_parts,
+                const seal_key& p_key = {}) {
+    if (p_key.set) {
+        ::unlink(p_path.c_str());
+        sealed_file file;
+        bool ok = file.open(p_path, p_key);
+        u_int64_t offset = 0;
+        for (const auto& [data, size] : p_parts) {
+            ok = ok && (size == 0 || file.write(offset, data, size));
+            offset += size;
+        }
+        return file.close() && ok;
+    }
+
+    int fd = ::open(p_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = true;
+    off_t offset = 0;
+    for (const auto& [data, size] : p_parts) {
+        ok = ok && (size == 0 || write_all(fd, data, size, offset));
+        offset += static_cast<off_t>(size);
+    }
+    ok = ok && ::fdatasync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+// Renames and new files only survive a crash once their directory is synced
+bool sync_dir(const std::string& p_dir) {
+    int fd = ::open(p_dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+std::string path_in(const std::string& p_dir, const char* p_name) {
+    return (std::filesystem::path(p_dir) / p_name).string();
+}
+
+// Private copies of [p_from, p_to) of a mapping, once the file holds the same bytes
+void drop_pages(char* p_data, size_t p_from, size_t p_to) {
+    const uintptr_t page_mask = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE)) - 1;
+    uintptr_t begin = reinterpret_cast<uintptr_t>(p_data + p_from) & ~page_mask;
+    uintptr_t end = reinterpret_cast<uintptr_t>(p_data + p_to);
+    ::madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED);
+}
+
+} // namespace
+
+patient_store::~patient_store() {
+    close();
+}
+
+bool patient_store::grow(region& p_region, size_t p_bytes) {
+    if (p_bytes <= p_region.bytes) {
+        return true;
+    }
+
+    // The file has to cover the whole mapping, touching a page past its end is SIGBUS
+    struct stat info;
+    off_t needed = p_region.offset + static_cast<off_t>(p_bytes);
+    if (p_region.fd >= 0 && (::fstat(p_region.fd, &info) != 0 ||
+                             (info.st_size < needed && ::ftruncate(p_region.fd, needed) != 0))) {
+        SDL_Log("patient_store: couldn't grow a file to %zu bytes: %s", p_bytes, std::strerror(errno));
+        return false;
+    }
+
+    void* mapped;
+    if (p_region.data) {
+        // Keeps the private (not yet checkpointed) pages
+        mapped = ::mremap(p_region.data, p_region.bytes, p_bytes, MREMAP_MAYMOVE);
+    } else if (p_region.fd >= 0) {
+        mapped = ::mmap(nullptr, p_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, p_region.fd, p_region.offset);
+    } else {
+        mapped = ::mmap(nullptr, p_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+    if (mapped == MAP_FAILED) {
+        SDL_Log("patient_store: couldn't map %zu bytes: %s", p_bytes, std::strerror(errno));
+        return false;
+    }
+
+    p_region.data = static_cast<char*>(mapped);
+    p_region.bytes = p_bytes;
+    if (p_region.on_demand) {
+        // Chunks the file holds wait for fault_in(), the ones past its end start out zero
+        size_t chunk = p_region.sealed->chunk_size();
+        size_t chunks = (static_cast<size_t>(p_region.offset) + p_bytes + chunk - 1) / chunk;
+        auto loaded = std::make_unique<std::atomic<bool>[]>(chunks);
+        for (size_t i = 0; i < chunks; i++) {
+            loaded[i] = i < p_region.chunks ? p_region.loaded[i].load() : i * chunk >= p_region.sealed->size();
+        }
+        p_region.loaded = std::move(loaded);
+        p_region.chunks = chunks;
+    }
+    return true;
+}
+
+bool patient_store::read_file(region& p_region, u_int64_t p_offset, void* p_out, size_t p_bytes) {
+    if (p_region.sealed) {
+        return p_region.sealed->read(p_offset, p_out, p_bytes);
+    }
+    return ::pread(p_region.fd, p_out, p_bytes, static_cast<off_t>(p_offset)) == static_cast<ssize_t>(p_bytes);
+}
+
+void patient_store::fault_in(const region& p_region, size_t p_from, size_t p_to) const {
+    if (p_region.chunks == 0 || p_from >= p_to) {
+        return;
+    }
+
+    size_t chunk = p_region.sealed->chunk_size();
+    size_t last = std::min((static_cast<size_t>(p_region.offset) + p_to - 1) / chunk, p_region.chunks - 1);
+    for (size_t i = (static_cast<size_t>(p_region.offset) + p_from) / chunk; i <= last; i++) {
+        if (p_region.loaded[i].load(std::memory_order_acquire)) {
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(seal_mutex);
+        if (p_region.loaded[i].load(std::memory_order_relaxed)) {
+            continue;
+        }
+        u_int64_t begin = std::max<u_int64_t>(i * chunk, p_region.offset);
+        u_int64_t end = std::min<u_int64_t>({(i + 1) * chunk, p_region.sealed->size(),
+                                             p_region.offset + p_region.bytes});
+        if (begin < end && !p_region.sealed->read(begin, p_region.data + (begin - p_region.offset), end - begin)) {
+            SDL_Log("patient_store: couldn't decrypt a chunk of %s, checkpoints stop", dir.c_str());
+            unreadable = true;
+        }
+        p_region.loaded[i].store(true, std::memory_order_release);
+    }
+}
+
+bool patient_store::write_back(region& p_region, size_t p_from, size_t p_to) {
+    u_int64_t begin = p_region.offset + p_from;
+    u_int64_t end = p_region.offset + p_to;
+    if (!p_region.sealed) {
+        return write_all(p_region.fd, p_region.data + p_from, p_to - p_from, static_cast<off_t>(begin));
+    }
+    if (unreadable) {
+        return false;
+    }
+
+    // Widened to whole chunks (within the mapping and the file) so none has to be decrypted first
+    u_int64_t chunk = p_region.sealed->chunk_size();
+    u_int64_t limit = std::min<u_int64_t>(p_region.sealed->size(), p_region.offset + p_region.bytes);
+    begin = std::max<u_int64_t>(begin / chunk * chunk, p_region.offset);
+    end = std::max(end, std::min((end + chunk - 1) / chunk * chunk, limit));
+    fault_in(p_region, begin - p_region.offset, end - p_region.offset);
+    std::lock_guard<std::mutex> lock(seal_mutex);
+    return p_region.sealed->write(begin, p_region.data + (begin - p_region.offset), end - begin);
+}
+
+bool patient_store::sync_file(region& p_region) {
+    if (!p_region.sealed) {
+        return ::fdatasync(p_region.fd) == 0;
+    }
+    std::lock_guard<std::mutex> lock(seal_mutex);
+    return p_region.sealed->sync();
+}
+
+bool patient_store::reserve(size_t p_slots) {
+    if (p_slots <= capacity) {
+        return true;
+    }
+
+    size_t grown = std::max({p_slots, capacity * 2, static_cast<size_t>(1024)});
+    if (!grow(hot_column, grown * sizeof(patient_hot)) || !grow(cold_column, grown * sizeof(patient_cold))) {
+        return false;
+    }
+    capacity = grown;
+    dirty_mark.resize(capacity, false);
+    return true;
+}
+
+bool patient_store::intern(const std::string& p_text, string_ref p_old, string_ref& p_ref) {
+    if (text(p_old) == p_text) {
+        p_ref = p_old; // Unchanged, nothing new in the arena
+        return true;
+    }
+    if (p_text.empty()) {
+        p_ref = {0, 0};
+        return true;
+    }
+
+    size_t end = arena_bytes + p_text.size();
+    if (end > MAX_ARENA) {
+        SDL_Log("patient_store: the string arena is full");
+        return false;
+    }
+    if (end > arena.bytes && !grow(arena, std::max({end, arena.bytes * 2, MIN_ARENA}))) {
+        return false;
+    }
+
+    fault_in(arena, arena_bytes, end);
+    std::memcpy(arena.data + arena_bytes, p_text.data(), p_text.size());
+    p_ref = {static_cast<u_int32_t>(arena_bytes), static_cast<u_int32_t>(p_text.size())};
+    arena_bytes = end;
+    return true;
+}
+
+std::string_view patient_store::text(string_ref p_ref) const {
+    if (static_cast<size_t>(p_ref.offset) + p_ref.length > arena_bytes) {
+        return {};
+    }
+    fault_in(arena, p_ref.offset, static_cast<size_t>(p_ref.offset) + p_ref.length);
+    return {arena.data + p_ref.offset, p_ref.length};
+}
+
+void patient_store::load(const patient_hot& p_row, patient& p_patient) const {
+    const patient_cold& extra = cold(p_row);
+    p_patient.id = p_row.id;
+    p_patient.name.assign(text(p_row.name));
+    p_patient.date_of_birth = p_row.date_of_birth;
+    p_patient.gender = p_row.gender;
+    p_patient.age = p_row.age;
+    p_patient.number = extra.number;
+    p_patient.email.assign(text(extra.email));
+    p_patient.address.assign(text(extra.address));
+}
+
+void patient_store::index() const {
+    if (indexed.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(index_mutex);
+    if (indexed.load(std::memory_order_relaxed)) {
+        return;
+    }
+    // Only reads the hot column, 24 bytes per record
+    const patient_hot* rows = hot_rows();
+    slot_of.clear();
+    slot_of.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        slot_of.assign(rows[i].id, i);
+    }
+    indexed.store(true, std::memory_order_release);
+}
+
+const patient_hot* patient_store::find(u_int64_t p_id) const {
+    index();
+    u_int64_t slot;
+    return slot_of.find(p_id, slot) ? &hot_rows()[slot] : nullptr;
+}
+
+u_int64_t patient_store::log(u_int64_t p_slot, u_int64_t p_count, size_t p_strings_from) {
+    if (p_slot != NO_SLOT && !dirty_mark[p_slot]) {
+        dirty_mark[p_slot] = true;
+        dirty.push_back(p_slot);
+    }
+
+    std::unique_lock<std::mutex> lock(wal_mutex);
+    u_int64_t lsn = next_lsn++;
+    logged_lsn = lsn;
+    if (!logging()) {
+        durable_lsn = lsn; // Memory only, nothing to wait for
+        return lsn;
+    }
+    if (failed) {
+        return lsn; // Memory only from here on
+    }
+
+    wal_frame frame = {FRAME_MAGIC, p_slot != NO_SLOT, lsn, p_slot, p_count, arena_bytes,
+                       arena_bytes - p_strings_from, 0};
+    u_int64_t checksum = hash64(&frame, sizeof(frame));
+    if (frame.has_image) {
+        checksum = hash64(&hot_rows()[p_slot], sizeof(patient_hot), checksum);
+        checksum = hash64(&cold_rows()[p_slot], sizeof(patient_cold), checksum);
+    }
+    if (frame.strings) {
+        checksum = hash64(arena.data + p_strings_from, frame.strings, checksum);
+    }
+    frame.checksum = checksum;
+
+    frames++;
+    pending.append(reinterpret_cast<const char*>(&frame), sizeof(frame));
+    if (frame.has_image) {
+        pending.append(reinterpret_cast<const char*>(&hot_rows()[p_slot]), sizeof(patient_hot));
+        pending.append(reinterpret_cast<const char*>(&cold_rows()[p_slot]), sizeof(patient_cold));
+    }
+    if (frame.strings) {
+        pending.append(arena.data + p_strings_from, frame.strings);
+    }
+    wal_cv.notify_one();
+    lock.unlock();
+
+    // A compaction the flusher found due. Only the writer may remap, the
+    // frame above is in the WAL first so recovery skips it
+    if (compact_due.exchange(false)) {
+        rewrite();
+    }
+    return lsn;
+}
+
+u_int64_t patient_store::upsert(const patient& p_patient) {
+    index();
+
+    u_int64_t slot;
+    bool existing = slot_of.find(p_patient.id, slot);
+    if (!existing && !reserve(count + 1)) {
+        return 0;
+    }
+    if (!existing) {
+        slot = count;
+    }
+
+    patient_hot old_row = {};
+    patient_cold old_extra = {};
+    if (existing) {
+        old_row = hot_rows()[slot];
+        old_extra = cold_at(slot);
+    }
+
+    size_t strings_from = arena_bytes;
+    patient_hot row = {p_patient.id, {0, 0}, p_patient.date_of_birth, p_patient.gender, p_patient.age, 0};
+    patient_cold extra = {p_patient.number, {0, 0}, {0, 0}};
+    if (!intern(p_patient.name, old_row.name, row.name) ||
+        !intern(p_patient.email, old_extra.email, extra.email) ||
+        !intern(p_patient.address, old_extra.address, extra.address)) {
+        arena_bytes = strings_from;
+        return 0;
+    }
+    live_bytes += row.name.length + extra.email.length + extra.address.length;
+    live_bytes -= old_row.name.length + old_extra.email.length + old_extra.address.length;
+
+    hot_rows()[slot] = row;
+    cold_at(slot) = extra;
+    if (!existing) {
+        count++;
+        slot_of.assign(p_patient.id, slot);
+    }
+    return log(slot, count, strings_from);
+}
+
+u_int64_t patient_store::remove(u_int64_t p_id, bool& p_removed) {
+    index();
+
+    u_int64_t slot;
+    p_removed = slot_of.find(p_id, slot);
+    if (!p_removed) {
+        return 0;
+    }
+
+    slot_of.erase(p_id);
+    const patient_cold& extra = cold_at(slot);
+    live_bytes -= hot_rows()[slot].name.length + extra.email.length + extra.address.length;
+    count--;
+
+    if (slot == count) {
+        return log(NO_SLOT, count, arena_bytes);
+    }
+    hot_rows()[slot] = hot_rows()[count];
+    cold_at(slot) = cold_at(count);
+    slot_of.assign(hot_rows()[slot].id, slot);
+    return log(slot, count, arena_bytes);
+}
+
+u_int64_t patient_store::clear() {
+    std::lock_guard<std::mutex> lock(index_mutex);
+    count = 0;
+    arena_bytes = arena_synced = live_bytes = 0;
+    slot_of.clear();
+    indexed.store(true, std::memory_order_release);
+    return log(NO_SLOT, 0, 0);
+}
+
+void patient_store::apply(const wal_frame& p_frame, const char* p_payload) {
+    if (p_frame.has_image) {
+        if (!reserve(p_frame.slot + 1)) {
+            return;
+        }
+        std::memcpy(&hot_rows()[p_frame.slot], p_payload, sizeof(patient_hot));
+        std::memcpy(&cold_at(p_frame.slot), p_payload + sizeof(patient_hot), sizeof(patient_cold));
+        p_payload += sizeof(patient_hot) + sizeof(patient_cold);
+        if (!dirty_mark[p_frame.slot]) {
+            dirty_mark[p_frame.slot] = true;
+            dirty.push_back(p_frame.slot);
+        }
+    }
+
+    size_t from = p_frame.arena_bytes - p_frame.strings;
+    if (p_frame.strings) {
+        if (!grow(arena, std::max<size_t>(p_frame.arena_bytes, MIN_ARENA))) {
+            return;
+        }
+        fault_in(arena, from, p_frame.arena_bytes);
+        std::memcpy(arena.data + from, p_payload, p_frame.strings);
+    }
+    arena_bytes = std::min<size_t>(p_frame.arena_bytes, arena.bytes);
+    arena_synced = std::min(arena_synced, from);
+    count = std::min<size_t>(p_frame.count, capacity);
+}
+
+bool patient_store::replay(const std::string& p_log) {
+    const std::string& log_data = p_log;
+    size_t at = 0;
+    u_int64_t last_lsn = 0;
+    while (at + sizeof(wal_frame) <= log_data.size()) {
+        wal_frame frame;
+        std::memcpy(&frame, log_data.data() + at, sizeof(frame));
+        size_t images = frame.has_image ? sizeof(patient_hot) + sizeof(patient_cold) : 0;
+        if (frame.magic != FRAME_MAGIC || frame.has_image > 1 || frame.arena_bytes > MAX_ARENA ||
+            frame.strings > frame.arena_bytes || at + sizeof(frame) + images + frame.strings > log_data.size()) {
+            break;
+        }
+
+        const char* payload = log_data.data() + at + sizeof(frame);
+        u_int64_t checksum = frame.checksum;
+        frame.checksum = 0;
+        u_int64_t expected = hash64(&frame, sizeof(frame));
+        if (frame.has_image) {
+            expected = hash64(payload, sizeof(patient_hot), expected);
+            expected = hash64(payload + sizeof(patient_hot), sizeof(patient_cold), expected);
+        }
+        if (frame.strings) {
+            expected = hash64(payload + images, frame.strings, expected);
+        }
+        if (checksum != expected || frame.lsn <= last_lsn) {
+            break; // Torn write at the tail
+        }
+
+        // Older frames are left over from a checkpoint that crashed before emptying the WAL
+        if (frame.lsn > checkpoint_lsn) {
+            apply(frame, payload);
+            recovered++;
+        }
+        last_lsn = frame.lsn;
+        at += sizeof(frame) + images + frame.strings;
+    }
+
+    if (at < log_data.size()) {
+        // A sealed_log already dropped torn records, what's left can't be cut
+        // inside one; the checkpoint open() makes empties it
+        SDL_Log("patient_store: dropping %zu bytes of torn WAL", log_data.size() - at);
+        if (wal_fd >= 0 && ::ftruncate(wal_fd, static_cast<off_t>(at)) != 0) {
+            return false;
+        }
+    }
+
+    if (recovered > 0) {
+        const patient_hot* rows = hot_rows();
+        live_bytes = 0;
+        for (size_t i = 0; i < count; i++) {
+            const patient_cold& extra = cold_at(i);
+            live_bytes += rows[i].name.length + extra.email.length + extra.address.length;
+        }
+    }
+
+    last_lsn = std::max(last_lsn, checkpoint_lsn);
+    next_lsn = last_lsn + 1;
+    logged_lsn = durable_lsn = last_lsn;
+    wal_bytes = at;
+    return true;
+}
+
+bool patient_store::migrate(const std::string& p_path) {
+    int fd = ::open(p_path.c_str(), O_RDONLY | O_CLOEXEC);
+    legacy_header header = {};
+    struct stat info;
+    if (fd < 0 || ::pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+        header.record_size != sizeof(legacy_patient) || ::fstat(fd, &info) != 0) {
+        SDL_Log("patient_store: %s isn't a version 1 store this build can read", p_path.c_str());
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return false;
+    }
+
+    size_t file_slots = info.st_size > static_cast<off_t>(HEADER_SIZE) ?
+        (static_cast<size_t>(info.st_size) - HEADER_SIZE) / sizeof(legacy_patient) : 0;
+    legacy_patient* mapped = nullptr;
+    if (file_slots > 0) {
+        void* data = ::mmap(nullptr, file_slots * sizeof(legacy_patient), PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                            fd, HEADER_SIZE);
+        if (data == MAP_FAILED) {
+            SDL_Log("patient_store: couldn't map %s: %s", p_path.c_str(), std::strerror(errno));
+            ::close(fd);
+            return false;
+        }
+        mapped = static_cast<legacy_patient*>(data);
+    }
+
+    std::vector<legacy_patient> extra; // Slots the WAL appended past the file
+    auto slot = [&](u_int64_t p_slot) -> legacy_patient& {
+        if (p_slot < file_slots) {
+            return mapped[p_slot];
+        }
+        if (p_slot - file_slots >= extra.size()) {
+            extra.resize(p_slot - file_slots + 1, legacy_patient{});
+        }
+        return extra[p_slot - file_slots];
+    };
+
+    // What the version 1 WAL still held, same rules as replay()
+    int log_fd = ::open(path_in(dir, PATIENT_STORE_WAL).c_str(), O_RDONLY | O_CLOEXEC);
+    std::string log_data = log_fd >= 0 ? read_all(log_fd) : "";
+    if (log_fd >= 0) {
+        ::close(log_fd);
+    }
+
+    size_t records = std::min<size_t>(header.count, file_slots);
+    u_int64_t last_lsn = 0;
+    for (size_t at = 0; at + sizeof(legacy_frame) <= log_data.size();) {
+        legacy_frame frame;
+        std::memcpy(&frame, log_data.data() + at, sizeof(frame));
+        size_t length = sizeof(frame) + (frame.has_image ? sizeof(legacy_patient) : 0);
+        if (frame.magic != LEGACY_FRAME_MAGIC || frame.has_image > 1 || at + length > log_data.size()) {
+            break;
+        }
+
+        const char* image = log_data.data() + at + sizeof(frame);
+        u_int64_t checksum = frame.checksum;
+        frame.checksum = 0;
+        u_int64_t expected = hash64(&frame, sizeof(frame));
+        if (frame.has_image) {
+            expected = hash64(image, sizeof(legacy_patient), expected);
+        }
+        if (checksum != expected || frame.lsn <= last_lsn) {
+            break;
+        }
+
+        if (frame.lsn > header.checkpoint_lsn) {
+            if (frame.has_image) {
+                std::memcpy(&slot(frame.slot), image, sizeof(legacy_patient));
+            }
+            records = std::min<size_t>(frame.count, file_slots + extra.size());
+        }
+        last_lsn = frame.lsn;
+        at += length;
+    }
+
+    // Into this (still memory only) store, the caller writes it out
+    patient record;
+    size_t undated = 0;
+    for (size_t i = 0; i < records; i++) {
+        if (!from_legacy(slot(i), record)) {
+            undated++;
+        }
+        upsert(record);
+    }
+    if (undated > 0) {
+        SDL_Log("patient_store: %zu dates of birth weren't YYYY-MM-DD and were left out", undated);
+    }
+
+    if (mapped) {
+        ::munmap(mapped, file_slots * sizeof(legacy_patient));
+    }
+    ::close(fd);
+
+    last_lsn = std::max<u_int64_t>(last_lsn, header.checkpoint_lsn);
+    next_lsn = last_lsn + 1;
+    logged_lsn = durable_lsn = last_lsn;
+    migrated = count;
+    return true;
+}
+
+bool patient_store::map_files() {
+    std::string data_path = path_in(dir, PATIENT_STORE_DATA);
+    std::string cold_path = path_in(dir, PATIENT_STORE_COLD);
+    std::string arena_path = path_in(dir, PATIENT_STORE_STRINGS);
+    hot_column.offset = HEADER_SIZE;
+    u_int64_t hot_size = 0, cold_size = 0, arena_size = 0;
+    if (cfg.key.set) {
+        if (!hot_file.open(data_path, cfg.key) || !cold_file.open(cold_path, cfg.key) ||
+            !arena_file.open(arena_path, cfg.key)) {
+            SDL_Log("patient_store: couldn't open the encrypted store in %s", dir.c_str());
+            return false;
+        }
+        hot_column.sealed = &hot_file;
+        cold_column.sealed = &cold_file;
+        arena.sealed = &arena_file;
+        cold_column.on_demand = arena.on_demand = true;
+        hot_size = hot_file.size();
+        cold_size = cold_file.size();
+        arena_size = arena_file.size();
+    } else {
+        hot_column.fd = ::open(data_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        cold_column.fd = ::open(cold_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        arena.fd = ::open(arena_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        if (hot_column.fd < 0 || cold_column.fd < 0 || arena.fd < 0) {
+            SDL_Log("patient_store: couldn't open %s: %s", dir.c_str(), std::strerror(errno));
+            return false;
+        }
+
+        struct stat hot_info, cold_info, arena_info;
+        ::fstat(hot_column.fd, &hot_info);
+        ::fstat(cold_column.fd, &cold_info);
+        ::fstat(arena.fd, &arena_info);
+        hot_size = static_cast<u_int64_t>(hot_info.st_size);
+        cold_size = static_cast<u_int64_t>(cold_info.st_size);
+        arena_size = static_cast<u_int64_t>(arena_info.st_size);
+    }
+
+    store_header header = {};
+    if (hot_size == 0) {
+        if ((hot_column.fd >= 0 && ::ftruncate(hot_column.fd, HEADER_SIZE) != 0) || !write_header()) {
+            SDL_Log("patient_store: couldn't initialize %s", data_path.c_str());
+            return false;
+        }
+        hot_size = HEADER_SIZE;
+    } else if (hot_size < HEADER_SIZE || !read_file(hot_column, 0, &header, sizeof(header)) ||
+               std::memcmp(header.magic, STORE_MAGIC, sizeof(STORE_MAGIC)) != 0 ||
+               header.version != STORE_VERSION || header.hot_size != sizeof(patient_hot) ||
+               header.cold_size != sizeof(patient_cold)) {
+        SDL_Log("patient_store: %s isn't a patient store this build can read", data_path.c_str());
+        return false;
+    }
+
+    // Whatever the files hold is mapped as is, pages are only read when touched.
+    // Encrypted, the hot column is decrypted into memory here, the rest by fault_in()
+    size_t slots = std::min(static_cast<size_t>(hot_size - HEADER_SIZE) / sizeof(patient_hot),
+                            static_cast<size_t>(cold_size) / sizeof(patient_cold));
+    if (slots > 0 && (!grow(hot_column, slots * sizeof(patient_hot)) ||
+                      !grow(cold_column, slots * sizeof(patient_cold)))) {
+        return false;
+    }
+    if (arena_size > 0 && !grow(arena, static_cast<size_t>(arena_size))) {
+        return false;
+    }
+    if (cfg.key.set && !read_file(hot_column, HEADER_SIZE, hot_column.data, slots * sizeof(patient_hot))) {
+        SDL_Log("patient_store: couldn't decrypt %s", dir.c_str());
+        return false;
+    }
+
+    capacity = slots;
+    dirty_mark.assign(capacity, false);
+    count = std::min<size_t>(header.count, capacity);
+    arena_bytes = arena_synced = std::min<size_t>(header.arena_bytes, arena.bytes);
+    live_bytes = std::min<size_t>(header.live_bytes, arena_bytes);
+    checkpoint_lsn = header.checkpoint_lsn;
+    unreadable = false;
+    indexed.store(false);
+    return true;
+}
+
+void patient_store::unmap() {
+    for (region* mapping : {&hot_column, &cold_column, &arena}) {
+        if (mapping->data) {
+            ::munmap(mapping->data, mapping->bytes);
+        }
+        if (mapping->fd >= 0) {
+            ::close(mapping->fd);
+        }
+        if (mapping->sealed) {
+            mapping->sealed->close();
+        }
+        *mapping = region{};
+    }
+
+    capacity = count = 0;
+    arena_bytes = arena_synced = live_bytes = 0;
+    dirty.clear();
+    dirty_mark.clear();
+    slot_of.clear();
+    indexed.store(true);
+}
+
+bool patient_store::finish_swap() {
+    std::error_code error;
+    for (const char* name : STORE_FILES) {
+        std::string target = path_in(dir, name);
+        std::string fresh = target + ".new";
+        if (::access(fresh.c_str(), F_OK) != 0) {
+            continue;
+        }
+        // An encrypted file's undo journal belongs to the old one, rolling the new one back with it would corrupt it
+        std::filesystem::remove(target + ".journal", error);
+        if (::rename(fresh.c_str(), target.c_str()) != 0) {
+            SDL_Log("patient_store: couldn't move %s into place: %s", fresh.c_str(), std::strerror(errno));
+            return false;
+        }
+    }
+
+    // Every rename is durable before the marker goes away
+    bool ok = sync_dir(dir);
+    ok = ok && std::filesystem::remove(path_in(dir, PATIENT_STORE_SWAP), error);
+    return ok && sync_dir(dir);
+}
+
+bool patient_store::rewrite() {
+    if (!sync_wal()) {
+        return false;
+    }
+    std::lock_guard<std::mutex> io(io_mutex);
+    auto start = clock_type::now();
+
+    // Live strings only, in record order
+    fault_in(cold_column, 0, count * sizeof(patient_cold));
+    std::vector<patient_hot> rows(hot_rows(), hot_rows() + count);
+    std::vector<patient_cold> extra(cold_rows(), cold_rows() + count);
+    std::string strings;
+    strings.reserve(live_bytes);
+    auto relocate = [this, &strings](string_ref& p_ref) {
+        std::string_view value = text(p_ref);
+        p_ref = {value.empty() ? 0 : static_cast<u_int32_t>(strings.size()), static_cast<u_int32_t>(value.size())};
+        strings.append(value);
+    };
+    for (size_t i = 0; i < count; i++) {
+        relocate(rows[i].name);
+        relocate(extra[i].email);
+        relocate(extra[i].address);
+    }
+
+    store_header header = {};
+    std::memcpy(header.magic, STORE_MAGIC, sizeof(STORE_MAGIC));
+    header.version = STORE_VERSION;
+    header.hot_size = sizeof(patient_hot);
+    header.cold_size = sizeof(patient_cold);
+    header.count = header.capacity = count;
+    header.arena_bytes = header.live_bytes = strings.size();
+    {
+        std::lock_guard<std::mutex> wal_lock(wal_mutex);
+        header.checkpoint_lsn = durable_lsn;
+    }
+    char page[HEADER_SIZE] = {};
+    std::memcpy(page, &header, sizeof(header));
+
+    std::string swap_path = path_in(dir, PATIENT_STORE_SWAP);
+    bool ok = write_file(path_in(dir, PATIENT_STORE_DATA) + ".new",
+                         {{page, sizeof(page)}, {rows.data(), rows.size() * sizeof(patient_hot)}}, cfg.key) &&
+              write_file(path_in(dir, PATIENT_STORE_COLD) + ".new",
+                         {{extra.data(), extra.size() * sizeof(patient_cold)}}, cfg.key) &&
+              write_file(path_in(dir, PATIENT_STORE_STRINGS) + ".new", {{strings.data(), strings.size()}}, cfg.key) &&
+              sync_dir(dir) && write_file(swap_path, {}) && sync_dir(dir);
+    if (!ok) {
+        SDL_Log("patient_store: couldn't write a compacted store: %s", std::strerror(errno));
+        std::error_code error;
+        std::filesystem::remove(swap_path, error);
+        for (const char* name : STORE_FILES) {
+            std::filesystem::remove(path_in(dir, name) + ".new", error);
+            std::filesystem::remove(path_in(dir, name) + ".new.journal", error);
+        }
+        return false;
+    }
+
+    // From the marker on, open() finishes the swap; WAL frames the new
+    // files already hold are skipped by their LSN
+    bool swapped = finish_swap();
+    swapped = swapped && reset_wal();
+    unmap();
+    if (!swapped || !map_files()) {
+        // Frames after this would describe the old layout, stop logging them
+        SDL_Log("patient_store: couldn't switch to the compacted store, changes are memory only now");
+        std::lock_guard<std::mutex> wal_lock(wal_mutex);
+        failed = true;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> wal_lock(wal_mutex);
+    wal_bytes = 0;
+    rewrites++;
+    last_sync_ms = elapsed_ms(start);
+    return true;
+}
+
+bool patient_store::open(const std::string& p_dir, const store_config& p_config) {
+    close();
+    auto start = clock_type::now();
+    auto lock = write_lock();
+
+    cfg = p_config;
+    dir = p_dir;
+
+    std::error_code error;
+    std::filesystem::create_directories(dir, error);
+
+    // A rewrite that got as far as its marker is finished, one that didn't is thrown away
+    bool ok = true;
+    if (::access(path_in(dir, PATIENT_STORE_SWAP).c_str(), F_OK) == 0) {
+        ok = finish_swap();
+    } else {
+        for (const char* name : STORE_FILES) {
+            std::filesystem::remove(path_in(dir, name) + ".new", error);
+        }
+    }
+
+    std::string data_path = path_in(dir, PATIENT_STORE_DATA);
+    char magic[8] = {};
+    int peek = ::open(data_path.c_str(), O_RDONLY | O_CLOEXEC);
+    bool existing = peek >= 0 && ::pread(peek, magic, sizeof(magic), 0) == static_cast<ssize_t>(sizeof(magic));
+    bool legacy = existing && std::memcmp(magic, LEGACY_MAGIC, sizeof(LEGACY_MAGIC)) == 0;
+    if (peek >= 0) {
+        ::close(peek);
+    }
+
+    bool encrypted = existing && is_sealed(data_path);
+    if (encrypted && !cfg.key.set) {
+        SDL_Log("patient_store: %s is encrypted, AVA_DATA_KEY or AVA_DATA_KEY_FILE has to be set", dir.c_str());
+        ok = false;
+    }
+    // A plaintext store is opened as it is, then rewritten encrypted below
+    bool encrypt = existing && !encrypted && cfg.key.set;
+    if (encrypt) {
+        cfg.key = {};
+    }
+
+    // Converted in memory (the WAL isn't open yet, nothing gets logged), then written out in columns
+    ok = ok && (!legacy || migrate(data_path));
+
+    std::string log_data;
+    ok = ok && open_wal(log_data);
+    ok = ok && (legacy ? rewrite() : map_files() && replay(log_data));
+    if (ok && encrypt) {
+        // rewrite() empties the WAL, which starts over encrypted
+        cfg.key = p_config.key;
+        ok = rewrite();
+        ::close(wal_fd);
+        wal_fd = -1;
+        ok = ok && open_wal(log_data);
+        if (ok) {
+            SDL_Log("patient_store: encrypted %s", dir.c_str());
+        }
+    }
+    if (!ok) {
+        SDL_Log("patient_store: couldn't open %s", dir.c_str());
+        lock.unlock();
+        close();
+        return false;
+    }
+    if (migrated > 0) {
+        SDL_Log("patient_store: migrated %llu records to the column layout", static_cast<unsigned long long>(migrated));
+    }
+    if (recovered > 0) {
+        SDL_Log("patient_store: recovered %llu changes from the WAL", static_cast<unsigned long long>(recovered));
+    }
+
+    stopping = false;
+    flusher = std::thread(&patient_store::flusher_main, this);
+    lock.unlock();
+
+    // Recovered changes, or frames the files already hold (a WAL whose
+    // checkpoint crashed, or that an encrypted one can't cut short)
+    if (recovered > 0 || wal_bytes > 0) {
+        checkpoint();
+    }
+    open_ms = elapsed_ms(start);
+    return true;
+}
+
+void patient_store::close() {
+    if (flusher.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(wal_mutex);
+            stopping = true;
+        }
+        wal_cv.notify_all();
+        flusher.join(); // Drains what's pending
+        checkpoint();
+    }
+
+    auto lock = write_lock();
+    unmap();
+    if (wal_fd >= 0) {
+        ::close(wal_fd);
+    }
+    wal_fd = -1;
+    wal_log.close();
+    checkpoint_lsn = 0;
+    dir.clear();
+
+    std::lock_guard<std::mutex> wal_lock(wal_mutex);
+    pending.clear();
+    next_lsn = 1;
+    logged_lsn = durable_lsn = wal_bytes = 0;
+    flush_requested = stopping = failed = false;
+    compact_due = false;
+    syncs = frames = checkpoints = rewrites = recovered = migrated = 0;
+}
+
+bool patient_store::open_wal(std::string& p_log) {
+    std::string path = path_in(dir, PATIENT_STORE_WAL);
+    if (!cfg.key.set) {
+        wal_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+        p_log = wal_fd >= 0 ? read_all(wal_fd) : "";
+        return wal_fd >= 0;
+    }
+
+    // Plaintext next to an encrypted store is left from the rewrite that
+    // encrypted it, crashed before emptying the WAL: the files hold all of it
+    std::error_code error;
+    if (std::filesystem::file_size(path, error) > 0 && !error && !is_sealed(path)) {
+        std::filesystem::resize_file(path, 0, error);
+    }
+    return wal_log.open(path, cfg.key, p_log);
+}
+
+bool patient_store::reset_wal() {
+    if (wal_log.is_open()) {
+        return wal_log.reset();
+    }
+    return ::ftruncate(wal_fd, 0) == 0 && ::fdatasync(wal_fd) == 0;
+}
+
+bool patient_store::sync_wal() {
+    std::lock_guard<std::mutex> io(io_mutex);
+
+    std::string batch;
+    u_int64_t upto;
+    {
+        std::lock_guard<std::mutex> lock(wal_mutex);
+        batch.swap(pending);
+        upto = logged_lsn;
+    }
+    if (batch.empty() || !logging()) {
+        return true;
+    }
+
+    auto start = clock_type::now();
+    bool ok = wal_fd >= 0 ? write_all(wal_fd, batch.data(), batch.size()) && ::fdatasync(wal_fd) == 0
+                          : wal_log.append(batch) && wal_log.sync();
+    if (!ok) {
+        SDL_Log("patient_store: WAL write failed: %s", std::strerror(errno));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(wal_mutex);
+        if (ok) {
+            durable_lsn = upto;
+            wal_bytes += batch.size();
+            syncs++;
+            last_sync_ms = elapsed_ms(start);
+        } else {
+            failed = true;
+        }
+    }
+    durable_cv.notify_all();
+    return ok;
+}
+
+void patient_store::flusher_main() {
+    std::unique_lock<std::mutex> lock(wal_mutex);
+    while (true) {
+        wal_cv.wait(lock, [this]() { return stopping || !pending.empty(); });
+        if (pending.empty() && stopping) {
+            break;
+        }
+
+        // Let the group fill up, unless someone is already waiting on it
+        if (!flush_requested && !stopping) {
+            wal_cv.wait_for(lock, std::chrono::milliseconds(cfg.commit_window_ms),
+                            [this]() { return stopping || flush_requested; });
+        }
+        flush_requested = false;
+        lock.unlock();
+
+        sync_wal();
+
+        lock.lock();
+        bool full = wal_bytes >= cfg.checkpoint_bytes;
+        lock.unlock();
+        if (full) {
+            write_checkpoint(false);
+        }
+        lock.lock();
+    }
+}
+
+void patient_store::settle(u_int64_t p_lsn) {
+    if (cfg.sync_commit && p_lsn) {
+        std::unique_lock<std::mutex> lock(wal_mutex);
+        flush_requested = true;
+        wal_cv.notify_all();
+        durable_cv.wait(lock, [this, p_lsn]() { return durable_lsn >= p_lsn || failed || !flusher.joinable(); });
+    }
+}
+
+bool patient_store::flush() {
+    if (!flusher.joinable()) {
+        return !failed;
+    }
+
+    std::unique_lock<std::mutex> lock(wal_mutex);
+    u_int64_t target = logged_lsn;
+    flush_requested = true;
+    wal_cv.notify_all();
+    durable_cv.wait(lock, [this, target]() { return durable_lsn >= target || failed; });
+    return !failed;
+}
+
+bool patient_store::write_header() {
+    store_header header = {};
+    std::memcpy(header.magic, STORE_MAGIC, sizeof(STORE_MAGIC));
+    header.version = STORE_VERSION;
+    header.hot_size = sizeof(patient_hot);
+    header.cold_size = sizeof(patient_cold);
+    header.count = count;
+    header.capacity = capacity;
+    header.arena_bytes = arena_bytes;
+    header.live_bytes = live_bytes;
+    header.checkpoint_lsn = checkpoint_lsn;
+    if (hot_column.sealed) {
+        // The whole page, a new file has to reach HEADER_SIZE
+        char page[HEADER_SIZE] = {};
+        std::memcpy(page, &header, sizeof(header));
+        return hot_file.write(0, page, hot_file.size() == 0 ? sizeof(page) : sizeof(header)) && hot_file.sync();
+    }
+    return write_all(hot_column.fd, &header, sizeof(header), 0) && ::fdatasync(hot_column.fd) == 0;
+}
+
+bool patient_store::checkpoint() {
+    return write_checkpoint(true);
+}
+
+bool patient_store::write_checkpoint(bool p_may_rewrite) {
+    std::lock_guard<std::mutex> guard(checkpoint_mutex);
+    auto lock = read_lock(); // Writers wait, readers carry on
+    if (!persistent()) {
+        return true;
+    }
+
+    // Once dead strings outweigh live ones, the store is written out compacted instead.
+    // That remaps the files under the writer thread's unlocked reads, so the
+    // flusher leaves it to the next change and checkpoints in place meanwhile
+    size_t dead = arena_bytes - live_bytes;
+    if (dead >= cfg.compact_bytes && dead > live_bytes) {
+        if (p_may_rewrite) {
+            lock.unlock();
+            auto exclusive = write_lock();
+            return !persistent() || rewrite();
+        }
+        compact_due = true;
+    }
+
+    // Everything we're about to write into the files has to be in the WAL first
+    if (!sync_wal()) {
+        return false;
+    }
+    std::lock_guard<std::mutex> io(io_mutex);
+
+    // Sorted so neighbouring rows go out in one pwrite. Encrypted, rows up
+    // to a chunk apart do too: every chunk they touch is sealed whole anyway
+    std::sort(dirty.begin(), dirty.end());
+    u_int64_t gap = hot_column.sealed ? hot_file.chunk_size() / sizeof(patient_hot) : 1;
+    std::vector<std::pair<u_int64_t, u_int64_t>> runs; // First slot, slot count
+    for (size_t i = 0; i < dirty.size();) {
+        size_t j = i + 1;
+        while (j < dirty.size() && dirty[j] - dirty[j - 1] <= gap) {
+            j++;
+        }
+        runs.push_back({dirty[i], dirty[j - 1] - dirty[i] + 1});
+        i = j;
+    }
+
+    bool ok = true;
+    for (const auto& [first, length] : runs) {
+        ok = ok && write_back(hot_column, first * sizeof(patient_hot), (first + length) * sizeof(patient_hot));
+        ok = ok && write_back(cold_column, first * sizeof(patient_cold), (first + length) * sizeof(patient_cold));
+    }
+    if (arena_synced < arena_bytes) {
+        ok = ok && write_back(arena, arena_synced, arena_bytes);
+    }
+    ok = ok && sync_file(hot_column) && sync_file(cold_column) && sync_file(arena);
+
+    u_int64_t previous = checkpoint_lsn;
+    {
+        std::lock_guard<std::mutex> wal_lock(wal_mutex);
+        checkpoint_lsn = durable_lsn;
+    }
+    // Only once the rows are durable does the header say the WAL isn't needed
+    ok = ok && write_header();
+    ok = ok && reset_wal();
+    if (!ok) {
+        checkpoint_lsn = previous;
+        SDL_Log("patient_store: checkpoint failed: %s", std::strerror(errno));
+        return false;
+    }
+
+    // The files are current now, drop our private copies of those pages
+    // (decrypted memory has no file behind it to fall back on, it stays)
+    for (const auto& [first, length] : runs) {
+        if (!hot_column.sealed) {
+            drop_pages(hot_column.data, first * sizeof(patient_hot), (first + length) * sizeof(patient_hot));
+            drop_pages(cold_column.data, first * sizeof(patient_cold), (first + length) * sizeof(patient_cold));
+        }
+    }
+    if (arena_synced < arena_bytes && !arena.sealed) {
+        drop_pages(arena.data, arena_synced, arena_bytes);
+    }
+    for (u_int64_t slot : dirty) {
+        dirty_mark[slot] = false;
+    }
+    dirty.clear();
+    arena_synced = arena_bytes;
+
+    std::lock_guard<std::mutex> wal_lock(wal_mutex);
+    wal_bytes = 0;
+    checkpoints++;
+    return true;
+}
+
+store_stats patient_store::stats() const {
+    std::lock_guard<std::mutex> lock(wal_mutex);
+    return {
+        logged_lsn, durable_lsn, syncs, frames, checkpoints, rewrites, wal_bytes, recovered, migrated,
+        arena_bytes, live_bytes, sizeof(patient_hot) + sizeof(patient_cold),
+        open_ms, last_sync_ms, persistent(), hot_column.sealed != nullptr, failed
+    };
+}
@@ -0,0 +1,207 @@
+#include "util/clinic/patient_tools.hpp"
+#include <algorithm>
+
+using json = nlohmann::json;
+
+namespace {
+
+constexpr size_t MAX_PAGE = 50; // Keeps any single tool result small
+
+json patient_json(const patient& p_patient) {
+    return {
+        {"id", p_patient.id},
+        {"name", p_patient.name},
+        {"gender", gender_name(p_patient.gender)},
+        {"age", p_patient.age},
+        {"date_of_birth", format_date(p_patient.date_of_birth)},
+        {"email", p_patient.email},
+        {"phone", p_patient.number},
+        {"address", p_patient.address}
+    };
+}
+
+// Hot column only
+json patient_brief(const patient_records& p_records, const patient_hot& p_row) {
+    return {
+        {"id", p_row.id},
+        {"name", p_records.text(p_row.name)},
+        {"date_of_birth", format_date(p_row.date_of_birth)}
+    };
+}
+
+size_t page_size(const json& p_args, size_t p_default) {
+    return std::min<size_t>(p_args.value("limit", p_default), MAX_PAGE);
+}
+
+} // namespace
+
+void register_patient_tools(llm_toolbox& p_toolbox, const patient_records& p_records, 
+                            const patient_retriever& p_retriever, const name_matcher& p_names) {
+    const patient_records* records = &p_records;
+    const patient_retriever* retriever = &p_retriever;
+    const name_matcher* names = &p_names;
+
+    p_toolbox.add({
+        "get_patient",
+        "Full record of one patient of the clinic: name, gender, age, date of birth, email, phone, address.",
+        {
+            {"type", "object"},
+            {"properties", {{"id", {{"type", "integer"}, {"description", "Patient id"}}}}},
+            {"required", {"id"}}
+        },
+        [records](const json& p_args) -> json {
+            u_int64_t id = p_args.at("id").get<u_int64_t>();
+            auto lock = records->read_lock();
+            patient p;
+            return records->get(id, p) ? patient_json(p) : json{{"error", "no patient with id " + std::to_string(id)}};
+        }
+    });
+
+    p_toolbox.add({
+        "search_patients",
+        "Finds patients by name, id, phone number, email, date of birth or address words. "
+        "Returns id, name and date of birth of the best matches, best first.",
+        {
+            {"type", "object"},
+            {"properties", {
+                {"query", {{"type", "string"}, {"description", "Words to look for, e.g. a name"}}},
+                {"limit", {{"type", "integer"}, {"description", "Most matches to return, default 5"}}}
+            }},
+            {"required", {"query"}}
+        },
+        [records, retriever](const json& p_args) -> json {
+            std::string query = p_args.at("query").get<std::string>();
+            size_t limit = page_size(p_args, 5);
+
+            auto lock = records->read_lock();
+            json matches = json::array();
+            for (u_int64_t id : retriever->match(query, limit)) {
+                if (const patient_hot* row = records->find(id)) {
+                    matches.push_back(patient_brief(*records, *row));
+                }
+            }
+            return {{"matches", std::move(matches)}};
+        }
+    });
+
+    p_toolbox.add({
+        "find_patients_by_name",
+        "Patients whose name has a word starting with the given text, e.g. \"mar\" or \"maria g\". "
+        "Returns id, name and date of birth.",
+        {
+            {"type", "object"},
+            {"properties", {
+                {"prefix", {{"type", "string"}, {"description", "Start of a first name, last name or full name"}}},
+                {"limit", {{"type", "integer"}, {"description", "Most patients to return, default 10, at most 50"}}}
+            }},
+            {"required", {"prefix"}}
+        },
+        [records](const json& p_args) -> json {
+            std::string prefix = p_args.at("prefix").get<std::string>();
+            size_t limit = page_size(p_args, 10);
+
+            auto lock = records->read_lock();
+            json matches = json::array();
+            for (u_int64_t id : records->with_name_prefix(prefix, limit)) {
+                if (const patient_hot* row = records->find(id)) {
+                    matches.push_back(patient_brief(*records, *row));
+                }
+            }
+            return {{"matches", std::move(matches)}};
+        }
+    });
+
+    p_toolbox.add({
+        "match_patient_name",
+        "Finds patients by a name that may be misspelled or misheard, e.g. \"Ode\" for Odeh. "
+        "Returns the closest names first with how many letters differ, plus id and date of birth.",
+        {
+            {"type", "object"},
+            {"properties", {
+                {"name", {{"type", "string"}, {"description", "The name as heard, first, last or both"}}},
+                {"limit", {{"type", "integer"}, {"description", "Most patients to return, default 5"}}}
+            }},
+            {"required", {"name"}}
+        },
+        [records, names](const json& p_args) -> json {
+            std::string name = p_args.at("name").get<std::string>();
+            size_t limit = page_size(p_args, 5);
+
+            auto lock = records->read_lock();
+            json matches = json::array();
+            for (const name_match& match : names->match(name, limit)) {
+                if (const patient_hot* row = records->find(match.id)) {
+                    json brief = patient_brief(*records, *row);
+                    brief["letters_differ"] = match.distance;
+                    matches.push_back(std::move(brief));
+                }
+            }
+            return {{"matches", std::move(matches)}};
+        }
+    });
+
+    p_toolbox.add({
+        "patients_born_between",
+        "Patients born between two dates, both included, oldest first: how many there are and the first few.",
+        {
+            {"type", "object"},
+            {"properties", {
+                {"from", {{"type", "string"}, {"description", "First date, YYYY-MM-DD"}}},
+                {"to", {{"type", "string"}, {"description", "Last date, YYYY-MM-DD"}}},
+                {"limit", {{"type", "integer"}, {"description", "Most patients to return, default 20, at most 50"}}}
+            }},
+            {"required", {"from", "to"}}
+        },
+        [records](const json& p_args) -> json {
+            u_int32_t from, to;
+            if (!parse_date(p_args.at("from").get<std::string>(), from) ||
+                !parse_date(p_args.at("to").get<std::string>(), to)) {
+                return {{"error", "dates must look like 1990-04-02"}};
+            }
+            size_t limit = page_size(p_args, 20);
+
+            auto lock = records->read_lock();
+            json page = json::array();
+            for (u_int64_t id : records->born_between(from, to, limit)) {
+                if (const patient_hot* row = records->find(id)) {
+                    page.push_back(patient_brief(*records, *row));
+                }
+            }
+            return {{"patients", std::move(page)}, {"total", records->count_born_between(from, to)}};
+        }
+    });
+
+    p_toolbox.add({
+        "list_patients",
+        "Pages through every patient of the clinic in storage order.",
+        {
+            {"type", "object"},
+            {"properties", {
+                {"offset", {{"type", "integer"}, {"description", "Patients to skip, default 0"}}},
+                {"limit", {{"type", "integer"}, {"description", "Page size, default 20, at most 50"}}}
+            }}
+        },
+        [records](const json& p_args) -> json {
+            size_t offset = p_args.value("offset", static_cast<size_t>(0));
+            size_t limit = page_size(p_args, 20);
+
+            auto lock = records->read_lock();
+            std::span<const patient_hot> all = records->all();
+            json page = json::array();
+            for (size_t i = offset; i < all.size() && i < offset + limit; i++) {
+                page.push_back(patient_brief(*records, all[i]));
+            }
+            return {{"patients", std::move(page)}, {"total", all.size()}};
+        }
+    });
+
+    p_toolbox.add({
+        "count_patients",
+        "Number of patients registered at the clinic.",
+        {{"type", "object"}, {"properties", json::object()}},
+        [records](const json&) -> json {
+            auto lock = records->read_lock();
+            return {{"count", records->size()}};
+        }
+    });
+}
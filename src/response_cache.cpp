@@ -0,0 +1,212 @@
+#include "util/llm/response_cache.hpp"
+#include "util/hash.hpp"
+#include "json/json.hpp"
+#include <SDL3/SDL_log.h>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace {
+
+int64_t unix_now() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+response_cache::response_cache(const response_cache_config& p_config)
+    : cfg(p_config), memory(p_config.capacity) { }
+
+std::string response_cache::normalize_prompt(const std::string& p_prompt) {
+    std::string out;
+    out.reserve(p_prompt.size());
+
+    bool pending_space = false;
+    for (char c : p_prompt) {
+        unsigned char u = static_cast<unsigned char>(c);
+        // Keep non-ASCII bytes as is, only ASCII punctuation/space is folded
+        if (u >= 0x80 || std::isalnum(u) || c == '\'') {
+            if (pending_space && !out.empty()) {
+                out += ' ';
+            }
+            pending_space = false;
+            out += static_cast<char>(std::tolower(u));
+        } else {
+            pending_space = true;
+        }
+    }
+
+    return out;
+}
+
+std::string response_cache::make_key(const std::string& p_normalized,
+                                     const std::string& p_model,
+                                     const std::string& p_params) {
+    uint64_t h = hash64(p_normalized);
+    h = hash64(p_model, h);
+    h = hash64(p_params, h);
+    return hash_hex(h);
+}
+
+bool response_cache::load() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::string contents;
+    bool encrypted = is_sealed(cfg.path);
+    if (encrypted) {
+        if (!cfg.key.set) {
+            SDL_Log("response_cache: %s is encrypted and there's no key", cfg.path.c_str());
+            return false;
+        }
+        log.close();
+        if (!log.open(cfg.path, cfg.key, contents)) {
+            return false;
+        }
+    } else if (!load_sealed(cfg.path, contents, cfg.key)) {
+        return false;
+    }
+
+    const int64_t now = unix_now();
+    size_t lines = 0;
+    std::istringstream file(contents);
+    std::string line;
+    while (std::getline(file, line)) {
+        lines++;
+        try {
+            json j = json::parse(line);
+            std::string key = j.at("key").get<std::string>();
+            entry e = {
+                j.at("prompt").get<std::string>(),
+                j.at("response").get<std::string>(),
+                j.at("expires_at").get<int64_t>()
+            };
+
+            // Later lines win, expired ones are simply not loaded
+            if (e.expires_at != 0 && e.expires_at <= now) {
+                memory.erase(key);
+            } else {
+                memory.put(key, std::move(e));
+            }
+        } catch (const std::exception&) {
+            // Torn last line after a crash, skip it
+        }
+    }
+    // Compact once the log is mostly overwritten / expired entries, and
+    // encrypt a plaintext one
+    if (lines > 2 * memory.size() + 64 || (cfg.key.set && !encrypted)) {
+        std::vector<std::pair<std::string, entry>> live;
+        memory.for_each([&](const std::string& p_key, const entry& p_entry) {
+            live.emplace_back(p_key, p_entry);
+        });
+
+        // Least recently used first so replaying keeps the LRU order
+        std::string out;
+        for (auto it = live.rbegin(); it != live.rend(); ++it) {
+            out += json{{"key", it->first}, 
+                        {"prompt", it->second.prompt}, 
+                        {"response", it->second.response}, 
+                        {"expires_at", it->second.expires_at}}.dump(-1, ' ', false, json::error_handler_t::replace) + '\n';
+        }
+
+        std::string tmp = cfg.path + ".tmp";
+        std::error_code ec;
+        std::filesystem::remove(tmp, ec);
+        bool written;
+        if (cfg.key.set) {
+            sealed_log compacted;
+            std::string none;
+            written = compacted.open(tmp, cfg.key, none) && (out.empty() || compacted.append(out)) && compacted.sync();
+        } else {
+            std::ofstream file_out(tmp, std::ios::trunc);
+            written = static_cast<bool>(file_out << out);
+        }
+        log.close(); // Appends go to the new file
+        if (written) {
+            std::filesystem::rename(tmp, cfg.path, ec);
+        }
+    }
+
+    return true;
+}
+
+bool response_cache::lookup(const std::string& p_prompt,
+                            const std::string& p_model,
+                            const std::string& p_params,
+                            std::string& p_response) {
+    std::string normalized = normalize_prompt(p_prompt);
+    std::string key = make_key(normalized, p_model, p_params);
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    entry* hit = memory.get(key);
+    if (!hit || hit->prompt != normalized) {
+        counters.misses++;
+        return false;
+    }
+
+    if (hit->expires_at != 0 && hit->expires_at <= unix_now()) {
+        memory.erase(key);
+        counters.expired++;
+        counters.misses++;
+        return false;
+    }
+
+    p_response = hit->response;
+    counters.hits++;
+    return true;
+}
+
+void response_cache::store(const std::string& p_prompt,
+                           const std::string& p_model,
+                           const std::string& p_params,
+                           const std::string& p_response,
+                           int64_t p_ttl_s) {
+    std::string normalized = normalize_prompt(p_prompt);
+    std::string key = make_key(normalized, p_model, p_params);
+
+    int64_t ttl = (p_ttl_s < 0) ? cfg.ttl_s : p_ttl_s;
+    entry e = {normalized, p_response, ttl > 0 ? unix_now() + ttl : 0};
+
+    std::lock_guard<std::mutex> lock(mutex);
+    append_to_log(key, e);
+    memory.put(key, std::move(e));
+    counters.stores++;
+}
+
+void response_cache::append_to_log(const std::string& p_key, const entry& p_entry) {
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(cfg.path).parent_path(), ec);
+
+    std::string line = json{{"key", p_key}, 
+                            {"prompt", p_entry.prompt}, 
+                            {"response", p_entry.response}, 
+                            {"expires_at", p_entry.expires_at}}.dump(-1, ' ', false, json::error_handler_t::replace) + '\n';
+    if (cfg.key.set) {
+        // One record per line; a plaintext log left from before (load() not called) doesn't open
+        std::string ignored;
+        if ((!log.is_open() && !log.open(cfg.path, cfg.key, ignored)) || !log.append(line)) {
+            SDL_Log("response_cache: couldn't append to %s", cfg.path.c_str());
+        }
+        return;
+    }
+
+    std::ofstream out(cfg.path, std::ios::app);
+    if (!out) {
+        SDL_Log("response_cache: couldn't append to %s", cfg.path.c_str());
+        return;
+    }
+    out << line;
+}
+
+response_cache_stats response_cache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    response_cache_stats out = counters;
+    out.entries = memory.size();
+    return out;
+}
@@ -0,0 +1,739 @@
+#include "util/sealed_file.hpp"
+#include "util/hash.hpp"
+#include <SDL3/SDL_log.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char FILE_MAGIC[8] = {'A', 'V', 'A', 'S', 'E', 'A', 'L', '1'};
+constexpr char LOG_MAGIC[8] = {'A', 'V', 'A', 'S', 'L', 'O', 'G', '1'};
+constexpr char JOURNAL_MAGIC[8] = {'A', 'V', 'A', 'J', 'R', 'N', 'L', '1'};
+constexpr size_t NONCE = 12;
+constexpr size_t TAG = 16;
+constexpr size_t OVERHEAD = NONCE + TAG;
+constexpr size_t DIRTY_LIMIT = 8 << 20; // Plaintext held back before write() syncs by itself
+constexpr size_t IO_BATCH = 64;       // Chunks per pread or pwrite
+
+// Both kinds of file start with one
+typedef struct seal_header {
+    char magic[8];
+    u_int32_t chunk_size; // 0 in a log
+    u_int32_t version;
+    u_int8_t salt[16];    // The file's key is derived from it
+    u_int8_t check[16];   // Tells a wrong key from a damaged file
+    u_int8_t reserved[16];
+} seal_header;
+
+static_assert(sizeof(seal_header) == 64, "Part of the file format");
+
+typedef struct journal_header {
+    char magic[8];
+    u_int64_t physical_size; // Of the file before the sync
+    u_int64_t entries;       // Then each one's chunk index, length and old ciphertext
+} journal_header;
+
+bool write_all(int p_fd, const void* p_data, size_t p_len, off_t p_offset = -1) {
+    const char* at = static_cast<const char*>(p_data);
+    while (p_len > 0) {
+        ssize_t n = p_offset < 0 ? ::write(p_fd, at, p_len) : ::pwrite(p_fd, at, p_len, p_offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        at += n;
+        p_len -= static_cast<size_t>(n);
+        if (p_offset >= 0) {
+            p_offset += n;
+        }
+    }
+    return true;
+}
+
+bool read_exact(int p_fd, void* p_out, size_t p_len, off_t p_offset) {
+    char* at = static_cast<char*>(p_out);
+    while (p_len > 0) {
+        ssize_t n = ::pread(p_fd, at, p_len, p_offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        at += n;
+        p_len -= static_cast<size_t>(n);
+        p_offset += n;
+    }
+    return true;
+}
+
+std::string read_all(int p_fd) {
+    std::string data;
+    char buffer[1 << 16];
+    ssize_t n;
+    off_t offset = 0;
+    while ((n = ::pread(p_fd, buffer, sizeof(buffer), offset)) > 0 || (n < 0 && errno == EINTR)) {
+        if (n > 0) {
+            data.append(buffer, static_cast<size_t>(n));
+            offset += n;
+        }
+    }
+    return data;
+}
+
+// The file key for p_salt, and a check value that shows whether p_master was the right one
+void derive_key(const seal_key& p_master, const u_int8_t* p_salt, u_int8_t* p_key, u_int8_t* p_check) {
+    u_int8_t input[32] = {'A', 'V', 'A', ' ', 'f', 'i', 'l', 'e', ' ', 'k', 'e', 'y'};
+    std::memcpy(input + 16, p_salt, 16);
+    unsigned int length = 32;
+    HMAC(EVP_sha256(), p_master.bytes, sizeof(p_master.bytes), input, sizeof(input), p_key, &length);
+    u_int8_t check[32];
+    HMAC(EVP_sha256(), p_key, 32, reinterpret_cast<const u_int8_t*>("AVA key check"), 13, check, &length);
+    std::memcpy(p_check, check, 16);
+}
+
+// A fresh header for p_magic and its file key
+bool new_header(const char* p_magic, u_int32_t p_chunk, const seal_key& p_master, seal_header& p_header, u_int8_t* p_key) {
+    p_header = {};
+    std::memcpy(p_header.magic, p_magic, sizeof(p_header.magic));
+    p_header.chunk_size = p_chunk;
+    p_header.version = 1;
+    if (RAND_bytes(p_header.salt, sizeof(p_header.salt)) != 1) {
+        SDL_Log("sealed_file: no random bytes for a salt");
+        return false;
+    }
+    derive_key(p_master, p_header.salt, p_key, p_header.check);
+    return true;
+}
+
+// The file key, if p_master is the one p_header was written with
+bool header_key(const seal_header& p_header, const seal_key& p_master, u_int8_t* p_key) {
+    u_int8_t check[16];
+    derive_key(p_master, p_header.salt, p_key, check);
+    return std::memcmp(check, p_header.check, sizeof(check)) == 0;
+}
+
+evp_cipher_ctx_st* make_cipher(const u_int8_t* p_key, bool p_encrypt) {
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    if (ctx && EVP_CipherInit_ex(ctx, EVP_aes_256_gcm(), nullptr, p_key, nullptr, p_encrypt ? 1 : 0) != 1) {
+        EVP_CIPHER_CTX_free(ctx);
+        ctx = nullptr;
+    }
+    return ctx;
+}
+
+// p_out gets nonce, ciphertext and tag, OVERHEAD + p_bytes in all
+bool seal(EVP_CIPHER_CTX* p_ctx, const u_int8_t* p_aad, size_t p_aad_bytes, const void* p_plain, size_t p_bytes,
+          u_int8_t* p_out) {
+    int n = 0;
+    return RAND_bytes(p_out, NONCE) == 1 && EVP_CipherInit_ex(p_ctx, nullptr, nullptr, nullptr, p_out, 1) == 1 &&
+           EVP_CipherUpdate(p_ctx, nullptr, &n, p_aad, static_cast<int>(p_aad_bytes)) == 1 &&
+           (p_bytes == 0 || EVP_CipherUpdate(p_ctx, p_out + NONCE, &n, static_cast<const u_int8_t*>(p_plain),
+                                             static_cast<int>(p_bytes)) == 1) &&
+           EVP_CipherFinal_ex(p_ctx, p_out + NONCE + p_bytes, &n) == 1 &&
+           EVP_CIPHER_CTX_ctrl(p_ctx, EVP_CTRL_GCM_GET_TAG, TAG, p_out + NONCE + p_bytes) == 1;
+}
+
+// The other way, false if anything (p_aad included) was altered
+bool unseal(EVP_CIPHER_CTX* p_ctx, const u_int8_t* p_aad, size_t p_aad_bytes, const u_int8_t* p_sealed, size_t p_bytes,
+            void* p_out) {
+    int n = 0;
+    return EVP_CipherInit_ex(p_ctx, nullptr, nullptr, nullptr, p_sealed, 0) == 1 &&
+           EVP_CipherUpdate(p_ctx, nullptr, &n, p_aad, static_cast<int>(p_aad_bytes)) == 1 &&
+           (p_bytes == 0 || EVP_CipherUpdate(p_ctx, static_cast<u_int8_t*>(p_out), &n, p_sealed + NONCE,
+                                             static_cast<int>(p_bytes)) == 1) &&
+           EVP_CIPHER_CTX_ctrl(p_ctx, EVP_CTRL_GCM_SET_TAG, TAG, const_cast<u_int8_t*>(p_sealed + NONCE + p_bytes)) == 1 &&
+           EVP_CipherFinal_ex(p_ctx, nullptr, &n) == 1;
+}
+
+// What a chunk is authenticated with besides its bytes
+void chunk_aad(u_int64_t p_index, bool p_last, u_int8_t* p_aad) {
+    std::memcpy(p_aad, &p_index, sizeof(p_index));
+    p_aad[8] = p_last;
+}
+
+void free_cipher(evp_cipher_ctx_st*& p_ctx) {
+    EVP_CIPHER_CTX_free(p_ctx);
+    p_ctx = nullptr;
+}
+
+} // namespace
+
+bool parse_seal_key(std::string_view p_text, seal_key& p_key) {
+    while (!p_text.empty() && std::isspace(static_cast<unsigned char>(p_text.back()))) {
+        p_text.remove_suffix(1);
+    }
+    while (!p_text.empty() && std::isspace(static_cast<unsigned char>(p_text.front()))) {
+        p_text.remove_prefix(1);
+    }
+    if (p_text.size() != 2 * sizeof(p_key.bytes)) {
+        return false;
+    }
+    auto digit = [](char c) {
+        return c >= '0' && c <= '9' ? c - '0' : (c >= 'a' && c <= 'f' ? c - 'a' + 10 : (c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1));
+    };
+    for (size_t i = 0; i < sizeof(p_key.bytes); i++) {
+        int high = digit(p_text[2 * i]), low = digit(p_text[2 * i + 1]);
+        if (high < 0 || low < 0) {
+            return false;
+        }
+        p_key.bytes[i] = static_cast<u_int8_t>(high << 4 | low);
+    }
+    p_key.set = true;
+    return true;
+}
+
+const seal_key& data_key() {
+    static const seal_key key = []() {
+        seal_key out;
+        if (const char* hex = std::getenv("AVA_DATA_KEY")) {
+            if (!parse_seal_key(hex, out)) {
+                SDL_Log("sealed_file: AVA_DATA_KEY isn't 64 hex digits, data stays unencrypted");
+            }
+        } else if (const char* path = std::getenv("AVA_DATA_KEY_FILE")) {
+            std::ifstream file(path, std::ios::binary);
+            std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            if (text.size() == sizeof(out.bytes)) {
+                std::memcpy(out.bytes, text.data(), sizeof(out.bytes));
+                out.set = true;
+            } else if (!parse_seal_key(text, out)) {
+                SDL_Log("sealed_file: %s doesn't hold a key, data stays unencrypted", path);
+            }
+        }
+        return out;
+    }();
+    return key;
+}
+
+bool is_sealed(const std::string& p_path) {
+    int fd = ::open(p_path.c_str(), O_RDONLY | O_CLOEXEC);
+    char magic[8] = {};
+    bool sealed = fd >= 0 && read_exact(fd, magic, sizeof(magic), 0) &&
+                  (std::memcmp(magic, FILE_MAGIC, sizeof(magic)) == 0 || std::memcmp(magic, LOG_MAGIC, sizeof(magic)) == 0);
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    return sealed;
+}
+
+sealed_file::~sealed_file() {
+    close();
+}
+
+size_t sealed_file::physical_chunk() const {
+    return NONCE + chunk + TAG;
+}
+
+u_int64_t sealed_file::chunks_on_disk() const {
+    return synced_length == 0 ? 1 : (synced_length + chunk - 1) / chunk;
+}
+
+bool sealed_file::open(const std::string& p_path, const seal_key& p_key) {
+    close();
+    if (!p_key.set) {
+        return false;
+    }
+    path = p_path;
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    struct stat info;
+    if (fd < 0 || !recover() || ::fstat(fd, &info) != 0) {
+        SDL_Log("sealed_file: couldn't open %s: %s", path.c_str(), std::strerror(errno));
+        close();
+        return false;
+    }
+
+    seal_header header;
+    u_int8_t file_key[32];
+    if (info.st_size == 0) {
+        // A new file is one empty last chunk
+        chunk = SEAL_CHUNK;
+        std::vector<u_int8_t> empty(OVERHEAD);
+        u_int8_t aad[9];
+        chunk_aad(0, true, aad);
+        bool ok = new_header(FILE_MAGIC, SEAL_CHUNK, p_key, header, file_key) &&
+                  (encrypt_ctx = make_cipher(file_key, true)) && (decrypt_ctx = make_cipher(file_key, false)) &&
+                  seal(encrypt_ctx, aad, sizeof(aad), nullptr, 0, empty.data()) &&
+                  write_all(fd, &header, sizeof(header), 0) &&
+                  write_all(fd, empty.data(), empty.size(), sizeof(header)) && ::fdatasync(fd) == 0;
+        if (!ok) {
+            SDL_Log("sealed_file: couldn't create %s: %s", path.c_str(), std::strerror(errno));
+            close();
+        }
+        return ok;
+    }
+
+    if (!read_exact(fd, &header, sizeof(header), 0) || std::memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 ||
+        header.version != 1 || header.chunk_size < 512 || header.chunk_size > (64u << 20)) {
+        SDL_Log("sealed_file: %s isn't a sealed file", path.c_str());
+        close();
+        return false;
+    }
+    if (!header_key(header, p_key, file_key)) {
+        SDL_Log("sealed_file: %s was sealed with another key", path.c_str());
+        close();
+        return false;
+    }
+    chunk = header.chunk_size;
+    encrypt_ctx = make_cipher(file_key, true);
+    decrypt_ctx = make_cipher(file_key, false);
+
+    // The size follows from the last chunk's, which has to say it's the last
+    u_int64_t physical = static_cast<u_int64_t>(info.st_size) - std::min<u_int64_t>(info.st_size, sizeof(header));
+    u_int64_t chunks = (physical + physical_chunk() - 1) / physical_chunk();
+    u_int64_t last = chunks ? physical - (chunks - 1) * physical_chunk() : 0;
+    std::string plain;
+    if (!encrypt_ctx || !decrypt_ctx || last < OVERHEAD) {
+        SDL_Log("sealed_file: %s is damaged", path.c_str());
+        close();
+        return false;
+    }
+    length = synced_length = (chunks - 1) * chunk + last - OVERHEAD;
+    if (!load_chunk(chunks - 1, plain)) {
+        SDL_Log("sealed_file: %s is damaged or was cut short", path.c_str());
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool sealed_file::close() {
+    bool ok = fd < 0 || sync();
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    fd = -1;
+    free_cipher(encrypt_ctx);
+    free_cipher(decrypt_ctx);
+    dirty.clear();
+    dirty_bytes = 0;
+    length = synced_length = 0;
+    return ok;
+}
+
+bool sealed_file::load_chunk(u_int64_t p_index, std::string& p_plain) {
+    u_int64_t last = chunks_on_disk() - 1;
+    if (p_index > last) {
+        return false;
+    }
+    size_t bytes = p_index == last ? synced_length - p_index * chunk : chunk;
+    scratch.resize(bytes + OVERHEAD);
+    p_plain.resize(bytes);
+    u_int8_t aad[9];
+    chunk_aad(p_index, p_index == last, aad);
+    if (!read_exact(fd, scratch.data(), scratch.size(), static_cast<off_t>(sizeof(seal_header) + p_index * physical_chunk())) ||
+        !unseal(decrypt_ctx, aad, sizeof(aad), scratch.data(), bytes, p_plain.data())) {
+        SDL_Log("sealed_file: chunk %llu of %s doesn't authenticate", static_cast<unsigned long long>(p_index), path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool sealed_file::seal_chunk(u_int64_t p_index, bool p_last, const std::string& p_plain, u_int8_t* p_out) {
+    u_int8_t aad[9];
+    chunk_aad(p_index, p_last, aad);
+    return seal(encrypt_ctx, aad, sizeof(aad), p_plain.data(), p_plain.size(), p_out);
+}
+
+bool sealed_file::read(u_int64_t p_offset, void* p_out, size_t p_bytes) {
+    if (fd < 0 || p_offset + p_bytes > length) {
+        return false;
+    }
+    u_int8_t* out = static_cast<u_int8_t*>(p_out);
+    const u_int64_t last = chunks_on_disk() - 1;
+    std::string plain;
+    while (p_bytes > 0) {
+        u_int64_t index = p_offset / chunk;
+        size_t within = p_offset % chunk;
+        size_t take = std::min<size_t>(p_bytes, chunk - within);
+        auto found = dirty.find(index);
+        if (found != dirty.end()) {
+            std::memcpy(out, found->second.data() + within, take);
+        } else if (within != 0 || take != chunk || index == last) {
+            if (!load_chunk(index, plain)) {
+                return false;
+            }
+            std::memcpy(out, plain.data() + within, take);
+        } else {
+            // Whole chunks straight into p_out, several per pread
+            u_int64_t run = 1;
+            while (run < IO_BATCH && index + run < last && p_bytes >= (run + 1) * chunk &&
+                   dirty.find(index + run) == dirty.end()) {
+                run++;
+            }
+            scratch.resize(run * physical_chunk());
+            if (!read_exact(fd, scratch.data(), scratch.size(), static_cast<off_t>(sizeof(seal_header) + index * physical_chunk()))) {
+                return false;
+            }
+            for (u_int64_t i = 0; i < run; i++) {
+                u_int8_t aad[9];
+                chunk_aad(index + i, false, aad);
+                if (!unseal(decrypt_ctx, aad, sizeof(aad), scratch.data() + i * physical_chunk(), chunk, out + i * chunk)) {
+                    SDL_Log("sealed_file: chunk %llu of %s doesn't authenticate",
+                            static_cast<unsigned long long>(index + i), path.c_str());
+                    return false;
+                }
+            }
+            take = run * chunk;
+        }
+        out += take;
+        p_offset += take;
+        p_bytes -= take;
+    }
+    return true;
+}
+
+std::string* sealed_file::chunk_for_write(u_int64_t p_index) {
+    auto found = dirty.find(p_index);
+    if (found != dirty.end()) {
+        return &found->second;
+    }
+    std::string plain;
+    plain.reserve(chunk);
+    if (p_index < chunks_on_disk() && !load_chunk(p_index, plain)) {
+        return nullptr;
+    }
+    dirty_bytes += chunk;
+    return &dirty.emplace(p_index, std::move(plain)).first->second;
+}
+
+bool sealed_file::write(u_int64_t p_offset, const void* p_data, size_t p_bytes) {
+    if (fd < 0) {
+        return false;
+    }
+    if (p_offset > length) {
+        std::string zeros(std::min<u_int64_t>(p_offset - length, chunk), '\0');
+        while (length < p_offset) {
+            if (!write(length, zeros.data(), std::min<u_int64_t>(zeros.size(), p_offset - length))) {
+                return false;
+            }
+        }
+    }
+
+    const u_int8_t* data = static_cast<const u_int8_t*>(p_data);
+    u_int64_t end = p_offset + p_bytes;
+    while (p_bytes > 0) {
+        u_int64_t index = p_offset / chunk;
+        size_t within = p_offset % chunk;
+        size_t take = std::min<size_t>(p_bytes, chunk - within);
+        std::string* plain = chunk_for_write(index);
+        if (!plain) {
+            return false;
+        }
+        if (plain->size() == within) {
+            plain->append(reinterpret_cast<const char*>(data), take); // Appending, nothing to zero first
+        } else {
+            if (plain->size() < within + take) {
+                plain->resize(within + take);
+            }
+            std::memcpy(plain->data() + within, data, take);
+        }
+        data += take;
+        p_offset += take;
+        p_bytes -= take;
+    }
+    length = std::max(length, end);
+    return dirty_bytes < DIRTY_LIMIT || sync();
+}
+
+bool sealed_file::sync() {
+    if (fd < 0) {
+        return false;
+    }
+    if (dirty.empty() && length == synced_length) {
+        return true;
+    }
+
+    // The old last chunk is one no longer (or a longer one) and gets sealed again, so does the new last one
+    const u_int64_t disk_chunks = chunks_on_disk();
+    const u_int64_t last = length == 0 ? 0 : (length - 1) / chunk;
+    if (!chunk_for_write(disk_chunks - 1) || !chunk_for_write(last)) {
+        return false;
+    }
+
+    // Undo journal: the ciphertext of every chunk about to be overwritten,
+    // on disk before any of them is
+    const u_int64_t old_last_bytes = synced_length - (disk_chunks - 1) * chunk + OVERHEAD;
+    journal_header header = {};
+    std::memcpy(header.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+    header.physical_size = sizeof(seal_header) + (disk_chunks - 1) * physical_chunk() + old_last_bytes;
+    std::string journal(sizeof(header), '\0');
+    for (const auto& [index, plain] : dirty) {
+        if (index >= disk_chunks) {
+            break;
+        }
+        u_int64_t bytes = index == disk_chunks - 1 ? old_last_bytes : physical_chunk();
+        size_t at = journal.size();
+        journal.resize(at + 2 * sizeof(u_int64_t) + bytes);
+        std::memcpy(&journal[at], &index, sizeof(index));
+        std::memcpy(&journal[at + sizeof(index)], &bytes, sizeof(bytes));
+        if (!read_exact(fd, &journal[at + 2 * sizeof(u_int64_t)], bytes,
+                        static_cast<off_t>(sizeof(seal_header) + index * physical_chunk()))) {
+            return false;
+        }
+        header.entries++;
+    }
+    std::memcpy(journal.data(), &header, sizeof(header));
+    u_int64_t checksum = hash64(journal.data(), journal.size());
+    journal.append(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+
+    std::string journal_path = path + ".journal";
+    int journal_fd = ::open(journal_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    bool ok = journal_fd >= 0 && write_all(journal_fd, journal.data(), journal.size(), 0) && ::fdatasync(journal_fd) == 0;
+
+    // Runs of neighbouring chunks go out in one pwrite, IO_BATCH at most so scratch stays small
+    scratch.reserve(IO_BATCH * physical_chunk());
+    for (auto it = dirty.begin(); ok && it != dirty.end();) {
+        u_int64_t first = it->first;
+        scratch.clear();
+        for (u_int64_t index = first; ok && it != dirty.end() && it->first == index && index - first < IO_BATCH;
+             ++it, ++index) {
+            if (index != last && it->second.size() != chunk) {
+                it->second.resize(chunk); // Only the last chunk is short
+            }
+            size_t at = scratch.size();
+            scratch.resize(at + it->second.size() + OVERHEAD);
+            ok = seal_chunk(index, index == last, it->second, scratch.data() + at);
+        }
+        ok = ok && write_all(fd, scratch.data(), scratch.size(), static_cast<off_t>(sizeof(seal_header) + first * physical_chunk()));
+    }
+    ok = ok && ::fdatasync(fd) == 0;
+
+    // Empty, the journal has nothing left to undo
+    ok = ok && ::ftruncate(journal_fd, 0) == 0 && ::fdatasync(journal_fd) == 0;
+    if (journal_fd >= 0) {
+        ::close(journal_fd);
+    }
+    if (!ok) {
+        SDL_Log("sealed_file: couldn't write %s: %s", path.c_str(), std::strerror(errno));
+        return false;
+    }
+    ::unlink(journal_path.c_str());
+
+    dirty.clear();
+    dirty_bytes = 0;
+    synced_length = length;
+    return true;
+}
+
+bool sealed_file::recover() {
+    std::string journal_path = path + ".journal";
+    int journal_fd = ::open(journal_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (journal_fd < 0) {
+        return true;
+    }
+    std::string journal = read_all(journal_fd);
+    ::close(journal_fd);
+
+    // A journal that isn't whole never got as far as overwriting anything
+    journal_header header;
+    u_int64_t checksum = 0;
+    bool whole = journal.size() >= sizeof(header) + sizeof(checksum);
+    if (whole) {
+        std::memcpy(&header, journal.data(), sizeof(header));
+        std::memcpy(&checksum, journal.data() + journal.size() - sizeof(checksum), sizeof(checksum));
+        whole = std::memcmp(header.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) == 0 &&
+                checksum == hash64(journal.data(), journal.size() - sizeof(checksum));
+    }
+
+    bool ok = true;
+    if (whole) {
+        size_t at = sizeof(header);
+        for (u_int64_t i = 0; ok && i < header.entries; i++) {
+            u_int64_t index, bytes;
+            std::memcpy(&index, &journal[at], sizeof(index));
+            std::memcpy(&bytes, &journal[at + sizeof(index)], sizeof(bytes));
+            at += 2 * sizeof(u_int64_t);
+            ok = write_all(fd, &journal[at], bytes, static_cast<off_t>(sizeof(seal_header) + index * physical_chunk()));
+            at += bytes;
+        }
+        ok = ok && ::ftruncate(fd, static_cast<off_t>(header.physical_size)) == 0 && ::fdatasync(fd) == 0;
+        if (ok) {
+            SDL_Log("sealed_file: rolled back an interrupted write to %s", path.c_str());
+        }
+    }
+    return ok && ::unlink(journal_path.c_str()) == 0;
+}
+
+sealed_log::~sealed_log() {
+    close();
+}
+
+bool sealed_log::open(const std::string& p_path, const seal_key& p_key, std::string& p_plain) {
+    close();
+    p_plain.clear();
+    if (!p_key.set) {
+        return false;
+    }
+    fd = ::open(p_path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        SDL_Log("sealed_log: couldn't open %s: %s", p_path.c_str(), std::strerror(errno));
+        return false;
+    }
+    master = p_key;
+    std::string file = read_all(fd);
+    const size_t on_disk = file.size();
+    if (file.empty()) {
+        return true; // start() writes the header with the first record
+    }
+
+    seal_header header;
+    u_int8_t file_key[32] = {};
+    if (file.size() < sizeof(header)) {
+        file.clear(); // Torn while the header was written, nothing to lose
+    } else {
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, LOG_MAGIC, sizeof(LOG_MAGIC)) != 0 || header.version != 1) {
+            SDL_Log("sealed_log: %s isn't a sealed log", p_path.c_str());
+            close();
+            return false;
+        }
+        if (!header_key(header, p_key, file_key)) {
+            SDL_Log("sealed_log: %s was sealed with another key", p_path.c_str());
+            close();
+            return false;
+        }
+    }
+
+    // Records up to the first that's torn or doesn't authenticate
+    size_t at = file.empty() ? 0 : sizeof(header);
+    if (at) {
+        EVP_CIPHER_CTX* decrypt = make_cipher(file_key, false);
+        encrypt_ctx = make_cipher(file_key, true);
+        if (!decrypt || !encrypt_ctx) {
+            EVP_CIPHER_CTX_free(decrypt);
+            close();
+            return false;
+        }
+        u_int32_t bytes;
+        while (at + sizeof(bytes) + OVERHEAD <= file.size()) {
+            std::memcpy(&bytes, &file[at], sizeof(bytes));
+            if (bytes > file.size() - at - sizeof(bytes) - OVERHEAD) {
+                break;
+            }
+            u_int64_t offset = at;
+            size_t plain = p_plain.size();
+            p_plain.resize(plain + bytes);
+            if (!unseal(decrypt, reinterpret_cast<const u_int8_t*>(&offset), sizeof(offset),
+                        reinterpret_cast<const u_int8_t*>(&file[at + sizeof(bytes)]), bytes, p_plain.data() + plain)) {
+                p_plain.resize(plain);
+                break;
+            }
+            at += sizeof(bytes) + OVERHEAD + bytes;
+        }
+        EVP_CIPHER_CTX_free(decrypt);
+    }
+    if (at < on_disk) {
+        SDL_Log("sealed_log: dropped %zu damaged bytes at the end of %s", on_disk - at, p_path.c_str());
+        if (::ftruncate(fd, static_cast<off_t>(at)) != 0 || ::fdatasync(fd) != 0) {
+            close();
+            return false;
+        }
+        if (at == 0) {
+            free_cipher(encrypt_ctx);
+        }
+    }
+    file_bytes = at;
+    return true;
+}
+
+void sealed_log::close() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    fd = -1;
+    file_bytes = 0;
+    free_cipher(encrypt_ctx);
+}
+
+bool sealed_log::start() {
+    seal_header header;
+    u_int8_t file_key[32];
+    if (!new_header(LOG_MAGIC, 0, master, header, file_key) || !(encrypt_ctx = make_cipher(file_key, true)) ||
+        !write_all(fd, &header, sizeof(header))) {
+        free_cipher(encrypt_ctx);
+        return false;
+    }
+    file_bytes = sizeof(header);
+    return true;
+}
+
+bool sealed_log::append(std::string_view p_plain) {
+    if (fd < 0 || p_plain.size() > UINT32_MAX || (!encrypt_ctx && !start())) {
+        return false;
+    }
+    u_int32_t bytes = static_cast<u_int32_t>(p_plain.size());
+    u_int64_t offset = file_bytes;
+    std::vector<u_int8_t> record(sizeof(bytes) + OVERHEAD + bytes);
+    std::memcpy(record.data(), &bytes, sizeof(bytes));
+    if (!seal(encrypt_ctx, reinterpret_cast<const u_int8_t*>(&offset), sizeof(offset), p_plain.data(), bytes,
+              record.data() + sizeof(bytes)) ||
+        !write_all(fd, record.data(), record.size())) {
+        // Whatever part made it out is dropped as torn by the next open()
+        return false;
+    }
+    file_bytes += record.size();
+    return true;
+}
+
+bool sealed_log::sync() {
+    return fd >= 0 && ::fdatasync(fd) == 0;
+}
+
+bool sealed_log::reset() {
+    if (fd < 0 || ::ftruncate(fd, 0) != 0 || ::fdatasync(fd) != 0) {
+        return false;
+    }
+    file_bytes = 0;
+    free_cipher(encrypt_ctx); // The next append() starts over with a new salt
+    return true;
+}
+
+bool load_sealed(const std::string& p_path, std::string& p_data, const seal_key& p_key) {
+    if (!is_sealed(p_path)) {
+        std::ifstream file(p_path, std::ios::binary);
+        if (!file) {
+            return false;
+        }
+        p_data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return true;
+    }
+    sealed_file file;
+    if (!file.open(p_path, p_key)) {
+        return false;
+    }
+    p_data.resize(file.size());
+    return file.read(0, p_data.data(), p_data.size());
+}
+
+bool save_sealed(const std::string& p_path, std::string_view p_data, const seal_key& p_key) {
+    std::string temporary = p_path + ".tmp";
+    std::filesystem::remove(temporary);
+    bool ok;
+    if (p_key.set) {
+        sealed_file file;
+        ok = file.open(temporary, p_key) && file.write(0, p_data.data(), p_data.size()) && file.close();
+    } else {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        ok = file && file.write(p_data.data(), static_cast<std::streamsize>(p_data.size())) && file.flush();
+    }
+    std::error_code error;
+    ok = ok && (std::filesystem::rename(temporary, p_path, error), !error);
+    if (!ok) {
+        SDL_Log("sealed_file: couldn't save %s", p_path.c_str());
+        std::filesystem::remove(temporary, error);
+    }
+    return ok;
+}
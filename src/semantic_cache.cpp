@@ -0,0 +1,168 @@
+#include "util/llm/semantic_cache.hpp"
+#include "util/hash.hpp"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <string_view>
+
+namespace {
+
+int64_t unix_now() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+u_int64_t scope_of(const std::string& p_model, const std::string& p_params) {
+    return hash64(p_params, hash64(p_model));
+}
+
+// How many neighbours to check, entries from other models can be closer
+constexpr size_t CANDIDATES = 8;
+
+// Words that pick a day, a paraphrase can't swap them
+constexpr std::string_view DATE_WORDS[] = {
+    "today", "tonight", "tomorrow", "yesterday", "now", "next", "last", "this", "week", "weekend", "month", "year",
+    "morning", "afternoon", "evening", "noon", "midnight", "am", "pm",
+    "monday", "tuesday", "wednesday", "thursday", "friday", "saturday", "sunday",
+    "january", "february", "march", "april", "may", "june", "july", "august", "september", "october",
+    "november", "december"};
+
+} // namespace
+
+semantic_cache::semantic_cache(const semantic_cache_config& p_config)
+    : cfg(p_config), embedder(p_config.dim), index(p_config.dim) { }
+
+bool semantic_cache::lookup(const std::string& p_prompt,
+                            const std::string& p_model,
+                            const std::string& p_params,
+                            std::string& p_response) {
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<float> query = embedder.embed(p_prompt);
+    const u_int64_t scope = scope_of(p_model, p_params);
+    const int64_t now = unix_now();
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    bool hit = false;
+    float best = 0.0f;
+    const std::string wanted = specifics(p_prompt);
+    for (const auto& [id, sim] : index.search(query.data(), CANDIDATES)) {
+        const entry& e = entries[id];
+        if (e.scope != scope || (e.expires_at != 0 && e.expires_at <= now) || e.specifics != wanted) {
+            continue;
+        }
+        best = std::max(best, sim);
+        if (sim >= cfg.threshold) {
+            p_response = e.response;
+            hit = true;
+            break; // Results come best first
+        }
+    }
+
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    (hit ? counters.hits : counters.misses)++;
+    total_lookup_us += us;
+    counters.last_lookup_us = us;
+    counters.max_lookup_us = std::max(counters.max_lookup_us, us);
+    counters.avg_lookup_us = total_lookup_us / (counters.hits + counters.misses);
+    counters.last_similarity = best;
+
+    return hit;
+}
+
+void semantic_cache::store(const std::string& p_prompt,
+                           const std::string& p_model,
+                           const std::string& p_params,
+                           const std::string& p_response) {
+    std::vector<float> vector = embedder.embed(p_prompt);
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    u_int32_t id = index.add(vector.data());
+    entries.resize(std::max<size_t>(entries.size(), id + 1));
+    entries[id] = {
+        scope_of(p_model, p_params),
+        specifics(p_prompt),
+        p_response,
+        cfg.ttl_s > 0 ? unix_now() + cfg.ttl_s : 0,
+        std::move(vector)
+    };
+
+    if (index.live() > cfg.capacity) {
+        rebuild();
+    }
+}
+
+void semantic_cache::rebuild() {
+    const int64_t now = unix_now();
+
+    // Node ids are insertion order, so the back half is the newest half
+    std::vector<entry> keep;
+    size_t first = entries.size() / 2;
+    for (size_t i = first; i < entries.size(); i++) {
+        if (entries[i].expires_at == 0 || entries[i].expires_at > now) {
+            keep.push_back(std::move(entries[i]));
+        }
+    }
+
+    index.clear();
+    entries.clear();
+    for (auto& e : keep) {
+        index.add(e.vector.data());
+        entries.push_back(std::move(e));
+    }
+}
+
+std::string semantic_cache::specifics(const std::string& p_prompt) {
+    std::vector<std::string> found;
+    bool sentence_start = true;
+    size_t i = 0;
+    while (i < p_prompt.size()) {
+        unsigned char c = static_cast<unsigned char>(p_prompt[i]);
+        if (c < 0x80 && !std::isalnum(c)) {
+            sentence_start = sentence_start || c == '.' || c == '?' || c == '!';
+            i++;
+            continue;
+        }
+
+        // A word, non-ASCII bytes (accented names) included
+        size_t end = i;
+        bool digits = false;
+        std::string word;
+        while (end < p_prompt.size() && (static_cast<unsigned char>(p_prompt[end]) >= 0x80 ||
+                                         std::isalnum(static_cast<unsigned char>(p_prompt[end])) ||
+                                         p_prompt[end] == '\'')) {
+            unsigned char w = static_cast<unsigned char>(p_prompt[end]);
+            digits = digits || std::isdigit(w);
+            word += static_cast<char>(w < 0x80 ? std::tolower(w) : w);
+            end++;
+        }
+        if (word.ends_with("'s")) {
+            word.resize(word.size() - 2);
+        }
+
+        bool date = std::find(std::begin(DATE_WORDS), std::end(DATE_WORDS), word) != std::end(DATE_WORDS);
+        bool name = !sentence_start && std::isupper(c) && word != "i";
+        if (digits || date || name) {
+            found.push_back(word);
+        }
+        sentence_start = false;
+        i = end;
+    }
+
+    std::sort(found.begin(), found.end());
+    std::string out;
+    for (const std::string& word : found) {
+        out += word;
+        out += ' ';
+    }
+    return out;
+}
+
+semantic_cache_stats semantic_cache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    semantic_cache_stats out = counters;
+    out.entries = index.live();
+    return out;
+}
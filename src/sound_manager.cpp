@@ -3,6 +3,7 @@
 #include <SDL3/SDL_hints.h>
 #include <SDL3/SDL_init.h>
 #include <cstdint>
+#include <cstring>
 #include <sys/types.h>
 
 // SOUND MANAGER
@@ -36,82 +37,73 @@ bool sound_manager::init() {
     return true;
 }
 
-bool sound_manager::load_wav(const std::string& p_path, const std::string& p_name) {
+asset_handle sound_manager::load_wav(const std::string& p_path, const std::string& p_name) {
     if (audio_device == 0) {
         SDL_Log("Audio device not initialized");
-        return false;
+        return INVALID_ASSET_HANDLE;
     }
 
     // Check if already loaded
-    auto it = audio_cache.find(p_name);
-    if (it != audio_cache.end()) {
-        return true;
+    asset_handle existing = audio_cache.find(p_name);
+    if (audio_cache.valid(existing)) {
+        return existing;
     }
 
-    static wav_audio audio = {nullptr, 0, nullptr, false};
-
-    audio_cache[p_name] = audio;
+    wav_audio audio = {nullptr, 0, nullptr, false};
 
-    // Dynamically allocate the full path using SDL_asSDL_Log
+    // Dynamically allocate the full path using SDL_asprintf
     char *wav_path = nullptr;
     if (SDL_asprintf(&wav_path, "%s%s", SDL_GetBasePath(), p_path.c_str()) < 0) {
         SDL_Log("Failed to allocate memory for WAV path: %s", SDL_GetError());
-        audio_cache.erase(p_name);
-        return false;
+        return INVALID_ASSET_HANDLE;
     }
 
     // Load the WAV file
     SDL_AudioSpec spec;
-    if (!SDL_LoadWAV(
-        wav_path, 
-        &spec, 
-        &audio_cache[p_name].data, 
-        &audio_cache[p_name].data_len)
-    ) {
+    bool loaded = SDL_LoadWAV(wav_path, &spec, &audio.data, &audio.data_len);
+    SDL_free(wav_path);
+    if (!loaded) {
         SDL_Log("Failed to load WAV file: %s", SDL_GetError());
-        audio_cache.erase(p_name);
-        return false;
+        return INVALID_ASSET_HANDLE;
     }
 
-    audio_cache[p_name].stream = SDL_CreateAudioStream(&spec, nullptr);
-    if (!audio_cache[p_name].stream) {
+    audio.stream = SDL_CreateAudioStream(&spec, nullptr);
+    if (!audio.stream) {
         SDL_Log("Failed to create audio stream: %s", SDL_GetError());
-        SDL_free(audio_cache[p_name].data);
-        audio_cache.erase(p_name);
-        return false;
+        SDL_free(audio.data);
+        return INVALID_ASSET_HANDLE;
     }
 
-    if (!SDL_BindAudioStream(audio_device, audio_cache[p_name].stream)) {
+    if (!SDL_BindAudioStream(audio_device, audio.stream)) {
         SDL_Log("Failed to bind audio stream: %s", SDL_GetError());
-        SDL_DestroyAudioStream(audio_cache[p_name].stream);
-        SDL_free(audio_cache[p_name].data);
-        audio_cache.erase(p_name);
-        return false;
+        SDL_DestroyAudioStream(audio.stream);
+        SDL_free(audio.data);
+        return INVALID_ASSET_HANDLE;
     }
 
-    SDL_free(wav_path);
+    audio.loaded = true;
 
-    audio_cache[p_name].loaded = true;
-    
-    return true;
+    return audio_cache.insert(p_name, audio);
 }
 
-wav_audio* sound_manager::get_audio(const std::string& p_name) {
-    auto it = audio_cache.find(p_name);
-    return (it != audio_cache.end()) ? &it->second : nullptr;
+asset_handle sound_manager::find_audio(const std::string& p_name) const {
+    return audio_cache.find(p_name);
 }
 
-void sound_manager::play(const std::string& p_name) {
-    wav_audio *audio = (audio_device != 0) ? get_audio(p_name) : nullptr;
+wav_audio* sound_manager::get_audio(asset_handle p_handle) {
+    return audio_cache.get(p_handle);
+}
 
-    // valid_audio = true if audio exists and is loaded
-    u_int8_t valid_audio = ((bool)audio + (u_int8_t)audio->loaded) >> 1;
+void sound_manager::play(asset_handle p_handle) {
+    wav_audio *audio = (audio_device != 0) ? get_audio(p_handle) : nullptr;
 
-    // stream_available is only queried if audio is valid
-    u_int8_t available = (valid_audio + (u_int8_t)SDL_GetAudioStreamAvailable(audio->stream)) >> 1;
+    // Stale / unloaded handles are a no-op
+    if (!audio || !audio->loaded) {
+        return;
+    }
 
-    // only attempt to push data if all conditions are good
-    (valid_audio && (available < static_cast<int>(audio->data_len))) ?
+    // only attempt to push data if the stream isn't already holding the clip
+    (SDL_GetAudioStreamAvailable(audio->stream) < static_cast<int>(audio->data_len)) ?
         SDL_PutAudioStreamData(audio->stream, 
                                audio->data, static_cast<int>(audio->data_len)) : 0;
 }
@@ -126,23 +118,23 @@ void sound_manager::quit() {
     printf("AUDIO DEVICE IS INITIALIZED...\n");
 
     printf("CLEANING DATA...\n");
-    for (auto& [name, audio] : audio_cache) { 
+    audio_cache.for_each([](std::string_view name, wav_audio& audio) { 
         printf("FREEING DATA...\n");
         if (audio.data) {
             SDL_free(audio.data);
             audio.data = nullptr;
-            printf("FREED DATA OF OBJ: %s\n", name.c_str());
+            printf("FREED DATA OF OBJ: %.*s\n", static_cast<int>(name.size()), name.data());
         }
         printf("DATA FREED...\n");
 
         printf("DESTROYING STREAMS...\n");
         if (audio.stream) { 
-            audio.stream = nullptr;
             SDL_DestroyAudioStream(audio.stream);
-            printf("DESTROYED STREAM OF OBJ: %s\n", name.c_str());
+            audio.stream = nullptr;
+            printf("DESTROYED STREAM OF OBJ: %.*s\n", static_cast<int>(name.size()), name.data());
         }
         printf("STREAM(S) DESTROYED...\n");
-    }
+    });
 
     printf("CLEARING AUDIO CACHE...\n");
     audio_cache.clear();
@@ -241,13 +233,10 @@ bool audio_capture::init() {
     }
 
     // Create WAV file
-    wav_file = fopen("output.wav", "wb");
-    if (!wav_file) {
+    if (!open_wav()) {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to open output.wav for writing");
         return SDL_APP_FAILURE;
     }
-    Uint8 header[44] = {0};
-    fwrite(header, 1, sizeof(header), wav_file);
 
     SDL_Log("Ready! Hold mouse button to record, release to play back and save to output.wav.");
 
@@ -297,6 +286,9 @@ SDL_AppResult audio_capture::main_action() {
         if (wav_file && br > 0) {
             fwrite(buf, 1, br, wav_file);
             wav_data += br;
+        } else if (sealed_wav.is_open() && br > 0) {
+            sealed_wav.write(44 + wav_data, buf, br);
+            wav_data += br;
         }
     }
 
@@ -311,14 +303,8 @@ void audio_capture::record() {
     wav_data = 0;  // reset recorded data size
 
     // Reopen file for new recording session
-    if (!wav_file) {
-        wav_file = fopen("output.wav", "wb");
-        if (!wav_file) {
-            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to open output.wav for writing");
-            return;
-        }
-        Uint8 header[44] = {0};  // Placeholder for WAV header
-        fwrite(header, 1, sizeof(header), wav_file);
+    if (!wav_file && !sealed_wav.is_open() && !open_wav()) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to open output.wav for writing");
     }
 }
 
@@ -326,19 +312,33 @@ void audio_capture::play() {
     SDL_PauseAudioStreamDevice(stream_i);
     SDL_FlushAudioStream(stream_i);
 
-    if (wav_file) {
-        write_wav(wav_file, &audio_spec, wav_data);
-        fclose(wav_file);
+    if (wav_file || sealed_wav.is_open()) {
+        write_wav(&audio_spec, wav_data);
+        if (wav_file) {
+            fclose(wav_file);
+        }
         wav_file = nullptr;  // prevent use-after-close
+        sealed_wav.close();
         SDL_Log("WAV file written to output.wav (%u bytes)", wav_data);
     }
 }
 
+bool audio_capture::open_wav() {
+    Uint8 header[44] = {0};  // Placeholder for WAV header
+    if (data_key().set) {
+        // Recordings are patient data, sealed at rest like the store
+        remove("output.wav");
+        wav_file = nullptr;
+        return sealed_wav.open("output.wav", data_key()) && sealed_wav.write(0, header, sizeof(header));
+    }
+    wav_file = fopen("output.wav", "wb");
+    return wav_file && fwrite(header, 1, sizeof(header), wav_file) == sizeof(header);
+}
+
 void audio_capture::write_wav(
-    FILE* p_file, 
     const SDL_AudioSpec* p_spec, 
     u_int32_t p_data) {
-    Uint16 audio_format = 1; // PCM
+    Uint16 audio_format = SDL_AUDIO_ISFLOAT(p_spec->format) ? 3 : 1; // IEEE float or PCM
     Uint16 num_channels = p_spec->channels;
     Uint32 sample_rate = p_spec->freq;
     Uint16 bits_per_sample = SDL_AUDIO_BITSIZE(p_spec->format);
@@ -346,21 +346,33 @@ void audio_capture::write_wav(
     Uint16 block_align = num_channels * bits_per_sample / 8;
     Uint32 chunk_size = 36 + p_data;
 
-    fseek(p_file, 0, SEEK_SET);
-    fwrite("RIFF", 1, 4, p_file);
-    fwrite(&chunk_size, 4, 1, p_file);
-    fwrite("WAVE", 1, 4, p_file);
+    Uint8 header[44];
+    size_t at = 0;
+    auto put = [&header, &at](const void* p_field, size_t p_size) {
+        std::memcpy(header + at, p_field, p_size);
+        at += p_size;
+    };
+    put("RIFF", 4);
+    put(&chunk_size, 4);
+    put("WAVE", 4);
 
-    fwrite("fmt ", 1, 4, p_file);
+    put("fmt ", 4);
     Uint32 subchunk1_size = 16;
-    fwrite(&subchunk1_size, 4, 1, p_file);
-    fwrite(&audio_format, 2, 1, p_file);
-    fwrite(&num_channels, 2, 1, p_file);
-    fwrite(&sample_rate, 4, 1, p_file);
-    fwrite(&byte_rate, 4, 1, p_file);
-    fwrite(&block_align, 2, 1, p_file);
-    fwrite(&bits_per_sample, 2, 1, p_file);
-
-    fwrite("data", 1, 4, p_file);
-    fwrite(&p_data, 4, 1, p_file);
+    put(&subchunk1_size, 4);
+    put(&audio_format, 2);
+    put(&num_channels, 2);
+    put(&sample_rate, 4);
+    put(&byte_rate, 4);
+    put(&block_align, 2);
+    put(&bits_per_sample, 2);
+
+    put("data", 4);
+    put(&p_data, 4);
+
+    if (wav_file) {
+        fseek(wav_file, 0, SEEK_SET);
+        fwrite(header, 1, sizeof(header), wav_file);
+    } else {
+        sealed_wav.write(0, header, sizeof(header));
+    }
 }
@@ -23,36 +23,39 @@ bool text_manager::init() {
     return true;
 }
 
-bool text_manager::load_font(
+asset_handle text_manager::load_font(
     const std::string& p_path, 
     const std::string& p_name, 
     int p_def_ptsize) { 
-    if (font_cache.find(p_name) != font_cache.end()) {
+    if (font_cache.valid(font_cache.find(p_name))) {
         SDL_Log("Font %s already loaded", p_name.c_str());
-        return false;
+        return INVALID_ASSET_HANDLE;
     }
 
     ttf_font font = {p_path.c_str(), NULL, p_def_ptsize};
     font.font = TTF_OpenFont(font.path, p_def_ptsize);
     if (!font.font) {
         SDL_Log("COULDN'T LOAD FONT: %s", SDL_GetError());
-        return false;
+        return INVALID_ASSET_HANDLE;
     }
 
-    font_cache[p_name] = font;
-    return true;
+    return font_cache.insert(p_name, font);
 }
 
-ttf_font* text_manager::get_font(const std::string& p_name) {
-    auto it = font_cache.find(p_name);
-    return (it != font_cache.end()) ? &it->second : nullptr;
+asset_handle text_manager::find_font(const std::string& p_name) const {
+    return font_cache.find(p_name);
 }
 
-std::string text_manager::generate_cache_key(const std::string& p_font_name,
+ttf_font* text_manager::get_font(asset_handle p_font) {
+    return font_cache.get(p_font);
+}
+
+std::string text_manager::generate_cache_key(asset_handle p_font,
                                             const char* p_text,
                                             float p_ptsize,
                                             const SDL_Color p_color) const {
-    return p_font_name + "|" + p_text + "|" + 
+    // Generation is part of the key so a reloaded slot never hits a stale texture
+    return std::to_string(p_font.index) + ":" + std::to_string(p_font.generation) + "|" + p_text + "|" + 
         std::to_string(static_cast<int>(p_ptsize)) + "|" +
         std::to_string(p_color.r) + "," +
         std::to_string(p_color.g) + "," +
@@ -61,7 +64,7 @@ std::string text_manager::generate_cache_key(const std::string& p_font_name,
 }
 
 void text_manager::render_text(SDL_Renderer* p_renderer,
-                               const std::string& p_font_name,
+                               asset_handle p_font,
                                const std::string& p_text,
                                float ptsize,
                                const SDL_Color p_color,
@@ -70,7 +73,7 @@ void text_manager::render_text(SDL_Renderer* p_renderer,
                                const SDL_FPoint* p_center,
                                SDL_FlipMode p_flip,
                                bool p_shadow_outline) {
-    ttf_font* font = get_font(p_font_name);
+    ttf_font* font = get_font(p_font);
     if (!font) return;
 
     TTF_SetFontSize(font->font, static_cast<int>(ptsize));
@@ -100,7 +103,7 @@ void text_manager::render_text(SDL_Renderer* p_renderer,
         // Create font cache key
         const std::string cache_key = 
             generate_cache_key(
-                p_font_name, p_text.c_str(), 
+                p_font, p_text.c_str(), 
                 ptsize, 
                 color
             );
@@ -148,7 +151,7 @@ void text_manager::render_text(SDL_Renderer* p_renderer,
     }
 }
 
-void text_manager::queue_text(const std::string& p_font_name,
+void text_manager::queue_text(asset_handle p_font,
                             const std::string& p_text,
                             float p_ptsize,
                             const SDL_Color p_color,
@@ -157,7 +160,7 @@ void text_manager::queue_text(const std::string& p_font_name,
                             const SDL_FPoint* p_center,
                             SDL_FlipMode p_flip) {
     render_queue.push_back({
-        p_font_name, 
+        p_font, 
         p_text, 
         p_ptsize, 
         p_color, 
@@ -172,14 +175,14 @@ void text_manager::render_queued_text(SDL_Renderer* p_renderer) {
     // Sort by font/size/color to minimize state changes
     std::sort(render_queue.begin(), render_queue.end(),
         [](const text_render_request& a, const text_render_request& b) {
-            return std::tie(a.font_name, a.ptsize, a.color.r, a.color.g, a.color.b, a.color.a) <
-                   std::tie(b.font_name, b.ptsize, b.color.r, b.color.g, b.color.b, b.color.a);
+            return std::tie(a.font.index, a.ptsize, a.color.r, a.color.g, a.color.b, a.color.a) <
+                   std::tie(b.font.index, b.ptsize, b.color.r, b.color.g, b.color.b, b.color.a);
         });
 
     // Render in batches
     for (const auto& request : render_queue) {
         render_text(p_renderer, 
-                    request.font_name, 
+                    request.font, 
                     request.text.c_str(),
                     request.ptsize, 
                     request.color, 
@@ -192,12 +195,12 @@ void text_manager::render_queued_text(SDL_Renderer* p_renderer) {
     render_queue.clear();
 }
 
-SDL_Rect text_manager::get_text_size(const std::string& p_font_name,
+SDL_Rect text_manager::get_text_size(asset_handle p_font,
                                     const std::string& p_text,
                                     float p_ptsize,
                                     int p_max_width,
                                     bool shadow) {
-    ttf_font* font = get_font(p_font_name);
+    ttf_font* font = get_font(p_font);
     if (!font) return {0, 0, 0, 0};
 
     int w;
@@ -223,12 +226,12 @@ void text_manager::quit() {
     text_texture_cache.clear();
     
     // Then clear fonts
-    for (auto& [name, font] : font_cache) {
+    font_cache.for_each([](std::string_view, ttf_font& font) {
         if (font.font) {
             TTF_CloseFont(font.font);
             font.font = nullptr;
         }
-    }
+    });
     font_cache.clear();
     
     TTF_Quit();
@@ -0,0 +1,51 @@
+#include "util/llm/tokenizer.hpp"
+#include <cctype>
+
+size_t count_tokens(std::string_view p_text) {
+    size_t tokens = 0;
+    size_t i = 0;
+    const size_t n = p_text.size();
+
+    while (i < n) {
+        unsigned char c = static_cast<unsigned char>(p_text[i]);
+
+        if (std::isspace(c)) {
+            i++;
+            continue;
+        }
+
+        if (std::isalpha(c)) {
+            size_t start = i;
+            while (i < n && std::isalpha(static_cast<unsigned char>(p_text[i]))) {
+                i++;
+            }
+            size_t len = i - start;
+            tokens += 1 + (len > 6 ? (len - 3) / 4 : 0);
+            continue;
+        }
+
+        if (std::isdigit(c)) {
+            size_t start = i;
+            while (i < n && std::isdigit(static_cast<unsigned char>(p_text[i]))) {
+                i++;
+            }
+            tokens += (i - start + 2) / 3;
+            continue;
+        }
+
+        if (c >= 0x80) {
+            // One token per code point, skip the continuation bytes
+            i++;
+            while (i < n && (static_cast<unsigned char>(p_text[i]) & 0xC0) == 0x80) {
+                i++;
+            }
+            tokens++;
+            continue;
+        }
+
+        tokens++; // Punctuation / symbols
+        i++;
+    }
+
+    return tokens;
+}
@@ -0,0 +1,363 @@
+#include "util/asr/transcriber.hpp"
+#include "util/sealed_file.hpp"
+#include "util/tools.hpp"
+#include <SDL3/SDL_log.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+namespace {
+
+// Single quote a path for /bin/sh
+std::string shell_quote(const std::string& p_arg) {
+    std::string out = "'";
+    for (char c : p_arg) {
+        if (c == '\'') {
+            out += "'\\''";
+        } else {
+            out += c;
+        }
+    }
+    return out + "'";
+}
+
+std::string trim(const std::string& p_str) {
+    size_t begin = p_str.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    size_t end = p_str.find_last_not_of(" \t\r\n");
+    return p_str.substr(begin, end - begin + 1);
+}
+
+} // namespace
+
+std::string transcript::text() const {
+    std::string out;
+    for (const auto& segment : segments) {
+        std::string piece = trim(segment.text);
+        if (piece.empty()) {
+            continue;
+        }
+        if (!out.empty()) {
+            out += ' ';
+        }
+        out += piece;
+    }
+    return out;
+}
+
+std::string format_timestamp(int64_t p_ms) {
+    char buff[32];
+    snprintf(buff, sizeof(buff), "%02lld:%02lld:%02lld.%03lld",
+             static_cast<long long>(p_ms / 3600000),
+             static_cast<long long>(p_ms / 60000 % 60),
+             static_cast<long long>(p_ms / 1000 % 60),
+             static_cast<long long>(p_ms % 1000));
+    return buff;
+}
+
+void load_asr_environment(transcriber_config& p_config) {
+    if (const char* model = std::getenv("AVA_ASR_MODEL")) {
+        p_config.model_path = model;
+    }
+    if (const char* model = std::getenv("AVA_ASR_CASCADE_MODEL")) {
+        p_config.cascade_model_path = model;
+    }
+}
+
+transcriber::transcriber(const transcriber_config& p_config) : cfg(p_config) { }
+
+bool transcriber::decode(const std::string& p_wav_path,
+                         const std::string& p_model_path,
+                         int64_t p_offset_ms,
+                         u_int32_t p_threads,
+                         std::vector<transcript_segment>& p_out,
+                         int64_t p_from_ms,
+                         int64_t p_duration_ms) const {
+    // -ojf writes <prefix>.json with per segment offsets and per token
+    // probabilities (which the cascade runs on). Into a scratch directory of
+    // its own, never next to the recording, decode() runs on several threads
+    char dir_template[] = "/tmp/ava_whisper_XXXXXX";
+    if (!mkdtemp(dir_template)) {
+        SDL_Log("transcriber: couldn't create a scratch directory");
+        return false;
+    }
+    const std::string dir = dir_template;
+    const std::string prefix = dir + "/out";
+
+    std::string cmd =
+        shell_quote(cfg.whisper_path) +
+        " -m " + shell_quote(p_model_path) +
+        " -f " + shell_quote(p_wav_path) +
+        " -t " + std::to_string(p_threads) +
+        " -ojf -of " + shell_quote(prefix) +
+        " --no-prints";
+    if (cfg.beam_size > 0) {
+        cmd += " -bs " + std::to_string(cfg.beam_size);
+    }
+    if (cfg.best_of > 0) {
+        cmd += " -bo " + std::to_string(cfg.best_of);
+    }
+    if (p_duration_ms > 0) {
+        cmd += " -ot " + std::to_string(p_from_ms) + " -d " + std::to_string(p_duration_ms);
+    }
+
+    std::string log = run_command(cmd.c_str());
+
+    std::error_code ec;
+    std::ifstream file(prefix + ".json");
+    if (!file) {
+        SDL_Log("transcriber: whisper produced no output for %s\n%s", p_wav_path.c_str(), log.c_str());
+        std::filesystem::remove_all(dir, ec);
+        return false;
+    }
+
+    try {
+        json j = json::parse(file);
+        for (const auto& segment : j.at("transcription")) {
+            // Special tokens ([_BEG_], [_TT_xxx]...) carry no information about the text
+            float sum = 0.0f;
+            int count = 0;
+            for (const auto& token : segment.value("tokens", json::array())) {
+                if (token.value("text", "").starts_with("[_")) {
+                    continue;
+                }
+                sum += token.value("p", 1.0f);
+                count++;
+            }
+
+            p_out.push_back({
+                p_offset_ms + segment.at("offsets").at("from").get<int64_t>(),
+                p_offset_ms + segment.at("offsets").at("to").get<int64_t>(),
+                segment.at("text").get<std::string>(),
+                count ? sum / count : 1.0f
+            });
+        }
+    } catch (const std::exception& e) {
+        SDL_Log("transcriber: bad whisper JSON for %s: %s", p_wav_path.c_str(), e.what());
+        file.close();
+        std::filesystem::remove_all(dir, ec);
+        return false;
+    }
+
+    file.close();
+    std::filesystem::remove_all(dir, ec);
+
+    return true;
+}
+
+bool transcriber::decode_piece(const std::string& p_wav_path,
+                               int64_t p_offset_ms,
+                               u_int32_t p_threads,
+                               std::vector<transcript_segment>& p_out) const {
+    if (!decode(p_wav_path, cfg.model_path, p_offset_ms, p_threads, p_out)) {
+        return false;
+    }
+
+    if (!cfg.cascade_model_path.empty()) {
+        refine(p_wav_path, p_offset_ms, p_threads, p_out);
+    }
+
+    return true;
+}
+
+void transcriber::refine(const std::string& p_wav_path,
+                         int64_t p_offset_ms,
+                         u_int32_t p_threads,
+                         std::vector<transcript_segment>& p_segments) const {
+    std::vector<transcript_segment> out;
+    out.reserve(p_segments.size());
+
+    int64_t total_ms = 0;
+    int64_t refined_ms = 0;
+
+    size_t i = 0;
+    while (i < p_segments.size()) {
+        total_ms += p_segments[i].to_ms - p_segments[i].from_ms;
+
+        if (p_segments[i].confidence >= cfg.cascade_threshold) {
+            out.push_back(std::move(p_segments[i++]));
+            continue;
+        }
+
+        // Merge neighbouring unsure segments into one span so the big model gets context
+        size_t run_end = i + 1;
+        while (run_end < p_segments.size() && p_segments[run_end].confidence < cfg.cascade_threshold) {
+            total_ms += p_segments[run_end].to_ms - p_segments[run_end].from_ms;
+            run_end++;
+        }
+
+        // whisper's -ot/-d work on the file's own timeline
+        int64_t from = std::max<int64_t>(0, p_segments[i].from_ms - p_offset_ms - cfg.cascade_pad_ms);
+        int64_t to = p_segments[run_end - 1].to_ms - p_offset_ms + cfg.cascade_pad_ms;
+
+        std::vector<transcript_segment> redo;
+        if (decode(p_wav_path, cfg.cascade_model_path, p_offset_ms, p_threads, redo, from, to - from) && !redo.empty()) {
+            refined_ms += to - from;
+            for (auto& segment : redo) {
+                out.push_back(std::move(segment));
+            }
+        } else {
+            // Keep the fast result rather than lose the span
+            for (size_t k = i; k < run_end; k++) {
+                out.push_back(std::move(p_segments[k]));
+            }
+        }
+
+        i = run_end;
+    }
+
+    if (refined_ms > 0) {
+        SDL_Log("transcriber: cascade re-decoded %lld of %lld ms in %s",
+                static_cast<long long>(refined_ms), 
+                static_cast<long long>(total_ms), 
+                p_wav_path.c_str());
+    }
+
+    p_segments = std::move(out);
+}
+
+std::string transcriber::signature() const {
+    return "model=" + cfg.model_path +
+           ";cascade=" + cfg.cascade_model_path + "@" + std::to_string(cfg.cascade_threshold) +
+           ";beam=" + std::to_string(cfg.beam_size) + "," + std::to_string(cfg.best_of) +
+           ";batch=" + std::to_string(cfg.batch_threshold_ms) +
+           ";vad=" + std::to_string(cfg.vad.frame_ms) + "," +
+                     std::to_string(cfg.vad.min_pause_ms) + "," +
+                     std::to_string(cfg.vad.target_segment_ms) + "," +
+                     std::to_string(cfg.vad.max_segment_ms) + "," +
+                     std::to_string(cfg.vad.threshold_scale) + "," +
+                     std::to_string(cfg.vad.drop_silent);
+}
+
+transcript transcriber::transcribe_file(const std::string& p_path) {
+    pcm_buffer pcm;
+    if (!read_wav(p_path, pcm)) {
+        return {};
+    }
+
+    // whisper can't read a sealed recording, it gets a scratch copy instead
+    return run(pcm, is_sealed(p_path) ? "" : p_path);
+}
+
+transcript transcriber::transcribe(const pcm_buffer& p_pcm) {
+    return run(p_pcm, "");
+}
+
+transcript transcriber::run(const pcm_buffer& p_pcm, const std::string& p_source_path) {
+    std::string key;
+    if (cfg.use_cache) {
+        key = transcript_cache::make_key(p_pcm, signature());
+        transcript cached;
+        if (results.lookup(key, cached)) {
+            return cached;
+        }
+    }
+
+    transcript result;
+    if (pcm_duration_ms(p_pcm) < cfg.batch_threshold_ms) {
+        // Short recordings go straight to whisper in one piece
+        std::string path = p_source_path;
+        if (path.empty()) {
+            char name[] = "/tmp/ava_asr_XXXXXX.wav";
+            int fd = mkstemps(name, 4);
+            if (fd < 0) {
+                SDL_Log("transcriber: couldn't create scratch WAV");
+                return result;
+            }
+            close(fd);
+            path = name;
+
+            if (!write_wav(path, p_pcm, 0, p_pcm.samples.size())) {
+                std::filesystem::remove(path);
+                return result;
+            }
+        }
+
+        u_int32_t threads = cfg.threads_per_job ? cfg.threads_per_job : std::max(1u, std::thread::hardware_concurrency());
+        result.ok = decode_piece(path, 0, threads, result.segments);
+
+        if (path != p_source_path) {
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+        }
+    } else {
+        result = decode_parallel(p_pcm);
+    }
+
+    if (cfg.use_cache && result.ok) {
+        results.store(key, result);
+    }
+
+    return result;
+}
+
+transcript transcriber::decode_parallel(const pcm_buffer& p_pcm) {
+    transcript result;
+
+    std::vector<audio_span> spans = split_at_pauses(p_pcm, cfg.vad);
+    if (spans.empty()) {
+        result.ok = true; // Nothing but silence
+        return result;
+    }
+
+    // Whisper stops scaling at a handful of threads per process, so past that
+    // point the cores are better spent on more processes
+    const u_int32_t cores = std::max(1u, std::thread::hardware_concurrency());
+    u_int32_t threads = cfg.threads_per_job ? cfg.threads_per_job : std::min(4u, cores);
+    u_int32_t jobs = cfg.jobs ? cfg.jobs : std::max(1u, cores / threads);
+    jobs = std::min<u_int32_t>(jobs, spans.size());
+
+    char dir_template[] = "/tmp/ava_asr_XXXXXX";
+    if (!mkdtemp(dir_template)) {
+        SDL_Log("transcriber: couldn't create a scratch directory");
+        return result;
+    }
+    const std::string dir = dir_template;
+
+    std::vector<std::vector<transcript_segment>> pieces(spans.size());
+    std::vector<char> decoded(spans.size(), 0);
+    std::atomic<size_t> next{0};
+
+    auto worker = [&]() {
+        for (size_t i = next++; i < spans.size(); i = next++) {
+            std::string path = dir + "/seg_" + std::to_string(i) + ".wav";
+            if (!write_wav(path, p_pcm, spans[i].first, spans[i].count)) {
+                continue;
+            }
+            int64_t offset_ms = static_cast<int64_t>(spans[i].first) * 1000 / p_pcm.sample_rate;
+            decoded[i] = decode_piece(path, offset_ms, threads, pieces[i]);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (u_int32_t i = 1; i < jobs; i++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+
+    std::error_code ec;
+    std::filesystem::remove_all(dir, ec);
+
+    // Stitch in recording order
+    result.ok = true;
+    for (size_t i = 0; i < pieces.size(); i++) {
+        result.ok &= decoded[i] != 0;
+        for (auto& segment : pieces[i]) {
+            // Whisper pads the last window, don't let a piece run into the next one
+            segment.to_ms = std::min<int64_t>(segment.to_ms,
+                static_cast<int64_t>(spans[i].first + spans[i].count) * 1000 / p_pcm.sample_rate);
+            result.segments.push_back(std::move(segment));
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,92 @@
+#include "util/asr/transcript_cache.hpp"
+#include "util/asr/transcriber.hpp"
+#include "util/hash.hpp"
+#include "util/sealed_file.hpp"
+#include "json/json.hpp"
+#include <SDL3/SDL_log.h>
+#include <filesystem>
+
+using json = nlohmann::json;
+
+transcript_cache::transcript_cache(const std::string& p_dir, size_t p_capacity)
+    : dir(p_dir), memory(p_capacity) { }
+
+std::string transcript_cache::make_key(const pcm_buffer& p_pcm, const std::string& p_signature) {
+    // Hash the decoded samples rather than the file so header rewrites don't matter
+    uint64_t content = hash64(p_pcm.samples.data(), p_pcm.samples.size() * sizeof(float), p_pcm.sample_rate);
+    return hash_hex(content) + "-" + hash_hex(hash64(p_signature));
+}
+
+bool transcript_cache::lookup(const std::string& p_key, transcript& p_out) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (transcript* hit = memory.get(p_key)) {
+        p_out = *hit;
+        counters.memory_hits++;
+        return true;
+    }
+
+    // Sealed with data_key() when one is set, what was written before that is
+    // read as is and sealed on the spot
+    const std::string path = dir + "/" + p_key + ".json";
+    const seal_key key = data_key();
+    std::string file;
+    if (load_sealed(path, file, key)) {
+        try {
+            json j = json::parse(file);
+            transcript loaded;
+            for (const auto& segment : j.at("segments")) {
+                loaded.segments.push_back({
+                    segment.at("from").get<int64_t>(),
+                    segment.at("to").get<int64_t>(),
+                    segment.at("text").get<std::string>(),
+                    segment.value("confidence", 1.0f)
+                });
+            }
+            loaded.ok = true;
+            if (key.set && !is_sealed(path) && !save_sealed(path, file, key)) {
+                SDL_Log("transcript_cache: couldn't encrypt %s", path.c_str());
+            }
+
+            memory.put(p_key, loaded);
+            p_out = std::move(loaded);
+            counters.disk_hits++;
+            return true;
+        } catch (const std::exception& e) {
+            SDL_Log("transcript_cache: dropping corrupt entry %s: %s", p_key.c_str(), e.what());
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+        }
+    }
+
+    counters.misses++;
+    return false;
+}
+
+void transcript_cache::store(const std::string& p_key, const transcript& p_transcript) {
+    json j;
+    j["segments"] = json::array();
+    for (const auto& segment : p_transcript.segments) {
+        j["segments"].push_back({{"from", segment.from_ms}, {"to", segment.to_ms}, {"text", segment.text}, {"confidence", segment.confidence}});
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    memory.put(p_key, p_transcript);
+    counters.stores++;
+
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+
+    // Written then renamed so a crash never leaves a half written entry behind
+    std::string path = dir + "/" + p_key + ".json";
+    if (!save_sealed(path, j.dump(-1, ' ', false, json::error_handler_t::replace), data_key())) {
+        SDL_Log("transcript_cache: couldn't write %s", path.c_str());
+    }
+}
+
+cache_stats transcript_cache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    cache_stats out = counters;
+    out.memory_entries = memory.size();
+    return out;
+}
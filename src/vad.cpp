@@ -0,0 +1,81 @@
+#include "util/asr/vad.hpp"
+#include <algorithm>
+#include <cmath>
+
+std::vector<audio_span> split_at_pauses(const pcm_buffer& p_pcm, const vad_config& p_config) {
+    std::vector<audio_span> spans;
+
+    const size_t frame_len = std::max<size_t>(1, static_cast<size_t>(p_pcm.sample_rate) * p_config.frame_ms / 1000);
+    const size_t frames = (p_pcm.samples.size() + frame_len - 1) / frame_len;
+    if (frames == 0) {
+        return spans;
+    }
+
+    // Per frame RMS
+    std::vector<float> energy(frames);
+    for (size_t f = 0; f < frames; f++) {
+        size_t begin = f * frame_len;
+        size_t end = std::min(begin + frame_len, p_pcm.samples.size());
+        double sum = 0.0;
+        for (size_t i = begin; i < end; i++) {
+            sum += p_pcm.samples[i] * p_pcm.samples[i];
+        }
+        energy[f] = static_cast<float>(std::sqrt(sum / (end - begin)));
+    }
+
+    // Noise floor = 10th percentile of frame energy, so it adapts to the room/mic
+    std::vector<float> sorted = energy;
+    std::nth_element(sorted.begin(), sorted.begin() + frames / 10, sorted.end());
+    const float threshold = std::max(sorted[frames / 10] * p_config.threshold_scale, 1e-4f);
+
+    const size_t min_pause = std::max<u_int32_t>(1, p_config.min_pause_ms / p_config.frame_ms);
+    const size_t target = std::max<u_int32_t>(1, p_config.target_segment_ms / p_config.frame_ms);
+    const size_t max_len = std::max<size_t>(target, p_config.max_segment_ms / p_config.frame_ms);
+
+    size_t seg_start = 0;
+    size_t run_start = frames; // frames == "not in a pause"
+    bool voiced = false;
+
+    auto cut = [&](size_t p_frame) {
+        if (voiced || !p_config.drop_silent) {
+            size_t first = seg_start * frame_len;
+            size_t last = std::min(p_frame * frame_len, p_pcm.samples.size());
+            spans.push_back({first, last - first});
+        }
+        seg_start = p_frame;
+        voiced = false;
+    };
+
+    for (size_t f = 0; f < frames; f++) {
+        if (energy[f] < threshold) {
+            if (run_start == frames) {
+                run_start = f;
+            }
+        } else {
+            if (run_start != frames) {
+                size_t run_len = f - run_start;
+                size_t center = run_start + run_len / 2;
+                if (run_len >= min_pause && center - seg_start >= target) {
+                    cut(center);
+                }
+                run_start = frames;
+            }
+            voiced = true;
+        }
+
+        if (f + 1 - seg_start >= max_len) {
+            // Nobody paused long enough, cut at the quietest frame in the back half
+            auto begin = energy.begin() + seg_start + target / 2;
+            auto end = energy.begin() + f + 1;
+            cut(static_cast<size_t>(std::min_element(begin, end) - energy.begin()) + 1);
+            run_start = frames;
+            voiced = true; // Conservative, the tail we carried over may contain speech
+        }
+    }
+
+    if (seg_start < frames) {
+        cut(frames);
+    }
+
+    return spans;
+}
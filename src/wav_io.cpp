@@ -0,0 +1,143 @@
+#include "util/asr/wav_io.hpp"
+#include "util/sealed_file.hpp"
+#include <SDL3/SDL_log.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <span>
+
+namespace {
+
+u_int16_t read_u16(const u_int8_t* p) { return p[0] | (p[1] << 8); }
+u_int32_t read_u32(const u_int8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<u_int32_t>(p[3]) << 24); }
+
+float sample_to_float(const u_int8_t* p, u_int16_t p_format, u_int16_t p_bits) {
+    if (p_format == 3 && p_bits == 32) {
+        float f;
+        std::memcpy(&f, p, sizeof(f));
+        return f;
+    }
+
+    switch (p_bits) {
+        case 8:  return (static_cast<int>(p[0]) - 128) / 128.0f;
+        case 16: return static_cast<int16_t>(read_u16(p)) / 32768.0f;
+        case 24: return static_cast<int32_t>((p[0] << 8) | (p[1] << 16) | (static_cast<u_int32_t>(p[2]) << 24)) / 2147483648.0f;
+        case 32: return static_cast<int32_t>(read_u32(p)) / 2147483648.0f;
+        default: return 0.0f;
+    }
+}
+
+} // namespace
+
+bool read_wav(const std::string& p_path, pcm_buffer& p_out) {
+    // Recordings are sealed when data_key() is set
+    std::string contents;
+    if (!load_sealed(p_path, contents, data_key())) {
+        SDL_Log("read_wav: couldn't open %s", p_path.c_str());
+        return false;
+    }
+    std::span<const u_int8_t> bytes(reinterpret_cast<const u_int8_t*>(contents.data()), contents.size());
+
+    if (bytes.size() < 12 || std::memcmp(bytes.data(), "RIFF", 4) || std::memcmp(bytes.data() + 8, "WAVE", 4)) {
+        SDL_Log("read_wav: %s is not a RIFF/WAVE file", p_path.c_str());
+        return false;
+    }
+
+    u_int16_t format = 0, channels = 0, bits = 0;
+    u_int32_t rate = 0;
+    const u_int8_t* data = nullptr;
+    size_t data_len = 0;
+
+    // Walk the chunk list, fmt and data can be anywhere after the header
+    size_t pos = 12;
+    while (pos + 8 <= bytes.size()) {
+        const u_int8_t* id = bytes.data() + pos;
+        size_t len = read_u32(id + 4);
+        size_t body = pos + 8;
+        size_t avail = std::min(len, bytes.size() - body);
+
+        if (!std::memcmp(id, "fmt ", 4) && avail >= 16) {
+            format   = read_u16(id + 8);
+            channels = read_u16(id + 10);
+            rate     = read_u32(id + 12);
+            bits     = read_u16(id + 22);
+            if (format == 0xFFFE && avail >= 26) { // WAVE_FORMAT_EXTENSIBLE, real tag is in the sub-format GUID
+                format = read_u16(id + 32);
+            }
+        } else if (!std::memcmp(id, "data", 4)) {
+            data = bytes.data() + body;
+            // Recordings that were cut off before the header got patched report 0, use what's there
+            data_len = (len == 0 || len > avail) ? bytes.size() - body : len;
+        }
+
+        pos = body + len + (len & 1);
+    }
+
+    if (!data || channels == 0 || rate == 0 || (format != 1 && format != 3) || bits % 8) {
+        SDL_Log("read_wav: unsupported WAV layout in %s (fmt %u, %u bits)", p_path.c_str(), format, bits);
+        return false;
+    }
+
+    size_t frame_bytes = channels * (bits / 8);
+    size_t frames = data_len / frame_bytes;
+
+    p_out.sample_rate = rate;
+    p_out.samples.resize(frames);
+    for (size_t i = 0; i < frames; i++) {
+        const u_int8_t* frame = data + i * frame_bytes;
+        float sum = 0.0f;
+        for (u_int16_t c = 0; c < channels; c++) {
+            sum += sample_to_float(frame + c * (bits / 8), format, bits);
+        }
+        p_out.samples[i] = sum / channels;
+    }
+
+    return true;
+}
+
+bool write_wav(const std::string& p_path,
+               const pcm_buffer& p_pcm,
+               size_t p_first,
+               size_t p_count) {
+    p_first = std::min(p_first, p_pcm.samples.size());
+    p_count = std::min(p_count, p_pcm.samples.size() - p_first);
+
+    FILE* file = fopen(p_path.c_str(), "wb");
+    if (!file) {
+        SDL_Log("write_wav: couldn't open %s", p_path.c_str());
+        return false;
+    }
+
+    u_int32_t data_len = static_cast<u_int32_t>(p_count * 2);
+    u_int32_t chunk_size = 36 + data_len;
+    u_int32_t fmt_size = 16;
+    u_int16_t audio_format = 1;
+    u_int16_t num_channels = 1;
+    u_int32_t byte_rate = p_pcm.sample_rate * 2;
+    u_int16_t block_align = 2;
+    u_int16_t bits_per_sample = 16;
+
+    fwrite("RIFF", 1, 4, file);
+    fwrite(&chunk_size, 4, 1, file);
+    fwrite("WAVE", 1, 4, file);
+    fwrite("fmt ", 1, 4, file);
+    fwrite(&fmt_size, 4, 1, file);
+    fwrite(&audio_format, 2, 1, file);
+    fwrite(&num_channels, 2, 1, file);
+    fwrite(&p_pcm.sample_rate, 4, 1, file);
+    fwrite(&byte_rate, 4, 1, file);
+    fwrite(&block_align, 2, 1, file);
+    fwrite(&bits_per_sample, 2, 1, file);
+    fwrite("data", 1, 4, file);
+    fwrite(&data_len, 4, 1, file);
+
+    std::vector<int16_t> out(p_count);
+    for (size_t i = 0; i < p_count; i++) {
+        float s = std::clamp(p_pcm.samples[p_first + i], -1.0f, 1.0f);
+        out[i] = static_cast<int16_t>(s * 32767.0f);
+    }
+    bool ok = fwrite(out.data(), sizeof(int16_t), out.size(), file) == out.size();
+    fclose(file);
+
+    return ok;
+}